@@ -4,6 +4,8 @@
 #define AV_PROGRESS_BAR_H
 
 #include "TaskProgressBar.h"
+#include "ProgressRenderer.h"
+#include "JobTelemetry.h"
 
 class XExec;
 
@@ -14,16 +16,15 @@ class AVProgressBar : public TaskProgressBar
 {
 protected:
     /// 进度状态结构，用于线程间共享
+    /// 除邮箱外的字段在进程启动前设置，之后只读
     struct AVProgressState
     {
-        std::mutex  mutex;
-        double      currentTime  = 0.0;  ///< 当前处理时间（秒）
-        double      clipDuration = 0.0;  ///< 剪切片段时长（秒），0表示使用总时长
-        double      startTime    = 0.0;  ///< 开始时间（用于剪切）
-        std::string displayTime;         ///< 显示时间字符串
-        std::string speed;               ///< 处理速度
-        std::string timeRange;           ///< 时间范围显示
-        bool        hasProgress = false; ///< 是否有新的进度信息
+        double                clipDuration = 0.0;   ///< 剪切片段时长（秒），0表示使用总时长
+        double                startTime    = 0.0;   ///< 开始时间（用于剪切）
+        bool                  interactive  = false; ///< 命令带播放（ffplay）：暂停播放不算卡死，不做卡死检测
+        std::string           timeRange;            ///< 时间范围显示
+        JobTelemetry::Profile profile;              ///< 遥测分组信息（任务/编码器/预设/分辨率）
+        ProgressMailbox       mailbox;              ///< 解析线程写入最新的 -progress 块，渲染线程读取
     };
 
 public:
@@ -39,16 +40,14 @@ public:
     auto updateProgress(XExec &exec, const std::string_view &taskName,
                         const std::map<std::string, ParameterValue> &inputParams) -> void override;
 
+    auto isStalled() const -> bool override;
+
     /// 供子类调用的辅助方法
 protected:
     /// 开始进度监控
     auto startProgressMonitoring(XExec &exec, const std::shared_ptr<AVProgressState> &progressState,
                                  const std::string_view &srcPath = "", const std::string_view &dstPath = "") -> void;
 
-    /// 解析FFmpeg输出行
-    auto parseFFmpegOutputLine(const std::string &line, double &outTime, std::string &displayTime,
-                               std::string &speed) const -> bool;
-
     /// 时间字符串转秒数
     auto parseTimeToSeconds(const std::string &timeStr) const -> double;
 
@@ -79,6 +78,11 @@ protected:
     auto setProgressState(const std::shared_ptr<AVProgressState> &state, double startTime = 0.0,
                           double clipDuration = 0.0, const std::string &timeRange = "") -> void;
 
+    /// 填写遥测分组信息；未指定 --video_codec 时使用 defaultCodec（需在 setProgressState 之后调用）
+    auto setJobProfile(const std::shared_ptr<AVProgressState> &state, const std::string_view &taskName,
+                       const std::map<std::string, ParameterValue> &inputParams,
+                       const std::string_view &defaultCodec = "-") const -> void;
+
 private:
     class PImpl;
     std::unique_ptr<PImpl> impl_;
@@ -17,6 +17,8 @@ public:
     auto execute(const std::string& command, const std::map<std::string, ParameterValue>& inputParams,
                  std::string& errorMsg, std::string& resultMsg) -> bool override;
 
+    auto clone() const -> XTask::Ptr override;
+
 
 private:
     class PImpl;
@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#ifndef AES_ENGINE_H
+#define AES_ENGINE_H
+
+#include "XConst.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/// \class AesEngine
+/// \brief 进程内整文件 AES 加解密引擎（不经过 ffmpeg 重封装）
+/// 运行时检测 AES-NI，不支持时回退到查表实现；
+/// CTR 与 CBC 解密按大块分给多个线程并行处理，CBC 加密因链式依赖只能串行；
+/// 输入输出均通过内存映射访问。输出与 `openssl enc -aes-*-ctr/-cbc -K <key> -iv <iv>` 字节级一致
+class AesEngine
+{
+public:
+    enum class Mode
+    {
+        CTR,
+        CBC, ///< PKCS#7 填充
+    };
+
+    struct Options
+    {
+        Mode                    mode = Mode::CTR;
+        std::vector<uint8_t>    key;                    ///< 16 / 24 / 32 字节
+        std::array<uint8_t, 16> iv{};                   ///< CTR 为初始计数器块
+        int                     threads   = 0;          ///< 0 表示按CPU核数
+        size_t                  chunkSize = 8ull << 20; ///< 每个线程一次处理的字节数
+    };
+
+    struct Result
+    {
+        uint64_t inputBytes  = 0;
+        uint64_t outputBytes = 0;
+        double   seconds     = 0.0;
+        int      threads     = 1;
+        bool     hardware    = false; ///< 是否使用了 AES-NI
+    };
+
+    /// 进度回调（在调用线程中周期性触发）
+    using ProgressCallback = std::function<void(uint64_t processed, uint64_t total)>;
+
+    AesEngine();
+    ~AesEngine();
+
+public:
+    auto encryptFile(const std::string_view &input, const std::string_view &output, const Options &options,
+                     Result &result, std::string &errorMsg, const ProgressCallback &progress = nullptr) const -> bool;
+
+    auto decryptFile(const std::string_view &input, const std::string_view &output, const Options &options,
+                     Result &result, std::string &errorMsg, const ProgressCallback &progress = nullptr) const -> bool;
+
+    /// 强制使用查表实现（用于对比测试）
+    auto setForceSoftware(bool force) -> void;
+
+public:
+    /// 是否为引擎支持的方法名（aes-128-ctr / aes-256-cbc ...）
+    static auto isNativeMethod(const std::string_view &method) -> bool;
+
+    /// 解析方法名得到模式与密钥长度
+    static auto parseMethod(const std::string_view &method, Mode &mode, size_t &keyBytes) -> bool;
+
+    /// CPU 是否支持 AES-NI
+    static auto hasHardwareAes() -> bool;
+
+    /// 十六进制字符串与字节互转
+    static auto fromHex(const std::string_view &hex, std::vector<uint8_t> &bytes) -> bool;
+
+    static auto toHex(const uint8_t *data, size_t size) -> std::string;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // AES_ENGINE_H
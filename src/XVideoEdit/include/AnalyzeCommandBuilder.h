@@ -14,6 +14,12 @@ public:
     auto validate(const std::map<std::string, ParameterValue> &params, std::string &errorMsg) const -> bool override;
     auto getTitle(const std::map<std::string, ParameterValue> &params) const -> std::string override;
 
+    /// --cached 时直接使用探测缓存生成摘要，不再启动 ffprobe；
+    /// --frame-stats 时流式读取 ffprobe 帧输出，只输出统计摘要
+    auto isInProcess(const std::map<std::string, ParameterValue> &params) const -> bool override;
+    auto run(const std::map<std::string, ParameterValue> &params, std::string &resultMsg, std::string &errorMsg) const
+            -> bool override;
+
 private:
     struct AnalyzeOptions
     {
@@ -25,9 +31,18 @@ private:
         bool        show_programs = false; /// 显示节目信息
         bool        show_chapters = false; /// 显示章节信息
         bool        show_error    = false; /// 显示错误信息
+        bool        cached        = false; /// 使用探测缓存输出摘要
+        bool        keyframes     = false; /// 摘要中包含关键帧索引
+        bool        frame_stats   = false; /// 流式帧级统计
+        std::string frame_table;           /// 二进制帧表输出路径
     };
 
     auto parseOptions(const std::map<std::string, ParameterValue> &params) const -> AnalyzeOptions;
+
+    auto runCachedSummary(const AnalyzeOptions &options, std::string &resultMsg, std::string &errorMsg) const -> bool;
+
+    auto runFrameStats(const AnalyzeOptions &options, const std::map<std::string, ParameterValue> &params,
+                       std::string &resultMsg, std::string &errorMsg) const -> bool;
 };
 
 #endif // ANALYZE_COMMAND_BUILDER_H
@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#ifndef BACKGROUND_JOBS_H
+#define BACKGROUND_JOBS_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// \class BackgroundJobs
+/// \brief 交互界面的后台作业（类似 shell 的 & / jobs / fg / kill / wait）：
+/// 作业在有界的工作线程中执行，不输出进度条，进度汇总为一行状态供提示符显示；
+/// 作业结束后保留到被报告一次为止
+class BackgroundJobs
+{
+public:
+    enum class State
+    {
+        Queued,
+        Running,
+        Succeeded,
+        Failed,
+        Killed
+    };
+
+    struct Job
+    {
+        size_t      id = 0; ///< 从 1 开始，显示为 [id]
+        std::string command;
+        State       state   = State::Queued;
+        double      seconds = 0.0; ///< 运行用时（不含排队）
+        double      percent = -1;  ///< 最近一次进度，未知时为 -1
+        std::string label;         ///< 进度来源的文件名
+        std::string errorMsg;
+    };
+
+    /// 在工作线程中执行作业，返回是否成功
+    using Runner = std::function<bool(std::string &errorMsg)>;
+
+    /// 有作业在运行时大约每秒回调一次，作业结束时立即回调（在状态线程中执行）
+    using StatusCallback = std::function<void()>;
+
+    /// concurrency 为同时执行的作业数，其余排队
+    explicit BackgroundJobs(size_t concurrency = 2);
+
+    /// 终止全部作业并等待工作线程退出
+    ~BackgroundJobs();
+
+    BackgroundJobs(const BackgroundJobs &)            = delete;
+    BackgroundJobs &operator=(const BackgroundJobs &) = delete;
+
+public:
+    auto submit(const std::string &command, const Runner &runner) -> size_t;
+
+    auto setOnStatus(const StatusCallback &callback) -> void;
+
+    /// 所有作业（含已结束尚未报告的）
+    auto list() const -> std::vector<Job>;
+
+    /// 取出已结束尚未报告的作业，并从列表中移除
+    auto takeFinished() -> std::vector<Job>;
+
+    /// 等待作业结束并从列表中移除（fg）；id 为 0 时取最近提交的作业；onTick 每隔 intervalMs 调用一次
+    auto wait(size_t id, Job &job, const std::function<void()> &onTick, int intervalMs, std::string &errorMsg)
+            -> bool;
+
+    /// 等待全部作业结束（wait）
+    auto waitAll(const std::function<void()> &onTick, int intervalMs) -> void;
+
+    /// 排队的作业直接取消；运行中的作业终止其外部进程，进程内的步骤无法中断，会在当前步骤结束后停止
+    auto kill(size_t id, std::string &errorMsg) -> bool;
+
+    /// 排队与运行中的作业数
+    auto activeCount() const -> size_t;
+
+    /// 活动作业的一行概要，如 "后台 [1] 42% a.mp4  [2] 排队"；没有活动作业时为空
+    auto statusLine() const -> std::string;
+
+    /// 单个作业的一行描述，用于 jobs 与结束通知
+    static auto describe(const Job &job) -> std::string;
+
+    static auto stateName(State state) -> const char *;
+
+    /// 作业在进度面板与 XExec 中使用的线程标签（最高位区分于作业服务的编号）
+    static auto threadTag(size_t id) -> uint64_t;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // BACKGROUND_JOBS_H
@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#ifndef BATCH_SCRIPT_H
+#define BATCH_SCRIPT_H
+
+#include "CommandParser.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// \class BatchScript
+/// \brief 批处理脚本：预先解析所有行，按命令行中出现的输入/输出路径推断依赖，
+/// 互不相关的任务并行执行，有依赖的按脚本顺序串行；结束后给出每条命令的耗时
+class BatchScript
+{
+public:
+    struct Command
+    {
+        size_t                       line = 0;        ///< 脚本中的行号（从 1 开始）
+        std::string                  text;
+        CommandParser::ParsedCommand parsed;
+        std::vector<std::string>     inputs;          ///< 规范化后的绝对路径
+        std::vector<std::string>     outputs;
+        std::vector<size_t>          dependsOn;       ///< 必须先完成的命令下标
+        bool                         barrier = false; ///< 非任务命令，与前后所有命令串行
+    };
+
+    struct Result
+    {
+        bool        success = false;
+        bool        skipped = false; ///< 依赖的命令失败，未执行
+        std::string errorMsg;
+        double      startSeconds = 0.0; ///< 相对批处理开始的时间
+        double      seconds      = 0.0;
+    };
+
+    /// 命令是否为任务（任务可以并行；其他内置命令作为屏障）
+    using TaskPredicate = std::function<bool(const CommandParser::ParsedCommand &command)>;
+
+    /// 执行一条命令，可能在多个线程中同时调用
+    using Executor = std::function<bool(const CommandParser::ParsedCommand &command, std::string &errorMsg)>;
+
+    BatchScript();
+    ~BatchScript();
+
+public:
+    /// 读取并解析脚本；空行与 # 开头的行忽略
+    auto load(const std::string &path, const TaskPredicate &isTask, std::string &errorMsg) -> bool;
+
+    /// 按依赖执行，jobs 为最大并行数；全部成功时返回 true
+    auto run(size_t jobs, const Executor &executor) -> bool;
+
+    auto getCommands() const -> const std::vector<Command> &;
+
+    auto getResults() const -> const std::vector<Result> &;
+
+    /// 每条命令的状态、开始时间、耗时与依赖，以及总用时和并行加速比
+    auto formatReport() const -> std::string;
+
+    /// 从参数中取出输入与输出路径：--output/-d/--frame-table 为输出，--keyfile/--keystore 既读又写，
+    /// 其余参数值与位置参数都视为可能的输入（逗号分隔的列表逐项拆开）
+    static auto classifyPaths(const CommandParser::ParsedCommand &command, std::vector<std::string> &inputs,
+                              std::vector<std::string> &outputs) -> void;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // BATCH_SCRIPT_H
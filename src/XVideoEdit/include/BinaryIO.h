@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/// \class BinaryWriter
+/// \brief 小端二进制记录写入器（探测缓存、密钥库、遥测共用的记录格式）
+/// 字符串以 uint16 长度前缀存放，短字节串以 uint8 长度前缀存放
+class BinaryWriter
+{
+public:
+    template <typename T>
+    auto put(const T &value) -> void
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        buffer_.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    auto putString(const std::string &value) -> void
+    {
+        const auto len = std::min<size_t>(value.size(), 0xFFFF);
+        put<uint16_t>(static_cast<uint16_t>(len));
+        buffer_.append(value.data(), len);
+    }
+
+    /// 写入不超过 255 字节的字节串
+    auto putBytes(const std::vector<uint8_t> &bytes) -> void
+    {
+        const auto len = std::min<size_t>(bytes.size(), 0xFF);
+        put<uint8_t>(static_cast<uint8_t>(len));
+        buffer_.append(reinterpret_cast<const char *>(bytes.data()), len);
+    }
+
+    auto data() const -> const std::string &
+    {
+        return buffer_;
+    }
+
+private:
+    std::string buffer_;
+};
+
+/// \class BinaryReader
+/// \brief 带边界检查的二进制记录读取器，越界时返回 false 而不是读到记录之外
+class BinaryReader
+{
+public:
+    explicit BinaryReader(std::string_view data) : data_(data)
+    {
+    }
+
+    template <typename T>
+    auto get(T &value) -> bool
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (pos_ + sizeof(T) > data_.size())
+        {
+            return false;
+        }
+        std::memcpy(&value, data_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    auto getString(std::string &value) -> bool
+    {
+        uint16_t len = 0;
+        if (!get(len) || pos_ + len > data_.size())
+        {
+            return false;
+        }
+        value.assign(data_.data() + pos_, len);
+        pos_ += len;
+        return true;
+    }
+
+    /// 读取 putBytes 写入的字节串，返回的视图指向原始数据
+    auto getBytes(std::string_view &bytes) -> bool
+    {
+        uint8_t len = 0;
+        if (!get(len) || pos_ + len > data_.size())
+        {
+            return false;
+        }
+        bytes = data_.substr(pos_, len);
+        pos_ += len;
+        return true;
+    }
+
+private:
+    std::string_view data_;
+    size_t           pos_ = 0;
+};
+
+#endif // BINARY_IO_H
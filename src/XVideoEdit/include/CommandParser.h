@@ -28,6 +28,9 @@ public:
 public:
     auto parse(const std::string_view& input) -> ParsedCommand;
 
+    /// 解析已由 shell 分好的参数（如 main 的 argv），规则与 parse 相同，值中可以含空格
+    auto parseArgs(const std::vector<std::string>& tokens) -> ParsedCommand;
+
     auto validate(const ParsedCommand& cmd) -> bool;
 
 private:
@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#ifndef CONCAT_COMMAND_BUILDER_H
+#define CONCAT_COMMAND_BUILDER_H
+
+#include "XTask.h"
+
+struct MediaProbeInfo;
+
+/// \class ConcatCommandBuilder
+/// \brief 无损拼接多个片段：并行探测各输入的编码参数，以占总时长最多的参数组合为基准，
+/// 只把不一致的片段并行重新编码为基准格式，最后用 concat 分离器（ffconcat 列表）流复制合并
+class ConcatCommandBuilder : public XTask::ICommandBuilder
+{
+    DECLARE_CREATE(ConcatCommandBuilder)
+
+public:
+    auto build(const std::map<std::string, ParameterValue> &params) const -> std::string override;
+    auto validate(const std::map<std::string, ParameterValue> &params, std::string &errorMsg) const -> bool override;
+    auto getTitle(const std::map<std::string, ParameterValue> &params) const -> std::string override;
+
+    auto isInProcess(const std::map<std::string, ParameterValue> &params) const -> bool override;
+    auto run(const std::map<std::string, ParameterValue> &params, std::string &resultMsg, std::string &errorMsg) const
+            -> bool override;
+
+private:
+    struct ConcatOptions
+    {
+        std::vector<std::string> inputs; /// 按拼接顺序
+        std::string              output;
+        int                      jobs      = 0;     /// 并行探测/重新编码数，0 表示自动
+        bool                     faststart = false; /// MP4快速启动
+    };
+
+    /// 决定能否直接流复制的参数组合
+    struct StreamProfile
+    {
+        std::string videoCodec;
+        std::string videoProfile; ///< 档次不同的片段参数集不同，不能共用一份文件头
+        int         level      = 0;
+        int         hasBFrames = 0;
+        std::string timeBase;
+        std::string extradataHash; ///< 流复制只保留第一个片段的 SPS/PPS，参数集不同的片段必须重新编码
+        std::string pixFmt;
+        int         width  = 0;
+        int         height = 0;
+        double      fps    = 0.0;
+        std::string audioCodec; ///< 空表示没有音频
+        int         sampleRate = 0;
+        int         channels   = 0;
+
+        auto key() const -> std::string;
+        auto describe() const -> std::string;
+    };
+
+    auto parseOptions(const std::map<std::string, ParameterValue> &params, ConcatOptions &options,
+                      std::string &errorMsg) const -> bool;
+
+    static auto profileOf(const MediaProbeInfo &info) -> StreamProfile;
+
+    /// 把一个片段重新编码为与基准一致的格式
+    static auto conformCommand(const std::string &input, const MediaProbeInfo &info, const StreamProfile &target,
+                               const std::string &output) -> std::string;
+};
+
+#endif // CONCAT_COMMAND_BUILDER_H
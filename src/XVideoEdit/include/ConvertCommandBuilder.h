@@ -14,6 +14,19 @@ public:
     auto validate(const std::map<std::string, ParameterValue> &params, std::string &errorMsg) const -> bool override;
     auto getTitle(const std::map<std::string, ParameterValue> &params) const -> std::string override;
 
+public:
+    /// 智能封装：源流已满足目标编码/码率/分辨率/帧率时，该类流改为流复制
+    struct StreamPlan
+    {
+        bool        copyVideo = false;
+        bool        copyAudio = false;
+        std::string videoReason; ///< 复制或需要重新编码的原因
+        std::string audioReason;
+    };
+
+    /// 按探测缓存中的源信息决定各类流是否复制（--remux false 时全部重新编码）
+    auto planStreams(const std::map<std::string, ParameterValue> &params) const -> StreamPlan;
+
 private:
     struct ConvertOptions
     {
@@ -27,12 +40,16 @@ private:
         std::string fps;
         std::string preset;
         std::string crf;
-        bool        faststart = false; /// MP4快速启动
-        bool        overwrite = true;  /// 覆盖输出文件
+        bool        faststart     = false; /// MP4快速启动
+        bool        fragmented    = false; /// 分片MP4，边编码边输出可读片段
+        double      frag_duration = 0.0;   /// 分片时长（秒），0 表示每个关键帧一个分片
+        bool        overwrite     = true;  /// 覆盖输出文件
     };
 
     auto parseOptions(const std::map<std::string, ParameterValue> &params) const -> ConvertOptions;
     auto buildVideoFilters(const ConvertOptions &options) const -> std::string;
+    auto planStreams(const ConvertOptions &options, const std::map<std::string, ParameterValue> &params) const
+            -> StreamPlan;
 };
 
 #endif // CONVERT_COMMAND_BUILDER_H
@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#ifndef COPY_COMMAND_BUILDER_H
+#define COPY_COMMAND_BUILDER_H
+
+#include "XTask.h"
+
+/// \class CopyCommandBuilder
+/// \brief 复制文件或目录（见 FileCopier），按字节显示进度
+class CopyCommandBuilder : public XTask::ICommandBuilder
+{
+    DECLARE_CREATE(CopyCommandBuilder)
+
+public:
+    auto build(const std::map<std::string, ParameterValue> &params) const -> std::string override;
+    auto validate(const std::map<std::string, ParameterValue> &params, std::string &errorMsg) const -> bool override;
+    auto getTitle(const std::map<std::string, ParameterValue> &params) const -> std::string override;
+
+    /// 全部在进程内完成：数据由内核直接搬运，不启动外部命令
+    auto isInProcess(const std::map<std::string, ParameterValue> &params) const -> bool override;
+    auto run(const std::map<std::string, ParameterValue> &params, std::string &resultMsg, std::string &errorMsg) const
+            -> bool override;
+
+private:
+    struct CopyOptions
+    {
+        std::string source;
+        std::string destination;
+        int         jobs        = 0;     /// 并行复制的文件数，0 表示自动
+        bool        overwrite   = false; /// 覆盖已存在的目标
+        bool        reflink     = true;  /// 同一文件系统时使用引用链接
+        bool        preallocate = true;  /// 预分配目标文件空间
+    };
+
+    auto parseOptions(const std::map<std::string, ParameterValue> &params) const -> CopyOptions;
+};
+
+#endif // COPY_COMMAND_BUILDER_H
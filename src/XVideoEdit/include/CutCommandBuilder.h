@@ -30,6 +30,8 @@ private:
         bool        use_copy      = true;
         bool        reencode      = false;
         bool        accurate_seek = false;
+        std::string preset        = "fast"; ///< 重新编码时的预设（auto 为自动调参）
+        std::string crf           = "23";   ///< 重新编码时的 CRF（auto 为自动调参）
     };
 
     auto parseOptions(const std::map<std::string, ParameterValue> &params) const -> CutOptions;
@@ -14,6 +14,11 @@ public:
     auto validate(const std::map<std::string, ParameterValue> &params, std::string &errorMsg) const -> bool override;
     auto getTitle(const std::map<std::string, ParameterValue> &params) const -> std::string override;
 
+    /// aes-* 方法（命令行或密钥文件指定）走进程内 AES 引擎整文件解密
+    auto isInProcess(const std::map<std::string, ParameterValue> &params) const -> bool override;
+    auto run(const std::map<std::string, ParameterValue> &params, std::string &resultMsg, std::string &errorMsg) const
+            -> bool override;
+
 private:
     struct DecryptOptions
     {
@@ -31,9 +36,17 @@ private:
         bool        delete_after_play  = false; ///< 播放后删除解密文件
         bool        play_only          = false; ///< 只播放不解密到文件
         std::string ffplay_args;                ///< ffplay额外参数
+        bool        stream_play        = false; ///< 边解密边播放：ffmpeg 经管道送给 ffplay，不写文件
+        std::string stream_format      = "ts";  ///< 流式播放的封装格式：ts / fmp4
 
         ////////////////// 新增密钥文件参数 ////////////////////////////
         std::string keyfile; ///< 从密钥文件读取参数（可选）
+
+        ////////////////// 密钥库 / 主密钥派生 ////////////////////////////
+        std::string keystore;           ///< 从密钥库按资源ID或KID查找（可选）
+        bool        derive_key = false; ///< 由主密钥派生密钥
+        std::string master_key;         ///< 主密钥，为空时取环境变量
+        std::string asset_id;           ///< 资源ID（默认为输入文件路径）
     };
 
     /// 支持的解密方法
@@ -46,11 +59,24 @@ private:
 
     /// 新增：从密钥文件读取参数
     auto readKeyFromFile(const std::string &keyfile, std::string &key, std::string &kid, std::string &method,
-                         std::string &errorMsg) const -> bool;
+                         std::string &iv, std::string &errorMsg) const -> bool;
 
     /// 新增：解析密钥文件内容
-    auto parseKeyFileContent(const std::string &content, std::string &key, std::string &kid, std::string &method) const
-            -> bool;
+    auto parseKeyFileContent(const std::string &content, std::string &key, std::string &kid, std::string &method,
+                             std::string &iv) const -> bool;
+
+    /// 流式播放管道：ffmpeg -c copy 重封装到 stdout，ffplay 从 stdin 读取
+    auto buildStreamPlayCommand(const DecryptOptions &options, const std::string &key) const -> std::string;
+
+    /// 是否有已保存的密钥来源（密钥库 / 主密钥 / 密钥文件）
+    auto hasStoredKey(const DecryptOptions &options) const -> bool;
+
+    /// 按 密钥库 > 主密钥派生 > 密钥文件 的优先级读取解密参数
+    auto loadKeyParams(const DecryptOptions &options, std::string &key, std::string &kid, std::string &method,
+                       std::string &iv, std::string &errorMsg) const -> bool;
+
+    /// 解析最终生效的解密方法（密钥文件优先），非原生方法返回空
+    auto resolveNativeMethod(const DecryptOptions &options) const -> std::string;
 };
 
 #endif // DECRYPT_COMMAND_BUILDER_H
@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#ifndef ENCODER_TUNER_H
+#define ENCODER_TUNER_H
+
+#include "XConst.h"
+#include "ISingleton.hpp"
+#include "ParameterValue.h"
+
+#include <vector>
+
+/// \class EncoderTuner
+/// \brief 编码预设自动选择：在源文件中取几个短窗口，并行试编码各 预设/CRF 组合，
+/// 按整批吞吐测量速度（并行窗口共用全部核心，与单个正式编码占满机器的情形相当）与输出码率，选出仍能达到目标速度（或完成期限）的最慢预设。
+/// 测量值按 源编码/分辨率/帧率 + 目标编码器/滤镜 缓存在 .encoder_tune.json，
+/// 目标变化时直接用缓存重新决策，只补测缺少的组合
+class EncoderTuner : public ISingleton<EncoderTuner>
+{
+public:
+    struct Options
+    {
+        std::string              videoCodec = "libx264";
+        std::vector<std::string> presets    = { "veryfast", "faster", "fast", "medium", "slow" }; ///< 由快到慢
+        std::vector<int>         crfs       = { 23 };
+        std::string              videoFilter;               ///< 与正式编码相同的 -vf（缩放对速度影响很大）
+        double                   targetSpeed     = 1.0;     ///< 每个编码至少达到的速度倍数
+        double                   deadlineSeconds = 0.0;     ///< 整段完成期限，>0 时与 targetSpeed 取较严者
+        double                   rangeStart      = 0.0;     ///< 只在该区间内取样（剪切）
+        double                   rangeDuration   = 0.0;     ///< 0 表示到文件末尾
+        int                      windows         = 3;       ///< 取样窗口数（同时运行）
+        double                   windowSeconds   = 4.0;     ///< 每个窗口的时长
+    };
+
+    /// 一个 预设/CRF 组合的测量结果
+    struct Trial
+    {
+        std::string preset;
+        int         crf         = 0;
+        double      speed       = 0.0; ///< 整批吞吐：各窗口媒体时长之和 / 整批墙钟时间
+        double      bitrateKbps = 0.0; ///< 输出视频码率
+        bool        cached      = false;
+    };
+
+    struct Decision
+    {
+        std::string        preset;
+        int                crf           = 23;
+        double             speed         = 0.0;
+        double             bitrateKbps   = 0.0;
+        double             requiredSpeed = 0.0;
+        bool               metTarget     = false; ///< 没有组合达标时为 false，选最快的组合
+        std::vector<Trial> trials;
+    };
+
+    EncoderTuner();
+    ~EncoderTuner() override;
+
+public:
+    /// 设置缓存文件所在目录（默认当前目录）
+    auto setStorageDirectory(const fs::path &dir) -> void;
+
+    auto storageDirectory() const -> fs::path;
+
+    auto tune(const std::string &input, const Options &options, Decision &decision, std::string &errorMsg) -> bool;
+
+    /// 某个输入最近一次的决策（供遥测记录实际使用的预设）
+    auto lastDecision(const std::string &input, Decision &decision) const -> bool;
+
+    /// 清空内存与磁盘缓存
+    auto clear() -> void;
+
+public:
+    /// 解析完成期限："5400"、"90m"、"1.5h"、"01:30:00"
+    static auto parseDeadline(const std::string &text, double &seconds) -> bool;
+
+    static auto formatDecision(const Decision &decision) -> std::string;
+
+    /// 校验任务参数中的 --preset/--crf auto、--target-speed、--deadline
+    static auto validateParams(const std::map<std::string, ParameterValue> &params, std::string &errorMsg) -> bool;
+
+    /// --preset 或 --crf 为 auto 时调参并改写 preset/crf（options 提供编码器、滤镜与取样区间）；
+    /// 调参失败时打印警告并回退到 fallbackPreset/fallbackCrf
+    static auto resolveParams(const std::map<std::string, ParameterValue> &params, Options options,
+                              std::string &preset, std::string &crf, const std::string &fallbackPreset = "fast",
+                              const std::string &fallbackCrf = "23") -> void;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // ENCODER_TUNER_H
@@ -15,6 +15,11 @@ public:
     auto validate(const std::map<std::string, ParameterValue> &params, std::string &errorMsg) const -> bool override;
     auto getTitle(const std::map<std::string, ParameterValue> &params) const -> std::string override;
 
+    /// aes-* 方法走进程内 AES 引擎整文件加密，不经过 ffmpeg
+    auto isInProcess(const std::map<std::string, ParameterValue> &params) const -> bool override;
+    auto run(const std::map<std::string, ParameterValue> &params, std::string &resultMsg, std::string &errorMsg) const
+            -> bool override;
+
 private:
     struct EncryptOptions
     {
@@ -29,6 +34,10 @@ private:
         std::string hmac_key;                      ///< HMAC密钥（如果启用）
         std::string keyfile;                       ///< 密钥保存文件路径（可选）
         std::string kid;                           ///< Key ID（可选）
+        std::string keystore;                      ///< 密钥库路径（可选）
+        bool        derive_key    = false;         ///< 由主密钥派生密钥
+        std::string master_key;                    ///< 主密钥，为空时取环境变量
+        std::string asset_id;                      ///< 资源ID（默认为输出文件路径）
     };
 
     /// 支持的加密方法
@@ -40,7 +49,11 @@ private:
 
     /// 保存密钥到文件
     auto saveKeyToFile(const std::string &key, const std::string &kid, const std::string &method,
-                       const std::string &keyfile) const -> bool;
+                       const std::string &keyfile, const std::string &iv = "") const -> bool;
+
+    /// 写入密钥库（派生密钥只记录 KID 与方法，不保存密钥材料）
+    auto saveKeyToStore(const EncryptOptions &options, const std::string &assetId, const std::string &key,
+                        const std::string &kid, const std::string &iv) const -> bool;
 
     /// 生成密钥文件名（如果未指定）
     auto generateKeyFileName(const std::string &outputFile) const -> std::string;
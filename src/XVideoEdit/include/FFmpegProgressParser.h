@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#ifndef FFMPEG_PROGRESS_PARSER_H
+#define FFMPEG_PROGRESS_PARSER_H
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+/// ffmpeg -progress 输出的一个完整块（以 progress=continue/end 结尾）
+/// 数值字段未出现或为 N/A 时保持 -1
+struct ProgressSnapshot
+{
+    int64_t  frame       = -1;
+    double   fps         = -1.0;
+    double   bitrateKbps = -1.0; ///< bitrate=1234.5kbits/s
+    int64_t  totalSize   = -1;   ///< 已输出字节数
+    int64_t  outTimeUs   = -1;   ///< 已处理到的媒体时间（微秒）
+    int64_t  dupFrames   = -1;
+    int64_t  dropFrames  = -1;
+    double   speed       = -1.0; ///< 处理速度倍数（1.5x → 1.5）
+    bool     ended       = false; ///< progress=end
+    uint64_t sequence    = 0;     ///< 第几个块（从 1 开始）
+
+    auto outTimeSeconds() const -> double
+    {
+        return outTimeUs >= 0 ? outTimeUs / 1e6 : 0.0;
+    }
+};
+
+/// \class FFmpegProgressParser
+/// \brief ffmpeg -progress 协议解析器
+/// 逐行输入 key=value，全程基于 string_view 与 std::from_chars，不分配内存；
+/// 每遇到 progress= 行产出一个 ProgressSnapshot
+class FFmpegProgressParser
+{
+public:
+    using SnapshotCallback = std::function<void(const ProgressSnapshot &snapshot)>;
+
+    FFmpegProgressParser() = default;
+
+public:
+    auto setCallback(const SnapshotCallback &callback) -> void;
+
+    /// 输入一行（可带 \r\n），返回该行是否结束了一个块
+    auto feedLine(std::string_view line) -> bool;
+
+    /// 输入任意数据块，内部按换行切分（不完整的行保留到下次）
+    auto feed(std::string_view chunk) -> size_t;
+
+    /// 最近一个完整的块
+    auto last() const -> const ProgressSnapshot &;
+
+    auto reset() -> void;
+
+public:
+    /// 解析 [-]HH:MM:SS.ffffff 为微秒
+    static auto parseClock(std::string_view text, int64_t &microseconds) -> bool;
+
+private:
+    ProgressSnapshot current_;
+    ProgressSnapshot last_;
+    uint64_t         sequence_ = 0;
+    SnapshotCallback callback_;
+    char             partial_[256] = {}; ///< feed() 跨块的不完整行
+    size_t           partialLen_   = 0;
+};
+
+#endif // FFMPEG_PROGRESS_PARSER_H
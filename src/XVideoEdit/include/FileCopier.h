@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#ifndef FILE_COPIER_H
+#define FILE_COPIER_H
+
+#include "XConst.h"
+
+#include <cstdint>
+#include <vector>
+
+/// \class FileCopier
+/// \brief 大文件/目录复制引擎，数据尽量不经过用户态缓冲
+/// Linux 下按 FICLONE 引用链接 → copy_file_range → sendfile → read/write 依次回退，
+/// 目标先用 fallocate 预分配并写到 .part 临时文件，完成后改名；目录中的文件由多个线程并行复制
+class FileCopier
+{
+public:
+    /// 单个文件实际使用的复制方式
+    enum class Method
+    {
+        Reflink,       ///< 同一文件系统上共享数据块（瞬间完成）
+        CopyFileRange, ///< 内核内复制（部分文件系统/NFS 可下推到服务端）
+        Sendfile,      ///< 内核内复制（旧内核跨文件系统时）
+        ReadWrite,     ///< 用户态缓冲复制
+        Platform,      ///< 平台 API（Windows CopyFileEx）
+    };
+
+    static constexpr size_t METHOD_COUNT = 5;
+
+    struct Options
+    {
+        int      jobs        = 0;           ///< 并行复制的文件数，0 表示按CPU核数（最多 8）
+        bool     overwrite   = false;       ///< 目标已存在时覆盖
+        bool     reflink     = true;        ///< 允许引用链接（目标与源共享数据块）
+        bool     preallocate = true;        ///< 复制前用 fallocate 预分配
+        uint64_t chunkSize   = 64ull << 20; ///< 每次内核复制调用的字节数（决定进度刷新粒度）
+    };
+
+    struct Result
+    {
+        uint64_t                 files                  = 0;  ///< 成功复制的文件数
+        uint64_t                 bytes                  = 0;
+        uint64_t                 failed                 = 0;
+        uint64_t                 directories            = 0;
+        uint64_t                 byMethod[METHOD_COUNT] = {}; ///< 按 Method 统计的文件数
+        double                   seconds                = 0.0;
+        int                      jobs                   = 1;
+        std::vector<std::string> errors;                      ///< 失败文件的错误信息
+    };
+
+    /// 进度回调（在调用线程中周期性触发）
+    using ProgressCallback = std::function<void(uint64_t copied, uint64_t total)>;
+
+public:
+    /// 复制文件或目录。source 为目录时与 cp -r 相同：destination 已存在则复制到其下的同名目录
+    auto copy(const std::string_view &source, const std::string_view &destination, const Options &options,
+              Result &result, std::string &errorMsg, const ProgressCallback &progress = nullptr) const -> bool;
+
+public:
+    static auto methodName(Method method) -> const char *;
+};
+
+#endif // FILE_COPIER_H
@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#ifndef FOLDER_WATCHER_H
+#define FOLDER_WATCHER_H
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// \class FolderWatcher
+/// \brief 热文件夹监视：inotify 等待 IN_CLOSE_WRITE / IN_MOVED_TO，不轮询目录。
+/// 同一文件的连续事件合并为一次；之后文件大小在 stable 时间内不变才认为写完并回调
+class FolderWatcher
+{
+public:
+    struct Directory
+    {
+        std::string              path;
+        std::vector<std::string> extensions; ///< 小写且带点，如 ".mp4"；为空时接受所有文件
+    };
+
+    struct Options
+    {
+        std::vector<Directory>    directories;
+        std::chrono::milliseconds settle{ 500 };  ///< 事件合并窗口
+        std::chrono::milliseconds stable{ 2000 }; ///< 大小保持不变的时间
+    };
+
+    /// path 为就绪文件，directory 为 Options::directories 中的下标
+    using ReadyCallback = std::function<void(const std::string &path, size_t directory)>;
+
+    FolderWatcher();
+    ~FolderWatcher();
+
+public:
+    /// 为所有目录建立监视，目录中已有的文件（如上次停止时未处理的）也会在确认写完后回调
+    auto start(const Options &options, std::string &errorMsg) -> bool;
+
+    /// 阻塞处理事件，直到 stop() 被调用
+    auto run(const ReadyCallback &onReady) -> void;
+
+    /// 唤醒 run 并退出；只写一次 eventfd，可以在信号处理函数中调用
+    auto stop() -> void;
+
+    /// 忽略某个文件的事件（如任务输出写回了监视目录）
+    auto ignore(const std::string &path) -> void;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // FOLDER_WATCHER_H
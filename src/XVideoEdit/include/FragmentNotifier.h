@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#ifndef FRAGMENT_NOTIFIER_H
+#define FRAGMENT_NOTIFIER_H
+
+#include "XConst.h"
+#include "ISingleton.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/// \class FragmentNotifier
+/// \brief 分片 MP4（empty_moov + frag_keyframe）输出的片段跟踪
+/// 编码进行中跟踪输出文件的顶层 box：ftyp+moov 落盘即为初始化段，之后每个 moof+mdat 完整写入就是一个片段。
+/// 扫描由 -progress 的 total_size 增长驱动，不单独轮询
+class FragmentNotifier : public ISingleton<FragmentNotifier>
+{
+public:
+    struct Fragment
+    {
+        std::string path;           ///< 输出文件（规范化绝对路径）
+        size_t      index  = 0;     ///< 0 为初始化段，之后依次为媒体片段
+        uint64_t    offset = 0;     ///< 在文件中的起始偏移
+        uint64_t    size   = 0;     ///< 字节数
+        bool        init   = false; ///< 是否为初始化段（ftyp+moov）
+    };
+
+    FragmentNotifier();
+    ~FragmentNotifier() override;
+
+public:
+    /// 开始跟踪输出文件（编码进程启动后调用）
+    auto watch(const std::string &path) -> void;
+
+    /// 进度回调中调用：totalSize（-progress 的 total_size）增长时扫描新写完的片段；未跟踪的文件直接忽略
+    auto update(const std::string &path, int64_t totalSize) -> void;
+
+    /// 编码结束：最后扫描一次并停止跟踪，返回媒体片段数
+    auto finish(const std::string &path, bool success) -> size_t;
+
+public:
+    /// 从 offset 开始扫描完整的顶层 box，产出完整的片段；offset 推进到最后一个片段之后。
+    /// atEnd 为真时（文件已写完）size 为 0 的 box 视为延伸到文件末尾
+    static auto scan(const std::string &path, uint64_t &offset, size_t &nextIndex, std::vector<Fragment> &fragments,
+                     bool atEnd = false) -> bool;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // FRAGMENT_NOTIFIER_H
@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#ifndef FRAME_STATS_ANALYZER_H
+#define FRAME_STATS_ANALYZER_H
+
+#include "XConst.h"
+
+#include <cstdint>
+
+/// \class FrameStatsAnalyzer
+/// \brief 逐行消费 ffprobe -show_frames 的 compact 输出，常量内存统计帧级指标
+/// 统计项：每秒码率、GOP长度分布、I/P/B帧数、帧大小分位数、最大关键帧间隔；
+/// 可选地把每帧写成紧凑的二进制表（16字节/帧，流式写盘）
+class FrameStatsAnalyzer
+{
+public:
+    /// 二进制帧表的单条记录
+#pragma pack(push, 1)
+    struct FrameRecord
+    {
+        double   pts      = 0.0; ///< 显示时间戳（秒）
+        uint32_t size     = 0;   ///< 压缩后帧大小（字节）
+        char     pictType = '?'; ///< I / P / B / ?
+        uint8_t  keyFrame = 0;
+        uint16_t reserved = 0;
+    };
+#pragma pack(pop)
+
+    struct Summary
+    {
+        uint64_t frames              = 0;
+        uint64_t totalBytes          = 0;
+        uint64_t iFrames             = 0;
+        uint64_t pFrames             = 0;
+        uint64_t bFrames             = 0;
+        uint64_t otherFrames         = 0;
+        double   firstPts            = 0.0;
+        double   lastPts             = 0.0;
+        double   minSecondBps        = 0.0; ///< 每秒码率最小值（bit/s）
+        double   avgSecondBps        = 0.0;
+        double   maxSecondBps        = 0.0;
+        double   peakSecond          = 0.0; ///< 码率峰值所在秒
+        uint64_t gopCount            = 0;
+        uint32_t minGop              = 0;
+        uint32_t maxGop              = 0;
+        double   avgGop              = 0.0;
+        double   maxKeyframeInterval = 0.0; ///< 相邻关键帧最大间隔（秒）
+        uint32_t sizeP50             = 0;
+        uint32_t sizeP90             = 0;
+        uint32_t sizeP99             = 0;
+        uint32_t sizeMax             = 0;
+    };
+
+    FrameStatsAnalyzer();
+    ~FrameStatsAnalyzer();
+
+public:
+    /// 输出二进制帧表（需在第一帧之前调用）
+    auto openFrameTable(const std::string_view &path, std::string &errorMsg) -> bool;
+
+    /// 喂入一行 ffprobe 输出，返回是否为有效帧
+    auto feedLine(std::string_view line) -> bool;
+
+    /// 结束统计（刷新最后一秒/最后一个GOP、关闭帧表）
+    auto finish() -> void;
+
+    auto summary() const -> Summary;
+
+    /// GOP 长度分布（长度, 次数），按长度升序
+    auto gopDistribution() const -> std::vector<std::pair<uint32_t, uint64_t>>;
+
+    /// 格式化为文本摘要
+    auto formatSummary() const -> std::string;
+
+public:
+    /// 生成流式统计所需的 ffprobe 命令
+    static auto buildProbeCommand(const std::string_view &input, const std::string_view &selectStreams = "v:0")
+            -> std::string;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // FRAME_STATS_ANALYZER_H
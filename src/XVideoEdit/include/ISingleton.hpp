@@ -2,6 +2,7 @@
 #define ISINGLE_H
 
 #include <type_traits>
+#include <utility>
 
 template <typename T>
 class ISingleton
@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#ifndef INDEX_COMMAND_BUILDER_H
+#define INDEX_COMMAND_BUILDER_H
+
+#include "XTask.h"
+
+/// \class IndexCommandBuilder
+/// \brief 遍历目录树，并行探测媒体文件并写出列式目录文件（见 MediaCatalog）
+class IndexCommandBuilder : public XTask::ICommandBuilder
+{
+    DECLARE_CREATE(IndexCommandBuilder)
+
+public:
+    auto build(const std::map<std::string, ParameterValue> &params) const -> std::string override;
+    auto validate(const std::map<std::string, ParameterValue> &params, std::string &errorMsg) const -> bool override;
+    auto getTitle(const std::map<std::string, ParameterValue> &params) const -> std::string override;
+
+    /// 全部在进程内完成：探测走 MediaProbeCache，已索引过的文件不会再次调用 ffprobe
+    auto isInProcess(const std::map<std::string, ParameterValue> &params) const -> bool override;
+    auto run(const std::map<std::string, ParameterValue> &params, std::string &resultMsg, std::string &errorMsg) const
+            -> bool override;
+
+private:
+    struct IndexOptions
+    {
+        std::string dir;
+        std::string output    = "media.xcat"; /// 目录文件路径
+        int         jobs      = 0;            /// 并行探测数，0 表示按CPU核数
+        bool        all_files = false;        /// 不按扩展名过滤
+    };
+
+    auto parseOptions(const std::map<std::string, ParameterValue> &params) const -> IndexOptions;
+
+    auto collectFiles(const IndexOptions &options) const -> std::vector<std::string>;
+};
+
+#endif // INDEX_COMMAND_BUILDER_H
@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#ifndef INPUT_PREFETCHER_H
+#define INPUT_PREFETCHER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// \class InputPrefetcher
+/// \brief 排队作业的输入预读：在当前作业运行时，把后续输入的文件头与 MP4 的 moov 区域提前读入页缓存，
+/// 避免 ffmpeg 启动后在冷的网络盘/机械盘上等待首批读取。预读在后台线程中进行，总量受页缓存预算限制
+class InputPrefetcher
+{
+public:
+    struct Options
+    {
+        uint64_t headBytes   = 32ull << 20;  ///< 每个文件预读的文件头字节数
+        uint64_t budgetBytes = 512ull << 20; ///< 已预读但作业尚未开始的字节上限
+        bool     moov        = true;         ///< MP4/MOV 额外预读 moov（未前置时位于文件末尾）
+    };
+
+    /// 文件中的一段
+    struct Range
+    {
+        uint64_t offset = 0;
+        uint64_t length = 0;
+    };
+
+    struct Statistics
+    {
+        size_t   files   = 0; ///< 已预读的文件数
+        size_t   skipped = 0; ///< 因预算不足而跳过的文件数
+        uint64_t bytes   = 0; ///< 累计预读字节
+        uint64_t pending = 0; ///< 当前占用的预算
+    };
+
+    InputPrefetcher();
+    explicit InputPrefetcher(const Options &options);
+    ~InputPrefetcher();
+
+public:
+    /// 请求预读（异步，重复请求会合并）
+    auto prefetch(const std::string &path) -> void;
+
+    /// 作业已开始读取该文件：归还预算；尚未执行的请求直接取消
+    auto release(const std::string &path) -> void;
+
+    /// 等待所有请求处理完（基准测试用）
+    auto waitIdle() -> void;
+
+    auto getStatistics() const -> Statistics;
+
+    /// 计算需要预读的区域：文件头，以及 MP4 顶层 box 中的 moov（只读 box 头，不读 box 内容）
+    static auto plan(const std::string &path, const Options &options, std::vector<Range> &ranges) -> bool;
+
+    /// 对各区域发起预读，返回发起的字节数
+    static auto advise(const std::string &path, const std::vector<Range> &ranges) -> uint64_t;
+
+    /// 从页缓存中丢弃整个文件（基准测试模拟冷缓存）
+    static auto evict(const std::string &path) -> bool;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // INPUT_PREFETCHER_H
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class InputPrefetcher;
+
+/// \class JobScheduler
+/// \brief 有界并发的作业队列：固定数量的工作线程按提交顺序取作业执行，
+/// 超出并发数的作业排队等待，不会同时启动过多的编码进程；
+/// 设置预读器后，队首的若干个作业在等待期间预读其输入文件
+class JobScheduler
+{
+public:
+    /// 作业返回是否成功，失败时填写 errorMsg
+    using Job = std::function<bool(std::string &errorMsg)>;
+
+    struct JobResult
+    {
+        uint64_t    id = 0;
+        std::string label;
+        bool        success = false;
+        std::string errorMsg;
+        double      seconds = 0.0; ///< 执行用时（不含排队）
+    };
+
+    using FinishCallback = std::function<void(const JobResult &result)>;
+
+    struct Statistics
+    {
+        size_t queued    = 0;
+        size_t running   = 0;
+        size_t succeeded = 0;
+        size_t failed    = 0;
+        size_t cancelled = 0; ///< shutdown 时丢弃的排队作业
+    };
+
+    /// concurrency 为 0 时取 CPU 核数
+    explicit JobScheduler(size_t concurrency = 0);
+    ~JobScheduler();
+
+    JobScheduler(const JobScheduler &)            = delete;
+    JobScheduler &operator=(const JobScheduler &) = delete;
+
+public:
+    /// 提交作业，返回作业ID；inputs 为作业要读取的文件，用于预读
+    auto submit(const std::string &label, const Job &job, const std::vector<std::string> &inputs = {}) -> uint64_t;
+
+    /// 排在最前面的 lookahead 个作业的输入交给预读器；作业开始时归还其预算
+    auto setPrefetcher(const std::shared_ptr<InputPrefetcher> &prefetcher, size_t lookahead) -> void;
+
+    /// 作业结束回调（在工作线程中执行）
+    auto setOnFinished(const FinishCallback &callback) -> void;
+
+    /// 等待队列清空且没有运行中的作业
+    auto waitIdle() -> void;
+
+    /// 停止接收作业；drain 为真时执行完排队作业，否则丢弃排队作业，只等待运行中的作业
+    auto shutdown(bool drain = true) -> void;
+
+    auto concurrency() const -> size_t;
+
+    auto getStatistics() const -> Statistics;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // JOB_SCHEDULER_H
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#ifndef JOB_SERVER_H
+#define JOB_SERVER_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+class TaskManager;
+
+/// \class JobServer
+/// \brief 无界面作业服务：在 Unix 域套接字上接收按行分隔的 JSON 请求，任务名与参数同 task 命令，
+/// 作业进入共享的有界工作线程池，进度与结果按行推回提交它的连接。
+/// 所有连接由一个 epoll 线程复用，空闲连接既不占线程也不会被轮询。
+/// 套接字权限为 0600；参数含 shell 特殊字符（$ ` " \ ' ; | & < > 换行）的请求直接拒绝。
+///
+/// 请求（每行一个 JSON 对象，op 缺省为 submit）：
+///   {"op":"submit","id":"a1","task":"cv","params":{"--input":"a.mp4","--output":"b.mp4"}}
+///   {"op":"status"}   {"op":"ping"}
+/// 响应（每行一个 JSON 对象，作业事件都带 job 与请求中的 id）：
+///   accepted / started / progress / finished，status，pong，error
+class JobServer
+{
+public:
+    struct Config
+    {
+        std::string socketPath;
+        size_t      jobs               = 2;        ///< 同时执行的作业数
+        int         progressIntervalMs = 1000;     ///< 进度推送间隔
+        size_t      maxLineBytes       = 64 << 10; ///< 单条请求长度上限，超过则断开连接
+        size_t      maxPendingBytes    = 4 << 20;  ///< 连接待发送数据超过此值时丢弃进度消息（慢客户端）
+    };
+
+    struct Request
+    {
+        std::string                        op = "submit";
+        std::string                        id; ///< 客户端自定义的请求标识，原样回显（非字符串转为 JSON 文本）
+        std::string                        task;
+        std::map<std::string, std::string> params;
+    };
+
+    explicit JobServer(TaskManager &taskManager);
+    ~JobServer();
+
+public:
+    /// 监听并阻塞，直到 Ctrl+C 或 stop()；返回时等待运行中的作业结束，丢弃排队的作业
+    auto run(const Config &config, std::string &errorMsg) -> bool;
+
+    /// 可在信号处理函数中调用
+    auto stop() -> void;
+
+    /// 解析一行请求；params 中的非字符串值转为 JSON 文本，args 数组按 task 命令转为 arg1、arg2 ...
+    static auto parseRequest(const std::string &line, Request &request, std::string &errorMsg) -> bool;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // JOB_SERVER_H
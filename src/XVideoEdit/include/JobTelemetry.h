@@ -0,0 +1,131 @@
+﻿#pragma once
+
+#ifndef JOB_TELEMETRY_H
+#define JOB_TELEMETRY_H
+
+#include "XConst.h"
+#include "ISingleton.hpp"
+#include "FFmpegProgressParser.h"
+
+#include <vector>
+#include <cstdint>
+
+/// 一个采样点；fps/speed/码率未知时为 -1
+struct TelemetrySample
+{
+    float    elapsed     = 0;  ///< 自任务开始的墙钟秒数
+    float    fps         = -1; ///< 编码帧率
+    float    speed       = -1; ///< 速度倍数
+    float    bitrateKbps = -1; ///< 输出码率
+    float    outTime     = 0;  ///< 已处理的媒体秒数
+    uint64_t totalSize   = 0;  ///< 已输出字节
+};
+
+/// 一次任务运行的完整记录
+struct TelemetryRun
+{
+    int64_t                      startTimeMs    = 0; ///< 开始时间（Unix 毫秒）
+    double                       wallSeconds    = 0; ///< 墙钟耗时
+    double                       mediaSeconds   = 0; ///< 待处理媒体时长，未知为0
+    int32_t                      exitCode       = 0;
+    float                        sampleInterval = 0; ///< 降采样后的实际采样间隔（秒）
+    std::string                  task;               ///< convert / cut / encrypt ...
+    std::string                  videoCodec;         ///< 视频编码器（未指定为 "-"）
+    std::string                  preset;             ///< 编码预设（未指定为 "-"）
+    std::string                  resolution;         ///< 输出分辨率（未缩放时为源分辨率）
+    std::string                  source;
+    std::string                  output;
+    std::vector<TelemetrySample> samples;
+
+    /// 采样中 speed 的中位数，没有采样时用 媒体时长/墙钟耗时
+    auto medianSpeed() const -> double;
+
+    auto medianFps() const -> double;
+};
+
+/// \class JobTelemetry
+/// \brief 任务吞吐遥测：按固定间隔记录每个任务的 -progress 快照，结束时追加写入二进制记录文件
+/// 采样点超过上限时两两合并并加倍间隔，长任务的记录大小有界；
+/// 记录文件与探测缓存、历史记录同目录，stats 命令按 任务/编码器/预设/分辨率 汇总中位速度
+class JobTelemetry : public ISingleton<JobTelemetry>
+{
+public:
+    /// 任务描述，用于分组对比
+    struct Profile
+    {
+        std::string task;
+        std::string videoCodec = "-";
+        std::string preset     = "-";
+        std::string resolution = "-";
+        std::string source;
+        std::string output;
+        double      mediaSeconds = 0;
+    };
+
+    /// 一组相同配置的运行汇总
+    struct GroupStats
+    {
+        std::string task;
+        std::string videoCodec;
+        std::string preset;
+        std::string resolution;
+        size_t      runs        = 0; ///< 成功次数
+        size_t      failed      = 0; ///< 失败次数
+        double      medianSpeed = 0; ///< 各次运行 speed 中位数的中位数
+        double      medianFps   = 0;
+        double      medianWall  = 0; ///< 墙钟耗时中位数
+        double      relative    = 0; ///< 相对同任务最快组的速度（0~1）
+    };
+
+    JobTelemetry();
+    ~JobTelemetry() override;
+
+public:
+    /// 设置记录文件所在目录（默认当前目录）
+    auto setStorageDirectory(const fs::path &dir) -> void;
+
+    auto storageDirectory() const -> fs::path;
+
+    auto setEnabled(bool enabled) -> void;
+
+    auto isEnabled() const -> bool;
+
+    /// 初始采样间隔（秒），对之后开始的任务生效
+    auto setSampleInterval(double seconds) -> void;
+
+    auto sampleInterval() const -> double;
+
+    /// 每个任务保留的采样点上限（至少 16）
+    auto setMaxSamples(size_t count) -> void;
+
+    /// 开始记录一个任务，禁用时返回0
+    auto beginJob(const Profile &profile) -> uint64_t;
+
+    /// 在解析线程中调用：未到采样间隔的快照直接丢弃，结束块总会记录
+    auto record(uint64_t id, const ProgressSnapshot &snapshot) -> void;
+
+    /// 任务结束：写入记录文件
+    auto finishJob(uint64_t id, int exitCode) -> void;
+
+    /// 读取全部历史记录（末尾不完整的记录被忽略）
+    auto loadRuns(std::vector<TelemetryRun> &runs, std::string &errorMsg) const -> bool;
+
+    /// 删除记录文件
+    auto clear() -> void;
+
+public:
+    /// 按 任务/编码器/预设/分辨率 分组，只统计成功的运行速度
+    static auto summarize(const std::vector<TelemetryRun> &runs) -> std::vector<GroupStats>;
+
+    static auto formatSummary(const std::vector<GroupStats> &groups) -> std::string;
+
+    /// 导出时间序列为 CSV：每个采样点一行
+    static auto exportCsv(const std::vector<TelemetryRun> &runs, const std::string &path, std::string &errorMsg)
+            -> bool;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // JOB_TELEMETRY_H
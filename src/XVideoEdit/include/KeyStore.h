@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#ifndef KEY_STORE_H
+#define KEY_STORE_H
+
+#include "XConst.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/// \class KeyStore
+/// \brief 单文件密钥库，替代每个资源一个的 *_key.txt
+/// 磁盘上为追加写的二进制记录（带 CRC），打开时顺序扫描一次建立 资源ID / KID 两个哈希索引，
+/// 同一资源的后写记录覆盖先写记录。每条记录写入后立即交给操作系统，
+/// fsync 按批次合并（默认 32 条或 200ms，时限由后台线程保证），进程退出或 sync() 时落盘剩余批次
+class KeyStore
+{
+public:
+    struct Entry
+    {
+        std::string assetId;           ///< 资源标识（默认为加密文件的规范化绝对路径）
+        std::string kid;               ///< Key ID（32 个十六进制字符）
+        std::string method;            ///< 加密方法
+        std::string key;               ///< 密钥（十六进制），派生记录为空
+        std::string iv;                ///< 初始化向量（十六进制，可为空）
+        bool        derived   = false; ///< 密钥由主密钥经 HKDF 派生，库中不保存密钥材料
+        int64_t     createdAt = 0;     ///< 写入时间（Unix 秒）
+    };
+
+    struct SyncPolicy
+    {
+        size_t                    batchRecords = 32;                             ///< 累积多少条记录后 fsync
+        std::chrono::milliseconds maxDelay     = std::chrono::milliseconds(200); ///< 最早未落盘记录的最长等待
+    };
+
+    KeyStore();
+    ~KeyStore();
+
+public:
+    /// 打开（不存在则创建）密钥库并建立索引
+    auto open(const std::string &path, std::string &errorMsg) -> bool;
+
+    /// 落盘剩余批次并关闭
+    auto close() -> void;
+
+    auto isOpen() const -> bool;
+
+    auto path() const -> std::string;
+
+    auto setSyncPolicy(const SyncPolicy &policy) -> void;
+
+    /// 追加一条记录（assetId 必填，kid 为空时由调用方保证可按资源ID查找）
+    auto put(const Entry &entry, std::string &errorMsg) -> bool;
+
+    auto find(const std::string &assetId, Entry &entry) const -> bool;
+
+    auto findByKid(const std::string &kid, Entry &entry) const -> bool;
+
+    /// 立即 fsync 尚未落盘的记录
+    auto sync(std::string &errorMsg) -> bool;
+
+    /// 有效资源数
+    auto size() const -> size_t;
+
+public:
+    /// 按路径共享已打开的密钥库，批量任务中只在首次使用时扫描文件
+    static auto shared(const std::string &path, std::string &errorMsg) -> std::shared_ptr<KeyStore>;
+
+    /// 资源ID：文件的规范化绝对路径
+    static auto assetIdFor(const std::string &file) -> std::string;
+
+    /// 用 HKDF-SHA256 从主密钥派生资源的密钥与 KID（十六进制）。
+    /// IV 不派生：同一资源重复加密必须换用随机 IV，否则 CTR 密钥流会重复
+    static auto derive(const std::vector<uint8_t> &masterKey, const std::string &assetId, size_t keyBytes,
+                       std::string &key, std::string &kid) -> void;
+
+    /// 读取主密钥：值为空时取环境变量 XVE_MASTER_KEY（避免密钥出现在命令历史中）
+    static auto loadMasterKey(const std::string &value, std::vector<uint8_t> &masterKey, std::string &errorMsg)
+            -> bool;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // KEY_STORE_H
@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include "XConst.h"
+
+#include <cstdint>
+
+/// \class MappedFile
+/// \brief 跨平台内存映射文件（POSIX mmap / Windows MapViewOfFile）
+class MappedFile
+{
+public:
+    enum class Advice
+    {
+        Normal,
+        Sequential, ///< 顺序访问，内核可加大预读
+        Random,     ///< 随机访问，关闭预读
+        WillNeed,   ///< 即将访问，提前读入页缓存
+    };
+
+    MappedFile();
+    ~MappedFile();
+    MappedFile(MappedFile &&) noexcept;
+    MappedFile &operator=(MappedFile &&) noexcept;
+
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+public:
+    /// 只读映射已有文件（空文件映射成功但 data() 为 nullptr）
+    auto openRead(const std::string_view &path, std::string &errorMsg) -> bool;
+
+    /// 创建/截断文件到 size 字节并读写映射
+    auto create(const std::string_view &path, uint64_t size, std::string &errorMsg) -> bool;
+
+    /// 解除映射并关闭文件，返回解除映射与关闭是否都成功（写入的文件应在此之前 flush 并检查结果）
+    auto close() -> bool;
+
+    /// 访问模式提示
+    auto advise(Advice advice, uint64_t offset = 0, uint64_t length = 0) const -> void;
+
+    /// 把脏页写回磁盘
+    auto flush() const -> bool;
+
+    auto isOpen() const -> bool;
+
+    auto data() const -> const uint8_t *;
+
+    auto mutableData() -> uint8_t *;
+
+    auto size() const -> uint64_t;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#ifndef MEDIA_CATALOG_H
+#define MEDIA_CATALOG_H
+
+#include "XConst.h"
+
+#include <vector>
+#include <cstdint>
+
+struct MediaProbeInfo;
+
+/// \class MediaCatalog
+/// \brief 列式媒体目录文件（每个字段一列，编解码器/容器名字典编码，整文件可直接 mmap）
+/// 文件布局：文件头 | 列目录 | 各列数据（8字节对齐）
+/// 查询时只映射文件，对参与过滤的列做顺序扫描，不做任何反序列化
+class MediaCatalog
+{
+public:
+    /// 写入目录时的一行
+    struct Row
+    {
+        std::string path;
+        uint64_t    size       = 0;
+        int64_t     mtime      = 0;   ///< 修改时间（秒）
+        double      duration   = 0.0; ///< 时长（秒）
+        int64_t     bitRate    = 0;   ///< 容器码率
+        std::string format;           ///< 容器格式
+        uint32_t    width      = 0;
+        uint32_t    height     = 0;
+        float       fps        = 0.0f;
+        std::string vcodec;
+        std::string acodec;
+        uint32_t    vbitrate   = 0;
+        uint32_t    abitrate   = 0;
+        uint32_t    sampleRate = 0;
+        uint16_t    channels   = 0;
+
+        static auto fromProbe(const std::string_view &path, uint64_t size, int64_t mtime, const MediaProbeInfo &info)
+                -> Row;
+    };
+
+    /// 分组聚合结果
+    struct Group
+    {
+        std::string key;
+        uint64_t    count    = 0;
+        uint64_t    bytes    = 0;
+        double      duration = 0.0;
+    };
+
+    struct QueryOptions
+    {
+        std::string where;     ///< 过滤条件，如 "height>=1080,vcodec=h264,abitrate>192k"
+        std::string groupBy;   ///< 分组列（vcodec/acodec/format/resolution/任意数值列）
+        size_t      limit = 0; ///< 列出前 N 条匹配路径
+    };
+
+    struct QueryResult
+    {
+        uint64_t                 scanned  = 0;
+        uint64_t                 matched  = 0;
+        uint64_t                 bytes    = 0;
+        double                   duration = 0.0;
+        std::vector<Group>       groups; ///< 按 count 降序
+        std::vector<std::string> paths;
+        double                   elapsedMs = 0.0;
+    };
+
+    MediaCatalog();
+    ~MediaCatalog();
+
+public:
+    /// 把行写成目录文件（先写临时文件再重命名）
+    static auto write(const fs::path &path, const std::vector<Row> &rows, std::string &errorMsg) -> bool;
+
+    /// 映射并校验目录文件
+    auto open(const fs::path &path, std::string &errorMsg) -> bool;
+
+    auto rowCount() const -> uint64_t;
+
+    /// 可用于过滤/分组的列名
+    auto columnNames() const -> std::vector<std::string>;
+
+    auto query(const QueryOptions &options, QueryResult &result, std::string &errorMsg) const -> bool;
+
+    static auto formatResult(const QueryResult &result, const QueryOptions &options) -> std::string;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // MEDIA_CATALOG_H
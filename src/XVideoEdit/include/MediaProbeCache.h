@@ -0,0 +1,117 @@
+﻿#pragma once
+
+#ifndef MEDIA_PROBE_CACHE_H
+#define MEDIA_PROBE_CACHE_H
+
+#include "XConst.h"
+#include "ISingleton.hpp"
+
+#include <vector>
+#include <cstdint>
+
+/// 单条流信息
+struct MediaStreamInfo
+{
+    int         index = -1;
+    std::string codecType;      ///< video / audio / subtitle / data
+    std::string codecName;      ///< h264 / aac ...
+    std::string profile;        ///< 编码档次，如 High / Main 10
+    std::string pixFmt;         ///< 视频像素格式，如 yuv420p
+    std::string timeBase;       ///< 流时间基，如 1/15360
+    std::string extradataHash;  ///< 编码器私有数据（如 avcC 中的 SPS/PPS）的 CRC32，没有时为空
+    int         level      = 0;   ///< 编码级别（如 H.264 的 40 表示 4.0），未知为0
+    int         hasBFrames = 0;   ///< 解码重排序深度（B 帧）
+    int         width      = 0;   ///< 视频宽度
+    int         height     = 0;   ///< 视频高度
+    double      sar        = 1.0; ///< 采样宽高比（像素宽/像素高），未知为1
+    int         rotation   = 0;   ///< 显示时的旋转角度（0/90/180/270），解码时 ffmpeg 默认自动旋转
+    double      fps        = 0;   ///< 平均帧率
+    int64_t     bitRate    = 0;   ///< 码率（bit/s），未知为0
+    int         sampleRate = 0;   ///< 音频采样率
+    int         channels   = 0;   ///< 音频声道数
+
+    /// 按 SAR 与旋转校正后的显示宽高比（宽/高），尺寸未知为0
+    auto displayAspect() const -> double;
+};
+
+/// 一次 ffprobe 探测得到的元数据
+struct MediaProbeInfo
+{
+    double                       duration = 0.0; ///< 总时长（秒）
+    int64_t                      bitRate  = 0;   ///< 容器总码率
+    std::string                  formatName;     ///< 容器格式
+    std::vector<MediaStreamInfo> streams;
+    std::vector<double>          keyframes;                ///< 视频关键帧时间戳（秒）
+    bool                         hasKeyframeIndex = false; ///< keyframes 是否已建立
+
+    auto videoStream() const -> const MediaStreamInfo *;
+    auto audioStream() const -> const MediaStreamInfo *;
+    auto hasVideo() const -> bool;
+};
+
+/// \class MediaProbeCache
+/// \brief 持久化的 ffprobe 元数据缓存
+/// 以 (设备号, inode, 文件大小, 修改时间ns) 作为键，文件被改写后自动失效；
+/// 内存中为 LRU，磁盘上是追加写的二进制记录文件（与历史记录文件同目录）
+class MediaProbeCache : public ISingleton<MediaProbeCache>
+{
+public:
+    /// 文件身份标识
+    struct FileKey
+    {
+        uint64_t device  = 0;
+        uint64_t inode   = 0;
+        uint64_t size    = 0;
+        int64_t  mtimeNs = 0;
+
+        auto operator==(const FileKey &other) const -> bool = default;
+    };
+
+    struct Statistics
+    {
+        size_t hits        = 0; ///< 内存命中
+        size_t diskHits    = 0; ///< 磁盘命中
+        size_t misses      = 0; ///< 需要调用 ffprobe
+        size_t memEntries  = 0;
+        size_t diskEntries = 0;
+    };
+
+    MediaProbeCache();
+    ~MediaProbeCache() override;
+
+public:
+    /// 设置缓存文件所在目录（默认当前目录）
+    auto setStorageDirectory(const fs::path &dir) -> void;
+
+    auto storageDirectory() const -> fs::path;
+
+    /// 设置内存 LRU 容量
+    auto setCapacity(size_t capacity) -> void;
+
+    /// 获取元数据，未命中时调用 ffprobe 并写入缓存
+    auto probe(const std::string_view &path, MediaProbeInfo &info, std::string &errorMsg) -> bool;
+
+    /// 获取元数据并保证关键帧索引已建立
+    auto probeKeyframes(const std::string_view &path, MediaProbeInfo &info, std::string &errorMsg) -> bool;
+
+    /// 便捷方法：获取时长，失败返回0
+    auto duration(const std::string_view &path) -> double;
+
+    /// 移除某个文件的缓存
+    auto invalidate(const std::string_view &path) -> void;
+
+    /// 清空内存与磁盘缓存
+    auto clear() -> void;
+
+    auto getStatistics() const -> Statistics;
+
+public:
+    /// 计算文件身份标识
+    static auto makeKey(const std::string_view &path, FileKey &key, std::string &errorMsg) -> bool;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // MEDIA_PROBE_CACHE_H
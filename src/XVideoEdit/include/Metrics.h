@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "ISingleton.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/// \class Metrics
+/// \brief 进程内运行指标，按 Prometheus 文本格式（0.0.4）导出。
+/// 计数器、仪表与直方图的桶都是原子变量，记录时不加锁；
+/// 按任务名区分的序列在任务实例创建时登记（加锁一次），调用方持有其引用，结束时同样只做原子加
+class Metrics : public ISingleton<Metrics>
+{
+public:
+    /// 单个任务的执行次数、失败次数与耗时
+    struct TaskSeries;
+
+    Metrics();
+    ~Metrics() override;
+
+public:
+    /// 作业队列（JobScheduler）：排队数、运行数与排队等待时间
+    auto jobQueued() -> void;
+    auto jobStarted(double waitSeconds) -> void;
+    auto jobFinished(bool success) -> void;
+    auto jobsDropped(size_t count) -> void;
+
+    /// 任务执行（TaskManager）：执行次数、失败次数与耗时
+    auto taskStarted() -> void;
+    auto taskFinished(TaskSeries &series, double seconds, bool success) -> void;
+
+    /// 登记或取得任务的序列；序列登记后不会移除，返回的引用在进程内始终有效
+    auto taskSeries(std::string_view task) -> TaskSeries &;
+
+    /// 外部进程（XExec）：从 start 调用到子进程与读取线程就绪的耗时
+    auto processSpawned(double seconds, bool success) -> void;
+
+    /// ffmpeg 结束：最后一个进度块的平均速度倍数与输出字节数，未知时为负
+    auto encodeFinished(double speed, int64_t bytes, bool success) -> void;
+
+    /// 全部指标的文本格式
+    auto render() const -> std::string;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include "ISingleton.hpp"
+
+#include <memory>
+#include <string>
+
+/// \class MetricsExporter
+/// \brief 导出 Metrics：在 Unix 域套接字或回环地址上提供 HTTP 抓取（GET /metrics），
+/// 或按间隔重写 textfile collector 文件（先写临时文件再改名，读取方不会看到半个文件）。
+/// 目标写法：unix:<路径>、[127.0.0.1:|localhost:]<端口>、file:<路径>
+class MetricsExporter : public ISingleton<MetricsExporter>
+{
+public:
+    MetricsExporter();
+    ~MetricsExporter() override;
+
+public:
+    /// 已在运行时先停止旧的目标；intervalMs 只用于 file: 目标
+    auto start(const std::string &target, int intervalMs, std::string &errorMsg) -> bool;
+
+    /// 停止导出；file: 目标停止前再写一次，套接字目标删除套接字文件
+    auto stop() -> void;
+
+    auto isRunning() const -> bool;
+
+    /// 当前目标的说明，如 http://127.0.0.1:9464/metrics；未运行时为空
+    auto describe() const -> std::string;
+
+    static auto writeTextfile(const std::string &path, std::string &errorMsg) -> bool;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // METRICS_EXPORTER_H
@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#ifndef PACKAGE_COMMAND_BUILDER_H
+#define PACKAGE_COMMAND_BUILDER_H
+
+#include "AVTask.h"
+
+/// \class PackageCommandBuilder
+/// \brief 一次 ffmpeg 调用完成 fMP4 HLS/DASH 打包：多码率时 split+scale 并行编码，
+/// 需要加密时在切片的同时做 CENC（cenc-aes-ctr），媒体只读写一遍
+class PackageCommandBuilder : public AVTask::ICommandBuilder
+{
+    DECLARE_CREATE(PackageCommandBuilder)
+
+public:
+    auto build(const std::map<std::string, ParameterValue> &params) const -> std::string override;
+    auto validate(const std::map<std::string, ParameterValue> &params, std::string &errorMsg) const -> bool override;
+    auto getTitle(const std::map<std::string, ParameterValue> &params) const -> std::string override;
+
+    /// 加密打包完成后在 MPD 的每个 AdaptationSet 中写入 ContentProtection（default_KID），
+    /// 并在每个 HLS 媒体播放列表中写入 #EXT-X-KEY（SAMPLE-AES-CTR + KEYID）
+    auto annotateManifest(const std::map<std::string, ParameterValue> &params, std::string &errorMsg) const -> bool;
+
+private:
+    struct Rendition
+    {
+        int height  = 0; ///< 输出高度，宽度按源宽高比
+        int bitrate = 0; ///< 视频码率（kbps）
+    };
+
+    struct PackageOptions
+    {
+        std::string            input;
+        std::string            output;             ///< 输出目录
+        std::string            format     = "hls"; ///< hls | dash | both（DASH 切片同时生成 HLS 播放列表）
+        double                 segment    = 6.0;   ///< 切片时长（秒）
+        std::vector<Rendition> renditions;         ///< 为空时流复制单一码率
+        bool                   encrypt    = false; ///< CENC 加密
+        std::string            key;                ///< 密钥（十六进制，可选）
+        std::string            kid;                ///< Key ID（十六进制，可选）
+        std::string            keystore;           ///< 密钥库路径（可选）
+        bool                   derive_key = false; ///< 由主密钥派生密钥
+        std::string            master_key;         ///< 主密钥，为空时取环境变量
+        std::string            asset_id;           ///< 资源ID（默认为输出目录路径）
+    };
+
+    auto parseOptions(const std::map<std::string, ParameterValue> &params) const -> PackageOptions;
+
+    /// 解析 "1080:5000k,720:2800k,480"，省略码率时按高度取默认值
+    static auto parseRenditions(const std::string &value, std::vector<Rendition> &renditions, std::string &errorMsg)
+            -> bool;
+
+    /// 依次尝试：显式 --key/--kid、主密钥派生、密钥库记录；generate 为真时最后生成随机密钥并写入密钥库
+    auto resolveKey(const PackageOptions &options, bool generate, std::string &key, std::string &kid,
+                    std::string &errorMsg) const -> bool;
+};
+
+#endif // PACKAGE_COMMAND_BUILDER_H
@@ -72,6 +72,8 @@ struct ProgressBarConfig
     /// 行为选项
     int  updateIntervalMs{ 100 }; /// 更新间隔
     bool hideCursor{ true };      /// 隐藏光标
+    int  stallTimeoutSec{ 120 };  /// 媒体时间与输出都不前进超过该秒数视为卡死（0 不检测）
+    int  stallRetries{ 1 };       /// 卡死终止后自动重试的次数
 
     /// 主题相关
     ProgressBarStyle style{ ProgressBarStyle::Default };
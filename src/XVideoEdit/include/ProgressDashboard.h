@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#ifndef PROGRESS_DASHBOARD_H
+#define PROGRESS_DASHBOARD_H
+
+#include "ProgressRenderer.h"
+
+#include <string_view>
+#include <vector>
+
+/// \class ProgressDashboard
+/// \brief 多任务进度面板：每个运行中的任务一行，末尾一行汇总
+/// 汇总行给出总帧率、速度倍数之和、每秒写入字节与整批 ETA。
+/// 作为 ProgressRenderer 的帧监听运行，每帧只读取各任务邮箱并拼成一次写出，
+/// 未变化的行不重发，行数超过终端高度时折叠，适合 SSH 下同时运行几十个任务
+class ProgressDashboard : public ISingleton<ProgressDashboard>
+{
+public:
+    using OutputSink = std::function<void(std::string_view frame)>;
+
+    struct Summary
+    {
+        size_t   running         = 0;
+        size_t   completed       = 0;
+        size_t   failed          = 0;
+        double   framesPerSecond = 0.0; ///< 运行中任务的 fps 之和
+        double   speed           = 0.0; ///< 运行中任务的 speed 之和
+        double   bytesPerSecond  = 0.0; ///< 运行中任务的平均输出速率之和
+        double   etaSeconds      = -1;  ///< 剩余媒体时长 / 速度之和，未知为 -1
+        uint64_t bytesOut        = 0;   ///< 本批已输出字节
+    };
+
+    /// 单个运行中任务的进度，供面板之外的视图转发（如作业服务器推送给客户端）
+    struct JobProgress
+    {
+        uint64_t    tag = 0; ///< addJob 时所在线程的标签
+        std::string label;
+        uint64_t    version      = 0;  ///< 邮箱版本号，未变化说明没有新进度
+        double      percent      = -1; ///< 总时长未知时为 -1
+        double      seconds      = 0;  ///< 已处理的媒体秒数（相对剪切起点）
+        double      totalSeconds = 0;
+        double      fps          = -1;
+        double      speed        = -1;
+        int64_t     totalSize    = -1; ///< 已输出字节
+    };
+
+    ProgressDashboard();
+    ~ProgressDashboard() override;
+
+public:
+    /// 启用后 AVProgressBar 不再单独绘制，而是加入面板
+    auto setEnabled(bool enabled) -> void;
+
+    auto isEnabled() const -> bool;
+
+    /// 输出目标（sink 为空时恢复 stdout；interactive=false 时只输出完成记录，不做原地重绘）
+    auto setOutput(const OutputSink &sink, bool interactive) -> void;
+
+    /// 加入一个任务；totalSeconds 为待处理时长（0 表示未知），startSeconds 为剪切起点
+    auto addJob(const std::string_view &label, const std::shared_ptr<const ProgressMailbox> &mailbox,
+                double totalSeconds, double startSeconds = 0.0) -> uint64_t;
+
+    /// 任务结束：从面板移除并在面板上方留下一行记录
+    auto finishJob(uint64_t id, bool success, const std::string_view &message = "") -> void;
+
+    auto getSummary() const -> Summary;
+
+    /// 所有运行中任务的当前进度
+    auto getJobProgress() const -> std::vector<JobProgress>;
+
+    /// 设置当前线程的标签：之后在本线程加入的任务都带上该标签（0 表示不标记）；
+    /// visible 为 false 时这些任务不在面板上绘制、不计入汇总，只能通过 getJobProgress 读取（后台作业）
+    static auto setThreadTag(uint64_t tag, bool visible = true) -> void;
+
+    static auto getThreadTag() -> uint64_t;
+
+    /// 当前线程的进度是否输出到终端；为 false 时进度条只更新数据不绘制
+    static auto isThreadVisible() -> bool;
+
+    /// 立即按当前数据生成一帧（渲染线程之外调用时用于测试与基准）
+    auto renderFrame() -> size_t;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // PROGRESS_DASHBOARD_H
@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#ifndef PROGRESS_RENDERER_H
+#define PROGRESS_RENDERER_H
+
+#include "FFmpegProgressParser.h"
+#include "ISingleton.hpp"
+#include "SeqlockSlot.hpp"
+
+#include <functional>
+#include <memory>
+
+/// 解析器（写者）与渲染线程（读者）之间的进度邮箱
+using ProgressMailbox = SeqlockSlot<ProgressSnapshot>;
+
+/// \class ProgressRenderer
+/// \brief 所有进度条共用的渲染线程
+/// 发布方写入邮箱后调用 notify()；渲染线程平时阻塞在原子变量上（空闲时零唤醒），
+/// 有更新时只重绘版本号变化的进度条，两帧之间至少间隔 1/maxFps 秒，突发的更新合并为一帧
+class ProgressRenderer : public ISingleton<ProgressRenderer>
+{
+public:
+    using DrawCallback  = std::function<void(const ProgressSnapshot &snapshot)>;
+    using FrameListener = std::function<void()>;
+
+    struct Statistics
+    {
+        uint64_t notifies = 0; ///< 发布次数
+        uint64_t wakeups  = 0; ///< 渲染线程被唤醒次数
+        uint64_t frames   = 0; ///< 实际重绘的进度条次数
+        size_t   attached = 0; ///< 当前注册的进度条数
+    };
+
+    ProgressRenderer();
+    ~ProgressRenderer() override;
+
+public:
+    /// 最大刷新帧率（默认 10）
+    auto setMaxFps(int fps) -> void;
+
+    /// 注册进度源，返回注销用的句柄；首次注册时才启动渲染线程
+    auto attach(const std::shared_ptr<const ProgressMailbox> &mailbox, const DrawCallback &draw) -> uint64_t;
+
+    /// 注销进度源；若还有未绘制的更新则在调用线程补绘最后一帧。返回后 draw 不会再被调用
+    auto detach(uint64_t id) -> void;
+
+    /// 注册帧监听：每次被唤醒重绘后在渲染线程调用一次（用于自行读取多个邮箱、整帧输出的视图）
+    auto addFrameListener(const FrameListener &listener) -> uint64_t;
+
+    auto removeFrameListener(uint64_t id) -> void;
+
+    /// 邮箱写入后调用，唤醒渲染线程（不加锁）
+    auto notify() -> void;
+
+    auto getStatistics() const -> Statistics;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // PROGRESS_RENDERER_H
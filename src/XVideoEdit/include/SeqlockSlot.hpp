@@ -0,0 +1,83 @@
+﻿#ifndef SEQLOCK_SLOT_H
+#define SEQLOCK_SLOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+/// \class SeqlockSlot
+/// \brief 单写者、多读者的无锁单槽邮箱（seqlock）
+/// 写者从不阻塞，只保留最新值；读者读到写入中途的数据时重试。
+/// 数据按 64 位原子字存放，避免普通 seqlock 的数据竞争
+template <typename T>
+class SeqlockSlot
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqlockSlot 只支持可平凡复制的类型");
+
+public:
+    SeqlockSlot() = default;
+
+    SeqlockSlot(const SeqlockSlot &)            = delete;
+    SeqlockSlot &operator=(const SeqlockSlot &) = delete;
+
+public:
+    /// 写入新值（同一时刻只能有一个写者）
+    auto store(const T &value) -> void
+    {
+        const uint64_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        uint64_t words[kWords] = {};
+        std::memcpy(words, &value, sizeof(T));
+        for (size_t i = 0; i < kWords; ++i)
+        {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    /// 读取一致的副本，返回其版本号（0 表示从未写入）
+    auto load(T &value) const -> uint64_t
+    {
+        uint64_t words[kWords];
+        for (;;)
+        {
+            const uint64_t before = sequence_.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            for (size_t i = 0; i < kWords; ++i)
+            {
+                words[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (sequence_.load(std::memory_order_relaxed) == before)
+            {
+                std::memcpy(&value, words, sizeof(T));
+                return before / 2;
+            }
+        }
+    }
+
+    /// 当前版本号，每次 store 加一；可用来判断是否有新值而不复制数据
+    auto version() const -> uint64_t
+    {
+        return sequence_.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> sequence_{ 0 }; ///< 奇数表示写入中
+    std::atomic<uint64_t> words_[kWords] = {};
+};
+
+#endif // SEQLOCK_SLOT_H
@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include "Metrics.h"
 #include "XTask.h"
 
 class TaskProgressBar;
@@ -12,6 +13,8 @@ public:
 
     using ProgressBarCreator = std::function<TaskProgressBar::Ptr(const std::string_view& name)>;
 
+    using TaskLoader = std::function<void()>;
+
     using TypeHistoryList = std::vector<std::string>;
 
     using TaskHistoryList = std::map<std::string, TypeHistoryList>; /// 类型-》所有记录
@@ -35,6 +38,7 @@ public:
         std::string                           name;
         std::string                           typeName;
         XTask::Ptr                            task;
+        Metrics::TaskSeries*                  metrics = nullptr; ///< 创建实例时登记，执行结束不再按名字查找
         std::vector<std::string>              executionHistory;
         std::chrono::system_clock::time_point createdTime;
         std::chrono::system_clock::time_point lastExecutedTime;
@@ -64,6 +68,13 @@ public:
     auto registerTask(const std::string_view& name, const XTask::TaskFunc& func,
                       const std::string_view& description = "") -> XTask&;
 
+    /// 延迟注册：任务第一次被查询或执行时才调用 loader（loader 中注册同名任务）；
+    /// 列出全部任务的接口会先执行所有未调用的 loader
+    auto registerTaskLoader(const std::string_view& name, const TaskLoader& loader) -> void;
+
+    /// 已登记但尚未注册的任务数
+    auto getPendingLoaderCount() const -> size_t;
+
     auto registerTaskInstance(const std::string_view& name, const XTask::Ptr& task,
                               const std::string_view& typeName = "default") -> bool;
 
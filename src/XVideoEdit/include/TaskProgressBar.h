@@ -39,6 +39,9 @@ public:
     /// 标记为失败
     virtual auto markAsFailed(const std::string_view& message = "失败 ✗") -> void;
 
+    /// 上一次监控是否因长时间无进展而终止了进程
+    virtual auto isStalled() const -> bool;
+
 public:
     /// \brief 设置进度
     /// \param percent
@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#ifndef THROUGHPUT_ESTIMATOR_H
+#define THROUGHPUT_ESTIMATOR_H
+
+#include <cstddef>
+
+/// \class ThroughputEstimator
+/// \brief 处理速率（媒体秒 / 墙钟秒）的指数加权估计
+/// 观测间隔不均匀时按 alpha = 1 - exp(-dt/τ) 加权，同时维护加权方差，
+/// 由此给出剩余时间及其置信区间；不依赖 ffmpeg 的 speed=（那是从头算起的累计平均）
+class ThroughputEstimator
+{
+public:
+    struct Estimate
+    {
+        bool   valid      = false; ///< 观测不足或速率为0时为 false
+        double rate       = 0.0;   ///< 平滑后的速率
+        double etaSeconds = -1.0;  ///< 剩余墙钟秒数，总时长未知为 -1
+        double etaLow     = -1.0;  ///< 置信区间下界
+        double etaHigh    = -1.0;  ///< 置信区间上界，速率下界接近0时为 -1（无上界）
+    };
+
+    /// timeConstant: 平滑时间常数（秒），越大越稳、响应越慢
+    explicit ThroughputEstimator(double timeConstant = 8.0);
+
+public:
+    /// 重新开始；totalMedia 为需要处理的媒体秒数（0 表示未知）
+    auto reset(double totalMedia) -> void;
+
+    /// 记录一次观测：wall 为自开始的墙钟秒数，media 为已处理的媒体秒数（相对起点）
+    auto observe(double wall, double media) -> void;
+
+    auto estimate() const -> Estimate;
+
+private:
+    double timeConstant_ = 8.0;
+    double totalMedia_   = 0.0;
+    double mean_         = 0.0;
+    double variance_     = 0.0;
+    double weight_       = 0.0; ///< 有效样本数的倒数估计（用于均值的标准误）
+    double lastWall_     = 0.0;
+    double lastMedia_    = 0.0;
+    size_t count_        = 0;
+    bool   started_      = false;
+};
+
+#endif // THROUGHPUT_ESTIMATOR_H
@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#ifndef THUMBS_COMMAND_BUILDER_H
+#define THUMBS_COMMAND_BUILDER_H
+
+#include "XTask.h"
+
+/// \class ThumbsCommandBuilder
+/// \brief 生成拖动条预览图：按探测时长均匀取时间点，每个时间点用输入侧 -ss 跳到关键帧只解码一帧。
+/// 时间点分批交给少数几个并行的 ffmpeg 进程（每个进程多个 -ss 输入），
+/// 再拼成雪碧图并写出 WebVTT 索引（不需要解码整个文件）
+class ThumbsCommandBuilder : public XTask::ICommandBuilder
+{
+    DECLARE_CREATE(ThumbsCommandBuilder)
+
+public:
+    auto build(const std::map<std::string, ParameterValue> &params) const -> std::string override;
+    auto validate(const std::map<std::string, ParameterValue> &params, std::string &errorMsg) const -> bool override;
+    auto getTitle(const std::map<std::string, ParameterValue> &params) const -> std::string override;
+
+    auto isInProcess(const std::map<std::string, ParameterValue> &params) const -> bool override;
+    auto run(const std::map<std::string, ParameterValue> &params, std::string &resultMsg, std::string &errorMsg) const
+            -> bool override;
+
+private:
+    struct ThumbsOptions
+    {
+        std::string input;
+        std::string output;           /// 输出目录，默认 <输入名>_thumbs
+        double      interval = 10.0;  /// 相邻缩略图的间隔（秒）
+        int         count    = 0;     /// 缩略图数量，>0 时覆盖 interval
+        int         width    = 160;   /// 缩略图宽度，高度按源宽高比
+        int         columns  = 10;    /// 每张雪碧图的列数
+        int         rows     = 10;    /// 每张雪碧图的行数
+        int         jobs     = 0;     /// 并行 ffmpeg 进程数，0 表示按CPU核数（最多 8）
+        bool        accurate = false; /// 精确定位到时间点（需要解码到该帧，较慢）
+    };
+
+    auto parseOptions(const std::map<std::string, ParameterValue> &params) const -> ThumbsOptions;
+};
+
+#endif // THUMBS_COMMAND_BUILDER_H
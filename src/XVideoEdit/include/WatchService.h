@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#ifndef WATCH_SERVICE_H
+#define WATCH_SERVICE_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class TaskManager;
+
+/// \class WatchService
+/// \brief 热文件夹入库：文件写完后按目录配置的任务流水线自动处理，并发数有上限。
+/// 参数值中的占位符按就绪文件展开：{input} 完整路径，{name} 文件名，{stem} 不含扩展名，{ext} 扩展名，
+/// {dir} 所在目录，{prev} 上一步的 --output（串联多步流水线）
+class WatchService
+{
+public:
+    /// 流水线中的一步：任务名 + 参数（值可含占位符）
+    struct Step
+    {
+        std::string                        task;
+        std::map<std::string, std::string> params;
+    };
+
+    struct Folder
+    {
+        std::string              path;
+        std::vector<std::string> extensions; ///< 为空时接受所有文件
+        std::vector<Step>        pipeline;   ///< 按顺序执行，某一步失败则停止
+    };
+
+    struct Config
+    {
+        std::vector<Folder> folders;
+        size_t              jobs             = 2;   ///< 同时处理的文件数
+        double              stableSeconds    = 2.0; ///< 文件大小保持不变多久才处理
+        int                 settleMs         = 500; ///< 同一文件的事件合并窗口
+        size_t              prefetchFiles    = 2;   ///< 预读排队中的前几个文件，0 表示关闭
+        size_t              prefetchMB       = 32;  ///< 每个文件预读的文件头大小
+        size_t              prefetchBudgetMB = 512; ///< 预读占用页缓存的上限
+    };
+
+    explicit WatchService(TaskManager &taskManager);
+    ~WatchService();
+
+public:
+    /// 读取 JSON 配置
+    static auto loadConfig(const std::string &path, Config &config, std::string &errorMsg) -> bool;
+
+    /// 开始监视并阻塞，直到 Ctrl+C 或 stop()；返回时等待运行中的作业结束。
+    /// 排队未处理的文件仍留在目录中，下次启动时扫描目录重新处理（输出已比输入新的跳过）
+    auto run(const Config &config, std::string &errorMsg) -> bool;
+
+    auto stop() -> void;
+
+    /// 展开参数中的占位符
+    static auto expand(const std::string &value, const std::string &file, const std::string &previous = {})
+            -> std::string;
+
+private:
+    class PImpl;
+    std::unique_ptr<PImpl> impl_;
+};
+
+#endif // WATCH_SERVICE_H
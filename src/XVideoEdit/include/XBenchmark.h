@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#ifndef X_BENCHMARK_H
+#define X_BENCHMARK_H
+
+#include <string>
+#include <vector>
+
+/// \class XBenchmark
+/// \brief REPL 内置 bench 命令使用的微基准，结果以可读文本返回
+class XBenchmark
+{
+public:
+    /// ffmpeg -progress 解析吞吐：FFmpegProgressParser 与旧的逐行正则解析对比（行/秒）
+    static auto progressParser(size_t lines) -> std::string;
+
+    /// 多任务面板的单帧开销：jobs 个任务、每帧约 1/5 的任务有更新（输出写入计数器而不是终端）
+    static auto dashboard(size_t jobs, size_t frames) -> std::string;
+
+    /// 冷缓存下的首帧时间：逐个文件丢弃页缓存后用 ffmpeg 解码第一帧，与先经 InputPrefetcher 预读后的结果对比
+    static auto prefetch(const std::vector<std::string> &files, size_t headMB) -> std::string;
+
+    /// 单次执行模式的启动耗时：重复启动 executable 执行一个最简单的任务（含进程创建与 shell 开销）
+    static auto startup(const std::string &executable, size_t runs) -> std::string;
+};
+
+#endif // X_BENCHMARK_H
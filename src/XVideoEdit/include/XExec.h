@@ -4,6 +4,7 @@
 #include <string>
 #include <functional>
 #include <memory>
+#include <cstdint>
 
 class XExec
 {
@@ -30,10 +31,17 @@ public:
     XExec(const XExec&)            = delete;
     XExec& operator=(const XExec&) = delete;
     using OutputCallback           = std::function<void(const std::string_view& line, bool isStderr)>;
+    using ProgressCallback         = std::function<void(const std::string_view& line)>;
 
 public:
     auto setOutputCallback(const OutputCallback& callback) -> void;
 
+    /// 进度通道（子进程的 fd 3）按行回调；未设置时进度行按 stdout 交给输出回调
+    auto setProgressCallback(const ProgressCallback& callback) -> void;
+
+    /// 是否累积输出到内存（默认累积）；流式处理大量输出时关闭，仅走回调
+    auto setCaptureOutput(bool capture) -> void;
+
     /// 设置执行模式
     auto setExecutionMode(ExecutionMode mode) -> void;
 
@@ -41,6 +49,9 @@ public:
 
     auto isRunning() const -> bool;
 
+    /// 阻塞等待进程退出，最多 timeoutMs 毫秒；返回进程是否已退出。不回收进程，退出码仍由 wait() 取得
+    auto waitFor(int timeoutMs) -> bool;
+
     /// \brief  等待
     /// \return 错误码
     auto wait() -> int;
@@ -56,6 +67,16 @@ public:
 public:
     static auto execute(const std::string_view& command, bool redirectStderr = true, int timeoutMs = 0) -> XResult;
 
+    /// ffmpeg -progress 的输出目标：POSIX 上为独立的 fd 3（与 stdout 上的媒体数据、日志互不干扰），
+    /// Windows 上 CreateProcess 无法继承额外描述符，仍为 pipe:1
+    static auto progressTarget() -> const char*;
+
+    /// 本线程此后启动的进程归入作业 tag（0 表示不归属，同时清除上一个 tag 的取消标记）
+    static auto setThreadJobTag(uint64_t tag) -> void;
+
+    /// 向作业 tag 下运行中的进程发送终止信号，并拒绝该作业再启动新进程；不等待退出，返回收到信号的进程数
+    static auto terminateJob(uint64_t tag) -> size_t;
+
 private:
     class PImpl;
     std::unique_ptr<PImpl> impl_;
@@ -22,12 +22,27 @@ public:
         virtual auto validate(const std::map<std::string, ParameterValue>& params, std::string& errorMsg) const
                 -> bool                                                                                 = 0;
         virtual auto getTitle(const std::map<std::string, ParameterValue>& params) const -> std::string = 0;
+
+        /// 是否由构建器在进程内直接完成（不启动外部命令）
+        virtual auto isInProcess(const std::map<std::string, ParameterValue>&) const -> bool
+        {
+            return false;
+        }
+
+        /// 进程内执行，isInProcess 返回 true 时代替 build + execute
+        virtual auto run(const std::map<std::string, ParameterValue>&, std::string&, std::string& errorMsg) const
+                -> bool
+        {
+            errorMsg = "构建器不支持进程内执行";
+            return false;
+        }
     };
     using SmartBuilder     = ICommandBuilder::Ptr;
     using List             = std::map<std::string, XTask::Ptr, std::less<>>;
     using Container        = std::vector<XTask::Ptr>;
     using TaskFunc         = std::function<void(const std::map<std::string, ParameterValue>&, const std::string&)>;
     using ProgressCallback = std::function<void(float percent, const std::string& timeInfo)>;
+    using BarFactory       = std::function<TaskProgressBar::Ptr()>;
     using Type             = Parameter::Type;
     using CompletionFunc   = Parameter::CompletionFunc;
     explicit XTask();
@@ -96,6 +111,12 @@ public:
 
     auto progressBar() const -> TaskProgressBar::Ptr;
 
+    /// 设置进度条工厂并立即创建一个进度条；clone 出的副本用它创建各自的进度条
+    auto setProgressBarFactory(const BarFactory& factory) -> XTask&;
+
+    /// 复制任务定义（参数、构建器、回调），参数表与进度条不共享，用于同一任务并发执行
+    virtual auto clone() const -> XTask::Ptr;
+
     auto setProgressCallback(ProgressCallback callback) -> XTask&;
 
     auto getProgressCallback() const -> ProgressCallback;
@@ -117,6 +138,10 @@ public:
     auto waitProgress(XExec& exec, const std::map<std::string, ParameterValue>& inputParams, std::string& errorMsg)
             -> bool;
 
+protected:
+    /// 把任务定义复制到新建的实例上（子类 clone 时调用）
+    auto copyDefinitionTo(XTask& other) const -> void;
+
 private:
     class PImpl;
     std::unique_ptr<PImpl> impl_;
@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 
 class XTool
@@ -9,11 +10,19 @@ public:
     /// \return
     static auto isInteractiveTerminal() -> bool;
 
+    /// \brief 获取终端列数与行数（stdout 不是终端时返回 false）
+    static auto getTerminalSize(int &columns, int &rows) -> bool;
+
     static auto split(const std::string_view &input, char delimiter = ' ', bool trimWhitespace = true)
             -> std::vector<std::string>;
 
     static auto smartSplit(const std::string &input) -> std::vector<std::string>;
 
+    /// \brief 是否含有 shell 特殊字符
+    /// 外部传入的值（文件名、套接字参数）最终拼进 /bin/sh -c 执行的命令行，构建器只用双引号包裹取值；
+    /// 双引号内仍会展开的字符（$ ` " \）、换行以及未加引号时能串接命令的字符（' ; | & < >）都算
+    static auto hasShellMetachar(std::string_view value) -> bool;
+
     static auto getFFmpegPath() -> std::string;
 
     static auto getFFprobePath() -> std::string;
@@ -78,6 +78,11 @@ public:
     /// \brief
     auto stop() -> void;
 
+    /// \brief 单次执行一条命令，不初始化 REPL 与历史记录
+    /// \param args 命令与参数，如 {"cv", "--input", "a.mp4", "--output", "b.mp4"}；任务名前的 task 可以省略
+    /// \return 进程退出码：0 成功，1 执行失败，2 未知或无效的命令
+    auto execute(const std::vector<std::string>& args) -> int;
+
     /// \brief 获取任务管理器引用
     /// \return TaskManager& 任务管理器
     auto getTaskManager() -> TaskManager&;
@@ -146,5 +151,5 @@ auto XUserInput::registerTask(const std::string_view& name, const std::string& t
 {
     return registerTask(name, typeName, func, description)
             .setBuilder(CommandType::create())
-            .setProgressBar(BarType::create(typeName));
+            .setProgressBarFactory([typeName] { return BarType::create(typeName); });
 }
@@ -1,16 +1,24 @@
 ﻿#include "AVProgressBar.h"
+#include "MediaProbeCache.h"
+#include "Metrics.h"
+#include "ProgressDashboard.h"
+#include "EncoderTuner.h"
+#include "FragmentNotifier.h"
 #include "ParameterValue.h"
 #include "XFile.h"
 #include "XExec.h"
 #include "XTool.h"
+#include "ThroughputEstimator.h"
 
+#include <atomic>
+#include <cstdio>
 #include <iostream>
 #include <regex>
 #include <sstream>
 #include <iomanip>
 #include <chrono>
-#include <thread>
 #include <filesystem>
+#include <thread>
 
 class AVProgressBar::PImpl
 {
@@ -19,179 +27,188 @@ public:
     ~PImpl() = default;
 
 public:
-    /// 主进度监控循环
-    auto runProgressLoop(XExec &exec, const std::shared_ptr<AVProgressState> &progressState,
-                         const std::string_view &dstPath) -> void;
+    /// 渲染线程回调：把一个 -progress 块画到进度条上
+    auto render(const AVProgressState &state, const ProgressSnapshot &snapshot) -> void;
+
+    /// 按平滑速率给出剩余时间与置信区间
+    auto calculateRemainingTime() const -> std::string;
+
+    /// 解析线程调用：媒体时间、输出大小或帧数前进时记下时刻
+    auto noteProgress(const ProgressSnapshot &snapshot) -> void;
+
+    /// 等待进程退出；媒体时间、输出大小、帧数在 stallTimeoutSec 内都没有前进时终止进程
+    auto waitForExit(XExec &exec, const AVProgressState &state) -> int;
 
-    /// 计算剩余时间
-    auto calculateRemainingTime(double currentTime, double startTime, double totalDuration,
-                                const std::string &speed) const -> std::string;
+    /// 最后一个进度块（progress=end）给出整次运行的平均速度与输出大小
+    static auto recordMetrics(const AVProgressState &state, int exitCode) -> void;
 
 public:
-    AVProgressBar *owner_ = nullptr;
-    std::string    sourceFile_;   ///< 源文件路径（缓存）
-    std::string    timeRangeStr_; ///< 时间范围字符串
+    AVProgressBar                        *owner_ = nullptr;
+    std::string                           sourceFile_;           ///< 源文件路径（缓存）
+    std::string                           timeRangeStr_;         ///< 时间范围字符串
+    float                                 lastPercent_   = 0.0f; ///< 进度只增不减
+    int                                   progressCount_ = 0;    ///< 已绘制的块数
+    ThroughputEstimator                   estimator_;            ///< 只在渲染线程中更新
+    std::chrono::steady_clock::time_point monitorStart_;
+    std::atomic<bool>                     stalled_{ false };
+    ProgressSnapshot                      lastSeen_;               ///< 只在解析线程中访问
+    std::atomic<int64_t>                  lastAdvanceNs_{ 0 };     ///< 最后一次前进的 steady_clock 时刻
+    std::atomic<bool>                     progressEnded_{ false }; ///< 已收到 progress=end
 };
 
 AVProgressBar::PImpl::PImpl(AVProgressBar *owner) : owner_(owner)
 {
 }
 
-auto AVProgressBar::PImpl::runProgressLoop(XExec &exec, const std::shared_ptr<AVProgressState> &progressState,
-                                           const std::string_view &dstPath) -> void
+auto AVProgressBar::PImpl::render(const AVProgressState &state, const ProgressSnapshot &snapshot) -> void
 {
-    /// 主进度监控循环
-    float       lastPercent = 0.0f;
-    std::string lastSpeed;
-    std::string lastTime;
-    auto        startTimePoint   = std::chrono::steady_clock::now();
-    auto        lastProgressTime = startTimePoint;
-    int         progressCount    = 0;
-    bool        hasTotalDuration = (progressState->clipDuration > 0);
-
-    while (exec.isRunning())
-    {
-        /// 获取进度信息
-        double      currentTime = 0.0;
-        std::string displayTime;
-        std::string speed;
-        bool        hasProgress = false;
+    /// 开头几个块的 out_time 可能是 N/A
+    if (snapshot.outTimeUs < 0)
+    {
+        return;
+    }
 
-        {
-            std::lock_guard<std::mutex> lock(progressState->mutex);
-            currentTime                = progressState->currentTime;
-            displayTime                = progressState->displayTime;
-            speed                      = progressState->speed;
-            hasProgress                = progressState->hasProgress;
-            progressState->hasProgress = false;
-        }
+    const int64_t us          = snapshot.outTimeUs;
+    const int64_t secs        = us / 1000000;
+    const double  currentTime = snapshot.outTimeSeconds();
+    char          clock[32]   = {};
+    char          speed[32]   = {};
+    std::snprintf(clock, sizeof(clock), "%02lld:%02lld:%02lld.%06lld", static_cast<long long>(secs / 3600),
+                  static_cast<long long>(secs / 60 % 60), static_cast<long long>(secs % 60),
+                  static_cast<long long>(us % 1000000));
+    if (snapshot.speed >= 0)
+    {
+        std::snprintf(speed, sizeof(speed), "%.3gx", snapshot.speed);
+    }
 
-        /// 计算运行时间
-        auto now     = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - startTimePoint);
+    /// 没有总时长时不再模拟进度，只显示已处理到的时间
+    float progressPercent = lastPercent_;
+    if (state.clipDuration > 0)
+    {
+        progressPercent = std::max(lastPercent_, owner_->calculateProgress(currentTime, state.startTime,
+                                                                           state.clipDuration));
+    }
+    lastPercent_ = progressPercent;
+    ++progressCount_;
 
-        if (hasProgress && (hasTotalDuration || !displayTime.empty()))
-        {
-            /// 计算进度百分比
-            float progressPercent = 0.0f;
-            if (hasTotalDuration)
-            {
-                progressPercent =
-                        owner_->calculateProgress(currentTime, progressState->startTime, progressState->clipDuration);
-            }
-            else if (!displayTime.empty())
-            {
-                /// 没有总时长，模拟进度
-                progressPercent = std::min(lastPercent + 0.2f, 99.0f);
-            }
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - monitorStart_).count();
+    estimator_.observe(wall, std::max(0.0, currentTime - state.startTime));
 
-            if (progressPercent > lastPercent || displayTime != lastTime || speed != lastSpeed)
-            {
-                progressCount++;
-                lastPercent      = progressPercent;
-                lastTime         = displayTime;
-                lastSpeed        = speed;
-                lastProgressTime = now;
-
-                /// 构建显示信息
-                std::string progressInfo =
-                        owner_->getProgressInfo(currentTime, progressState->startTime, progressState->clipDuration,
-                                                displayTime, speed, progressPercent);
-
-                /// 更新进度条
-                owner_->setProgress(progressPercent);
-                owner_->setMessage(progressInfo);
-                owner_->updateDisplay();
-
-                /// 定期显示详细状态
-                if (progressCount % 100 == 0)
-                {
-                    std::cout << "\n[处理状态] 进度: " << progressPercent << "%, "
-                              << "速度: " << (speed.empty() ? "N/A" : speed) << ", 已运行: " << elapsed.count() << "秒"
-                              << std::endl;
-                }
-            }
-        }
-        else
-        {
-            /// 检查是否长时间没有进度更新
-            auto timeSinceLastProgress = std::chrono::duration_cast<std::chrono::seconds>(now - lastProgressTime);
+    const std::string progressInfo = owner_->getProgressInfo(currentTime, state.startTime, state.clipDuration, clock,
+                                                             speed, progressPercent);
+    owner_->setProgress(progressPercent, progressInfo);
 
-            if (timeSinceLastProgress.count() > 3)
-            {
-                std::stringstream message;
-                message << "处理中... 已运行 " << elapsed.count() << " 秒";
+    /// 定期显示详细状态
+    if (progressCount_ % 100 == 0)
+    {
+        std::cout << "\n[处理状态] 进度: " << progressPercent << "%, "
+                  << "速度: " << (speed[0] != '\0' ? speed : "N/A") << ", 已处理: " << clock << std::endl;
+    }
+}
 
-                if (hasTotalDuration && lastPercent < 99.0f)
-                {
-                    /// 轻微增加进度（避免卡住的感觉）
-                    float newPercent = std::min(lastPercent + 0.1f, 99.0f);
-                    if (newPercent > lastPercent)
-                    {
-                        owner_->setProgress(newPercent);
-                        lastPercent = newPercent;
-                    }
-                }
+auto AVProgressBar::PImpl::calculateRemainingTime() const -> std::string
+{
+    const auto estimate = estimator_.estimate();
+    if (!estimate.valid || estimate.etaSeconds < 0)
+    {
+        return "";
+    }
 
-                owner_->setMessage(message.str());
-                owner_->updateDisplay();
-            }
+    auto format = [](double seconds) -> std::string
+    {
+        const auto total = static_cast<long long>(seconds + 0.5);
+        char       text[32];
+        if (total >= 3600)
+        {
+            std::snprintf(text, sizeof(text), "%lld时%02lld分", total / 3600, total / 60 % 60);
+        }
+        else if (total >= 60)
+        {
+            std::snprintf(text, sizeof(text), "%lld分%02lld秒", total / 60, total % 60);
         }
+        else
+        {
+            std::snprintf(text, sizeof(text), "%lld秒", total);
+        }
+        return text;
+    };
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    /// 区间上界不存在时（速率波动大到下界接近0）只显示下界
+    std::string result = "剩余: " + format(estimate.etaSeconds);
+    if (estimate.etaHigh >= 0)
+    {
+        result += " (" + format(estimate.etaLow) + "~" + format(estimate.etaHigh) + ")";
     }
-
-    /// 任务完成
-    auto endTimePoint = std::chrono::steady_clock::now();
-    auto totalElapsed = std::chrono::duration_cast<std::chrono::seconds>(endTimePoint - startTimePoint);
-
-    owner_->markAsCompleted();
-    owner_->showCompletionInfo(dstPath, totalElapsed);
+    else
+    {
+        result += " (≥" + format(estimate.etaLow) + ")";
+    }
+    return result;
 }
 
-auto AVProgressBar::PImpl::calculateRemainingTime(double currentTime, double startTime, double totalDuration,
-                                                  const std::string &speed) const -> std::string
+auto AVProgressBar::PImpl::noteProgress(const ProgressSnapshot &snapshot) -> void
 {
-    if (speed.empty() || totalDuration <= 0)
-        return "";
+    if (snapshot.ended)
+    {
+        progressEnded_ = true;
+    }
+    if (snapshot.outTimeUs > lastSeen_.outTimeUs || snapshot.totalSize > lastSeen_.totalSize ||
+        snapshot.frame > lastSeen_.frame)
+    {
+        lastSeen_      = snapshot;
+        lastAdvanceNs_ = std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+}
 
-    try
+auto AVProgressBar::PImpl::waitForExit(XExec &exec, const AVProgressState &state) -> int
+{
+    stalled_           = false;
+    const auto config  = owner_->getConfig();
+    const int  timeout = config ? config->stallTimeoutSec : 0;
+    if (timeout <= 0 || state.interactive)
     {
-        /// 解析速度倍数
-        std::string speedNum = speed;
-        std::erase(speedNum, 'x');
-        double speedFactor = std::stod(speedNum);
+        return exec.wait();
+    }
 
-        if (speedFactor > 0)
+    /// 只在截止时刻醒来检查：解析线程记录最后一次前进的时刻，进程退出时 waitFor 立即返回。
+    /// 进程完全不输出时同样计时；progress=end 之后（如 faststart 重写文件）不再检测
+    using Clock      = std::chrono::steady_clock;
+    const auto limit = std::chrono::seconds(timeout);
+    for (;;)
+    {
+        if (progressEnded_)
         {
-            double elapsedTime   = currentTime - startTime;
-            double remainingTime = (totalDuration - elapsedTime) / speedFactor;
-
-            if (remainingTime > 0 && remainingTime < 3600) /// 小于1小时才显示
+            break;
+        }
+        const auto lastAdvance = Clock::time_point(Clock::duration(lastAdvanceNs_.load()));
+        const auto remaining   = lastAdvance + limit - Clock::now();
+        if (remaining > Clock::duration::zero())
+        {
+            const auto waitMs = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+            if (exec.waitFor(static_cast<int>(waitMs)))
             {
-                int remainingSecs = static_cast<int>(remainingTime);
-                int mins          = remainingSecs / 60;
-                int secs          = remainingSecs % 60;
-
-                std::stringstream ss;
-                if (mins > 0)
-                {
-                    ss << "剩余: " << mins << "分" << secs << "秒";
-                }
-                else
-                {
-                    ss << "剩余: " << secs << "秒";
-                }
-                return ss.str();
+                break;
             }
         }
+        else
+        {
+            stalled_ = true;
+            if (ProgressDashboard::isThreadVisible())
+            {
+                std::cout << "\n[卡死检测] " << timeout << " 秒内没有任何进展，终止进程" << std::endl;
+            }
+            exec.terminate();
+            break;
+        }
     }
-    catch (...)
-    {
-        /// 速度解析失败
-    }
+    return exec.wait();
+}
 
-    return "";
+auto AVProgressBar::PImpl::recordMetrics(const AVProgressState &state, int exitCode) -> void
+{
+    ProgressSnapshot last;
+    state.mailbox.load(last);
+    Metrics::getInstance()->encodeFinished(last.speed, last.totalSize, exitCode == 0);
 }
 
 /// ==================== AVProgressBar 实现 ====================
@@ -221,115 +238,112 @@ auto AVProgressBar::updateProgress(XExec &exec, const std::string_view &taskName
 }
 
 
+auto AVProgressBar::isStalled() const -> bool
+{
+    return impl_->stalled_;
+}
+
 auto AVProgressBar::startProgressMonitoring(XExec &exec, const std::shared_ptr<AVProgressState> &progressState,
                                             const std::string_view &srcPath, const std::string_view &dstPath) -> void
 {
-    /// 显示任务信息
-    if (!srcPath.empty() && !dstPath.empty())
-    {
-        showTaskInfo(srcPath, dstPath, progressState->clipDuration, progressState->timeRange);
-    }
+    /// 设置FFmpeg输出回调：进度块由 FFmpegProgressParser 解析，每个完整块写入邮箱并通知渲染线程
+    /// XExec 在同一把锁内分发 stdout 与进度通道，邮箱始终只有一个写者
+    /// 同一回调中按采样间隔记录遥测，并以 total_size 的增长驱动分片输出的片段扫描
+    auto *renderer  = ProgressRenderer::getInstance();
+    auto *telemetry = JobTelemetry::getInstance();
+    auto *fragments = FragmentNotifier::getInstance();
+    auto  parser    = std::make_shared<FFmpegProgressParser>();
+    auto  record    = telemetry->beginJob(progressState->profile);
+
+    /// 卡死检测的计时从此刻开始；回调在本函数返回前（进程被回收后）不再触发，可以引用 impl_
+    impl_->lastSeen_      = ProgressSnapshot{};
+    impl_->lastAdvanceNs_ = std::chrono::steady_clock::now().time_since_epoch().count();
+    impl_->progressEnded_ = false;
+    parser->setCallback(
+            [progressState, renderer, telemetry, fragments, record, output = std::string(dstPath),
+             impl = impl_.get()](const ProgressSnapshot &snapshot)
+            {
+                progressState->mailbox.store(snapshot);
+                renderer->notify();
+                telemetry->record(record, snapshot);
+                impl->noteProgress(snapshot);
+                if (!output.empty())
+                {
+                    fragments->update(output, snapshot.totalSize);
+                }
+            });
 
-    /// 设置FFmpeg输出回调
+    exec.setProgressCallback([parser](const std::string_view &line) { parser->feedLine(line); });
+#ifdef _WIN32
+    /// Windows 上进度仍写在 stdout；其他平台进度走 fd 3，stdout 上的内容不是进度
     exec.setOutputCallback(
-            [progressState, this](const std::string_view &line, bool isStderr)
+            [parser](const std::string_view &line, bool isStderr)
             {
                 if (!isStderr)
                 {
-                    double      outTime = 0.0;
-                    std::string displayTime;
-                    std::string speed;
-
-                    if (parseFFmpegOutputLine(std::string(line), outTime, displayTime, speed))
-                    {
-                        std::lock_guard<std::mutex> lock(progressState->mutex);
-
-                        progressState->currentTime = outTime;
-                        if (!displayTime.empty())
-                        {
-                            progressState->displayTime = displayTime;
-                        }
-                        if (!speed.empty())
-                        {
-                            progressState->speed = speed;
-                        }
-
-                        progressState->hasProgress = true;
-                    }
+                    parser->feedLine(line);
                 }
             });
+#endif
 
-    /// 显示初始进度条
-    setProgress(0.0f);
-    setMessage("准备开始处理...");
-    updateDisplay();
-
-    /// 启动进度监控循环
-    impl_->runProgressLoop(exec, progressState, dstPath);
-}
+    const auto mailbox = std::shared_ptr<const ProgressMailbox>(progressState, &progressState->mailbox);
+    impl_->estimator_.reset(progressState->clipDuration);
+    impl_->monitorStart_ = std::chrono::steady_clock::now();
 
-auto AVProgressBar::parseFFmpegOutputLine(const std::string &line, double &outTime, std::string &displayTime,
-                                          std::string &speed) const -> bool
-{
-    bool hasProgress = false;
-
-    /// 查找 out_time=
-    size_t timePos = line.find("out_time=");
-    if (timePos != std::string::npos)
+    /// 面板模式：多个任务共用一个视图，本进度条不单独输出；后台作业只登记进度，不绘制
+    auto *dashboard = ProgressDashboard::getInstance();
+    if (dashboard->isEnabled() || !ProgressDashboard::isThreadVisible())
     {
-        size_t end = line.find(' ', timePos);
-        if (end == std::string::npos)
-            end = line.length();
+        const auto label    = fs::path(dstPath.empty() ? srcPath : dstPath).filename().string();
+        const auto job      = dashboard->addJob(label, mailbox, progressState->clipDuration, progressState->startTime);
+        const int  exitCode = impl_->waitForExit(exec, *progressState);
+        telemetry->finishJob(record, exitCode);
+        PImpl::recordMetrics(*progressState, exitCode);
+        dashboard->finishJob(job, exitCode == 0,
+                             impl_->stalled_ ? "无进展超时"
+                                             : (exitCode == 0 ? "" : "退出码 " + std::to_string(exitCode)));
+        return;
+    }
 
-        displayTime = line.substr(timePos + 9, end - timePos - 9);
+    /// 显示任务信息
+    if (!srcPath.empty() && !dstPath.empty())
+    {
+        showTaskInfo(srcPath, dstPath, progressState->clipDuration, progressState->timeRange);
+    }
 
-        /// 将时间字符串转换为秒数
-        try
-        {
-            /// 格式: HH:MM:SS.mmmmmm
-            std::regex  timeRegex(R"((\d{2}):(\d{2}):(\d{2})\.(\d+))");
-            std::smatch matches;
+    /// 显示初始进度条
+    impl_->lastPercent_   = 0.0f;
+    impl_->progressCount_ = 0;
+    setProgress(0.0f, "准备开始处理...");
 
-            if (std::regex_search(displayTime, matches, timeRegex) && matches.size() >= 5)
-            {
-                int         hours    = std::stoi(matches[1].str());
-                int         minutes  = std::stoi(matches[2].str());
-                int         seconds  = std::stoi(matches[3].str());
-                std::string microStr = matches[4].str();
+    /// 本线程阻塞在进程退出上，重绘由共用的渲染线程按帧率上限完成
+    const auto startTimePoint = std::chrono::steady_clock::now();
+    const auto subscription   = renderer->attach(mailbox, [this, progressState](const ProgressSnapshot &snapshot)
+                                                 { impl_->render(*progressState, snapshot); });
 
-                /// 取前3位作为毫秒
-                int microLen     = std::min(3, static_cast<int>(microStr.length()));
-                int milliseconds = std::stoi(microStr.substr(0, microLen));
+    const int exitCode = impl_->waitForExit(exec, *progressState);
+    renderer->detach(subscription);
+    telemetry->finishJob(record, exitCode);
+    PImpl::recordMetrics(*progressState, exitCode);
 
-                outTime     = hours * 3600 + minutes * 60 + seconds + milliseconds / 1000.0;
-                hasProgress = true;
-            }
-        }
-        catch (...)
+    /// 任务完成
+    auto totalElapsed =
+            std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - startTimePoint);
+    if (exitCode != 0)
+    {
+        if (impl_->stalled_)
         {
-            /// 转换失败
+            markAsFailed("无进展超时 ✗");
         }
-    }
-
-    /// 查找 speed=
-    size_t speedPos = line.find("speed=");
-    if (speedPos != std::string::npos)
-    {
-        size_t end = line.find(' ', speedPos);
-        if (end == std::string::npos)
-            end = line.length();
-
-        speed = line.substr(speedPos + 6, end - speedPos - 6);
-
-        /// 清理速度字符串
-        std::erase(speed, ' ');
-        if (!speed.empty() && speed.back() != 'x')
+        else
         {
-            speed += "x";
+            markAsFailed();
         }
+        return;
     }
 
-    return hasProgress;
+    markAsCompleted();
+    showCompletionInfo(dstPath, totalElapsed);
 }
 
 auto AVProgressBar::parseTimeToSeconds(const std::string &timeStr) const -> double
@@ -430,34 +444,8 @@ auto AVProgressBar::calculateProgress(double currentTime, double startTime, doub
 
 auto AVProgressBar::estimateTotalDuration(const std::string_view &srcPath) const -> double
 {
-    std::string ffprobeCmd = XTool::getFFprobePath() +
-            " -v error -show_entries format=duration -of default=noprint_wrappers=1:nokey=1 \"" +
-            std::string{ srcPath } + "\"";
-
-    XExec exec;
-    if (exec.start(ffprobeCmd, true))
-    {
-        exec.wait();
-        std::string output = exec.getOutput();
-
-        try
-        {
-            /// 清理输出
-            std::erase(output, '\n');
-            std::erase(output, '\r');
-
-            if (!output.empty())
-            {
-                return std::stod(output);
-            }
-        }
-        catch (...)
-        {
-            /// 解析失败
-        }
-    }
-
-    return 0.0;
+    /// 同一文件只探测一次，结果持久化在探测缓存中
+    return MediaProbeCache::getInstance()->duration(srcPath);
 }
 
 auto AVProgressBar::getProgressInfo(double currentTime, double startTime, double totalDuration,
@@ -488,10 +476,10 @@ auto AVProgressBar::getProgressInfo(double currentTime, double startTime, double
         ss << " | " << speed;
     }
 
-    /// 计算剩余时间（如果有总时长和速度）
-    if (totalDuration > 0 && !speed.empty())
+    /// 剩余时间来自平滑速率估计，不依赖瞬时 speed
+    if (totalDuration > 0)
     {
-        std::string remainingTime = impl_->calculateRemainingTime(currentTime, startTime, totalDuration, speed);
+        std::string remainingTime = impl_->calculateRemainingTime();
         if (!remainingTime.empty())
         {
             ss << " | " << remainingTime;
@@ -570,3 +558,48 @@ auto AVProgressBar::setProgressState(const std::shared_ptr<AVProgressState> &sta
     state->clipDuration = clipDuration;
     state->timeRange    = timeRange;
 }
+
+auto AVProgressBar::setJobProfile(const std::shared_ptr<AVProgressState> &state, const std::string_view &taskName,
+                                  const std::map<std::string, ParameterValue> &inputParams,
+                                  const std::string_view &defaultCodec) const -> void
+{
+    auto paramOr = [&inputParams](const char *name, const std::string_view &fallback) -> std::string
+    {
+        auto it = inputParams.find(name);
+        return it != inputParams.end() && !it->second.empty() ? it->second.asString() : std::string(fallback);
+    };
+
+    auto &profile        = state->profile;
+    profile.task         = taskName;
+    profile.videoCodec   = paramOr("--video_codec", defaultCodec);
+    profile.preset       = paramOr("--preset", "-");
+    profile.source       = paramOr("--input", "");
+    profile.output       = paramOr("--output", "");
+    profile.mediaSeconds = state->clipDuration;
+    profile.resolution   = paramOr("--resolution", "");
+
+    /// 自动调参时记录实际选用的预设
+    if (profile.preset == "auto")
+    {
+        EncoderTuner::Decision decision;
+        if (EncoderTuner::getInstance()->lastDecision(profile.source, decision))
+        {
+            profile.preset = decision.preset;
+        }
+    }
+
+    /// 未缩放时按源分辨率分组（元数据来自探测缓存）
+    if (profile.resolution.empty())
+    {
+        profile.resolution = "-";
+        MediaProbeInfo info;
+        std::string    errorMsg;
+        if (MediaProbeCache::getInstance()->probe(profile.source, info, errorMsg))
+        {
+            if (const auto *video = info.videoStream(); video && video->width > 0)
+            {
+                profile.resolution = std::to_string(video->width) + "x" + std::to_string(video->height);
+            }
+        }
+    }
+}
@@ -1,7 +1,10 @@
 ﻿#include "AVTask.h"
+#include "FragmentNotifier.h"
+#include "ProgressDashboard.h"
 #include "XExec.h"
 #include "VideoFileValidator.h"
 
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 #include <sstream>
@@ -141,24 +144,76 @@ auto AVTask::validateCommon(const std::map<std::string, ParameterValue>& inputPa
 auto AVTask::execute(const std::string& command, const std::map<std::string, ParameterValue>& inputParams,
                      std::string& errorMsg, std::string& resultMsg) -> bool
 {
-    XExec exec;
+    /// 进度条检测到卡死会终止进程，按配置的次数重新执行
+    const auto bar        = progressBar();
+    const int  maxRetries = bar && bar->getConfig() ? std::max(0, bar->getConfig()->stallRetries) : 0;
 
-    /// 启动命令
-    if (!exec.start(command, true)) /// 合并 stderr 到 stdout
-    {
-        errorMsg = "启动FFmpeg命令失败";
-        return false;
-    }
+    /// 分片输出时跟踪输出文件，进度回调中按 total_size 的增长统计已写完的片段
+    const bool fragmented = inputParams.contains("--fragmented") && inputParams.contains("--output") &&
+            (inputParams.at("--fragmented").empty() || inputParams.at("--fragmented").asBool());
+    const std::string output   = fragmented ? inputParams.at("--output").asString() : std::string();
+    auto*             notifier = FragmentNotifier::getInstance();
 
-    /// 显示进度条（使用FFmpeg特定的进度监控）
-    updateProgress(exec, getName(), inputParams);
-    if (!waitProgress(exec, inputParams, errorMsg))
+    for (int attempt = 0;; ++attempt)
     {
-        return false;
+        XExec exec;
+
+        /// 启动命令
+        if (!exec.start(command, true)) /// 合并 stderr 到 stdout
+        {
+            errorMsg = "启动FFmpeg命令失败";
+            return false;
+        }
+        if (fragmented)
+        {
+            notifier->watch(output);
+        }
+
+        /// 显示进度条（使用FFmpeg特定的进度监控）
+        updateProgress(exec, getName(), inputParams);
+        if (bar && bar->isStalled())
+        {
+            exec.wait();
+            if (fragmented)
+            {
+                notifier->finish(output, false);
+            }
+            if (attempt < maxRetries)
+            {
+                if (ProgressDashboard::isThreadVisible())
+                {
+                    std::cout << "[卡死检测] 第 " << attempt + 1 << "/" << maxRetries << " 次重试" << std::endl;
+                }
+                continue;
+            }
+            errorMsg = "FFmpeg长时间没有进展，已终止（重试 " + std::to_string(maxRetries) + " 次）";
+            return false;
+        }
+
+        const bool ok = waitProgress(exec, inputParams, errorMsg);
+        if (fragmented)
+        {
+            const size_t fragments = notifier->finish(output, ok);
+            if (ok && ProgressDashboard::isThreadVisible())
+            {
+                std::cout << "[分片输出] 共 " << fragments << " 个片段" << std::endl;
+            }
+        }
+        if (!ok)
+        {
+            return false;
+        }
+        resultMsg = exec.getOutput();
+
+        return true;
     }
-    resultMsg = exec.getOutput();
+}
 
-    return true;
+auto AVTask::clone() const -> XTask::Ptr
+{
+    auto task = std::make_shared<AVTask>(getName(), TaskFunc{}, getDescription());
+    copyDefinitionTo(*task);
+    return task;
 }
 
 
@@ -0,0 +1,875 @@
+﻿#include "AesEngine.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define XAES_X86 1
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define XAES_TARGET
+#else
+#define XAES_TARGET __attribute__((target("aes,sse2")))
+#endif
+#endif
+
+namespace
+{
+    constexpr size_t BLOCK_SIZE = 16;
+    constexpr int    MAX_ROUNDS = 14;
+
+    auto loadU32(const uint8_t *p) -> uint32_t
+    {
+        return (uint32_t{ p[0] } << 24) | (uint32_t{ p[1] } << 16) | (uint32_t{ p[2] } << 8) | uint32_t{ p[3] };
+    }
+
+    auto storeU32(uint8_t *p, uint32_t v) -> void
+    {
+        p[0] = static_cast<uint8_t>(v >> 24);
+        p[1] = static_cast<uint8_t>(v >> 16);
+        p[2] = static_cast<uint8_t>(v >> 8);
+        p[3] = static_cast<uint8_t>(v);
+    }
+
+    /// S盒与 T 表（启动时由 GF(2^8) 运算生成，避免手抄常量）
+    struct AesTables
+    {
+        uint8_t  sbox[256];
+        uint8_t  invSbox[256];
+        uint32_t te[4][256];
+        uint32_t td[4][256];
+
+        AesTables()
+        {
+            auto rotl8 = [](uint8_t x, int shift) -> uint8_t
+            { return static_cast<uint8_t>((x << shift) | (x >> (8 - shift))); };
+            auto mul = [](uint8_t a, uint8_t b) -> uint8_t
+            {
+                uint8_t product = 0;
+                while (b)
+                {
+                    if (b & 1)
+                    {
+                        product ^= a;
+                    }
+                    a = static_cast<uint8_t>((a << 1) ^ ((a & 0x80) ? 0x1B : 0));
+                    b >>= 1;
+                }
+                return product;
+            };
+
+            uint8_t p = 1, q = 1;
+            do
+            {
+                /// p 乘以 3，q 除以 3（即求逆）
+                p = static_cast<uint8_t>(p ^ (p << 1) ^ ((p & 0x80) ? 0x1B : 0));
+                q ^= static_cast<uint8_t>(q << 1);
+                q ^= static_cast<uint8_t>(q << 2);
+                q ^= static_cast<uint8_t>(q << 4);
+                if (q & 0x80)
+                {
+                    q ^= 0x09;
+                }
+                uint8_t x = q ^ rotl8(q, 1) ^ rotl8(q, 2) ^ rotl8(q, 3) ^ rotl8(q, 4);
+                sbox[p]   = x ^ 0x63;
+            }
+            while (p != 1);
+            sbox[0] = 0x63;
+
+            for (int i = 0; i < 256; ++i)
+            {
+                invSbox[sbox[i]] = static_cast<uint8_t>(i);
+            }
+
+            for (int i = 0; i < 256; ++i)
+            {
+                uint8_t s  = sbox[i];
+                uint8_t si = invSbox[i];
+                te[0][i]   = (uint32_t{ mul(s, 2) } << 24) | (uint32_t{ s } << 16) | (uint32_t{ s } << 8) | mul(s, 3);
+                td[0][i]   = (uint32_t{ mul(si, 14) } << 24) | (uint32_t{ mul(si, 9) } << 16) |
+                        (uint32_t{ mul(si, 13) } << 8) | mul(si, 11);
+                for (int t = 1; t < 4; ++t)
+                {
+                    te[t][i] = std::rotr(te[0][i], 8 * t);
+                    td[t][i] = std::rotr(td[0][i], 8 * t);
+                }
+            }
+        }
+    };
+
+    auto tables() -> const AesTables &
+    {
+        static const AesTables instance;
+        return instance;
+    }
+
+    /// 展开后的轮密钥（字形式供查表实现，字节形式供 AES-NI 直接加载）
+    struct KeySchedule
+    {
+        int      rounds = 0;
+        uint32_t ek[4 * (MAX_ROUNDS + 1)];
+        uint32_t dk[4 * (MAX_ROUNDS + 1)]; ///< 等价逆密码的轮密钥
+        alignas(16) uint8_t ekBytes[BLOCK_SIZE * (MAX_ROUNDS + 1)];
+        alignas(16) uint8_t dkBytes[BLOCK_SIZE * (MAX_ROUNDS + 1)];
+    };
+
+    auto expandKey(const std::vector<uint8_t> &key, KeySchedule &ks) -> void
+    {
+        static constexpr uint8_t rcon[] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36 };
+
+        const auto &tb = tables();
+        auto        subWord = [&tb](uint32_t w) -> uint32_t
+        {
+            return (uint32_t{ tb.sbox[w >> 24] } << 24) | (uint32_t{ tb.sbox[(w >> 16) & 0xFF] } << 16) |
+                    (uint32_t{ tb.sbox[(w >> 8) & 0xFF] } << 8) | tb.sbox[w & 0xFF];
+        };
+
+        int nk    = static_cast<int>(key.size() / 4);
+        ks.rounds = nk + 6;
+        int total = 4 * (ks.rounds + 1);
+        for (int i = 0; i < nk; ++i)
+        {
+            ks.ek[i] = loadU32(key.data() + 4 * i);
+        }
+        for (int i = nk; i < total; ++i)
+        {
+            uint32_t temp = ks.ek[i - 1];
+            if (i % nk == 0)
+            {
+                temp = subWord(std::rotl(temp, 8)) ^ (uint32_t{ rcon[i / nk - 1] } << 24);
+            }
+            else if (nk > 6 && i % nk == 4)
+            {
+                temp = subWord(temp);
+            }
+            ks.ek[i] = ks.ek[i - nk] ^ temp;
+        }
+
+        /// 解密轮密钥：逆序，中间各轮做 InvMixColumns
+        for (int r = 0; r <= ks.rounds; ++r)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                uint32_t w = ks.ek[4 * (ks.rounds - r) + c];
+                if (r != 0 && r != ks.rounds)
+                {
+                    w = tb.td[0][tb.sbox[w >> 24]] ^ tb.td[1][tb.sbox[(w >> 16) & 0xFF]] ^
+                            tb.td[2][tb.sbox[(w >> 8) & 0xFF]] ^ tb.td[3][tb.sbox[w & 0xFF]];
+                }
+                ks.dk[4 * r + c] = w;
+            }
+        }
+
+        for (int i = 0; i < total; ++i)
+        {
+            storeU32(ks.ekBytes + 4 * i, ks.ek[i]);
+            storeU32(ks.dkBytes + 4 * i, ks.dk[i]);
+        }
+    }
+
+    auto encryptBlockSoft(const KeySchedule &ks, const uint8_t *in, uint8_t *out) -> void
+    {
+        const auto     &tb = tables();
+        const uint32_t *rk = ks.ek;
+
+        uint32_t s0 = loadU32(in) ^ rk[0];
+        uint32_t s1 = loadU32(in + 4) ^ rk[1];
+        uint32_t s2 = loadU32(in + 8) ^ rk[2];
+        uint32_t s3 = loadU32(in + 12) ^ rk[3];
+
+        for (int r = 1; r < ks.rounds; ++r)
+        {
+            rk += 4;
+            uint32_t t0 = tb.te[0][s0 >> 24] ^ tb.te[1][(s1 >> 16) & 0xFF] ^ tb.te[2][(s2 >> 8) & 0xFF] ^
+                    tb.te[3][s3 & 0xFF] ^ rk[0];
+            uint32_t t1 = tb.te[0][s1 >> 24] ^ tb.te[1][(s2 >> 16) & 0xFF] ^ tb.te[2][(s3 >> 8) & 0xFF] ^
+                    tb.te[3][s0 & 0xFF] ^ rk[1];
+            uint32_t t2 = tb.te[0][s2 >> 24] ^ tb.te[1][(s3 >> 16) & 0xFF] ^ tb.te[2][(s0 >> 8) & 0xFF] ^
+                    tb.te[3][s1 & 0xFF] ^ rk[2];
+            uint32_t t3 = tb.te[0][s3 >> 24] ^ tb.te[1][(s0 >> 16) & 0xFF] ^ tb.te[2][(s1 >> 8) & 0xFF] ^
+                    tb.te[3][s2 & 0xFF] ^ rk[3];
+            s0 = t0;
+            s1 = t1;
+            s2 = t2;
+            s3 = t3;
+        }
+
+        rk += 4;
+        auto last = [&tb](uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t k) -> uint32_t
+        {
+            return (uint32_t{ tb.sbox[a >> 24] } << 24) ^ (uint32_t{ tb.sbox[(b >> 16) & 0xFF] } << 16) ^
+                    (uint32_t{ tb.sbox[(c >> 8) & 0xFF] } << 8) ^ tb.sbox[d & 0xFF] ^ k;
+        };
+        storeU32(out, last(s0, s1, s2, s3, rk[0]));
+        storeU32(out + 4, last(s1, s2, s3, s0, rk[1]));
+        storeU32(out + 8, last(s2, s3, s0, s1, rk[2]));
+        storeU32(out + 12, last(s3, s0, s1, s2, rk[3]));
+    }
+
+    auto decryptBlockSoft(const KeySchedule &ks, const uint8_t *in, uint8_t *out) -> void
+    {
+        const auto     &tb = tables();
+        const uint32_t *rk = ks.dk;
+
+        uint32_t s0 = loadU32(in) ^ rk[0];
+        uint32_t s1 = loadU32(in + 4) ^ rk[1];
+        uint32_t s2 = loadU32(in + 8) ^ rk[2];
+        uint32_t s3 = loadU32(in + 12) ^ rk[3];
+
+        for (int r = 1; r < ks.rounds; ++r)
+        {
+            rk += 4;
+            uint32_t t0 = tb.td[0][s0 >> 24] ^ tb.td[1][(s3 >> 16) & 0xFF] ^ tb.td[2][(s2 >> 8) & 0xFF] ^
+                    tb.td[3][s1 & 0xFF] ^ rk[0];
+            uint32_t t1 = tb.td[0][s1 >> 24] ^ tb.td[1][(s0 >> 16) & 0xFF] ^ tb.td[2][(s3 >> 8) & 0xFF] ^
+                    tb.td[3][s2 & 0xFF] ^ rk[1];
+            uint32_t t2 = tb.td[0][s2 >> 24] ^ tb.td[1][(s1 >> 16) & 0xFF] ^ tb.td[2][(s0 >> 8) & 0xFF] ^
+                    tb.td[3][s3 & 0xFF] ^ rk[2];
+            uint32_t t3 = tb.td[0][s3 >> 24] ^ tb.td[1][(s2 >> 16) & 0xFF] ^ tb.td[2][(s1 >> 8) & 0xFF] ^
+                    tb.td[3][s0 & 0xFF] ^ rk[3];
+            s0 = t0;
+            s1 = t1;
+            s2 = t2;
+            s3 = t3;
+        }
+
+        rk += 4;
+        auto last = [&tb](uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t k) -> uint32_t
+        {
+            return (uint32_t{ tb.invSbox[a >> 24] } << 24) ^ (uint32_t{ tb.invSbox[(b >> 16) & 0xFF] } << 16) ^
+                    (uint32_t{ tb.invSbox[(c >> 8) & 0xFF] } << 8) ^ tb.invSbox[d & 0xFF] ^ k;
+        };
+        storeU32(out, last(s0, s3, s2, s1, rk[0]));
+        storeU32(out + 4, last(s1, s0, s3, s2, rk[1]));
+        storeU32(out + 8, last(s2, s1, s0, s3, rk[2]));
+        storeU32(out + 12, last(s3, s2, s1, s0, rk[3]));
+    }
+
+    /// 128 位大端计数器（与 OpenSSL CTR 一致，整个 16 字节参与进位）
+    struct Counter
+    {
+        uint64_t hi = 0;
+        uint64_t lo = 0;
+
+        static auto fromBytes(const uint8_t *iv) -> Counter
+        {
+            Counter c;
+            for (int i = 0; i < 8; ++i)
+            {
+                c.hi = (c.hi << 8) | iv[i];
+                c.lo = (c.lo << 8) | iv[8 + i];
+            }
+            return c;
+        }
+
+        auto add(uint64_t blocks) const -> Counter
+        {
+            Counter c{ hi, lo + blocks };
+            if (c.lo < lo)
+            {
+                c.hi++;
+            }
+            return c;
+        }
+
+        auto toBytes(uint8_t *out) const -> void
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                out[i]     = static_cast<uint8_t>(hi >> (56 - 8 * i));
+                out[8 + i] = static_cast<uint8_t>(lo >> (56 - 8 * i));
+            }
+        }
+    };
+
+    auto xorBlock(uint8_t *out, const uint8_t *a, const uint8_t *b, size_t len) -> void
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            out[i] = a[i] ^ b[i];
+        }
+    }
+
+    auto ctrSoft(const KeySchedule &ks, Counter counter, const uint8_t *in, uint8_t *out, size_t len) -> void
+    {
+        uint8_t block[BLOCK_SIZE], stream[BLOCK_SIZE];
+        for (size_t pos = 0; pos < len; pos += BLOCK_SIZE)
+        {
+            counter.toBytes(block);
+            encryptBlockSoft(ks, block, stream);
+            xorBlock(out + pos, in + pos, stream, std::min(BLOCK_SIZE, len - pos));
+            counter = counter.add(1);
+        }
+    }
+
+    auto cbcDecryptSoft(const KeySchedule &ks, const uint8_t *prev, const uint8_t *in, uint8_t *out, size_t blocks)
+            -> void
+    {
+        uint8_t plain[BLOCK_SIZE];
+        for (size_t i = 0; i < blocks; ++i)
+        {
+            decryptBlockSoft(ks, in + i * BLOCK_SIZE, plain);
+            xorBlock(out + i * BLOCK_SIZE, plain, i == 0 ? prev : in + (i - 1) * BLOCK_SIZE, BLOCK_SIZE);
+        }
+    }
+
+    auto cbcEncryptSoft(const KeySchedule &ks, uint8_t *chain, const uint8_t *in, uint8_t *out, size_t blocks)
+            -> void
+    {
+        uint8_t block[BLOCK_SIZE];
+        for (size_t i = 0; i < blocks; ++i)
+        {
+            xorBlock(block, in + i * BLOCK_SIZE, chain, BLOCK_SIZE);
+            encryptBlockSoft(ks, block, out + i * BLOCK_SIZE);
+            std::memcpy(chain, out + i * BLOCK_SIZE, BLOCK_SIZE);
+        }
+    }
+
+#ifdef XAES_X86
+    /// AES-NI 实现：一次处理 8 个块以填满 aesenc/aesdec 流水线
+    constexpr size_t HW_LANES = 8;
+
+    XAES_TARGET auto ctrHardware(const KeySchedule &ks, Counter counter, const uint8_t *in, uint8_t *out,
+                                 size_t len) -> void
+    {
+        __m128i rk[MAX_ROUNDS + 1];
+        for (int r = 0; r <= ks.rounds; ++r)
+        {
+            rk[r] = _mm_load_si128(reinterpret_cast<const __m128i *>(ks.ekBytes) + r);
+        }
+
+        auto counterBlock = [](const Counter &c) -> __m128i
+        {
+            return _mm_set_epi64x(static_cast<long long>(std::byteswap(c.lo)),
+                                  static_cast<long long>(std::byteswap(c.hi)));
+        };
+
+        size_t pos = 0;
+        for (; pos + HW_LANES * BLOCK_SIZE <= len; pos += HW_LANES * BLOCK_SIZE)
+        {
+            __m128i b[HW_LANES];
+            for (size_t j = 0; j < HW_LANES; ++j)
+            {
+                b[j] = _mm_xor_si128(counterBlock(counter.add(j)), rk[0]);
+            }
+            for (int r = 1; r < ks.rounds; ++r)
+            {
+                for (auto &block : b)
+                {
+                    block = _mm_aesenc_si128(block, rk[r]);
+                }
+            }
+            for (size_t j = 0; j < HW_LANES; ++j)
+            {
+                b[j]      = _mm_aesenclast_si128(b[j], rk[ks.rounds]);
+                auto *src = reinterpret_cast<const __m128i *>(in + pos) + j;
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + pos) + j, _mm_xor_si128(_mm_loadu_si128(src), b[j]));
+            }
+            counter = counter.add(HW_LANES);
+        }
+
+        for (; pos < len; pos += BLOCK_SIZE)
+        {
+            __m128i b = _mm_xor_si128(counterBlock(counter), rk[0]);
+            for (int r = 1; r < ks.rounds; ++r)
+            {
+                b = _mm_aesenc_si128(b, rk[r]);
+            }
+            b = _mm_aesenclast_si128(b, rk[ks.rounds]);
+
+            alignas(16) uint8_t stream[BLOCK_SIZE];
+            _mm_store_si128(reinterpret_cast<__m128i *>(stream), b);
+            xorBlock(out + pos, in + pos, stream, std::min(BLOCK_SIZE, len - pos));
+            counter = counter.add(1);
+        }
+    }
+
+    XAES_TARGET auto cbcDecryptHardware(const KeySchedule &ks, const uint8_t *prev, const uint8_t *in, uint8_t *out,
+                                        size_t blocks) -> void
+    {
+        __m128i rk[MAX_ROUNDS + 1];
+        for (int r = 0; r <= ks.rounds; ++r)
+        {
+            rk[r] = _mm_load_si128(reinterpret_cast<const __m128i *>(ks.dkBytes) + r);
+        }
+
+        __m128i        chain = _mm_loadu_si128(reinterpret_cast<const __m128i *>(prev));
+        const __m128i *src   = reinterpret_cast<const __m128i *>(in);
+        __m128i       *dst   = reinterpret_cast<__m128i *>(out);
+
+        size_t i = 0;
+        for (; i + HW_LANES <= blocks; i += HW_LANES)
+        {
+            __m128i c[HW_LANES], b[HW_LANES];
+            for (size_t j = 0; j < HW_LANES; ++j)
+            {
+                c[j] = _mm_loadu_si128(src + i + j);
+                b[j] = _mm_xor_si128(c[j], rk[0]);
+            }
+            for (int r = 1; r < ks.rounds; ++r)
+            {
+                for (auto &block : b)
+                {
+                    block = _mm_aesdec_si128(block, rk[r]);
+                }
+            }
+            for (size_t j = 0; j < HW_LANES; ++j)
+            {
+                b[j] = _mm_aesdeclast_si128(b[j], rk[ks.rounds]);
+                _mm_storeu_si128(dst + i + j, _mm_xor_si128(b[j], j == 0 ? chain : c[j - 1]));
+            }
+            chain = c[HW_LANES - 1];
+        }
+
+        for (; i < blocks; ++i)
+        {
+            __m128i c = _mm_loadu_si128(src + i);
+            __m128i b = _mm_xor_si128(c, rk[0]);
+            for (int r = 1; r < ks.rounds; ++r)
+            {
+                b = _mm_aesdec_si128(b, rk[r]);
+            }
+            b = _mm_aesdeclast_si128(b, rk[ks.rounds]);
+            _mm_storeu_si128(dst + i, _mm_xor_si128(b, chain));
+            chain = c;
+        }
+    }
+
+    XAES_TARGET auto cbcEncryptHardware(const KeySchedule &ks, uint8_t *chainBytes, const uint8_t *in, uint8_t *out,
+                                        size_t blocks) -> void
+    {
+        __m128i rk[MAX_ROUNDS + 1];
+        for (int r = 0; r <= ks.rounds; ++r)
+        {
+            rk[r] = _mm_load_si128(reinterpret_cast<const __m128i *>(ks.ekBytes) + r);
+        }
+
+        __m128i chain = _mm_loadu_si128(reinterpret_cast<const __m128i *>(chainBytes));
+        for (size_t i = 0; i < blocks; ++i)
+        {
+            __m128i b = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in) + i), chain);
+            b         = _mm_xor_si128(b, rk[0]);
+            for (int r = 1; r < ks.rounds; ++r)
+            {
+                b = _mm_aesenc_si128(b, rk[r]);
+            }
+            chain = _mm_aesenclast_si128(b, rk[ks.rounds]);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out) + i, chain);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(chainBytes), chain);
+    }
+#endif
+} // namespace
+
+class AesEngine::PImpl
+{
+public:
+    PImpl(AesEngine *owner);
+    ~PImpl() = default;
+
+public:
+    auto process(bool encrypt, const std::string_view &input, const std::string_view &output, const Options &options,
+                 Result &result, std::string &errorMsg, const ProgressCallback &progress) const -> bool;
+
+    auto ctr(const KeySchedule &ks, Counter counter, const uint8_t *in, uint8_t *out, size_t len) const -> void;
+
+    auto cbcDecrypt(const KeySchedule &ks, const uint8_t *prev, const uint8_t *in, uint8_t *out, size_t blocks) const
+            -> void;
+
+    auto cbcEncrypt(const KeySchedule &ks, uint8_t *chain, const uint8_t *in, uint8_t *out, size_t blocks) const
+            -> void;
+
+public:
+    AesEngine *owner_         = nullptr;
+    bool       forceSoftware_ = false;
+    bool       hardware_      = false;
+};
+
+AesEngine::PImpl::PImpl(AesEngine *owner) : owner_(owner)
+{
+    hardware_ = AesEngine::hasHardwareAes();
+}
+
+auto AesEngine::PImpl::ctr(const KeySchedule &ks, Counter counter, const uint8_t *in, uint8_t *out, size_t len) const
+        -> void
+{
+#ifdef XAES_X86
+    if (hardware_ && !forceSoftware_)
+    {
+        ctrHardware(ks, counter, in, out, len);
+        return;
+    }
+#endif
+    ctrSoft(ks, counter, in, out, len);
+}
+
+auto AesEngine::PImpl::cbcDecrypt(const KeySchedule &ks, const uint8_t *prev, const uint8_t *in, uint8_t *out,
+                                  size_t blocks) const -> void
+{
+#ifdef XAES_X86
+    if (hardware_ && !forceSoftware_)
+    {
+        cbcDecryptHardware(ks, prev, in, out, blocks);
+        return;
+    }
+#endif
+    cbcDecryptSoft(ks, prev, in, out, blocks);
+}
+
+auto AesEngine::PImpl::cbcEncrypt(const KeySchedule &ks, uint8_t *chain, const uint8_t *in, uint8_t *out,
+                                  size_t blocks) const -> void
+{
+#ifdef XAES_X86
+    if (hardware_ && !forceSoftware_)
+    {
+        cbcEncryptHardware(ks, chain, in, out, blocks);
+        return;
+    }
+#endif
+    cbcEncryptSoft(ks, chain, in, out, blocks);
+}
+
+auto AesEngine::PImpl::process(bool encrypt, const std::string_view &input, const std::string_view &output,
+                               const Options &options, Result &result, std::string &errorMsg,
+                               const ProgressCallback &progress) const -> bool
+{
+    auto start = std::chrono::steady_clock::now();
+    result     = Result{};
+
+    if (options.key.size() != 16 && options.key.size() != 24 && options.key.size() != 32)
+    {
+        errorMsg = "AES密钥长度必须为16/24/32字节，当前: " + std::to_string(options.key.size());
+        return false;
+    }
+
+    std::error_code ec;
+    if (fs::exists(output, ec) && fs::equivalent(input, output, ec))
+    {
+        errorMsg = "输入与输出不能是同一个文件";
+        return false;
+    }
+
+    KeySchedule ks;
+    expandKey(options.key, ks);
+
+    MappedFile in;
+    if (!in.openRead(input, errorMsg))
+    {
+        return false;
+    }
+    in.advise(MappedFile::Advice::Sequential);
+
+    const uint8_t *src  = in.data();
+    uint64_t       size = in.size();
+
+    /// 1. 计算输出大小（CBC 解密先解最后一块校验填充，得到精确长度）
+    uint64_t outSize = size;
+    uint8_t  lastPlain[BLOCK_SIZE];
+    size_t   padding = 0;
+    if (options.mode == Mode::CBC)
+    {
+        if (encrypt)
+        {
+            outSize = (size / BLOCK_SIZE + 1) * BLOCK_SIZE;
+        }
+        else
+        {
+            if (size == 0 || size % BLOCK_SIZE != 0)
+            {
+                errorMsg = "密文长度不是16字节的整数倍，无法进行CBC解密";
+                return false;
+            }
+            const uint8_t *prev = size >= 2 * BLOCK_SIZE ? src + size - 2 * BLOCK_SIZE : options.iv.data();
+            cbcDecrypt(ks, prev, src + size - BLOCK_SIZE, lastPlain, 1);
+
+            padding = lastPlain[BLOCK_SIZE - 1];
+            bool ok = padding >= 1 && padding <= BLOCK_SIZE;
+            for (size_t i = BLOCK_SIZE - padding; ok && i < BLOCK_SIZE; ++i)
+            {
+                ok = lastPlain[i] == padding;
+            }
+            if (!ok)
+            {
+                errorMsg = "PKCS#7填充校验失败（密钥或IV错误？）";
+                return false;
+            }
+            outSize = size - padding;
+        }
+    }
+
+    MappedFile out;
+    if (!out.create(output, outSize, errorMsg))
+    {
+        return false;
+    }
+    uint8_t *dst = out.mutableData();
+
+    /// 2. 切分任务：CTR 全文件、CBC 解密除最后一块外均可按块并行；CBC 加密只能串行
+    size_t   chunk = std::max<size_t>(options.chunkSize / BLOCK_SIZE * BLOCK_SIZE, BLOCK_SIZE);
+    uint64_t parallelBytes;
+    if (options.mode == Mode::CTR)
+    {
+        parallelBytes = size;
+    }
+    else if (!encrypt)
+    {
+        parallelBytes = size - BLOCK_SIZE;
+    }
+    else
+    {
+        parallelBytes = 0;
+    }
+
+    size_t chunkCount = static_cast<size_t>((parallelBytes + chunk - 1) / chunk);
+    int    threads    = options.threads > 0 ? options.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threads           = static_cast<int>(std::clamp<size_t>(threads, 1, std::max<size_t>(chunkCount, 1)));
+
+    std::atomic<size_t>     nextChunk{ 0 };
+    std::atomic<uint64_t>   processed{ 0 };
+    int                     running = threads;
+    std::mutex              doneMtx;
+    std::condition_variable doneCv;
+    Counter                 base = Counter::fromBytes(options.iv.data());
+
+    auto worker = [&]()
+    {
+        if (options.mode == Mode::CBC && encrypt)
+        {
+            /// 串行 CBC 加密，按块大小分段以便上报进度
+            uint8_t  chain[BLOCK_SIZE];
+            uint64_t fullBlocks = size / BLOCK_SIZE;
+            std::memcpy(chain, options.iv.data(), BLOCK_SIZE);
+            for (uint64_t block = 0; block < fullBlocks;)
+            {
+                uint64_t count = std::min<uint64_t>(chunk / BLOCK_SIZE, fullBlocks - block);
+                cbcEncrypt(ks, chain, src + block * BLOCK_SIZE, dst + block * BLOCK_SIZE, count);
+                block += count;
+                processed.fetch_add(count * BLOCK_SIZE, std::memory_order_relaxed);
+            }
+
+            uint8_t tail[BLOCK_SIZE];
+            size_t  remain = size % BLOCK_SIZE;
+            std::memcpy(tail, src + fullBlocks * BLOCK_SIZE, remain);
+            std::memset(tail + remain, static_cast<int>(BLOCK_SIZE - remain), BLOCK_SIZE - remain);
+            cbcEncrypt(ks, chain, tail, dst + fullBlocks * BLOCK_SIZE, 1);
+            processed.fetch_add(remain, std::memory_order_relaxed);
+        }
+        else
+        {
+            for (size_t k = nextChunk.fetch_add(1); k < chunkCount; k = nextChunk.fetch_add(1))
+            {
+                uint64_t offset = uint64_t{ k } * chunk;
+                size_t   len    = static_cast<size_t>(std::min<uint64_t>(chunk, parallelBytes - offset));
+                if (options.mode == Mode::CTR)
+                {
+                    ctr(ks, base.add(offset / BLOCK_SIZE), src + offset, dst + offset, len);
+                }
+                else
+                {
+                    const uint8_t *prev = offset == 0 ? options.iv.data() : src + offset - BLOCK_SIZE;
+                    cbcDecrypt(ks, prev, src + offset, dst + offset, len / BLOCK_SIZE);
+                }
+                processed.fetch_add(len, std::memory_order_relaxed);
+            }
+        }
+        std::lock_guard<std::mutex> lock(doneMtx);
+        if (--running == 0)
+        {
+            doneCv.notify_one();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (int i = 0; i < threads; ++i)
+    {
+        pool.emplace_back(worker);
+    }
+    {
+        /// 等待期间每 100ms 上报一次进度，全部完成时立即返回
+        std::unique_lock<std::mutex> lock(doneMtx);
+        while (!doneCv.wait_for(lock, std::chrono::milliseconds(100), [&running] { return running == 0; }))
+        {
+            if (progress)
+            {
+                progress(processed.load(std::memory_order_relaxed), size);
+            }
+        }
+    }
+    for (auto &thread : pool)
+    {
+        thread.join();
+    }
+
+    if (options.mode == Mode::CBC && !encrypt)
+    {
+        std::memcpy(dst + size - BLOCK_SIZE, lastPlain, BLOCK_SIZE - padding);
+    }
+    if (progress)
+    {
+        progress(size, size);
+    }
+
+    /// 映射写入的错误（磁盘满、I/O 错误）只在写回时暴露：写回失败不能报告成功，删除不完整的输出
+    const bool written = out.flush();
+    const bool closed  = out.close();
+    in.close();
+    if (!written || !closed)
+    {
+        errorMsg = "写入输出文件失败: " + std::string(output) + " (" + std::strerror(errno) + ")";
+        fs::remove(output, ec);
+        return false;
+    }
+
+    result.inputBytes  = size;
+    result.outputBytes = outSize;
+    result.threads     = threads;
+    result.hardware    = hardware_ && !forceSoftware_;
+    result.seconds     = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+AesEngine::AesEngine() : impl_(std::make_unique<PImpl>(this))
+{
+}
+
+AesEngine::~AesEngine() = default;
+
+auto AesEngine::encryptFile(const std::string_view &input, const std::string_view &output, const Options &options,
+                            Result &result, std::string &errorMsg, const ProgressCallback &progress) const -> bool
+{
+    return impl_->process(true, input, output, options, result, errorMsg, progress);
+}
+
+auto AesEngine::decryptFile(const std::string_view &input, const std::string_view &output, const Options &options,
+                            Result &result, std::string &errorMsg, const ProgressCallback &progress) const -> bool
+{
+    return impl_->process(false, input, output, options, result, errorMsg, progress);
+}
+
+auto AesEngine::setForceSoftware(bool force) -> void
+{
+    impl_->forceSoftware_ = force;
+}
+
+auto AesEngine::isNativeMethod(const std::string_view &method) -> bool
+{
+    Mode   mode;
+    size_t keyBytes;
+    return parseMethod(method, mode, keyBytes);
+}
+
+auto AesEngine::parseMethod(const std::string_view &method, Mode &mode, size_t &keyBytes) -> bool
+{
+    std::string lower(method);
+    std::ranges::transform(lower, lower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (!lower.starts_with("aes-") || lower.size() != 11)
+    {
+        return false;
+    }
+
+    std::string bits = lower.substr(4, 3);
+    std::string name = lower.substr(8);
+    if (bits == "128")
+    {
+        keyBytes = 16;
+    }
+    else if (bits == "192")
+    {
+        keyBytes = 24;
+    }
+    else if (bits == "256")
+    {
+        keyBytes = 32;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (name == "ctr")
+    {
+        mode = Mode::CTR;
+    }
+    else if (name == "cbc")
+    {
+        mode = Mode::CBC;
+    }
+    else
+    {
+        return false;
+    }
+    return lower[7] == '-';
+}
+
+auto AesEngine::hasHardwareAes() -> bool
+{
+#ifdef XAES_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 25)) != 0;
+#else
+    static const bool supported = __builtin_cpu_supports("aes");
+    return supported;
+#endif
+#else
+    return false;
+#endif
+}
+
+auto AesEngine::fromHex(const std::string_view &hex, std::vector<uint8_t> &bytes) -> bool
+{
+    auto nibble = [](char c) -> int
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    };
+
+    if (hex.size() % 2 != 0)
+    {
+        return false;
+    }
+
+    bytes.clear();
+    bytes.reserve(hex.size() / 2);
+    for (size_t i = 0; i < hex.size(); i += 2)
+    {
+        int high = nibble(hex[i]);
+        int low  = nibble(hex[i + 1]);
+        if (high < 0 || low < 0)
+        {
+            return false;
+        }
+        bytes.push_back(static_cast<uint8_t>((high << 4) | low));
+    }
+    return true;
+}
+
+auto AesEngine::toHex(const uint8_t *data, size_t size) -> std::string
+{
+    static const char hexChars[] = "0123456789abcdef";
+    std::string       hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hex.push_back(hexChars[data[i] >> 4]);
+        hex.push_back(hexChars[data[i] & 0x0F]);
+    }
+    return hex;
+}
@@ -1,6 +1,10 @@
 ﻿#include "AnalyzeCommandBuilder.h"
 #include "XTool.h"
+#include "MediaProbeCache.h"
+#include "FrameStatsAnalyzer.h"
+#include "XExec.h"
 #include <sstream>
+#include <iomanip>
 #include <iostream>
 #include <algorithm>
 #include <cctype>
@@ -64,6 +68,33 @@ auto AnalyzeCommandBuilder::parseOptions(const std::map<std::string, ParameterVa
         options.show_error = (val == "true" || val == "1" || val == "yes" || val == "on");
     }
 
+    if (params.contains("--cached"))
+    {
+        std::string val = params.at("--cached").asString();
+        std::ranges::transform(val, val.begin(), ::tolower);
+        options.cached = (val.empty() || val == "true" || val == "1" || val == "yes" || val == "on");
+    }
+
+    if (params.contains("--keyframes"))
+    {
+        std::string val = params.at("--keyframes").asString();
+        std::ranges::transform(val, val.begin(), ::tolower);
+        options.keyframes = (val.empty() || val == "true" || val == "1" || val == "yes" || val == "on");
+    }
+
+    if (params.contains("--frame-stats"))
+    {
+        std::string val = params.at("--frame-stats").asString();
+        std::ranges::transform(val, val.begin(), ::tolower);
+        options.frame_stats = (val.empty() || val == "true" || val == "1" || val == "yes" || val == "on");
+    }
+
+    if (params.contains("--frame-table"))
+    {
+        options.frame_table = params.at("--frame-table").asString();
+        options.frame_stats = options.frame_stats || !options.frame_table.empty();
+    }
+
     return options;
 }
 
@@ -225,4 +256,138 @@ auto AnalyzeCommandBuilder::getTitle(const std::map<std::string, ParameterValue>
     return title;
 }
 
+auto AnalyzeCommandBuilder::isInProcess(const std::map<std::string, ParameterValue>& params) const -> bool
+{
+    AnalyzeOptions options = parseOptions(params);
+    return options.cached || options.frame_stats;
+}
+
+auto AnalyzeCommandBuilder::run(const std::map<std::string, ParameterValue>& params, std::string& resultMsg,
+                                std::string& errorMsg) const -> bool
+{
+    AnalyzeOptions options = parseOptions(params);
+    if (options.frame_stats)
+    {
+        return runFrameStats(options, params, resultMsg, errorMsg);
+    }
+    return runCachedSummary(options, resultMsg, errorMsg);
+}
+
+auto AnalyzeCommandBuilder::runFrameStats(const AnalyzeOptions& options,
+                                          const std::map<std::string, ParameterValue>& params, std::string& resultMsg,
+                                          std::string& errorMsg) const -> bool
+{
+    FrameStatsAnalyzer analyzer;
+    if (!options.frame_table.empty() && !analyzer.openFrameTable(options.frame_table, errorMsg))
+    {
+        return false;
+    }
+
+    std::string selectStreams = params.contains("--select-streams") ? params.at("--select-streams").asString() : "v:0";
+    std::string command       = FrameStatsAnalyzer::buildProbeCommand(options.input, selectStreams);
+    std::cout << "执行命令: " << command << std::endl;
+
+    /// 不累积输出，逐行喂给统计器，内存占用与文件长度无关
+    XExec    exec;
+    uint64_t frames = 0;
+    exec.setCaptureOutput(false);
+    exec.setOutputCallback(
+            [&analyzer, &frames](const std::string_view& line, bool isStderr)
+            {
+                if (!isStderr && analyzer.feedLine(line) && ++frames % 10000 == 0)
+                {
+                    std::cout << "\r已分析 " << frames << " 帧" << std::flush;
+                }
+            });
+
+    if (!exec.start(command, false))
+    {
+        errorMsg = "启动FFprobe命令失败";
+        return false;
+    }
+    int exitCode = exec.wait();
+    analyzer.finish();
+    if (frames >= 10000)
+    {
+        std::cout << std::endl;
+    }
+
+    if (exitCode != 0)
+    {
+        errorMsg = "FFprobe执行失败，退出码: " + std::to_string(exitCode);
+        return false;
+    }
+
+    resultMsg = analyzer.formatSummary();
+    if (!options.frame_table.empty())
+    {
+        resultMsg += "帧表已写入: " + options.frame_table + " (" +
+                std::to_string(sizeof(FrameStatsAnalyzer::FrameRecord)) + " 字节/帧)\n";
+    }
+    return true;
+}
+
+auto AnalyzeCommandBuilder::runCachedSummary(const AnalyzeOptions& options, std::string& resultMsg,
+                                             std::string& errorMsg) const -> bool
+{
+    auto *cache = MediaProbeCache::getInstance();
+
+    MediaProbeInfo info;
+    bool           ok = options.keyframes ? cache->probeKeyframes(options.input, info, errorMsg)
+                                          : cache->probe(options.input, info, errorMsg);
+    if (!ok)
+    {
+        return false;
+    }
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "格式: " << info.formatName << "\n";
+    ss << "时长: " << info.duration << " 秒\n";
+    if (info.bitRate > 0)
+    {
+        ss << "码率: " << info.bitRate / 1000 << " kb/s\n";
+    }
+
+    for (const auto& stream : info.streams)
+    {
+        ss << "流 #" << stream.index << " [" << stream.codecType << "] " << stream.codecName;
+        if (stream.codecType == "video")
+        {
+            ss << " " << stream.width << "x" << stream.height << " " << std::setprecision(2) << stream.fps << "fps"
+               << std::setprecision(3);
+        }
+        else if (stream.codecType == "audio")
+        {
+            ss << " " << stream.sampleRate << "Hz " << stream.channels << "ch";
+        }
+        if (stream.bitRate > 0)
+        {
+            ss << " " << stream.bitRate / 1000 << "kb/s";
+        }
+        ss << "\n";
+    }
+
+    if (info.hasKeyframeIndex)
+    {
+        ss << "关键帧: " << info.keyframes.size() << " 个";
+        double maxGap = 0.0;
+        for (size_t i = 1; i < info.keyframes.size(); ++i)
+        {
+            maxGap = std::max(maxGap, info.keyframes[i] - info.keyframes[i - 1]);
+        }
+        if (info.keyframes.size() > 1)
+        {
+            ss << "，最大间隔 " << maxGap << " 秒";
+        }
+        ss << "\n";
+    }
+
+    auto stats = cache->getStatistics();
+    ss << "缓存: 内存命中 " << stats.hits << "，磁盘命中 " << stats.diskHits << "，探测 " << stats.misses;
+
+    resultMsg = ss.str();
+    return true;
+}
+
 IMPLEMENT_CREATE(AnalyzeCommandBuilder);
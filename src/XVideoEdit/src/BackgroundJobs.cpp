@@ -0,0 +1,416 @@
+﻿#include "BackgroundJobs.h"
+#include "JobScheduler.h"
+#include "ProgressDashboard.h"
+#include "XExec.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    auto formatElapsed(double seconds) -> std::string
+    {
+        const auto total = static_cast<long long>(seconds);
+        char       buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%lld:%02lld", total / 60, total % 60);
+        return buffer;
+    }
+
+    auto isFinished(BackgroundJobs::State state) -> bool
+    {
+        return state != BackgroundJobs::State::Queued && state != BackgroundJobs::State::Running;
+    }
+} // namespace
+
+class BackgroundJobs::PImpl
+{
+public:
+    struct Entry
+    {
+        Job                                   job;
+        uint64_t                              tag           = 0;
+        bool                                  killRequested = false;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    PImpl(BackgroundJobs *owner, size_t concurrency);
+
+public:
+    /// 在工作线程中执行作业
+    auto runEntry(const std::shared_ptr<Entry> &entry, const Runner &runner, std::string &errorMsg) -> bool;
+
+    auto statusLoop() -> void;
+
+    /// 以下调用方持有 mutex_
+    auto findLocked(size_t id) const -> std::shared_ptr<Entry>;
+    auto activeLocked() const -> size_t;
+
+    /// 作业的当前状态，运行中的作业补上用时与面板中的进度
+    auto snapshotLocked(const Entry &entry, const std::vector<ProgressDashboard::JobProgress> &progress) const -> Job;
+
+public:
+    BackgroundJobs                     *owner_ = nullptr;
+    mutable std::mutex                  mutex_;
+    std::condition_variable             changedCv_; ///< 作业状态变化
+    std::condition_variable             statusCv_;  ///< 唤醒状态线程
+    std::vector<std::shared_ptr<Entry>> jobs_;      ///< 按提交顺序
+    size_t                              nextId_ = 1;
+    /// 有作业结束，状态线程应立即回调
+    bool                                notify_   = false;
+    bool                                stopping_ = false;
+    StatusCallback                      onStatus_;
+    std::unique_ptr<JobScheduler>       scheduler_;
+    std::thread                         statusThread_;
+};
+
+BackgroundJobs::PImpl::PImpl(BackgroundJobs *owner, size_t concurrency) :
+    owner_(owner), scheduler_(std::make_unique<JobScheduler>(concurrency))
+{
+}
+
+auto BackgroundJobs::PImpl::runEntry(const std::shared_ptr<Entry> &entry, const Runner &runner, std::string &errorMsg)
+        -> bool
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entry->killRequested)
+        {
+            errorMsg = "作业已取消";
+            return false;
+        }
+        entry->job.state = State::Running;
+        entry->started   = std::chrono::steady_clock::now();
+    }
+    changedCv_.notify_all();
+
+    /// 后台线程的进度只登记到面板邮箱，外部进程归入本作业以便 kill
+    ProgressDashboard::setThreadTag(entry->tag, false);
+    XExec::setThreadJobTag(entry->tag);
+
+    const bool success = runner(errorMsg);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        /// 与 kill 互斥：作业结束后不再向它的 tag 发信号
+        XExec::setThreadJobTag(0);
+        entry->job.seconds =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - entry->started).count();
+        entry->job.state    = entry->killRequested ? State::Killed : (success ? State::Succeeded : State::Failed);
+        entry->job.errorMsg = success ? "" : errorMsg;
+        notify_             = true;
+    }
+    ProgressDashboard::setThreadTag(0);
+    changedCv_.notify_all();
+    statusCv_.notify_all();
+    return success;
+}
+
+auto BackgroundJobs::PImpl::statusLoop() -> void
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_)
+    {
+        /// 没有活动作业时不产生任何唤醒
+        if (activeLocked() == 0 && !notify_)
+        {
+            statusCv_.wait(lock, [this] { return stopping_ || notify_ || activeLocked() > 0; });
+            continue;
+        }
+
+        notify_       = false;
+        auto callback = onStatus_;
+        lock.unlock();
+        if (callback)
+        {
+            callback();
+        }
+        lock.lock();
+
+        statusCv_.wait_for(lock, std::chrono::seconds(1), [this] { return stopping_ || notify_; });
+    }
+}
+
+auto BackgroundJobs::PImpl::findLocked(size_t id) const -> std::shared_ptr<Entry>
+{
+    if (id == 0)
+    {
+        return jobs_.empty() ? nullptr : jobs_.back();
+    }
+
+    const auto it = std::ranges::find(jobs_, id, [](const auto &entry) { return entry->job.id; });
+    return it == jobs_.end() ? nullptr : *it;
+}
+
+auto BackgroundJobs::PImpl::activeLocked() const -> size_t
+{
+    return std::ranges::count_if(jobs_, [](const auto &entry) { return !isFinished(entry->job.state); });
+}
+
+auto BackgroundJobs::PImpl::snapshotLocked(const Entry                                      &entry,
+                                           const std::vector<ProgressDashboard::JobProgress> &progress) const -> Job
+{
+    Job job = entry.job;
+    if (job.state != State::Running)
+    {
+        return job;
+    }
+
+    job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - entry.started).count();
+
+    /// 一个作业可能先后启动多个进程，取最后登记的那个
+    for (const auto &item : progress)
+    {
+        if (item.tag == entry.tag)
+        {
+            job.percent = item.percent;
+            job.label   = item.label;
+        }
+    }
+    return job;
+}
+
+BackgroundJobs::BackgroundJobs(size_t concurrency) : impl_(std::make_unique<PImpl>(this, concurrency))
+{
+    impl_->statusThread_ = std::thread([this] { impl_->statusLoop(); });
+}
+
+BackgroundJobs::~BackgroundJobs()
+{
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        impl_->stopping_ = true;
+        for (const auto &entry : impl_->jobs_)
+        {
+            if (isFinished(entry->job.state))
+            {
+                continue;
+            }
+            entry->killRequested = true;
+            if (entry->job.state == State::Running)
+            {
+                XExec::terminateJob(entry->tag);
+            }
+        }
+    }
+    impl_->statusCv_.notify_all();
+
+    /// 排队的作业直接丢弃，只等待运行中的作业
+    impl_->scheduler_->shutdown(false);
+    if (impl_->statusThread_.joinable())
+    {
+        impl_->statusThread_.join();
+    }
+}
+
+auto BackgroundJobs::submit(const std::string &command, const Runner &runner) -> size_t
+{
+    auto entry = std::make_shared<PImpl::Entry>();
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        entry->job.id      = impl_->nextId_++;
+        entry->job.command = command;
+        entry->tag         = threadTag(entry->job.id);
+        impl_->jobs_.push_back(entry);
+    }
+    impl_->statusCv_.notify_all();
+
+    impl_->scheduler_->submit(command, [this, entry, runner](std::string &errorMsg)
+                              { return impl_->runEntry(entry, runner, errorMsg); });
+    return entry->job.id;
+}
+
+auto BackgroundJobs::setOnStatus(const StatusCallback &callback) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->onStatus_ = callback;
+}
+
+auto BackgroundJobs::list() const -> std::vector<Job>
+{
+    const auto progress = ProgressDashboard::getInstance()->getJobProgress();
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    std::vector<Job>            jobs;
+    jobs.reserve(impl_->jobs_.size());
+    for (const auto &entry : impl_->jobs_)
+    {
+        jobs.push_back(impl_->snapshotLocked(*entry, progress));
+    }
+    return jobs;
+}
+
+auto BackgroundJobs::takeFinished() -> std::vector<Job>
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    std::vector<Job>            finished;
+    std::erase_if(impl_->jobs_,
+                  [&finished](const auto &entry)
+                  {
+                      if (!isFinished(entry->job.state))
+                      {
+                          return false;
+                      }
+                      finished.push_back(entry->job);
+                      return true;
+                  });
+    return finished;
+}
+
+auto BackgroundJobs::wait(size_t id, Job &job, const std::function<void()> &onTick, int intervalMs,
+                          std::string &errorMsg) -> bool
+{
+    std::unique_lock<std::mutex> lock(impl_->mutex_);
+    const auto                   entry = impl_->findLocked(id);
+    if (!entry)
+    {
+        errorMsg = id == 0 ? "没有后台作业" : "没有作业 [" + std::to_string(id) + "]";
+        return false;
+    }
+
+    while (!impl_->changedCv_.wait_for(lock, std::chrono::milliseconds(intervalMs),
+                                       [&entry] { return isFinished(entry->job.state); }))
+    {
+        lock.unlock();
+        if (onTick)
+        {
+            onTick();
+        }
+        lock.lock();
+    }
+
+    job = entry->job;
+    std::erase(impl_->jobs_, entry);
+    return true;
+}
+
+auto BackgroundJobs::waitAll(const std::function<void()> &onTick, int intervalMs) -> void
+{
+    std::unique_lock<std::mutex> lock(impl_->mutex_);
+    while (!impl_->changedCv_.wait_for(lock, std::chrono::milliseconds(intervalMs),
+                                       [this] { return impl_->activeLocked() == 0; }))
+    {
+        lock.unlock();
+        if (onTick)
+        {
+            onTick();
+        }
+        lock.lock();
+    }
+}
+
+auto BackgroundJobs::kill(size_t id, std::string &errorMsg) -> bool
+{
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        const auto                  entry = id == 0 ? nullptr : impl_->findLocked(id);
+        if (!entry)
+        {
+            errorMsg = "没有作业 [" + std::to_string(id) + "]";
+            return false;
+        }
+        if (isFinished(entry->job.state))
+        {
+            errorMsg = "作业 [" + std::to_string(id) + "] 已结束";
+            return false;
+        }
+
+        entry->killRequested = true;
+        if (entry->job.state == State::Queued)
+        {
+            /// 工作线程取到它时看到 killRequested 直接返回
+            entry->job.state = State::Killed;
+            impl_->notify_   = true;
+        }
+        else
+        {
+            XExec::terminateJob(entry->tag);
+        }
+    }
+    impl_->changedCv_.notify_all();
+    impl_->statusCv_.notify_all();
+    return true;
+}
+
+auto BackgroundJobs::activeCount() const -> size_t
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->activeLocked();
+}
+
+auto BackgroundJobs::statusLine() const -> std::string
+{
+    const auto progress = ProgressDashboard::getInstance()->getJobProgress();
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    std::string                 line;
+    for (const auto &entry : impl_->jobs_)
+    {
+        if (isFinished(entry->job.state))
+        {
+            continue;
+        }
+
+        const auto job = impl_->snapshotLocked(*entry, progress);
+        line += line.empty() ? "后台" : " ";
+        line += " [" + std::to_string(job.id) + "] ";
+        if (job.state == State::Queued)
+        {
+            line += "排队";
+        }
+        else if (job.percent >= 0)
+        {
+            line += std::to_string(static_cast<int>(job.percent)) + "% " + job.label;
+        }
+        else
+        {
+            line += "运行 " + formatElapsed(job.seconds);
+        }
+    }
+    return line;
+}
+
+auto BackgroundJobs::describe(const Job &job) -> std::string
+{
+    std::string text = "[" + std::to_string(job.id) + "] " + stateName(job.state);
+    if (job.state == State::Running && job.percent >= 0)
+    {
+        text += " " + std::to_string(static_cast<int>(job.percent)) + "%";
+    }
+    if (job.state != State::Queued && !(job.state == State::Killed && job.seconds <= 0))
+    {
+        text += " (" + formatElapsed(job.seconds) + ")";
+    }
+    text += "  " + job.command;
+    if (job.state == State::Failed && !job.errorMsg.empty())
+    {
+        text += "  - " + job.errorMsg;
+    }
+    return text;
+}
+
+auto BackgroundJobs::stateName(State state) -> const char *
+{
+    switch (state)
+    {
+        case State::Queued:
+            return "排队";
+        case State::Running:
+            return "运行中";
+        case State::Succeeded:
+            return "完成";
+        case State::Failed:
+            return "失败";
+        case State::Killed:
+            return "已终止";
+    }
+    return "";
+}
+
+auto BackgroundJobs::threadTag(size_t id) -> uint64_t
+{
+    return (uint64_t{ 1 } << 63) | id;
+}
@@ -0,0 +1,461 @@
+﻿#include "BatchScript.h"
+#include "JobScheduler.h"
+#include "ProgressDashboard.h"
+#include "XConst.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+namespace
+{
+    constexpr size_t REPORT_COMMAND_WIDTH = 60;
+
+    auto normalizePath(const std::string &path) -> std::string
+    {
+        std::error_code ec;
+        auto            absolute = fs::absolute(path, ec);
+        return (ec ? fs::path(path) : absolute).lexically_normal().generic_string();
+    }
+
+    auto trim(const std::string &text) -> std::string
+    {
+        const auto begin = text.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos)
+        {
+            return {};
+        }
+        const auto end = text.find_last_not_of(" \t\r\n");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    /// 相同路径，或一个是另一个的上级目录（输出目录与其中的文件）
+    auto overlaps(const std::string &a, const std::string &b) -> bool
+    {
+        const auto &shorter = a.size() <= b.size() ? a : b;
+        const auto &longer  = a.size() <= b.size() ? b : a;
+        if (!longer.starts_with(shorter))
+        {
+            return false;
+        }
+        return longer.size() == shorter.size() || shorter.ends_with('/') || longer[shorter.size()] == '/';
+    }
+
+    auto anyOverlap(const std::vector<std::string> &left, const std::vector<std::string> &right) -> bool
+    {
+        for (const auto &a : left)
+        {
+            for (const auto &b : right)
+            {
+                if (overlaps(a, b))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /// 后一条命令读前一条的输出、两条写同一处，或后一条覆盖前一条的输入，都必须保持脚本顺序
+    auto conflicts(const BatchScript::Command &earlier, const BatchScript::Command &later) -> bool
+    {
+        return anyOverlap(earlier.outputs, later.inputs) || anyOverlap(earlier.outputs, later.outputs) ||
+                anyOverlap(earlier.inputs, later.outputs);
+    }
+
+    auto secondsSince(std::chrono::steady_clock::time_point begin) -> double
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+} // namespace
+
+class BatchScript::PImpl
+{
+public:
+    PImpl(BatchScript *owner);
+    ~PImpl() = default;
+
+public:
+    /// 为每条命令找出必须先完成的命令
+    auto analyzeDependencies() -> void;
+
+public:
+    BatchScript         *owner_ = nullptr;
+    std::vector<Command> commands_;
+    std::vector<Result>  results_;
+    double               wallSeconds_ = 0.0;
+};
+
+BatchScript::PImpl::PImpl(BatchScript *owner) : owner_(owner)
+{
+}
+
+auto BatchScript::PImpl::analyzeDependencies() -> void
+{
+    /// 屏障依赖之前的所有命令，之后的命令只需依赖最近的屏障
+    size_t lastBarrier = std::string::npos;
+    for (size_t j = 0; j < commands_.size(); ++j)
+    {
+        auto        &command = commands_[j];
+        const size_t first   = lastBarrier == std::string::npos ? 0 : lastBarrier + 1;
+        if (lastBarrier != std::string::npos)
+        {
+            command.dependsOn.push_back(lastBarrier);
+        }
+
+        for (size_t i = first; i < j; ++i)
+        {
+            if (command.barrier || conflicts(commands_[i], command))
+            {
+                command.dependsOn.push_back(i);
+            }
+        }
+
+        if (command.barrier)
+        {
+            lastBarrier = j;
+        }
+    }
+}
+
+BatchScript::BatchScript()
+{
+    impl_ = std::make_unique<BatchScript::PImpl>(this);
+}
+
+BatchScript::~BatchScript() = default;
+
+auto BatchScript::load(const std::string &path, const TaskPredicate &isTask, std::string &errorMsg) -> bool
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        errorMsg = "无法打开脚本文件: " + path;
+        return false;
+    }
+
+    impl_->commands_.clear();
+    impl_->results_.clear();
+
+    CommandParser parser;
+    std::string   line;
+    for (size_t number = 1; std::getline(file, line); ++number)
+    {
+        auto text = trim(line);
+        if (number == 1 && text.starts_with("\xEF\xBB\xBF"))
+        {
+            text = trim(text.substr(3));
+        }
+        if (text.empty() || text[0] == '#')
+        {
+            continue;
+        }
+
+        Command command;
+        command.line   = number;
+        command.text   = text;
+        command.parsed = parser.parse(text);
+        if (!parser.validate(command.parsed))
+        {
+            errorMsg = "第 " + std::to_string(number) + " 行命令格式无效: " + text;
+            return false;
+        }
+
+        command.barrier = !isTask(command.parsed);
+        if (!command.barrier)
+        {
+            classifyPaths(command.parsed, command.inputs, command.outputs);
+        }
+        impl_->commands_.push_back(std::move(command));
+    }
+
+    impl_->analyzeDependencies();
+    return true;
+}
+
+auto BatchScript::run(size_t jobs, const Executor &executor) -> bool
+{
+    const auto  &commands = impl_->commands_;
+    auto        &results  = impl_->results_;
+    const size_t count    = commands.size();
+    results.assign(count, {});
+    impl_->wallSeconds_ = 0.0;
+    if (count == 0)
+    {
+        return true;
+    }
+
+    std::vector<std::vector<size_t>> dependents(count);
+    std::vector<size_t>              remaining(count);
+    std::vector<uint8_t>             blocked(count, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        remaining[i] = commands[i].dependsOn.size();
+        for (const auto dependency : commands[i].dependsOn)
+        {
+            dependents[dependency].push_back(i);
+        }
+    }
+
+    /// 并行执行时各任务的进度条合并到面板中，避免互相覆盖
+    auto       dashboard    = ProgressDashboard::getInstance();
+    const bool dashboardWas = dashboard->isEnabled();
+    if (jobs > 1)
+    {
+        dashboard->setEnabled(true);
+    }
+
+    std::mutex              mutex;
+    std::condition_variable doneCv;
+    size_t                  finished = 0;
+    bool                    allOk    = true;
+    const auto              begin    = std::chrono::steady_clock::now();
+    JobScheduler            scheduler(std::max<size_t>(1, jobs));
+
+    std::function<void(size_t)> submit;
+
+    /// 记录结果并释放后继命令；失败或跳过的命令使其所有后继都被跳过。调用方持有 mutex
+    auto complete = [&](size_t index) -> std::vector<size_t>
+    {
+        std::vector<size_t> ready;
+        std::vector<size_t> stack{ index };
+        while (!stack.empty())
+        {
+            const size_t current = stack.back();
+            stack.pop_back();
+            ++finished;
+
+            const auto &result = results[current];
+            allOk              = allOk && result.success;
+            std::cout << "[批处理] " << (result.success ? "✓ " : result.skipped ? "- " : "✗ ") << "第 "
+                      << commands[current].line << " 行";
+            if (!result.skipped)
+            {
+                std::cout << std::fixed << std::setprecision(1) << " (" << result.seconds << " 秒)";
+            }
+            if (!result.errorMsg.empty())
+            {
+                std::cout << " " << result.errorMsg;
+            }
+            std::cout << std::endl;
+
+            for (const auto next : dependents[current])
+            {
+                if (!result.success)
+                {
+                    blocked[next] = 1;
+                }
+                if (--remaining[next] > 0)
+                {
+                    continue;
+                }
+                if (blocked[next])
+                {
+                    results[next].skipped  = true;
+                    results[next].errorMsg = "依赖的命令未成功，已跳过";
+                    stack.push_back(next);
+                }
+                else
+                {
+                    ready.push_back(next);
+                }
+            }
+        }
+        std::sort(ready.begin(), ready.end());
+        return ready;
+    };
+
+    submit = [&](size_t index)
+    {
+        const auto &command = commands[index];
+        scheduler.submit(
+                "第 " + std::to_string(command.line) + " 行", [&, index](std::string &errorMsg) -> bool
+                {
+                    const double start = secondsSince(begin);
+                    std::string  error;
+                    bool         ok = false;
+                    try
+                    {
+                        ok = executor(commands[index].parsed, error);
+                    }
+                    catch (const std::exception &e)
+                    {
+                        error = e.what();
+                    }
+
+                    std::vector<size_t> ready;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        auto                       &result = results[index];
+                        result.success                     = ok;
+                        result.errorMsg                    = error;
+                        result.startSeconds                = start;
+                        result.seconds                     = secondsSince(begin) - start;
+                        ready                              = complete(index);
+                    }
+                    for (const auto next : ready)
+                    {
+                        submit(next);
+                    }
+                    doneCv.notify_all();
+
+                    errorMsg = error;
+                    return ok;
+                },
+                command.inputs);
+    };
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (remaining[i] == 0)
+        {
+            submit(i);
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCv.wait(lock, [&] { return finished == count; });
+    }
+    scheduler.shutdown(true);
+    dashboard->setEnabled(dashboardWas);
+
+    impl_->wallSeconds_ = secondsSince(begin);
+    return allOk;
+}
+
+auto BatchScript::getCommands() const -> const std::vector<Command> &
+{
+    return impl_->commands_;
+}
+
+auto BatchScript::getResults() const -> const std::vector<Result> &
+{
+    return impl_->results_;
+}
+
+auto BatchScript::formatReport() const -> std::string
+{
+    const auto &commands = impl_->commands_;
+    const auto &results  = impl_->results_;
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "\n=== 批处理报告 ===\n";
+    ss << " 行号  状态     开始     耗时  依赖(行)  命令\n";
+
+    size_t succeeded = 0;
+    size_t failed    = 0;
+    size_t skipped   = 0;
+    double total     = 0.0;
+    for (size_t i = 0; i < commands.size() && i < results.size(); ++i)
+    {
+        const auto &command = commands[i];
+        const auto &result  = results[i];
+
+        std::string dependencies;
+        for (const auto dependency : command.dependsOn)
+        {
+            dependencies += (dependencies.empty() ? "" : ",") + std::to_string(commands[dependency].line);
+        }
+        if (command.barrier && command.dependsOn.size() > 1)
+        {
+            dependencies = "之前全部";
+        }
+        else if (dependencies.empty())
+        {
+            dependencies = "-";
+        }
+
+        std::string text = command.text;
+        if (text.size() > REPORT_COMMAND_WIDTH)
+        {
+            /// 不在 UTF-8 多字节字符中间截断
+            size_t cut = REPORT_COMMAND_WIDTH;
+            while (cut > 0 && (static_cast<unsigned char>(text[cut]) & 0xC0) == 0x80)
+            {
+                --cut;
+            }
+            text = text.substr(0, cut) + "...";
+        }
+
+        ss << std::setw(5) << command.line << "  ";
+        if (result.skipped)
+        {
+            ++skipped;
+            ss << "跳过" << std::setw(9) << "-" << std::setw(9) << "-";
+        }
+        else
+        {
+            result.success ? ++succeeded : ++failed;
+            total += result.seconds;
+            ss << (result.success ? "成功" : "失败") << std::setw(9) << result.startSeconds << std::setw(9)
+               << result.seconds;
+        }
+        ss << "  " << std::left << std::setw(8) << dependencies << std::right << "  " << text << "\n";
+    }
+
+    ss << "------------------\n";
+    ss << "命令: " << commands.size() << "，成功 " << succeeded << "，失败 " << failed << "，跳过 " << skipped << "\n";
+    ss << "总用时 " << impl_->wallSeconds_ << " 秒，命令耗时合计 " << total << " 秒";
+    if (impl_->wallSeconds_ > 0)
+    {
+        ss << "，并行加速 " << total / impl_->wallSeconds_ << "x";
+    }
+    ss << "\n";
+    return ss.str();
+}
+
+auto BatchScript::classifyPaths(const CommandParser::ParsedCommand &command, std::vector<std::string> &inputs,
+                                std::vector<std::string> &outputs) -> void
+{
+    static const std::set<std::string> OUTPUT_KEYS     = { "--output", "-o", "-d", "--frame-table" };
+    static const std::set<std::string> READ_WRITE_KEYS = { "--keyfile", "--keystore" };
+
+    auto addList = [](const std::string &value, std::vector<std::string> &paths)
+    {
+        std::stringstream ss(value);
+        std::string       item;
+        while (std::getline(ss, item, ','))
+        {
+            if (item = trim(item); !item.empty())
+            {
+                paths.push_back(normalizePath(item));
+            }
+        }
+    };
+
+    for (const auto &[key, value] : command.options)
+    {
+        if (value.empty())
+        {
+            continue;
+        }
+        if (OUTPUT_KEYS.contains(key))
+        {
+            outputs.push_back(normalizePath(value));
+        }
+        else if (READ_WRITE_KEYS.contains(key))
+        {
+            inputs.push_back(normalizePath(value));
+            outputs.push_back(normalizePath(value));
+        }
+        else
+        {
+            addList(value, inputs);
+        }
+    }
+
+    /// task <任务名> 形式的第一个位置参数是任务名，不是路径
+    const size_t first = command.command == "task" ? 1 : 0;
+    for (size_t i = first; i < command.args.size(); ++i)
+    {
+        addList(command.args[i], inputs);
+    }
+}
@@ -1,4 +1,5 @@
 ﻿#include "CVProgressBar.h"
+#include "ConvertCommandBuilder.h"
 #include "ParameterValue.h"
 #include "XFile.h"
 #include "XExec.h"
@@ -48,6 +49,14 @@ auto CVProgressBar::updateProgress(XExec &exec, const std::string_view &taskName
         /// 创建进度状态
         auto progressState = std::make_shared<AVProgressState>();
         setProgressState(progressState, 0.0, totalDuration, "");
+        setJobProfile(progressState, taskName, inputParams, "libx264");
+
+        /// 智能封装时按流复制记录，避免与真正的编码混在一起统计
+        if (ConvertCommandBuilder::create()->planStreams(inputParams).copyVideo)
+        {
+            progressState->profile.videoCodec = "copy";
+            progressState->profile.preset     = "-";
+        }
 
         /// 开始进度监控
         startProgressMonitoring(exec, progressState, srcPath, dstPath);
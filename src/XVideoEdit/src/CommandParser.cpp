@@ -74,6 +74,41 @@ auto CommandParser::parse(const std::string_view &input) -> CommandParser::Parse
     return result;
 }
 
+auto CommandParser::parseArgs(const std::vector<std::string> &tokens) -> CommandParser::ParsedCommand
+{
+    ParsedCommand result;
+
+    if (tokens.empty())
+        throw std::invalid_argument("Input cannot be empty");
+
+    result.command = tokens[0];
+    for (size_t i = 1; i < tokens.size(); ++i)
+    {
+        const std::string &token = tokens[i];
+        if (token.empty() || token[0] != '-')
+        {
+            result.args.push_back(token);
+            continue;
+        }
+
+        /// --option=value、--option value 或无值的 --flag
+        if (const size_t eq = token.find('='); eq != std::string::npos)
+        {
+            result.options[token.substr(0, eq)] = token.substr(eq + 1);
+        }
+        else if (i + 1 < tokens.size() && !tokens[i + 1].empty() && tokens[i + 1][0] != '-')
+        {
+            result.options[token] = tokens[++i];
+        }
+        else
+        {
+            result.options[token] = "";
+        }
+    }
+
+    return result;
+}
+
 auto CommandParser::validate(const ParsedCommand &cmd) -> bool
 {
     if (cmd.command.empty())
@@ -112,7 +147,8 @@ auto CommandParser::parseOption(std::string_view &remaining) -> std::map<std::st
     size_t      pos = remaining.find_first_of(" \t=");
     std::string key = std::string(remaining.substr(0, pos));
 
-    remaining = remaining.substr(pos);
+    /// 行尾的无值选项（如 "--all"）没有后续内容
+    remaining = pos == std::string_view::npos ? std::string_view{} : remaining.substr(pos);
     remaining = trim(remaining);
 
     if (!remaining.empty() && remaining[0] == '=')
@@ -0,0 +1,564 @@
+﻿#include "ConcatCommandBuilder.h"
+#include "MediaProbeCache.h"
+#include "TaskProgressBar.h"
+#include "VideoFileValidator.h"
+#include "XExec.h"
+#include "XTool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+    constexpr int MAX_DEFAULT_JOBS = 4; ///< 编码器本身是多线程的，并行数不宜过多
+
+    /// 编码名 -> 编码器，未知返回空
+    auto encoderOf(const std::string &codec) -> std::string
+    {
+        static const std::unordered_map<std::string, std::string> encoders = {
+            { "h264", "libx264" },      { "hevc", "libx265" },    { "vp9", "libvpx-vp9" },      { "vp8", "libvpx" },
+            { "mpeg4", "mpeg4" },       { "av1", "libaom-av1" },  { "mpeg2video", "mpeg2video" }, { "aac", "aac" },
+            { "mp3", "libmp3lame" },    { "opus", "libopus" },    { "vorbis", "libvorbis" },    { "flac", "flac" },
+            { "ac3", "ac3" },           { "alac", "alac" },
+        };
+        if (auto it = encoders.find(codec); it != encoders.end())
+        {
+            return it->second;
+        }
+        return codec.starts_with("pcm_") ? codec : std::string();
+    }
+
+    /// ffprobe 的档次名转为编码器的 -profile:v 取值，无法对应时返回空，交给编码器按像素格式选择
+    auto encoderProfileOf(const std::string &encoder, const std::string &profile) -> std::string
+    {
+        static const std::unordered_map<std::string, std::string> x264 = {
+            { "Constrained Baseline", "baseline" }, { "Baseline", "baseline" }, { "Main", "main" },
+            { "High", "high" },                     { "High 10", "high10" },    { "High 4:2:2", "high422" },
+            { "High 4:4:4 Predictive", "high444" },
+        };
+        static const std::unordered_map<std::string, std::string> x265 = {
+            { "Main", "main" },
+            { "Main 10", "main10" },
+        };
+
+        if (encoder != "libx264" && encoder != "libx265")
+        {
+            return {};
+        }
+        const auto &profiles = encoder == "libx264" ? x264 : x265;
+        if (auto it = profiles.find(profile); it != profiles.end())
+        {
+            return it->second;
+        }
+        return {};
+    }
+
+    /// 参数集可以放在码流中的编码：重新编码的片段在每个关键帧前带上参数集
+    auto carriesInBandParameters(const std::string &codec) -> bool
+    {
+        return codec == "h264" || codec == "hevc" || codec == "mpeg4" || codec == "mpeg2video";
+    }
+
+    /// ffconcat 中的路径用单引号包围，内部的单引号写成 '\''
+    auto quoteConcatPath(const std::string &path) -> std::string
+    {
+        std::string quoted = "'";
+        for (char c : path)
+        {
+            if (c == '\'')
+            {
+                quoted += "'\\''";
+            }
+            else
+            {
+                quoted += c;
+            }
+        }
+        return quoted + "'";
+    }
+
+    /// 列表文件：每行一个路径，忽略空行与 # 注释
+    auto readListFile(const std::string &path, std::vector<std::string> &inputs, std::string &errorMsg) -> bool
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            errorMsg = "无法打开列表文件: " + path;
+            return false;
+        }
+        const fs::path base = fs::path(path).parent_path();
+        std::string    line;
+        while (std::getline(file, line))
+        {
+            line.erase(0, line.find_first_not_of(" \t"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (line.empty() || line.front() == '#')
+            {
+                continue;
+            }
+            /// 相对路径相对于列表文件所在目录
+            const fs::path entry(line);
+            inputs.push_back(entry.is_absolute() ? line : (base / entry).string());
+        }
+        return true;
+    }
+} // namespace
+
+/// ==================== StreamProfile ====================
+
+auto ConcatCommandBuilder::StreamProfile::key() const -> std::string
+{
+    std::stringstream ss;
+    ss << videoCodec << "|" << videoProfile << "|" << level << "|" << hasBFrames << "|" << timeBase << "|"
+       << extradataHash << "|" << pixFmt << "|" << width << "x" << height << "|" << std::fixed << std::setprecision(2)
+       << fps << "|" << audioCodec << "|" << sampleRate << "|" << channels;
+    return ss.str();
+}
+
+auto ConcatCommandBuilder::StreamProfile::describe() const -> std::string
+{
+    std::stringstream ss;
+    ss << videoCodec;
+    if (!videoProfile.empty())
+    {
+        ss << " (" << videoProfile;
+        if (level > 0)
+        {
+            ss << " L" << level;
+        }
+        ss << ")";
+    }
+    ss << " " << width << "x" << height << " " << pixFmt << " " << std::fixed << std::setprecision(2) << fps << "fps";
+    if (!audioCodec.empty())
+    {
+        ss << " / " << audioCodec << " " << sampleRate << "Hz " << channels << "ch";
+    }
+    return ss.str();
+}
+
+/// ==================== ConcatCommandBuilder ====================
+
+auto ConcatCommandBuilder::parseOptions(const std::map<std::string, ParameterValue>& params, ConcatOptions& options,
+                                        std::string& errorMsg) const -> bool
+{
+    options.output = params.at("--output").asString();
+
+    /// --inputs 逗号分隔
+    if (params.contains("--inputs"))
+    {
+        std::stringstream ss(params.at("--inputs").asString());
+        std::string       item;
+        while (std::getline(ss, item, ','))
+        {
+            if (!item.empty())
+            {
+                options.inputs.push_back(item);
+            }
+        }
+    }
+
+    if (params.contains("--list") && !readListFile(params.at("--list").asString(), options.inputs, errorMsg))
+    {
+        return false;
+    }
+
+    /// --dir 按文件名排序
+    if (params.contains("--dir"))
+    {
+        std::vector<std::string> files;
+        std::error_code          ec;
+        for (const auto& entry : fs::directory_iterator(params.at("--dir").asString(), ec))
+        {
+            std::string ignored;
+            if (entry.is_regular_file(ec) && VideoFileValidator::isVideoFileByExtension(entry.path().string(), ignored))
+            {
+                files.push_back(entry.path().string());
+            }
+        }
+        std::ranges::sort(files);
+        options.inputs.insert(options.inputs.end(), files.begin(), files.end());
+    }
+
+    if (params.contains("--jobs"))
+    {
+        options.jobs = params.at("--jobs").asInt();
+    }
+    if (options.jobs <= 0)
+    {
+        options.jobs = std::min(MAX_DEFAULT_JOBS, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+    }
+
+    if (params.contains("--faststart"))
+    {
+        options.faststart = params.at("--faststart").empty() || params.at("--faststart").asBool();
+    }
+
+    if (options.inputs.size() < 2)
+    {
+        errorMsg = "至少需要两个输入片段(--inputs / --list / --dir)";
+        return false;
+    }
+
+    /// 片段路径会拼进 /bin/sh -c 执行的重新编码命令，目录与列表文件中的名字同样不可信
+    for (const auto& input : options.inputs)
+    {
+        if (XTool::hasShellMetachar(input))
+        {
+            errorMsg = "片段路径含 shell 特殊字符: " + input;
+            return false;
+        }
+    }
+    return true;
+}
+
+auto ConcatCommandBuilder::profileOf(const MediaProbeInfo& info) -> StreamProfile
+{
+    StreamProfile profile;
+    if (const auto* video = info.videoStream())
+    {
+        profile.videoCodec    = video->codecName;
+        profile.videoProfile  = video->profile;
+        profile.level         = video->level;
+        profile.hasBFrames    = video->hasBFrames;
+        profile.timeBase      = video->timeBase;
+        profile.extradataHash = video->extradataHash;
+        profile.pixFmt        = video->pixFmt;
+        profile.width         = video->width;
+        profile.height        = video->height;
+        profile.fps           = video->fps;
+    }
+    if (const auto* audio = info.audioStream())
+    {
+        profile.audioCodec = audio->codecName;
+        profile.sampleRate = audio->sampleRate;
+        profile.channels   = audio->channels;
+    }
+    return profile;
+}
+
+auto ConcatCommandBuilder::conformCommand(const std::string& input, const MediaProbeInfo& info,
+                                          const StreamProfile& target, const std::string& output) -> std::string
+{
+    const bool hasAudio = info.audioStream() != nullptr;
+
+    std::ostringstream cmd;
+    cmd << "\"" << XTool::getFFmpegPath() << "\" -hide_banner -nostats -loglevel error -y -i \"" << input << "\" ";
+
+    /// 基准有音频而片段没有时补一条同长度的静音
+    const bool addSilence = !target.audioCodec.empty() && !hasAudio;
+    if (addSilence)
+    {
+        cmd << "-f lavfi -i \"anullsrc=r=" << target.sampleRate << ":cl=" << (target.channels == 1 ? "mono" : "stereo")
+            << "\" -shortest ";
+    }
+
+    cmd << "-map 0:v:0 ";
+    if (addSilence)
+    {
+        cmd << "-map 1:a:0 ";
+    }
+    else if (!target.audioCodec.empty())
+    {
+        cmd << "-map 0:a:0 ";
+    }
+
+    /// 视频：缩放并居中补边到基准尺寸，帧率、像素格式与档次对齐
+    const std::string videoEncoder = encoderOf(target.videoCodec);
+    cmd << "-c:v " << videoEncoder << " ";
+    if (videoEncoder == "libx264" || videoEncoder == "libx265")
+    {
+        cmd << "-preset fast -crf 18 ";
+    }
+    if (const auto profile = encoderProfileOf(videoEncoder, target.videoProfile); !profile.empty())
+    {
+        cmd << "-profile:v " << profile << " ";
+    }
+
+    /// 流复制合并后整个文件只有第一个片段的文件头；重新编码的片段参数集与之不同，
+    /// 在每个关键帧前重复参数集，解码器切换到该片段时能拿到正确的 SPS/PPS
+    if (carriesInBandParameters(target.videoCodec))
+    {
+        cmd << "-bsf:v dump_extra ";
+    }
+    cmd << "-vf \"scale=" << target.width << ":" << target.height << ":force_original_aspect_ratio=decrease,pad="
+        << target.width << ":" << target.height << ":(ow-iw)/2:(oh-ih)/2,setsar=1";
+    if (target.fps > 0)
+    {
+        cmd << ",fps=" << std::fixed << std::setprecision(3) << target.fps;
+    }
+    cmd << ",format=" << (target.pixFmt.empty() ? "yuv420p" : target.pixFmt) << "\" ";
+
+    if (target.audioCodec.empty())
+    {
+        cmd << "-an ";
+    }
+    else
+    {
+        cmd << "-c:a " << encoderOf(target.audioCodec) << " -ar " << target.sampleRate << " -ac " << target.channels
+            << " ";
+    }
+
+    cmd << "-f matroska \"" << output << "\"";
+    return cmd.str();
+}
+
+auto ConcatCommandBuilder::build(const std::map<std::string, ParameterValue>&) const -> std::string
+{
+    /// 探测、重新编码与合并都在 run 中完成
+    return {};
+}
+
+auto ConcatCommandBuilder::validate(const std::map<std::string, ParameterValue>& params, std::string& errorMsg) const
+        -> bool
+{
+    if (!params.contains("--output") || params.at("--output").empty())
+    {
+        errorMsg = "缺少输出文件参数(--output)";
+        return false;
+    }
+    if (!params.contains("--inputs") && !params.contains("--list") && !params.contains("--dir"))
+    {
+        errorMsg = "缺少输入参数(--inputs / --list / --dir)";
+        return false;
+    }
+
+    ConcatOptions options;
+    if (!parseOptions(params, options, errorMsg))
+    {
+        return false;
+    }
+
+    std::error_code ec;
+    for (const auto& input : options.inputs)
+    {
+        if (!fs::is_regular_file(input, ec))
+        {
+            errorMsg = "输入文件不存在: " + input;
+            return false;
+        }
+        if (fs::exists(options.output, ec) && fs::equivalent(input, options.output, ec))
+        {
+            errorMsg = "输出文件不能是输入之一: " + options.output;
+            return false;
+        }
+    }
+    return true;
+}
+
+auto ConcatCommandBuilder::getTitle(const std::map<std::string, ParameterValue>& params) const -> std::string
+{
+    return "拼接: → " + fs::path(params.at("--output").asString()).filename().string();
+}
+
+auto ConcatCommandBuilder::isInProcess(const std::map<std::string, ParameterValue>&) const -> bool
+{
+    return true;
+}
+
+auto ConcatCommandBuilder::run(const std::map<std::string, ParameterValue>& params, std::string& resultMsg,
+                               std::string& errorMsg) const -> bool
+{
+    const auto    start = std::chrono::steady_clock::now();
+    ConcatOptions options;
+    if (!parseOptions(params, options, errorMsg))
+    {
+        return false;
+    }
+
+    const size_t count = options.inputs.size();
+    auto         bar   = TaskProgressBar::create();
+    bar->setTitle(getTitle(params));
+
+    /// 多线程按原子下标领取任务，主线程刷新进度
+    auto parallelFor = [&](size_t total, const std::function<void(size_t)>& body, float base, float span,
+                           const std::string& label)
+    {
+        std::atomic<size_t>      next{ 0 };
+        std::atomic<size_t>      done{ 0 };
+        const size_t             workerCount = std::min<size_t>(options.jobs, total);
+        std::vector<std::thread> workers;
+        workers.reserve(workerCount);
+        for (size_t w = 0; w < workerCount; ++w)
+        {
+            workers.emplace_back(
+                    [&]()
+                    {
+                        for (size_t i = next.fetch_add(1); i < total; i = next.fetch_add(1))
+                        {
+                            body(i);
+                            done.fetch_add(1, std::memory_order_release);
+                        }
+                    });
+        }
+        while (done.load(std::memory_order_acquire) < total)
+        {
+            const size_t finished = done.load();
+            bar->setProgress(base + span * finished / total,
+                             label + " " + std::to_string(finished) + "/" + std::to_string(total));
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    };
+
+    /// 1. 并行探测（已缓存的片段不会再调用 ffprobe）
+    std::vector<MediaProbeInfo> infos(count);
+    std::vector<std::string>    probeErrors(count);
+    parallelFor(
+            count,
+            [&](size_t i) { MediaProbeCache::getInstance()->probe(options.inputs[i], infos[i], probeErrors[i]); }, 0.0f,
+            10.0f, "探测");
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!probeErrors[i].empty() || !infos[i].hasVideo())
+        {
+            bar->markAsFailed();
+            errorMsg = "无法探测视频片段: " + options.inputs[i] + " " + probeErrors[i];
+            return false;
+        }
+    }
+
+    /// 2. 以占总时长最多的参数组合为基准，重新编码的时长最少
+    std::vector<StreamProfile>              profiles(count);
+    std::unordered_map<std::string, double> durationByKey;
+    for (size_t i = 0; i < count; ++i)
+    {
+        profiles[i] = profileOf(infos[i]);
+        durationByKey[profiles[i].key()] += infos[i].duration;
+    }
+    const auto best = std::ranges::max_element(durationByKey, {}, [](const auto& entry) { return entry.second; });
+    size_t     referenceIndex = 0;
+    while (profiles[referenceIndex].key() != best->first)
+    {
+        ++referenceIndex;
+    }
+    const StreamProfile& reference = profiles[referenceIndex];
+    if (encoderOf(reference.videoCodec).empty() ||
+        (!reference.audioCodec.empty() && encoderOf(reference.audioCodec).empty()))
+    {
+        bar->markAsFailed();
+        errorMsg = "基准格式没有可用的编码器: " + reference.describe();
+        return false;
+    }
+
+    /// 3. 只把不一致的片段并行重新编码
+    std::error_code ec;
+    const fs::path  outputPath = fs::absolute(options.output, ec);
+    const fs::path  workDir    = outputPath.parent_path() / (".concat_" + outputPath.stem().string());
+    fs::create_directories(workDir, ec);
+    if (ec)
+    {
+        bar->markAsFailed();
+        errorMsg = "无法创建临时目录: " + workDir.string() + " (" + ec.message() + ")";
+        return false;
+    }
+
+    std::vector<size_t>      mismatched;
+    std::vector<std::string> segments(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        segments[i] = fs::absolute(options.inputs[i], ec).string();
+        if (profiles[i].key() != reference.key())
+        {
+            mismatched.push_back(i);
+        }
+    }
+
+    std::vector<std::string> encodeErrors(count);
+    if (!mismatched.empty())
+    {
+        parallelFor(
+                mismatched.size(),
+                [&](size_t n)
+                {
+                    const size_t i       = mismatched[n];
+                    const auto   output  = (workDir / ("segment_" + std::to_string(i) + ".mkv")).string();
+                    const auto   command = conformCommand(segments[i], infos[i], reference, output);
+                    auto         result  = XExec::execute(command, true);
+                    if (result.exitCode != 0)
+                    {
+                        encodeErrors[i] = result.stdoutOutput;
+                        return;
+                    }
+                    segments[i] = output;
+                },
+                10.0f, 70.0f, "重新编码");
+
+        for (size_t i : mismatched)
+        {
+            if (!encodeErrors[i].empty())
+            {
+                bar->markAsFailed();
+                fs::remove_all(workDir, ec);
+                errorMsg = "重新编码片段失败: " + options.inputs[i] + "\n" + encodeErrors[i];
+                return false;
+            }
+        }
+    }
+
+    /// 4. ffconcat 列表（时间戳由分离器按各片段实际的包时间推算，不写 duration 以免累积误差）
+    const fs::path listPath = workDir / "list.ffconcat";
+    {
+        std::ofstream list(listPath, std::ios::binary);
+        list << "ffconcat version 1.0\n";
+        for (const auto& segment : segments)
+        {
+            list << "file " << quoteConcatPath(segment) << "\n";
+        }
+        if (!list)
+        {
+            bar->markAsFailed();
+            fs::remove_all(workDir, ec);
+            errorMsg = "无法写入拼接列表: " + listPath.string();
+            return false;
+        }
+    }
+
+    /// 5. 流复制合并
+    bar->setProgress(mismatched.empty() ? 10.0f : 80.0f, "合并中");
+    std::ostringstream cmd;
+    cmd << "\"" << XTool::getFFmpegPath() << "\" -hide_banner -nostats -loglevel error -y -f concat -safe 0 -i \""
+        << listPath.string() << "\" -map 0:v:0 " << (reference.audioCodec.empty() ? "" : "-map 0:a:0 ")
+        << "-c copy ";
+    if (options.faststart)
+    {
+        cmd << "-movflags +faststart ";
+    }
+    cmd << "\"" << options.output << "\"";
+
+    auto result = XExec::execute(cmd.str(), true);
+    fs::remove_all(workDir, ec);
+    if (result.exitCode != 0)
+    {
+        bar->markAsFailed();
+        errorMsg = "合并失败: " + result.stdoutOutput;
+        return false;
+    }
+    bar->markAsCompleted();
+
+    double totalDuration = 0.0;
+    for (const auto& info : infos)
+    {
+        totalDuration += info.duration;
+    }
+
+    const double      seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "已合并 " << count << " 个片段到 " << options.output << "，总时长 " << totalDuration << " 秒\n";
+    ss << "基准格式: " << reference.describe() << "，重新编码 " << mismatched.size() << " 个片段\n";
+    ss << "用时 " << seconds << " 秒";
+    resultMsg = ss.str();
+    return true;
+}
+
+IMPLEMENT_CREATE(ConcatCommandBuilder);
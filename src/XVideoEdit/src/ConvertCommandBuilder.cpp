@@ -1,9 +1,116 @@
 ﻿#include "ConvertCommandBuilder.h"
+#include "EncoderTuner.h"
+#include "MediaProbeCache.h"
 #include "XTool.h"
+#include "XExec.h"
 #include <sstream>
 #include <iostream>
 #include <algorithm>
 #include <cctype>
+#include <cmath>
+
+namespace
+{
+    /// 编码器名 -> ffprobe 报告的编码名（libx264 -> h264），未知返回空
+    auto codecNameOf(const std::string &encoder) -> std::string
+    {
+        struct Mapping
+        {
+            const char *pattern;
+            const char *codec;
+        };
+        static constexpr Mapping mappings[] = {
+            { "264", "h264" },        { "265", "hevc" },     { "hevc", "hevc" },     { "vp9", "vp9" },
+            { "vp8", "vp8" },         { "libvpx", "vp8" },   { "mpeg4", "mpeg4" },   { "mpeg2video", "mpeg2video" },
+            { "aac", "aac" },         { "mp3", "mp3" },      { "opus", "opus" },     { "vorbis", "vorbis" },
+            { "flac", "flac" },
+        };
+        for (const auto &mapping : mappings)
+        {
+            if (encoder.find(mapping.pattern) != std::string::npos)
+            {
+                return mapping.codec;
+            }
+        }
+        return {};
+    }
+
+    /// "2000k" / "1.5M" / "128000" -> bit/s，无法解析返回0
+    auto parseBitrate(const std::string &text) -> int64_t
+    {
+        try
+        {
+            size_t       pos   = 0;
+            const double value = std::stod(text, &pos);
+            double       scale = 1.0;
+            if (pos < text.size())
+            {
+                switch (std::tolower(static_cast<unsigned char>(text[pos])))
+                {
+                    case 'k':
+                        scale = 1e3;
+                        break;
+                    case 'm':
+                        scale = 1e6;
+                        break;
+                    default:
+                        return 0;
+                }
+            }
+            return value > 0 ? static_cast<int64_t>(value * scale) : 0;
+        }
+        catch (const std::exception &)
+        {
+            return 0;
+        }
+    }
+
+    /// "30" / "29.97" / "30000/1001" -> 帧率，无法解析返回0
+    auto parseFrameRate(const std::string &text) -> double
+    {
+        try
+        {
+            const auto slash = text.find('/');
+            if (slash == std::string::npos)
+            {
+                return std::stod(text);
+            }
+            const double den = std::stod(text.substr(slash + 1));
+            return den > 0 ? std::stod(text.substr(0, slash)) / den : 0.0;
+        }
+        catch (const std::exception &)
+        {
+            return 0.0;
+        }
+    }
+
+    /// scale 参数（1280:720、1280x720、-1:720）是否与源尺寸一致；表达式等无法判断的视为不一致
+    auto resolutionMatches(const std::string &text, int width, int height) -> bool
+    {
+        const auto sep = text.find_first_of(":x");
+        if (sep == std::string::npos)
+        {
+            return false;
+        }
+        try
+        {
+            size_t    pos1 = 0;
+            size_t    pos2 = 0;
+            const int w    = std::stoi(text.substr(0, sep), &pos1);
+            const int h    = std::stoi(text.substr(sep + 1), &pos2);
+            if (pos1 != sep || pos2 != text.size() - sep - 1)
+            {
+                return false;
+            }
+            /// -1/-2 表示按比例，由另一边决定
+            return (w < 0 || w == width) && (h < 0 || h == height);
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+    }
+} // namespace
 
 auto ConvertCommandBuilder::parseOptions(const std::map<std::string, ParameterValue>& params) const
         -> ConvertCommandBuilder::ConvertOptions
@@ -39,6 +146,14 @@ auto ConvertCommandBuilder::parseOptions(const std::map<std::string, ParameterVa
         std::ranges::transform(val, val.begin(), ::tolower);
         options.faststart = (val == "true" || val == "1" || val == "yes" || val == "on");
     }
+    if (params.contains("--fragmented"))
+    {
+        options.fragmented = params.at("--fragmented").empty() || params.at("--fragmented").asBool();
+    }
+    if (params.contains("--frag-duration"))
+    {
+        options.frag_duration = params.at("--frag-duration").asDouble();
+    }
 
     return options;
 }
@@ -92,8 +207,8 @@ bool ConvertCommandBuilder::validate(const std::map<std::string, ParameterValue>
         }
     }
 
-    /// 验证CRF值（如果提供）
-    if (params.contains("--crf"))
+    /// 验证CRF值（如果提供，auto 表示自动调参）
+    if (params.contains("--crf") && params.at("--crf").asString() != "auto")
     {
         try
         {
@@ -111,7 +226,13 @@ bool ConvertCommandBuilder::validate(const std::map<std::string, ParameterValue>
         }
     }
 
-    return true;
+    if (params.contains("--frag-duration") && params.at("--frag-duration").asDouble() < 0)
+    {
+        errorMsg = "--frag-duration 不能为负数";
+        return false;
+    }
+
+    return EncoderTuner::validateParams(params, errorMsg);
 }
 
 auto ConvertCommandBuilder::buildVideoFilters(const ConvertOptions& options) const -> std::string
@@ -140,61 +261,209 @@ auto ConvertCommandBuilder::buildVideoFilters(const ConvertOptions& options) con
     return filters.str();
 }
 
+auto ConvertCommandBuilder::planStreams(const std::map<std::string, ParameterValue>& params) const -> StreamPlan
+{
+    return planStreams(parseOptions(params), params);
+}
+
+auto ConvertCommandBuilder::planStreams(const ConvertOptions&                        options,
+                                        const std::map<std::string, ParameterValue>& params) const -> StreamPlan
+{
+    StreamPlan plan;
+    if (params.contains("--remux") && !(params.at("--remux").empty() || params.at("--remux").asBool()))
+    {
+        plan.videoReason = plan.audioReason = "已禁用 (--remux false)";
+        return plan;
+    }
+
+    MediaProbeInfo info;
+    std::string    errorMsg;
+    if (!MediaProbeCache::getInstance()->probe(options.input, info, errorMsg))
+    {
+        plan.videoReason = plan.audioReason = "无法探测源文件";
+        return plan;
+    }
+
+    /// 视频：编码一致，且分辨率/帧率/码率约束（只检查显式给出的）均已满足
+    const auto *video  = info.videoStream();
+    const auto  vcodec = codecNameOf(options.video_codec);
+    if (!video)
+    {
+        plan.videoReason = "源文件没有视频流";
+    }
+    else if (vcodec.empty() || video->codecName != vcodec)
+    {
+        plan.videoReason = "源编码 " + video->codecName + " 与目标 " + options.video_codec + " 不一致";
+    }
+    else if (params.contains("--preset") || params.contains("--crf"))
+    {
+        plan.videoReason = "指定了 --preset/--crf，按要求重新编码";
+    }
+    else if (!options.resolution.empty() && !resolutionMatches(options.resolution, video->width, video->height))
+    {
+        plan.videoReason = "需要缩放到 " + options.resolution;
+    }
+    else if (!options.fps.empty() && std::abs(parseFrameRate(options.fps) - video->fps) > 0.01)
+    {
+        plan.videoReason = "需要转换帧率到 " + options.fps;
+    }
+    else
+    {
+        plan.copyVideo   = true;
+        plan.videoReason = video->codecName + " " + std::to_string(video->width) + "x" + std::to_string(video->height);
+
+        /// 默认的 2000k 只是编码参数，显式给出码率时才作为上限；流码率未知时用容器总码率估计
+        if (params.contains("--bitrate") || params.contains("--video_bitrate"))
+        {
+            const int64_t limit  = parseBitrate(options.video_bitrate);
+            const int64_t source = video->bitRate > 0 ? video->bitRate : info.bitRate;
+            if (limit <= 0 || source <= 0 || source > limit)
+            {
+                plan.copyVideo   = false;
+                plan.videoReason = "源码率超过 " + options.video_bitrate + " 或未知";
+            }
+        }
+    }
+
+    /// 音频：所有音频流都满足才复制（-c:a 对全部音频流生效）
+    const auto acodec   = codecNameOf(options.audio_codec);
+    const auto limit    = options.audio_bitrate.empty() ? 0 : parseBitrate(options.audio_bitrate);
+    bool       hasAudio = false;
+    plan.copyAudio      = !acodec.empty();
+    for (const auto& stream : info.streams)
+    {
+        if (stream.codecType != "audio")
+        {
+            continue;
+        }
+        hasAudio = true;
+        if (stream.codecName != acodec)
+        {
+            plan.copyAudio   = false;
+            plan.audioReason = "源编码 " + stream.codecName + " 与目标 " + options.audio_codec + " 不一致";
+            break;
+        }
+        if (!options.audio_bitrate.empty() && (limit <= 0 || stream.bitRate <= 0 || stream.bitRate > limit))
+        {
+            plan.copyAudio   = false;
+            plan.audioReason = "源码率超过 " + options.audio_bitrate + " 或未知";
+            break;
+        }
+    }
+    if (!hasAudio)
+    {
+        plan.copyAudio   = false;
+        plan.audioReason = "源文件没有音频流";
+    }
+    else if (plan.copyAudio)
+    {
+        plan.audioReason = acodec;
+    }
+
+    return plan;
+}
+
 auto ConvertCommandBuilder::build(const std::map<std::string, ParameterValue>& params) const -> std::string
 {
     ConvertOptions options = parseOptions(params);
 
+    /// 源流已满足目标时直接复制，转换退化为只受 I/O 限制的重新封装
+    const StreamPlan plan = planStreams(options, params);
+    if (plan.copyVideo || plan.copyAudio)
+    {
+        std::cout << "[智能封装] 视频: " << (plan.copyVideo ? "流复制 (" : "重新编码 (") << plan.videoReason << ")"
+                  << "，音频: " << (plan.copyAudio ? "流复制 (" : "重新编码 (") << plan.audioReason << ")"
+                  << std::endl;
+    }
+
+    /// --preset/--crf auto：按目标速度试编码选择（滤镜与正式编码一致）
+    if (!plan.copyVideo)
+    {
+        EncoderTuner::Options tuneOptions;
+        tuneOptions.videoCodec  = options.video_codec;
+        tuneOptions.videoFilter = buildVideoFilters(options);
+        EncoderTuner::resolveParams(params, tuneOptions, options.preset, options.crf, "medium", "23");
+    }
+
     std::stringstream cmd;
     cmd << "\"" << XTool::getFFmpegPath() << "\" ";
 
     /// 基本参数
-    cmd << "-hide_banner -progress pipe:1 -nostats -loglevel error ";
+    cmd << "-hide_banner -progress " << XExec::progressTarget() << " -nostats -loglevel error ";
     cmd << "-y "; /// 覆盖输出文件
 
     /// 输入文件
     cmd << "-i \"" << options.input << "\" ";
 
-    /// 视频参数
-    cmd << "-c:v " << options.video_codec << " ";
-
-    if (!options.video_bitrate.empty())
+    /// 视频参数（流复制时码率/滤镜/预设/CRF 都不适用）
+    if (plan.copyVideo)
     {
-        cmd << "-b:v " << options.video_bitrate << " ";
+        cmd << "-c:v copy ";
     }
-
-    /// 视频滤镜
-    std::string videoFilters = buildVideoFilters(options);
-    if (!videoFilters.empty())
+    else
     {
-        cmd << "-vf \"" << videoFilters << "\" ";
-    }
+        cmd << "-c:v " << options.video_codec << " ";
 
-    /// 编码预设
-    if (!options.preset.empty())
-    {
-        cmd << "-preset " << options.preset << " ";
-    }
+        if (!options.video_bitrate.empty())
+        {
+            cmd << "-b:v " << options.video_bitrate << " ";
+        }
 
-    /// CRF质量
-    if (!options.crf.empty())
-    {
-        cmd << "-crf " << options.crf << " ";
+        /// 视频滤镜
+        std::string videoFilters = buildVideoFilters(options);
+        if (!videoFilters.empty())
+        {
+            cmd << "-vf \"" << videoFilters << "\" ";
+        }
+
+        /// 编码预设
+        if (!options.preset.empty())
+        {
+            cmd << "-preset " << options.preset << " ";
+        }
+
+        /// CRF质量
+        if (!options.crf.empty())
+        {
+            cmd << "-crf " << options.crf << " ";
+        }
     }
 
     /// 音频参数
-    cmd << "-c:a " << options.audio_codec << " ";
-
-    if (!options.audio_bitrate.empty())
+    if (plan.copyAudio)
     {
-        cmd << "-b:a " << options.audio_bitrate << " ";
+        cmd << "-c:a copy ";
     }
     else
     {
-        cmd << "-b:a 128k "; /// 默认音频码率
+        cmd << "-c:a " << options.audio_codec << " ";
+
+        if (!options.audio_bitrate.empty())
+        {
+            cmd << "-b:a " << options.audio_bitrate << " ";
+        }
+        else
+        {
+            cmd << "-b:a 128k "; /// 默认音频码率
+        }
     }
 
+    /// 分片输出：moov 在文件头且不含样本，每个关键帧写出独立的 moof+mdat，
+    /// 写完的片段可以立即被读取，也不需要结束时再整体重写一遍文件
+    if (options.fragmented)
+    {
+        if (options.faststart)
+        {
+            std::cout << "[分片输出] moov 已在文件头，忽略 --faststart" << std::endl;
+        }
+        cmd << "-movflags frag_keyframe+empty_moov+default_base_moof ";
+        if (options.frag_duration > 0)
+        {
+            cmd << "-frag_duration " << static_cast<int64_t>(options.frag_duration * 1000000) << " ";
+        }
+    }
     /// 快速启动（针对MP4）
-    if (options.faststart)
+    else if (options.faststart)
     {
         cmd << "-movflags +faststart ";
     }
@@ -0,0 +1,177 @@
+﻿#include "CopyCommandBuilder.h"
+#include "FileCopier.h"
+#include "TaskProgressBar.h"
+#include "ThroughputEstimator.h"
+#include "XFile.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    constexpr double MIB = 1024.0 * 1024.0;
+
+    auto formatSeconds(double seconds) -> std::string
+    {
+        const auto        total = static_cast<long long>(seconds + 0.5);
+        std::stringstream ss;
+        ss << std::setfill('0') << std::setw(2) << total / 3600 << ":" << std::setw(2) << total / 60 % 60 << ":"
+           << std::setw(2) << total % 60;
+        return ss.str();
+    }
+} // namespace
+
+auto CopyCommandBuilder::parseOptions(const std::map<std::string, ParameterValue>& params) const
+        -> CopyCommandBuilder::CopyOptions
+{
+    CopyOptions options;
+    options.source      = params.at("-s").asString();
+    options.destination = params.at("-d").asString();
+
+    if (params.contains("--jobs"))
+    {
+        options.jobs = params.at("--jobs").asInt();
+    }
+
+    /// 无值的布尔参数视为开启
+    auto flag = [&params](const char* name, bool fallback) -> bool
+    {
+        if (!params.contains(name))
+        {
+            return fallback;
+        }
+        return params.at(name).empty() || params.at(name).asBool();
+    };
+    options.overwrite   = flag("--overwrite", false);
+    options.reflink     = flag("--reflink", true);
+    options.preallocate = flag("--preallocate", true);
+    return options;
+}
+
+auto CopyCommandBuilder::build(const std::map<std::string, ParameterValue>&) const -> std::string
+{
+    /// 复制任务全部在进程内执行，不生成外部命令
+    return {};
+}
+
+auto CopyCommandBuilder::validate(const std::map<std::string, ParameterValue>& params, std::string& errorMsg) const
+        -> bool
+{
+    if (!params.contains("-s") || params.at("-s").empty())
+    {
+        errorMsg = "缺少源路径参数(-s)";
+        return false;
+    }
+    if (!params.contains("-d") || params.at("-d").empty())
+    {
+        errorMsg = "缺少目标路径参数(-d)";
+        return false;
+    }
+
+    std::error_code ec;
+    if (!fs::exists(params.at("-s").asString(), ec))
+    {
+        errorMsg = "源路径不存在: " + params.at("-s").asString();
+        return false;
+    }
+
+    if (params.contains("--jobs") && params.at("--jobs").asInt() < 0)
+    {
+        errorMsg = "--jobs 必须为非负整数";
+        return false;
+    }
+    return true;
+}
+
+auto CopyCommandBuilder::getTitle(const std::map<std::string, ParameterValue>& params) const -> std::string
+{
+    return "复制: " + XFile::getFileName(params.at("-s").asString()) + " → " + params.at("-d").asString();
+}
+
+auto CopyCommandBuilder::isInProcess(const std::map<std::string, ParameterValue>&) const -> bool
+{
+    return true;
+}
+
+auto CopyCommandBuilder::run(const std::map<std::string, ParameterValue>& params, std::string& resultMsg,
+                             std::string& errorMsg) const -> bool
+{
+    CopyOptions options = parseOptions(params);
+
+    FileCopier::Options copyOptions;
+    copyOptions.jobs        = options.jobs;
+    copyOptions.overwrite   = options.overwrite;
+    copyOptions.reflink     = options.reflink;
+    copyOptions.preallocate = options.preallocate;
+
+    /// 按字节计算进度；速率与剩余时间用指数加权估计（以 MiB 为单位）
+    auto bar = TaskProgressBar::create();
+    bar->setTitle(getTitle(params));
+
+    const auto          start = std::chrono::steady_clock::now();
+    ThroughputEstimator estimator;
+    bool                started = false;
+
+    auto progress = [&](uint64_t copied, uint64_t total)
+    {
+        if (!started)
+        {
+            estimator.reset(total / MIB);
+            started = true;
+        }
+        const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        estimator.observe(wall, copied / MIB);
+
+        std::stringstream ss;
+        ss << XFile::formatFileSize(copied) << " / " << XFile::formatFileSize(total);
+        if (const auto estimate = estimator.estimate(); estimate.valid)
+        {
+            ss << "  " << std::fixed << std::setprecision(1) << estimate.rate << " MB/s";
+            if (estimate.etaSeconds >= 0)
+            {
+                ss << "  剩余: " << formatSeconds(estimate.etaSeconds);
+            }
+        }
+
+        const float percent = total ? static_cast<float>(100.0 * copied / total) : 100.0f;
+        bar->setProgress(percent, ss.str());
+    };
+
+    FileCopier         copier;
+    FileCopier::Result result;
+    const bool         ok = copier.copy(options.source, options.destination, copyOptions, result, errorMsg, progress);
+    if (!ok)
+    {
+        bar->markAsFailed();
+        if (result.errors.size() > 1)
+        {
+            for (const auto& error : result.errors)
+            {
+                std::cerr << "  " << error << std::endl;
+            }
+        }
+        return false;
+    }
+    bar->markAsCompleted();
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "复制完成: " << result.files << " 个文件，" << result.directories << " 个目录，"
+       << XFile::formatFileSize(result.bytes) << "，并行 " << result.jobs << "\n";
+    ss << "方式:";
+    for (size_t i = 0; i < FileCopier::METHOD_COUNT; ++i)
+    {
+        if (result.byMethod[i] > 0)
+        {
+            ss << " " << FileCopier::methodName(static_cast<FileCopier::Method>(i)) << "×" << result.byMethod[i];
+        }
+    }
+    ss << "\n用时 " << result.seconds << " 秒，吞吐 "
+       << (result.seconds > 0 ? result.bytes / MIB / result.seconds : 0.0) << " MB/s";
+    resultMsg = ss.str();
+    return true;
+}
+
+IMPLEMENT_CREATE(CopyCommandBuilder);
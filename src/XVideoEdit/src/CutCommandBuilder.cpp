@@ -1,5 +1,7 @@
 ﻿#include "CutCommandBuilder.h"
+#include "EncoderTuner.h"
 #include "XTool.h"
+#include "XExec.h"
 #include <sstream>
 #include <iostream>
 #include <algorithm>
@@ -48,7 +50,14 @@ auto CutCommandBuilder::parseOptions(const std::map<std::string, ParameterValue>
 
     if (params.contains("--reencode"))
     {
-        options.reencode = parseBool(params.at("--reencode"));
+        /// 不带值的 --reencode 即表示开启
+        options.reencode = params.at("--reencode").empty() || parseBool(params.at("--reencode"));
+
+        /// 只给 --reencode 时不再落回默认的流复制
+        if (!params.contains("--copy"))
+        {
+            options.use_copy = !options.reencode;
+        }
     }
 
     if (params.contains("--accurate"))
@@ -56,6 +65,16 @@ auto CutCommandBuilder::parseOptions(const std::map<std::string, ParameterValue>
         options.accurate_seek = parseBool(params.at("--accurate"));
     }
 
+    if (params.contains("--preset") && !params.at("--preset").empty())
+    {
+        options.preset = params.at("--preset").asString();
+    }
+
+    if (params.contains("--crf") && !params.at("--crf").empty())
+    {
+        options.crf = params.at("--crf").asString();
+    }
+
     return options;
 }
 
@@ -207,7 +226,7 @@ auto CutCommandBuilder::validate(const std::map<std::string, ParameterValue>& pa
         }
     }
 
-    return true;
+    return EncoderTuner::validateParams(params, errorMsg);
 }
 
 auto CutCommandBuilder::build(const std::map<std::string, ParameterValue>& params) const -> std::string
@@ -218,7 +237,7 @@ auto CutCommandBuilder::build(const std::map<std::string, ParameterValue>& param
     cmd << "\"" << XTool::getFFmpegPath() << "\" ";
 
     /// 基本参数
-    cmd << "-hide_banner -progress pipe:1 -nostats -loglevel error ";
+    cmd << "-hide_banner -progress " << XExec::progressTarget() << " -nostats -loglevel error ";
     cmd << "-y "; /// 覆盖输出文件
 
     /// 准确搜索（如果启用）
@@ -252,8 +271,24 @@ auto CutCommandBuilder::build(const std::map<std::string, ParameterValue>& param
     }
     else if (options.reencode && !options.use_copy)
     {
-        /// 重新编码模式（精确）
-        cmd << "-c:v libx264 -crf 23 -preset fast ";
+        /// 重新编码模式（精确）；auto 时只在剪切区间内取样
+        if (options.preset == "auto" || options.crf == "auto")
+        {
+            EncoderTuner::Options tuneOptions;
+            try
+            {
+                tuneOptions.rangeStart = std::stod(timeToSeconds(options.start_time));
+                const double value     = std::stod(timeToSeconds(options.time_value));
+                tuneOptions.rangeDuration =
+                        options.time_spec == TimeSpec::DURATION ? value : value - tuneOptions.rangeStart;
+            }
+            catch (const std::exception&)
+            {
+                /// 时间无法换算时在整个文件中取样
+            }
+            EncoderTuner::resolveParams(params, tuneOptions, options.preset, options.crf);
+        }
+        cmd << "-c:v libx264 -crf " << options.crf << " -preset " << options.preset << " ";
         cmd << "-c:a aac -b:a 128k ";
     }
     else
@@ -105,6 +105,16 @@ auto CutProgressBar::updateProgress(XExec &exec, const std::string_view &taskNam
         auto progressState = std::make_shared<AVProgressState>();
         setProgressState(progressState, startTime, clipDuration, timeRangeStr);
 
+        /// 与 CutCommandBuilder 一致：只有单独指定 --reencode 时重新编码，否则流复制
+        const bool copy     = inputParams.contains("--copy") && inputParams.at("--copy").asBool();
+        const bool reencode = inputParams.contains("--reencode") &&
+                (inputParams.at("--reencode").empty() || inputParams.at("--reencode").asBool());
+        setJobProfile(progressState, taskName, inputParams, reencode && !copy ? "libx264" : "copy");
+        if (reencode && !copy && progressState->profile.preset == "-")
+        {
+            progressState->profile.preset = "fast";
+        }
+
         /// 开始进度监控
         startProgressMonitoring(exec, progressState, srcPath, dstPath);
     }
@@ -1,5 +1,8 @@
 ﻿#include "DecryptCommandBuilder.h"
 #include "XTool.h"
+#include "XExec.h"
+#include "AesEngine.h"
+#include "KeyStore.h"
 #include <sstream>
 #include <iostream>
 #include <algorithm>
@@ -10,21 +13,25 @@
 #include <filesystem>
 #include <chrono>
 #include <fstream>
+#include <iomanip>
 
 /// 支持的解密算法
 const std::vector<std::string> DecryptCommandBuilder::SUPPORTED_CIPHERS = {
     "cenc-aes-ctr", /// MP4 Common Encryption AES-CTR
     "cenc-aes-cbc", /// MP4 Common Encryption AES-CBC
-    "aes-128-cbc",  /// 用于OpenSSL解密
-    "aes-256-cbc"   /// 用于OpenSSL解密
+    "aes-128-cbc",  /// 进程内AES引擎整文件解密（与OpenSSL兼容）
+    "aes-256-cbc",  /// 进程内AES引擎整文件解密（与OpenSSL兼容）
+    "aes-128-ctr",  /// 进程内AES引擎，多线程
+    "aes-256-ctr"   /// 进程内AES引擎，多线程
 };
 
 auto DecryptCommandBuilder::parseKeyFileContent(const std::string& content, std::string& key, std::string& kid,
-                                                std::string& method) const -> bool
+                                                std::string& method, std::string& iv) const -> bool
 {
     bool foundKey    = false;
     bool foundKid    = false;
     bool foundMethod = false;
+    bool foundIv     = false;
 
     std::istringstream stream(content);
     std::string        line;
@@ -38,6 +45,7 @@ auto DecryptCommandBuilder::parseKeyFileContent(const std::string& content, std:
     std::regex simpleKeyRegex(R"(--key\s+([0-9a-fA-F]+))");
     std::regex simpleKidRegex(R"(--kid\s+([0-9a-fA-F]+))");
     std::regex simpleMethodRegex(R"(--method\s+(\S+))");
+    std::regex simpleIvRegex(R"(--iv\s+([0-9a-fA-F]+))");
 
     while (std::getline(stream, line))
     {
@@ -84,6 +92,13 @@ auto DecryptCommandBuilder::parseKeyFileContent(const std::string& content, std:
             // std::cout << "从密钥文件读取到加密方法: " << method << std::endl;
             foundMethod = true;
         }
+
+        /// 尝试匹配初始化向量（原生AES方法需要）
+        if (!foundIv && std::regex_search(line, matches, simpleIvRegex) && matches.size() >= 2)
+        {
+            iv      = matches[1].str();
+            foundIv = true;
+        }
     }
 
     /// 必须找到密钥
@@ -111,7 +126,7 @@ auto DecryptCommandBuilder::parseKeyFileContent(const std::string& content, std:
 }
 
 auto DecryptCommandBuilder::readKeyFromFile(const std::string& keyfile, std::string& key, std::string& kid,
-                                            std::string& method, std::string& errorMsg) const -> bool
+                                            std::string& method, std::string& iv, std::string& errorMsg) const -> bool
 {
     try
     {
@@ -139,7 +154,7 @@ auto DecryptCommandBuilder::readKeyFromFile(const std::string& keyfile, std::str
         }
 
         /// 解析文件内容
-        if (!parseKeyFileContent(content, key, kid, method))
+        if (!parseKeyFileContent(content, key, kid, method, iv))
         {
             errorMsg = "无法从密钥文件中解析出必要的参数";
             return false;
@@ -154,6 +169,79 @@ auto DecryptCommandBuilder::readKeyFromFile(const std::string& keyfile, std::str
     }
 }
 
+auto DecryptCommandBuilder::hasStoredKey(const DecryptOptions& options) const -> bool
+{
+    return !options.keystore.empty() || options.derive_key || !options.keyfile.empty();
+}
+
+auto DecryptCommandBuilder::loadKeyParams(const DecryptOptions& options, std::string& key, std::string& kid,
+                                          std::string& method, std::string& iv, std::string& errorMsg) const -> bool
+{
+    std::string assetId = options.asset_id.empty() ? KeyStore::assetIdFor(options.input) : options.asset_id;
+
+    if (!options.keystore.empty())
+    {
+        auto store = KeyStore::shared(options.keystore, errorMsg);
+        if (!store)
+        {
+            return false;
+        }
+
+        /// 指定了 KID 时按 KID 查找（文件被移动后资源ID失效）
+        KeyStore::Entry entry;
+        bool            found = options.kid.empty() ? store->find(assetId, entry)
+                                                    : store->findByKid(cleanHexString(options.kid), entry);
+        if (!found)
+        {
+            errorMsg = "密钥库中没有该资源的密钥: " + (options.kid.empty() ? assetId : options.kid);
+            return false;
+        }
+
+        key    = entry.key;
+        kid    = entry.kid;
+        method = entry.method;
+        iv     = entry.iv;
+        if (!entry.derived)
+        {
+            return true;
+        }
+        if (!options.derive_key)
+        {
+            errorMsg = "该资源的密钥由主密钥派生，请提供 --master-key 或设置环境变量 XVE_MASTER_KEY";
+            return false;
+        }
+        assetId = entry.assetId;
+    }
+    else if (options.derive_key)
+    {
+        method = options.method;
+    }
+    else
+    {
+        return readKeyFromFile(options.keyfile, key, kid, method, iv, errorMsg);
+    }
+
+    /// 主密钥派生：与加密时使用同一资源ID即可还原密钥，无需读取任何密钥文件
+    std::vector<uint8_t> masterKey;
+    if (!KeyStore::loadMasterKey(options.master_key, masterKey, errorMsg))
+    {
+        return false;
+    }
+
+    AesEngine::Mode mode;
+    size_t          keyBytes = 16;
+    AesEngine::parseMethod(method, mode, keyBytes);
+
+    /// IV 不派生：原生方法的随机IV来自密钥库记录或 --iv
+    std::string derivedKid;
+    KeyStore::derive(masterKey, assetId, keyBytes, key, derivedKid);
+    if (kid.empty())
+    {
+        kid = derivedKid;
+    }
+    return true;
+}
+
 auto DecryptCommandBuilder::parseOptions(const std::map<std::string, ParameterValue>& params) const
         -> DecryptCommandBuilder::DecryptOptions
 {
@@ -169,6 +257,23 @@ auto DecryptCommandBuilder::parseOptions(const std::map<std::string, ParameterVa
         options.keyfile = params.at("--keyfile").asString();
     }
 
+    /// 密钥库与主密钥派生
+    if (params.contains("--keystore"))
+    {
+        options.keystore = params.at("--keystore").asString();
+    }
+
+    if (params.contains("--master-key"))
+    {
+        options.derive_key = true;
+        options.master_key = params.at("--master-key").asString();
+    }
+
+    if (params.contains("--asset-id"))
+    {
+        options.asset_id = params.at("--asset-id").asString();
+    }
+
     /// 解密密钥（必需，但如果提供了keyfile，可以从文件中读取）
     if (params.contains("--key"))
     {
@@ -198,7 +303,12 @@ auto DecryptCommandBuilder::parseOptions(const std::map<std::string, ParameterVa
         std::string requestedMethod = params.at("--method").asString();
 
         /// 标准化方法名
-        if (requestedMethod.find("AES-128") != std::string::npos)
+        if (AesEngine::isNativeMethod(requestedMethod))
+        {
+            options.method = requestedMethod;
+            std::ranges::transform(options.method, options.method.begin(), ::tolower);
+        }
+        else if (requestedMethod.find("AES-128") != std::string::npos)
         {
             options.method = "cenc-aes-ctr";
         }
@@ -255,6 +365,17 @@ auto DecryptCommandBuilder::parseOptions(const std::map<std::string, ParameterVa
         options.ffplay_args = params.at("--ffplay-args").asString();
     }
 
+    if (params.contains("--stream"))
+    {
+        options.stream_play = parseBool(params.at("--stream").asString());
+    }
+
+    if (params.contains("--stream-format"))
+    {
+        options.stream_format = params.at("--stream-format").asString();
+        std::ranges::transform(options.stream_format, options.stream_format.begin(), ::tolower);
+    }
+
     return options;
 }
 
@@ -338,27 +459,26 @@ auto DecryptCommandBuilder::validate(const std::map<std::string, ParameterValue>
 
     /// 检查解密密钥来源
     bool hasKeyParam     = params.contains("--key") || params.contains("--password");
-    bool hasKeyfileParam = params.contains("--keyfile");
+    bool hasStoredKeyParam = hasStoredKey(parseOptions(params));
 
-    if (!hasKeyParam && !hasKeyfileParam)
+    if (!hasKeyParam && !hasStoredKeyParam)
     {
-        errorMsg = "需要解密密钥(--key)、密码(--password)或密钥文件(--keyfile)";
+        errorMsg = "需要解密密钥(--key)、密码(--password)、密钥文件(--keyfile)、"
+                   "密钥库(--keystore)或主密钥(--master-key)";
         return false;
     }
 
     /// 如果同时指定了密钥和密钥文件，优先使用密钥文件，但给出警告
-    if (hasKeyParam && hasKeyfileParam)
+    if (hasKeyParam && hasStoredKeyParam)
     {
-        std::cout << "警告: 同时指定了密钥和密钥文件，优先使用密钥文件中的参数" << std::endl;
+        std::cout << "警告: 同时指定了密钥和已保存的密钥来源，优先使用已保存的参数" << std::endl;
     }
 
-    /// 验证密钥文件（如果提供）
-    std::string keyFromFile, kidFromFile, methodFromFile;
-    if (hasKeyfileParam)
+    /// 验证密钥库 / 主密钥 / 密钥文件（如果提供）
+    std::string keyFromFile, kidFromFile, methodFromFile, ivFromFile;
+    if (hasStoredKeyParam)
     {
-        std::string keyfile = params.at("--keyfile").asString();
-
-        if (!readKeyFromFile(keyfile, keyFromFile, kidFromFile, methodFromFile, errorMsg))
+        if (!loadKeyParams(parseOptions(params), keyFromFile, kidFromFile, methodFromFile, ivFromFile, errorMsg))
         {
             /// 如果读取文件失败，尝试使用命令行参数
             std::cout << "警告: " << errorMsg << "，将尝试使用命令行参数" << std::endl;
@@ -368,7 +488,7 @@ auto DecryptCommandBuilder::validate(const std::map<std::string, ParameterValue>
         {
             // 验证从文件中读取的密钥
             std::string cleanKey = cleanHexString(keyFromFile);
-            if (!validateKeyFormat(cleanKey, "密钥文件中的解密密钥", errorMsg))
+            if (!validateKeyFormat(cleanKey, "已保存的解密密钥", errorMsg))
             {
                 return false;
             }
@@ -377,7 +497,7 @@ auto DecryptCommandBuilder::validate(const std::map<std::string, ParameterValue>
             if (!kidFromFile.empty())
             {
                 std::string cleanKid = cleanHexString(kidFromFile);
-                if (!validateKeyFormat(cleanKid, "密钥文件中的Key ID", errorMsg))
+                if (!validateKeyFormat(cleanKid, "已保存的Key ID", errorMsg))
                 {
                     return false;
                 }
@@ -392,7 +512,7 @@ auto DecryptCommandBuilder::validate(const std::map<std::string, ParameterValue>
     }
 
     /// 验证命令行中的密钥（如果没有使用密钥文件，或密钥文件读取失败）
-    if (!hasKeyfileParam || keyFromFile.empty())
+    if (!hasStoredKeyParam || keyFromFile.empty())
     {
         if (!params.contains("--key") && !params.contains("--password"))
         {
@@ -427,7 +547,12 @@ auto DecryptCommandBuilder::validate(const std::map<std::string, ParameterValue>
         std::string requestedMethod = params.at("--method").asString();
 
         /// 标准化方法名
-        if (requestedMethod.find("AES") != std::string::npos)
+        if (AesEngine::isNativeMethod(requestedMethod))
+        {
+            method = requestedMethod;
+            std::ranges::transform(method, method.begin(), ::tolower);
+        }
+        else if (requestedMethod.find("AES") != std::string::npos)
         {
             method = "cenc-aes-ctr";
         }
@@ -458,6 +583,22 @@ auto DecryptCommandBuilder::validate(const std::map<std::string, ParameterValue>
         }
     }
 
+    /// 原生AES解密：需要IV，且不支持直接用ffplay播放密文
+    std::string nativeMethod = resolveNativeMethod(parseOptions(params));
+    if (!nativeMethod.empty())
+    {
+        if (!params.contains("--iv") && ivFromFile.empty())
+        {
+            errorMsg = nativeMethod + " 解密需要初始化向量(--iv)或包含IV的密钥文件";
+            return false;
+        }
+        if (params.contains("--play-only") && params.at("--play-only").asBool())
+        {
+            errorMsg = nativeMethod + " 为整文件加密，ffplay无法直接播放，请去掉 --play-only";
+            return false;
+        }
+    }
+
     /// 检查输入文件是否存在
     std::string inputFile = params.at("--input").asString();
     if (!std::filesystem::exists(inputFile))
@@ -480,7 +621,7 @@ auto DecryptCommandBuilder::validate(const std::map<std::string, ParameterValue>
         std::string ext = std::filesystem::path(inputFile).extension().string();
         std::ranges::transform(ext, ext.begin(), ::tolower);
 
-        if (ext != ".mp4" && ext != ".m4v" && ext != ".mov")
+        if (nativeMethod.empty() && ext != ".mp4" && ext != ".m4v" && ext != ".mov")
         {
             std::cout << "警告: 输入文件可能不是MP4格式，CENC解密主要支持MP4文件" << std::endl;
         }
@@ -524,6 +665,34 @@ auto DecryptCommandBuilder::validate(const std::map<std::string, ParameterValue>
         return false;
     }
 
+    /// 流式播放：不落盘，因此与保存/删除文件相关的选项互斥
+    if (params.contains("--stream") && params.at("--stream").asBool())
+    {
+        if (!play_after_decrypt)
+        {
+            errorMsg = "--stream 参数需要同时指定 --play true";
+            return false;
+        }
+        if (play_only || delete_after_play)
+        {
+            errorMsg = "--stream 模式不写解密文件，不能与 --play-only / --delete-after-play 同时使用";
+            return false;
+        }
+        if (!nativeMethod.empty())
+        {
+            errorMsg = nativeMethod + " 为整文件加密，无法边解密边播放，请去掉 --stream";
+            return false;
+        }
+
+        std::string format = params.contains("--stream-format") ? params.at("--stream-format").asString() : "ts";
+        std::ranges::transform(format, format.begin(), ::tolower);
+        if (format != "ts" && format != "fmp4")
+        {
+            errorMsg = "不支持的流式封装格式: " + format + "（可选 ts / fmp4）";
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -535,19 +704,19 @@ auto DecryptCommandBuilder::build(const std::map<std::string, ParameterValue>& p
     std::string key, kid, method;
     bool        fromKeyFile = false;
 
-    if (!options.keyfile.empty())
+    if (hasStoredKey(options))
     {
         std::string errorMsg;
-        std::string fileKey, fileKid, fileMethod;
+        std::string fileKey, fileKid, fileMethod, fileIv;
 
-        if (readKeyFromFile(options.keyfile, fileKey, fileKid, fileMethod, errorMsg))
+        if (loadKeyParams(options, fileKey, fileKid, fileMethod, fileIv, errorMsg))
         {
             key         = cleanHexString(fileKey);
             kid         = cleanHexString(fileKid);
             method      = fileMethod;
             fromKeyFile = true;
 
-            std::cout << "使用密钥文件中的参数:" << std::endl;
+            std::cout << "使用已保存的密钥参数:" << std::endl;
             std::cout << "  密钥: " << key << std::endl;
             if (!kid.empty())
                 std::cout << "  KID: " << kid << std::endl;
@@ -621,15 +790,23 @@ auto DecryptCommandBuilder::build(const std::map<std::string, ParameterValue>& p
         }
     }
 
-    std::stringstream cmd;
-
+    /// POSIX 下 XExec 经 /bin/sh -c 执行，&& 与管道可直接使用；Windows 需交给 cmd /c 解释
+    auto shellCommand = [](const std::string& body) -> std::string
+    {
 #ifdef _WIN32
-    /// Windows: 使用 cmd /c 包装整个命令
-    cmd << "cmd /c \"";
+        return "cmd /c \"" + body + "\"";
 #else
-    /// Linux/macOS: 使用 sh -c
-    cmd << "sh -c \"";
+        return body;
 #endif
+    };
+
+    /// 流式播放：不生成中间文件
+    if (options.play_after_decrypt && options.stream_play)
+    {
+        return shellCommand(buildStreamPlayCommand(options, key));
+    }
+
+    std::stringstream cmd;
 
     /// 如果只需要播放，不需要保存解密文件
     if (options.play_only)
@@ -654,7 +831,7 @@ auto DecryptCommandBuilder::build(const std::map<std::string, ParameterValue>& p
 
         cmd << "\"" << options.input << "\"";
 
-        return cmd.str();
+        return shellCommand(cmd.str());
     }
 
     /// 构建输出文件名
@@ -701,7 +878,7 @@ auto DecryptCommandBuilder::build(const std::map<std::string, ParameterValue>& p
     }
 
     /// 基本参数
-    cmd << "-hide_banner -progress pipe:1 -nostats -loglevel info ";
+    cmd << "-hide_banner -progress " << XExec::progressTarget() << " -nostats -loglevel info ";
     cmd << "-y "; /// 覆盖输出文件
 
     /// 输入文件
@@ -769,6 +946,50 @@ auto DecryptCommandBuilder::build(const std::map<std::string, ParameterValue>& p
         }
     }
 
+    return shellCommand(cmd.str());
+}
+
+auto DecryptCommandBuilder::buildStreamPlayCommand(const DecryptOptions& options, const std::string& key) const
+        -> std::string
+{
+    std::stringstream cmd;
+
+    /// 1. ffmpeg 只解密与重封装（-c copy），输出到 stdout
+    cmd << "\"" << XTool::getFFmpegPath() << "\" ";
+    cmd << "-decryption_key " << key << " ";
+    cmd << "-hide_banner -nostats -loglevel error ";
+#ifndef _WIN32
+    /// stdout 用于传输媒体数据，进度走 XExec 提供的 fd 3
+    cmd << "-progress " << XExec::progressTarget() << " ";
+#endif
+    cmd << "-i \"" << options.input << "\" ";
+
+    /// 只保留一路视频与音频：字幕/数据流大多无法放入 TS
+    cmd << "-map \"0:v:0?\" -map \"0:a:0?\" -c copy ";
+    if (options.stream_format == "fmp4")
+    {
+        /// 空 moov + 按关键帧分片，ffplay 收到首个分片即可开始播放
+        cmd << "-f mp4 -movflags frag_keyframe+empty_moov+default_base_moof ";
+    }
+    else
+    {
+        cmd << "-f mpegts ";
+    }
+    cmd << "pipe:1";
+
+    /// 2. ffplay 从 stdin 读取，管道写满时 ffmpeg 自动阻塞，内存占用恒定
+    cmd << " | \"" << XTool::getFFplayPath() << "\" ";
+    cmd << "-autoexit -hide_banner -loglevel error ";
+    if (!options.ffplay_args.empty())
+    {
+        cmd << options.ffplay_args << " ";
+    }
+    else
+    {
+        cmd << "-window_title \"Decrypted Stream: " << fs::path(options.input).filename().string() << "\" ";
+    }
+    cmd << "-i pipe:0";
+
     return cmd.str();
 }
 
@@ -780,8 +1001,13 @@ auto DecryptCommandBuilder::getTitle(const std::map<std::string, ParameterValue>
     std::filesystem::path inputPath(input);
     std::filesystem::path outputPath(output);
 
-    std::string method = "MP4 CENC-AES-CTR";
-    if (params.contains("--method"))
+    std::string method       = "MP4 CENC-AES-CTR";
+    std::string nativeMethod = resolveNativeMethod(parseOptions(params));
+    if (!nativeMethod.empty())
+    {
+        method = "原生AES " + nativeMethod;
+    }
+    else if (params.contains("--method"))
     {
         std::string userMethod = params.at("--method").asString();
         method                 = "MP4 CENC (" + userMethod + ")";
@@ -797,6 +1023,10 @@ auto DecryptCommandBuilder::getTitle(const std::map<std::string, ParameterValue>
         {
             title += " [ffplay直接播放]";
         }
+        else if (params.contains("--stream") && params.at("--stream").asBool())
+        {
+            title += " [边解密边播放]";
+        }
         else
         {
             title += " [解密后播放]";
@@ -809,7 +1039,15 @@ auto DecryptCommandBuilder::getTitle(const std::map<std::string, ParameterValue>
     }
 
     /// 添加密钥文件说明
-    if (params.contains("--keyfile"))
+    if (params.contains("--keystore"))
+    {
+        title += " [从密钥库读取]";
+    }
+    else if (params.contains("--master-key"))
+    {
+        title += " [主密钥派生]";
+    }
+    else if (params.contains("--keyfile"))
     {
         title += " [从密钥文件读取]";
     }
@@ -825,4 +1063,122 @@ auto DecryptCommandBuilder::getTitle(const std::map<std::string, ParameterValue>
     return title;
 }
 
+auto DecryptCommandBuilder::resolveNativeMethod(const DecryptOptions& options) const -> std::string
+{
+    std::string method = options.method;
+    if (hasStoredKey(options))
+    {
+        std::string key, kid, fileMethod, iv, errorMsg;
+        if (loadKeyParams(options, key, kid, fileMethod, iv, errorMsg))
+        {
+            method = fileMethod;
+        }
+    }
+
+    if (!AesEngine::isNativeMethod(method))
+    {
+        return {};
+    }
+    std::ranges::transform(method, method.begin(), ::tolower);
+    return method;
+}
+
+auto DecryptCommandBuilder::isInProcess(const std::map<std::string, ParameterValue>& params) const -> bool
+{
+    return !resolveNativeMethod(parseOptions(params)).empty();
+}
+
+auto DecryptCommandBuilder::run(const std::map<std::string, ParameterValue>& params, std::string& resultMsg,
+                                std::string& errorMsg) const -> bool
+{
+    DecryptOptions options = parseOptions(params);
+    std::string    method  = resolveNativeMethod(options);
+
+    /// 与 build 一致：已保存的参数（密钥库 / 主密钥 / 密钥文件）优先
+    std::string key = options.key, iv = options.iv;
+    if (hasStoredKey(options))
+    {
+        std::string fileKey, fileKid, fileMethod, fileIv, readError;
+        if (loadKeyParams(options, fileKey, fileKid, fileMethod, fileIv, readError))
+        {
+            key = fileKey;
+            if (!fileIv.empty())
+            {
+                iv = fileIv;
+            }
+        }
+    }
+
+    AesEngine::Options engineOptions;
+    size_t             keyBytes = 0;
+    AesEngine::parseMethod(method, engineOptions.mode, keyBytes);
+
+    std::vector<uint8_t> ivBytes;
+    if (!AesEngine::fromHex(cleanHexString(key), engineOptions.key) || engineOptions.key.size() != keyBytes)
+    {
+        errorMsg = method + " 需要 " + std::to_string(keyBytes * 2) + " 个十六进制字符的密钥";
+        return false;
+    }
+    if (!AesEngine::fromHex(cleanHexString(iv), ivBytes) || ivBytes.size() != engineOptions.iv.size())
+    {
+        errorMsg = method + " 需要 32 个十六进制字符的IV";
+        return false;
+    }
+    std::ranges::copy(ivBytes, engineOptions.iv.begin());
+
+    if (params.contains("--threads"))
+    {
+        engineOptions.threads = params.at("--threads").asInt();
+    }
+
+    auto progress = [](uint64_t processed, uint64_t total)
+    {
+        double percent = total ? 100.0 * processed / total : 100.0;
+        std::cout << "\r解密进度: " << std::fixed << std::setprecision(1) << percent << "%" << std::flush;
+    };
+
+    AesEngine         engine;
+    AesEngine::Result result;
+    bool ok = engine.decryptFile(options.input, options.output, engineOptions, result, errorMsg, progress);
+    std::cout << std::endl;
+    if (!ok)
+    {
+        return false;
+    }
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "解密完成: " << options.output << "\n";
+    ss << "方法: " << method << "，实现: " << (result.hardware ? "AES-NI" : "软件查表") << "，线程: " << result.threads
+       << "\n";
+    ss << "数据量: " << result.inputBytes / 1048576.0 << " MB，用时 " << result.seconds << " 秒，吞吐 "
+       << (result.seconds > 0 ? result.inputBytes / 1048576.0 / result.seconds : 0.0) << " MB/s";
+
+    /// 解密后播放
+    if (options.play_after_decrypt)
+    {
+        std::string command = "\"" + XTool::getFFplayPath() + "\" -autoexit ";
+        if (!options.ffplay_args.empty())
+        {
+            command += options.ffplay_args + " ";
+        }
+        command += "\"" + options.output + "\"";
+
+        auto playResult = XExec::execute(command, true);
+        if (playResult.exitCode != 0)
+        {
+            ss << "\n警告: ffplay退出码 " << playResult.exitCode;
+        }
+        if (options.delete_after_play)
+        {
+            std::error_code ec;
+            fs::remove(options.output, ec);
+            ss << "\n已删除解密文件: " << options.output;
+        }
+    }
+
+    resultMsg = ss.str();
+    return true;
+}
+
 IMPLEMENT_CREATE(DecryptCommandBuilder);
@@ -120,6 +120,10 @@ auto DecryptProgressBar::updateProgress(XExec &exec, const std::string_view &tas
         /// 创建进度状态
         auto progressState = std::make_shared<AVProgressState>();
         setProgressState(progressState, 0.0, totalDuration, "");
+        setJobProfile(progressState, taskName, inputParams);
+
+        /// --play / --stream 时进程包含交互播放，用户暂停期间没有进度是正常的
+        progressState->interactive = inputParams.contains("--play") && inputParams.at("--play").asBool();
 
         /// 开始进度监控
         startProgressMonitoring(exec, progressState, srcPath, dstPath);
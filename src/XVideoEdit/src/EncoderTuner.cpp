@@ -0,0 +1,537 @@
+﻿#include "EncoderTuner.h"
+#include "MediaProbeCache.h"
+#include "XExec.h"
+#include "XTool.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+namespace
+{
+    constexpr auto TUNE_FILE_NAME = ".encoder_tune.json";
+
+    auto trialKey(const std::string &preset, int crf) -> std::string
+    {
+        return preset + ":" + std::to_string(crf);
+    }
+} // namespace
+
+class EncoderTuner::PImpl
+{
+public:
+    PImpl(EncoderTuner *owner);
+    ~PImpl() = default;
+
+public:
+    auto filePath() const -> fs::path;
+
+    auto ensureLoaded() -> void;
+
+    auto save() const -> void;
+
+    /// 源画面特征 + 目标编码参数，决定测量值能否复用
+    static auto profileKey(const MediaStreamInfo &video, const Options &options) -> std::string;
+
+    /// 并行编码所有窗口，返回整批吞吐（窗口媒体时长之和 / 整批墙钟时间）与平均码率
+    static auto measure(const std::string &input, const std::vector<double> &starts, double windowSeconds,
+                        const Options &options, const std::string &preset, int crf, Trial &trial,
+                        std::string &errorMsg) -> bool;
+
+public:
+    EncoderTuner                             *owner_ = nullptr;
+    mutable std::mutex                        mutex_;
+    fs::path                                  storageDir_;
+    json                                      cache_  = json::object();
+    bool                                      loaded_ = false;
+    std::unordered_map<std::string, Decision> lastDecisions_;
+};
+
+EncoderTuner::PImpl::PImpl(EncoderTuner *owner) : owner_(owner)
+{
+}
+
+auto EncoderTuner::PImpl::filePath() const -> fs::path
+{
+    return storageDir_ / TUNE_FILE_NAME;
+}
+
+auto EncoderTuner::PImpl::ensureLoaded() -> void
+{
+    if (loaded_)
+    {
+        return;
+    }
+    loaded_ = true;
+
+    std::ifstream file(filePath());
+    if (!file.is_open())
+    {
+        return;
+    }
+    try
+    {
+        cache_ = json::parse(file);
+        if (!cache_.is_object())
+        {
+            cache_ = json::object();
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "警告: 调参缓存文件损坏，已忽略: " << e.what() << std::endl;
+        cache_ = json::object();
+    }
+}
+
+auto EncoderTuner::PImpl::save() const -> void
+{
+    std::error_code ec;
+    if (!storageDir_.empty() && !fs::exists(storageDir_, ec))
+    {
+        fs::create_directories(storageDir_, ec);
+    }
+
+    /// 先写临时文件再改名，中途退出不会留下半个 JSON
+    fs::path tmpPath = filePath();
+    tmpPath += ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        if (!file.is_open())
+        {
+            return;
+        }
+        file << cache_.dump(2);
+        if (!file)
+        {
+            return;
+        }
+    }
+    fs::rename(tmpPath, filePath(), ec);
+}
+
+auto EncoderTuner::PImpl::profileKey(const MediaStreamInfo &video, const Options &options) -> std::string
+{
+    std::ostringstream key;
+    key << video.codecName << "|" << video.width << "x" << video.height << "|" << std::fixed << std::setprecision(2)
+        << video.fps << "|" << options.videoCodec << "|" << options.videoFilter << "|" << std::setprecision(1)
+        << options.windowSeconds << "s|" << std::thread::hardware_concurrency() << "cpu|batch";
+    return key.str();
+}
+
+auto EncoderTuner::PImpl::measure(const std::string &input, const std::vector<double> &starts, double windowSeconds,
+                                  const Options &options, const std::string &preset, int crf, Trial &trial,
+                                  std::string &errorMsg) -> bool
+{
+    struct WindowResult
+    {
+        double      seconds  = 0.0;
+        uintmax_t   bytes    = 0;
+        int         exitCode = -1;
+        std::string error;
+    };
+
+    /// 多个任务可能同时调参，临时文件名带上全局序号
+    static std::atomic<uint64_t> sequence{ 0 };
+    const auto                   tempDir = fs::temp_directory_path();
+    const auto                   batch   = std::to_string(sequence.fetch_add(1));
+
+    std::vector<WindowResult> results(starts.size());
+    std::vector<std::thread>  workers;
+    workers.reserve(starts.size());
+
+    /// 各窗口同时争用全部核心，单个窗口的 时长/耗时 约为单任务速度的 1/窗口数，
+    /// 因此按整批计：从第一个启动到最后一个结束
+    const auto batchBegin = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < starts.size(); ++i)
+    {
+        workers.emplace_back(
+                [&, i]()
+                {
+                    /// 只编码视频：音频与封装开销和预设无关
+                    const auto output = tempDir / ("xve_tune_" + batch + "_" + std::to_string(i) + ".mkv");
+
+                    std::ostringstream cmd;
+                    cmd << "\"" << XTool::getFFmpegPath() << "\" -hide_banner -nostats -loglevel error -y "
+                        << "-ss " << std::fixed << std::setprecision(3) << starts[i] << " -t " << windowSeconds
+                        << " -i \"" << input << "\" -map 0:v:0 -an -sn -c:v " << options.videoCodec
+                        << " -preset " << preset << " -crf " << crf << " ";
+                    if (!options.videoFilter.empty())
+                    {
+                        cmd << "-vf \"" << options.videoFilter << "\" ";
+                    }
+                    cmd << "-f matroska \"" << output.string() << "\"";
+
+                    const auto begin  = std::chrono::steady_clock::now();
+                    auto       result = XExec::execute(cmd.str(), true);
+                    auto      &window = results[i];
+                    const auto end    = std::chrono::steady_clock::now();
+                    window.seconds    = std::chrono::duration<double>(end - begin).count();
+                    window.exitCode   = result.exitCode;
+                    window.error      = result.stdoutOutput;
+
+                    std::error_code ec;
+                    window.bytes = fs::file_size(output, ec);
+                    fs::remove(output, ec);
+                });
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    const double batchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batchBegin).count();
+
+    uintmax_t totalBytes = 0;
+    for (const auto &window : results)
+    {
+        if (window.exitCode != 0 || window.seconds <= 0)
+        {
+            errorMsg = "试编码失败（预设 " + preset + "）: " + window.error;
+            return false;
+        }
+        totalBytes += window.bytes;
+    }
+
+    trial.preset      = preset;
+    trial.crf         = crf;
+    trial.speed       = batchSeconds > 0 ? windowSeconds * results.size() / batchSeconds : 0.0;
+    trial.bitrateKbps = static_cast<double>(totalBytes) * 8.0 / 1000.0 / (windowSeconds * results.size());
+    trial.cached      = false;
+    return true;
+}
+
+EncoderTuner::EncoderTuner() : impl_(std::make_unique<PImpl>(this))
+{
+}
+
+EncoderTuner::~EncoderTuner() = default;
+
+auto EncoderTuner::setStorageDirectory(const fs::path &dir) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->storageDir_ = dir;
+    impl_->loaded_     = false;
+    impl_->cache_      = json::object();
+}
+
+auto EncoderTuner::storageDirectory() const -> fs::path
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->storageDir_;
+}
+
+auto EncoderTuner::tune(const std::string &input, const Options &options, Decision &decision, std::string &errorMsg)
+        -> bool
+{
+    MediaProbeInfo info;
+    if (!MediaProbeCache::getInstance()->probe(input, info, errorMsg))
+    {
+        return false;
+    }
+    const auto *video = info.videoStream();
+    if (!video)
+    {
+        errorMsg = "输入文件没有视频流: " + input;
+        return false;
+    }
+    if (options.presets.empty() || options.crfs.empty())
+    {
+        errorMsg = "没有可选的预设或CRF";
+        return false;
+    }
+
+    /// 取样区间与窗口：均匀分布在区间内，区间太短时减少窗口
+    const double rangeStart  = std::clamp(options.rangeStart, 0.0, std::max(0.0, info.duration));
+    double       rangeLength = options.rangeDuration > 0 ? options.rangeDuration : info.duration - rangeStart;
+    rangeLength              = std::min(rangeLength, info.duration - rangeStart);
+    if (rangeLength <= 0)
+    {
+        errorMsg = "无法确定取样区间（时长未知）";
+        return false;
+    }
+
+    const double        windowSeconds = std::min(options.windowSeconds, rangeLength);
+    const int           maxWindows    = std::max(1, options.windows);
+    const int           windowCount   = std::clamp(static_cast<int>(rangeLength / windowSeconds), 1, maxWindows);
+    std::vector<double> starts;
+    for (int i = 0; i < windowCount; ++i)
+    {
+        const double center = rangeStart + rangeLength * (i + 0.5) / windowCount;
+        starts.push_back(std::clamp(center - windowSeconds / 2, rangeStart, rangeStart + rangeLength - windowSeconds));
+    }
+
+    decision               = Decision{};
+    decision.requiredSpeed = std::max(0.0, options.targetSpeed);
+    if (options.deadlineSeconds > 0)
+    {
+        decision.requiredSpeed = std::max(decision.requiredSpeed, rangeLength / options.deadlineSeconds);
+    }
+
+    std::vector<int> crfs = options.crfs;
+    std::ranges::sort(crfs);
+
+    std::unique_lock<std::mutex> lock(impl_->mutex_);
+    impl_->ensureLoaded();
+    const auto key   = PImpl::profileKey(*video, options);
+    bool       dirty = false;
+
+    /// 预设由快到慢：某个预设的所有 CRF 都不达标时，更慢的预设也不会达标，停止测量
+    int chosen = -1;
+    for (const auto &preset : options.presets)
+    {
+        int passed = -1;
+        for (int crf : crfs)
+        {
+            Trial       trial;
+            const auto &entries = impl_->cache_[key];
+            if (auto it = entries.find(trialKey(preset, crf)); it != entries.end())
+            {
+                trial.preset      = preset;
+                trial.crf         = crf;
+                trial.speed       = it->value("speed", 0.0);
+                trial.bitrateKbps = it->value("kbps", 0.0);
+                trial.cached      = true;
+            }
+            else
+            {
+                /// 试编码期间不持有锁，其他任务仍可查询
+                lock.unlock();
+                std::cout << "[自动调参] 试编码 预设=" << preset << " crf=" << crf << " 窗口=" << starts.size()
+                          << "×" << windowSeconds << "秒" << std::endl;
+                const bool ok = PImpl::measure(input, starts, windowSeconds, options, preset, crf, trial, errorMsg);
+                lock.lock();
+                if (!ok)
+                {
+                    return false;
+                }
+                auto &entry = impl_->cache_[key][trialKey(preset, crf)];
+                entry       = { { "speed", trial.speed }, { "kbps", trial.bitrateKbps } };
+                dirty       = true;
+            }
+
+            decision.trials.push_back(trial);
+            if (trial.speed >= decision.requiredSpeed)
+            {
+                passed = static_cast<int>(decision.trials.size()) - 1;
+                break; /// CRF 由低到高，第一个达标的画质最好
+            }
+        }
+
+        if (passed < 0)
+        {
+            break;
+        }
+        chosen = passed;
+    }
+
+    decision.metTarget = chosen >= 0;
+    const auto   fastest = std::ranges::max_element(decision.trials, {}, &Trial::speed);
+    const Trial &result  = decision.metTarget ? decision.trials[chosen] : *fastest;
+    decision.preset      = result.preset;
+    decision.crf         = result.crf;
+    decision.speed       = result.speed;
+    decision.bitrateKbps = result.bitrateKbps;
+
+    impl_->lastDecisions_[input] = decision;
+    if (dirty)
+    {
+        impl_->save();
+    }
+    return true;
+}
+
+auto EncoderTuner::lastDecision(const std::string &input, Decision &decision) const -> bool
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    auto                        it = impl_->lastDecisions_.find(input);
+    if (it == impl_->lastDecisions_.end())
+    {
+        return false;
+    }
+    decision = it->second;
+    return true;
+}
+
+auto EncoderTuner::clear() -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->cache_  = json::object();
+    impl_->loaded_ = true;
+    impl_->lastDecisions_.clear();
+
+    std::error_code ec;
+    fs::remove(impl_->filePath(), ec);
+}
+
+auto EncoderTuner::parseDeadline(const std::string &text, double &seconds) -> bool
+{
+    if (text.empty())
+    {
+        return false;
+    }
+
+    /// HH:MM:SS
+    if (text.find(':') != std::string::npos)
+    {
+        double total = 0.0;
+        for (const auto &part : XTool::split(text, ':'))
+        {
+            double value = 0.0;
+            auto [ptr, ec] = std::from_chars(part.data(), part.data() + part.size(), value);
+            if (ec != std::errc() || ptr != part.data() + part.size())
+            {
+                return false;
+            }
+            total = total * 60.0 + value;
+        }
+        seconds = total;
+        return seconds > 0;
+    }
+
+    double      value  = 0.0;
+    const char *end    = text.data() + text.size();
+    auto [ptr, ec]     = std::from_chars(text.data(), end, value);
+    if (ec != std::errc())
+    {
+        return false;
+    }
+    const std::string_view unit(ptr, static_cast<size_t>(end - ptr));
+    if (unit.empty() || unit == "s")
+    {
+        seconds = value;
+    }
+    else if (unit == "m")
+    {
+        seconds = value * 60.0;
+    }
+    else if (unit == "h")
+    {
+        seconds = value * 3600.0;
+    }
+    else
+    {
+        return false;
+    }
+    return seconds > 0;
+}
+
+auto EncoderTuner::formatDecision(const Decision &decision) -> std::string
+{
+    std::stringstream ss;
+    ss << "[自动调参] 目标速度 ≥ " << std::fixed << std::setprecision(2) << decision.requiredSpeed << "x\n";
+    ss << std::left << std::setw(12) << "  preset" << std::right << std::setw(6) << "crf" << std::setw(10) << "speed"
+       << std::setw(12) << "kbps" << "\n";
+    for (const auto &trial : decision.trials)
+    {
+        const bool picked = trial.preset == decision.preset && trial.crf == decision.crf;
+        ss << (picked ? "* " : "  ") << std::left << std::setw(10) << trial.preset << std::right << std::setw(6)
+           << trial.crf << std::setw(9) << std::setprecision(2) << trial.speed << "x" << std::setw(12)
+           << std::setprecision(0) << trial.bitrateKbps << (trial.cached ? "  (缓存)" : "") << "\n";
+    }
+    ss << "  选用: -preset " << decision.preset << " -crf " << decision.crf;
+    if (!decision.metTarget)
+    {
+        ss << "（没有组合达到目标，使用最快的组合）";
+    }
+    ss << "\n";
+    return ss.str();
+}
+
+auto EncoderTuner::validateParams(const std::map<std::string, ParameterValue> &params, std::string &errorMsg) -> bool
+{
+    if (auto it = params.find("--target-speed"); it != params.end())
+    {
+        double speed = 0.0;
+        try
+        {
+            speed = it->second.asDouble();
+        }
+        catch (const std::exception &)
+        {
+        }
+        if (speed <= 0)
+        {
+            errorMsg = "无效的目标速度(--target-speed): " + it->second.asString();
+            return false;
+        }
+    }
+
+    if (auto it = params.find("--deadline"); it != params.end())
+    {
+        double seconds = 0.0;
+        if (!parseDeadline(it->second.asString(), seconds))
+        {
+            errorMsg = "无效的完成期限(--deadline，如 5400、90m、1.5h、01:30:00): " + it->second.asString();
+            return false;
+        }
+    }
+    return true;
+}
+
+auto EncoderTuner::resolveParams(const std::map<std::string, ParameterValue> &params, Options options,
+                                 std::string &preset, std::string &crf, const std::string &fallbackPreset,
+                                 const std::string &fallbackCrf) -> void
+{
+    const bool autoPreset = preset == "auto";
+    const bool autoCrf    = crf == "auto";
+    if (!autoPreset && !autoCrf)
+    {
+        return;
+    }
+
+    /// 固定的一方只测它自己
+    if (!autoPreset)
+    {
+        options.presets = { preset.empty() ? fallbackPreset : preset };
+    }
+    if (autoCrf)
+    {
+        options.crfs = { 20, 23, 26 };
+    }
+    else
+    {
+        options.crfs = { std::stoi(crf.empty() ? fallbackCrf : crf) };
+    }
+
+    if (auto it = params.find("--target-speed"); it != params.end())
+    {
+        options.targetSpeed = it->second.asDouble();
+    }
+    if (auto it = params.find("--deadline"); it != params.end())
+    {
+        parseDeadline(it->second.asString(), options.deadlineSeconds);
+        if (!params.contains("--target-speed"))
+        {
+            options.targetSpeed = 0.0; /// 只给期限时以期限为准
+        }
+    }
+
+    Decision    decision;
+    std::string errorMsg;
+    if (!getInstance()->tune(params.at("--input").asString(), options, decision, errorMsg))
+    {
+        std::cout << "警告: 自动调参失败（" << errorMsg << "），使用 -preset " << fallbackPreset << " -crf "
+                  << fallbackCrf << std::endl;
+        preset = autoPreset ? fallbackPreset : preset;
+        crf    = autoCrf ? fallbackCrf : crf;
+        return;
+    }
+
+    std::cout << formatDecision(decision);
+    preset = decision.preset;
+    crf    = std::to_string(decision.crf);
+}
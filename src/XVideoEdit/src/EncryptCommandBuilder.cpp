@@ -1,5 +1,8 @@
 ﻿#include "EncryptCommandBuilder.h"
 #include "XTool.h"
+#include "XExec.h"
+#include "AesEngine.h"
+#include "KeyStore.h"
 #include <sstream>
 #include <iostream>
 #include <algorithm>
@@ -15,8 +18,10 @@
 const std::vector<std::string> EncryptCommandBuilder::SUPPORTED_CIPHERS = {
     "cenc-aes-ctr", /// MP4 Common Encryption AES-CTR (你的FFmpeg支持这个)
     "cenc-aes-cbc", /// MP4 Common Encryption AES-CBC
-    "aes-128-cbc",  /// 用于OpenSSL加密（如果可用）
-    "aes-256-cbc"   /// 用于OpenSSL加密（如果可用）
+    "aes-128-cbc",  /// 进程内AES引擎整文件加密（与OpenSSL兼容）
+    "aes-256-cbc",  /// 进程内AES引擎整文件加密（与OpenSSL兼容）
+    "aes-128-ctr",  /// 进程内AES引擎，多线程
+    "aes-256-ctr"   /// 进程内AES引擎，多线程
 };
 
 auto EncryptCommandBuilder::cleanHexString(const std::string& str) const -> std::string
@@ -87,7 +92,7 @@ auto EncryptCommandBuilder::generateKeyFileName(const std::string& outputFile) c
 }
 
 auto EncryptCommandBuilder::saveKeyToFile(const std::string& key, const std::string& kid, const std::string& method,
-                                          const std::string& keyfile) const -> bool
+                                          const std::string& keyfile, const std::string& iv) const -> bool
 {
     try
     {
@@ -110,11 +115,19 @@ auto EncryptCommandBuilder::saveKeyToFile(const std::string& key, const std::str
         keyFile << "=== 解密所需参数 ===" << std::endl;
         keyFile << "解密密钥 (--key): " << key << std::endl;
         keyFile << "Key ID (--kid): " << kid << std::endl;
+        if (!iv.empty())
+        {
+            keyFile << "初始化向量 (--iv): " << iv << std::endl;
+        }
         keyFile << std::endl;
         keyFile << "=== 解密命令示例 ===" << std::endl;
         keyFile << "task decrypt --input encrypted_video.mp4 --output decrypted.mp4 \\" << std::endl;
         keyFile << "  --key " << key << " \\" << std::endl;
         keyFile << "  --kid " << kid << " \\" << std::endl;
+        if (!iv.empty())
+        {
+            keyFile << "  --iv " << iv << " \\" << std::endl;
+        }
         keyFile << "  --method " << method << std::endl;
         keyFile << std::endl;
         keyFile << "=== 重要提醒 ===" << std::endl;
@@ -133,6 +146,32 @@ auto EncryptCommandBuilder::saveKeyToFile(const std::string& key, const std::str
     }
 }
 
+auto EncryptCommandBuilder::saveKeyToStore(const EncryptOptions& options, const std::string& assetId,
+                                           const std::string& key, const std::string& kid, const std::string& iv) const
+        -> bool
+{
+    std::string errorMsg;
+    auto        store = KeyStore::shared(options.keystore, errorMsg);
+
+    KeyStore::Entry entry;
+    entry.assetId = assetId;
+    entry.kid     = kid;
+    entry.method  = options.method;
+    entry.iv      = iv;
+    entry.derived = options.derive_key;
+    if (!options.derive_key)
+    {
+        entry.key = key;
+    }
+
+    if (!store || !store->put(entry, errorMsg))
+    {
+        std::cerr << "警告: 保存密钥到密钥库失败: " << errorMsg << std::endl;
+        return false;
+    }
+    return true;
+}
+
 auto EncryptCommandBuilder::parseOptions(const std::map<std::string, ParameterValue>& params) const
         -> EncryptCommandBuilder::EncryptOptions
 {
@@ -171,6 +210,23 @@ auto EncryptCommandBuilder::parseOptions(const std::map<std::string, ParameterVa
         options.keyfile = params.at("--keyfile").asString();
     }
 
+    /// 密钥库与主密钥派生
+    if (params.contains("--keystore"))
+    {
+        options.keystore = params.at("--keystore").asString();
+    }
+
+    if (params.contains("--master-key"))
+    {
+        options.derive_key = true;
+        options.master_key = params.at("--master-key").asString();
+    }
+
+    if (params.contains("--asset-id"))
+    {
+        options.asset_id = params.at("--asset-id").asString();
+    }
+
     /// 加密方法 - 默认为FFmpeg支持的cenc-aes-ctr
     options.method = "cenc-aes-ctr";
     if (params.contains("--method"))
@@ -178,7 +234,13 @@ auto EncryptCommandBuilder::parseOptions(const std::map<std::string, ParameterVa
         std::string requestedMethod = params.at("--method").asString();
 
         /// 将用户请求的方法映射到FFmpeg支持的方法
-        if (requestedMethod.find("AES-128") != std::string::npos)
+        if (AesEngine::isNativeMethod(requestedMethod))
+        {
+            /// aes-128-cbc / aes-256-ctr 等由进程内引擎处理
+            options.method = requestedMethod;
+            std::ranges::transform(options.method, options.method.begin(), ::tolower);
+        }
+        else if (requestedMethod.find("AES-128") != std::string::npos)
         {
             options.method = "cenc-aes-ctr";
         }
@@ -226,16 +288,15 @@ auto EncryptCommandBuilder::parseOptions(const std::map<std::string, ParameterVa
 auto EncryptCommandBuilder::generateRandomKey(size_t length) const -> std::string
 {
     static const char               hex_chars[] = "0123456789abcdef";
-    std::random_device              rd;
-    std::mt19937                    gen(rd());
-    std::uniform_int_distribution<> dis(0, 15);
+    std::random_device              rd; /// 密钥材料直接取自系统随机源，不经过 mt19937
+    std::uniform_int_distribution<> dis(0, 255);
 
     std::string key;
     key.reserve(length * 2); /// hex字符串长度是字节数的2倍
 
     for (size_t i = 0; i < length; ++i)
     {
-        uint8_t byte = static_cast<uint8_t>(dis(gen));
+        uint8_t byte = static_cast<uint8_t>(dis(rd));
         key.push_back(hex_chars[byte >> 4]);
         key.push_back(hex_chars[byte & 0x0F]);
     }
@@ -280,7 +341,26 @@ auto EncryptCommandBuilder::validate(const std::map<std::string, ParameterValue>
         /// 允许用户请求的方法，但我们会映射到FFmpeg支持的方法
         std::string mappedCipher = "cenc-aes-ctr"; /// 默认映射
 
-        if (cipher.find("AES") != std::string::npos)
+        AesEngine::Mode mode;
+        size_t          keyBytes = 0;
+        if (AesEngine::parseMethod(cipher, mode, keyBytes))
+        {
+            mappedCipher = cipher;
+            std::ranges::transform(mappedCipher, mappedCipher.begin(), ::tolower);
+
+            /// 原生引擎要求密钥长度与方法严格一致
+            if (params.contains("--key") && cleanHexString(params.at("--key").asString()).length() != keyBytes * 2)
+            {
+                errorMsg = mappedCipher + " 需要 " + std::to_string(keyBytes * 2) + " 个十六进制字符的密钥";
+                return false;
+            }
+            if (params.contains("--iv") && cleanHexString(params.at("--iv").asString()).length() != 32)
+            {
+                errorMsg = mappedCipher + " 需要 32 个十六进制字符的IV";
+                return false;
+            }
+        }
+        else if (cipher.find("AES") != std::string::npos)
         {
             mappedCipher = "cenc-aes-ctr";
         }
@@ -359,6 +439,41 @@ auto EncryptCommandBuilder::validate(const std::map<std::string, ParameterValue>
         }
     }
 
+    /// 主密钥派生时密钥由资源ID决定，IV 每次随机生成，都不能再手动指定
+    if (params.contains("--master-key"))
+    {
+        if (params.contains("--key") || params.contains("--iv"))
+        {
+            errorMsg = "--master-key 与 --key / --iv 不能同时使用";
+            return false;
+        }
+
+        /// 原生方法的随机IV只能从密钥库取回，CENC 的IV则由 ffmpeg 写在每个样本中
+        if (isInProcess(params) && !params.contains("--keystore"))
+        {
+            errorMsg = "原生AES方法使用 --master-key 时需要 --keystore 保存随机IV";
+            return false;
+        }
+
+        std::vector<uint8_t> masterKey;
+        if (!KeyStore::loadMasterKey(params.at("--master-key").asString(), masterKey, errorMsg))
+        {
+            return false;
+        }
+    }
+
+    /// 验证密钥库路径（如果提供）
+    if (params.contains("--keystore"))
+    {
+        std::error_code ec;
+        auto            parentPath = fs::path(params.at("--keystore").asString()).parent_path();
+        if (!parentPath.empty() && !fs::is_directory(parentPath, ec))
+        {
+            errorMsg = "密钥库目录不存在: " + parentPath.string();
+            return false;
+        }
+    }
+
     /// 注意：你的FFmpeg不支持HMAC，所以这里忽略HMAC验证
     /// 但保留参数以保持API兼容性
 
@@ -427,6 +542,46 @@ auto EncryptCommandBuilder::build(const std::map<std::string, ParameterValue>& p
         }
     }
 
+    /// 确保输出为MP4格式（CENC加密只支持MP4）
+    std::string outputFile = options.output;
+    std::string ext        = std::filesystem::path(outputFile).extension().string();
+    std::ranges::transform(ext, ext.begin(), ::tolower);
+
+    if (ext != ".mp4" && ext != ".m4v" && ext != ".mov")
+    {
+        size_t dotPos = outputFile.find_last_of('.');
+        if (dotPos != std::string::npos)
+        {
+            outputFile = outputFile.substr(0, dotPos) + "_encrypted.mp4";
+        }
+        else
+        {
+            outputFile += "_encrypted.mp4";
+        }
+    }
+
+    /// 主密钥派生：密钥与KID由资源ID决定，批量加密时无需逐个保存密钥；
+    /// 不传 IV，由 ffmpeg 为每次加密随机生成并写入样本加密信息
+    std::string assetId = options.asset_id.empty() ? KeyStore::assetIdFor(outputFile) : options.asset_id;
+    if (options.derive_key)
+    {
+        std::vector<uint8_t> masterKey;
+        std::string          errorMsg, derivedKid;
+        if (KeyStore::loadMasterKey(options.master_key, masterKey, errorMsg))
+        {
+            KeyStore::derive(masterKey, assetId, 16, key, derivedKid);
+            if (options.kid.empty())
+            {
+                kid = derivedKid;
+            }
+        }
+    }
+
+    if (!options.keystore.empty() && saveKeyToStore(options, assetId, key, kid, iv))
+    {
+        std::cout << "密钥已写入密钥库: " << options.keystore << " (资源ID: " << assetId << ")" << std::endl;
+    }
+
     /// 处理密钥文件保存
     std::string keyfile = options.keyfile;
     if (!keyfile.empty())
@@ -437,7 +592,7 @@ auto EncryptCommandBuilder::build(const std::map<std::string, ParameterValue>& p
             std::cout << "密钥已保存到: " << keyfile << std::endl;
         }
     }
-    else
+    else if (options.keystore.empty() && !options.derive_key)
     {
         /// 如果没有指定密钥文件，询问用户是否要保存
         std::cout << "警告: 未指定密钥文件，强烈建议保存密钥以便后续解密！" << std::endl;
@@ -447,29 +602,11 @@ auto EncryptCommandBuilder::build(const std::map<std::string, ParameterValue>& p
         std::cout << "请妥善保管以上信息，否则将无法解密视频！" << std::endl;
     }
 
-    /// 确保输出为MP4格式（CENC加密只支持MP4）
-    std::string outputFile = options.output;
-    std::string ext        = std::filesystem::path(outputFile).extension().string();
-    std::ranges::transform(ext, ext.begin(), ::tolower);
-
-    if (ext != ".mp4" && ext != ".m4v" && ext != ".mov")
-    {
-        size_t dotPos = outputFile.find_last_of('.');
-        if (dotPos != std::string::npos)
-        {
-            outputFile = outputFile.substr(0, dotPos) + "_encrypted.mp4";
-        }
-        else
-        {
-            outputFile += "_encrypted.mp4";
-        }
-    }
-
     std::stringstream cmd;
     cmd << "\"" << XTool::getFFmpegPath() << "\" ";
 
     /// 基本参数
-    cmd << "-hide_banner -progress pipe:1 -nostats -loglevel info ";
+    cmd << "-hide_banner -progress " << XExec::progressTarget() << " -nostats -loglevel info ";
     cmd << "-y "; /// 覆盖输出文件
 
     /// 输入文件
@@ -529,7 +666,11 @@ auto EncryptCommandBuilder::getTitle(const std::map<std::string, ParameterValue>
 
     std::string method = "MP4 CENC-AES-CTR"; /// 显示实际使用的方法
 
-    if (params.contains("--method"))
+    if (isInProcess(params))
+    {
+        method = "原生AES " + parseOptions(params).method;
+    }
+    else if (params.contains("--method"))
     {
         std::string userMethod = params.at("--method").asString();
         method                 = "MP4 CENC (" + userMethod + ")";
@@ -539,7 +680,15 @@ auto EncryptCommandBuilder::getTitle(const std::map<std::string, ParameterValue>
             "加密: " + inputPath.filename().string() + " → " + outputPath.filename().string() + " (" + method + ")";
 
     /// 如果指定了密钥文件，在标题中添加提示
-    if (params.contains("--keyfile"))
+    if (params.contains("--master-key"))
+    {
+        title += " [主密钥派生]";
+    }
+    else if (params.contains("--keystore"))
+    {
+        title += " [密钥保存到密钥库]";
+    }
+    else if (params.contains("--keyfile"))
     {
         title += " [密钥保存到文件]";
     }
@@ -555,4 +704,99 @@ auto EncryptCommandBuilder::getTitle(const std::map<std::string, ParameterValue>
     return title;
 }
 
+auto EncryptCommandBuilder::isInProcess(const std::map<std::string, ParameterValue>& params) const -> bool
+{
+    return params.contains("--method") && AesEngine::isNativeMethod(params.at("--method").asString());
+}
+
+auto EncryptCommandBuilder::run(const std::map<std::string, ParameterValue>& params, std::string& resultMsg,
+                                std::string& errorMsg) const -> bool
+{
+    EncryptOptions options = parseOptions(params);
+
+    AesEngine::Options engineOptions;
+    size_t             keyBytes = 0;
+    AesEngine::parseMethod(options.method, engineOptions.mode, keyBytes);
+
+    /// 未指定密钥/IV 时按方法要求的长度随机生成；主密钥派生同样使用随机IV，
+    /// 同一资源重复加密不会复用 CTR 密钥流，IV 随记录写入密钥库
+    std::string key = params.contains("--key") ? cleanHexString(options.key) : generateRandomKey(keyBytes);
+    std::string iv  = options.iv.empty() ? generateRandomKey(16) : cleanHexString(options.iv);
+    std::string kid = options.kid.empty() ? key.substr(0, 32) : cleanHexString(options.kid);
+
+    std::string assetId = options.asset_id.empty() ? KeyStore::assetIdFor(options.output) : options.asset_id;
+    if (options.derive_key)
+    {
+        std::vector<uint8_t> masterKey;
+        std::string          derivedKid;
+        if (!KeyStore::loadMasterKey(options.master_key, masterKey, errorMsg))
+        {
+            return false;
+        }
+        KeyStore::derive(masterKey, assetId, keyBytes, key, derivedKid);
+        if (options.kid.empty())
+        {
+            kid = derivedKid;
+        }
+    }
+
+    std::vector<uint8_t> ivBytes;
+    if (!AesEngine::fromHex(key, engineOptions.key) || !AesEngine::fromHex(iv, ivBytes) ||
+        engineOptions.key.size() != keyBytes || ivBytes.size() != engineOptions.iv.size())
+    {
+        errorMsg = "密钥或IV格式无效";
+        return false;
+    }
+    std::ranges::copy(ivBytes, engineOptions.iv.begin());
+
+    if (params.contains("--threads"))
+    {
+        engineOptions.threads = params.at("--threads").asInt();
+    }
+
+    if (!options.keystore.empty() && saveKeyToStore(options, assetId, key, kid, iv))
+    {
+        std::cout << "密钥已写入密钥库: " << options.keystore << " (资源ID: " << assetId << ")" << std::endl;
+    }
+
+    if (!options.keyfile.empty())
+    {
+        if (saveKeyToFile(key, kid, options.method, options.keyfile, iv))
+        {
+            std::cout << "密钥已保存到: " << options.keyfile << std::endl;
+        }
+    }
+    else if (options.keystore.empty() && !options.derive_key)
+    {
+        std::cout << "警告: 未指定密钥文件，强烈建议保存密钥以便后续解密！" << std::endl;
+        std::cout << "加密密钥: " << key << std::endl;
+        std::cout << "初始化向量: " << iv << std::endl;
+    }
+
+    auto progress = [](uint64_t processed, uint64_t total)
+    {
+        double percent = total ? 100.0 * processed / total : 100.0;
+        std::cout << "\r加密进度: " << std::fixed << std::setprecision(1) << percent << "%" << std::flush;
+    };
+
+    AesEngine         engine;
+    AesEngine::Result result;
+    bool ok = engine.encryptFile(options.input, options.output, engineOptions, result, errorMsg, progress);
+    std::cout << std::endl;
+    if (!ok)
+    {
+        return false;
+    }
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "加密完成: " << options.output << "\n";
+    ss << "方法: " << options.method << "，实现: " << (result.hardware ? "AES-NI" : "软件查表") << "，线程: "
+       << result.threads << "\n";
+    ss << "数据量: " << result.inputBytes / 1048576.0 << " MB，用时 " << result.seconds << " 秒，吞吐 "
+       << (result.seconds > 0 ? result.inputBytes / 1048576.0 / result.seconds : 0.0) << " MB/s";
+    resultMsg = ss.str();
+    return true;
+}
+
 IMPLEMENT_CREATE(EncryptCommandBuilder);
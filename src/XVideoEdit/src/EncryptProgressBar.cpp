@@ -110,6 +110,7 @@ auto EncryptProgressBar::updateProgress(XExec &exec, const std::string_view &tas
         /// 创建进度状态
         auto progressState = std::make_shared<AVProgressState>();
         setProgressState(progressState, 0.0, totalDuration, "");
+        setJobProfile(progressState, taskName, inputParams);
 
         /// 开始进度监控
         startProgressMonitoring(exec, progressState, srcPath, dstPath);
@@ -0,0 +1,230 @@
+﻿#include "FFmpegProgressParser.h"
+
+#include <charconv>
+#include <cstring>
+
+namespace
+{
+    auto trim(std::string_view text) -> std::string_view
+    {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+        {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() &&
+               (text.back() == ' ' || text.back() == '\t' || text.back() == '\r' || text.back() == '\n'))
+        {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+
+    /// 解析整数前缀；N/A 或非数字返回 false
+    auto parseInt(std::string_view text, int64_t &value) -> bool
+    {
+        const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && ptr != text.data();
+    }
+
+    /// 解析浮点前缀，允许带单位后缀（"1.5x"、"1234.5kbits/s"）
+    auto parseDouble(std::string_view text, double &value) -> bool
+    {
+        const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && ptr != text.data();
+    }
+} // namespace
+
+auto FFmpegProgressParser::setCallback(const SnapshotCallback &callback) -> void
+{
+    callback_ = callback;
+}
+
+auto FFmpegProgressParser::feedLine(std::string_view line) -> bool
+{
+    line           = trim(line);
+    const auto pos = line.find('=');
+    if (pos == std::string_view::npos)
+    {
+        return false;
+    }
+
+    const auto key   = trim(line.substr(0, pos));
+    const auto value = trim(line.substr(pos + 1));
+
+    /// 按出现频率排列；ffmpeg 每个块约 12 行
+    if (key == "out_time_us" || key == "out_time_ms")
+    {
+        /// out_time_ms 历史上就是微秒
+        int64_t us = 0;
+        if (parseInt(value, us))
+        {
+            current_.outTimeUs = us;
+        }
+    }
+    else if (key == "out_time")
+    {
+        int64_t us = 0;
+        if (current_.outTimeUs < 0 && parseClock(value, us))
+        {
+            current_.outTimeUs = us;
+        }
+    }
+    else if (key == "frame")
+    {
+        parseInt(value, current_.frame);
+    }
+    else if (key == "fps")
+    {
+        parseDouble(value, current_.fps);
+    }
+    else if (key == "bitrate")
+    {
+        parseDouble(value, current_.bitrateKbps);
+    }
+    else if (key == "total_size")
+    {
+        parseInt(value, current_.totalSize);
+    }
+    else if (key == "dup_frames")
+    {
+        parseInt(value, current_.dupFrames);
+    }
+    else if (key == "drop_frames")
+    {
+        parseInt(value, current_.dropFrames);
+    }
+    else if (key == "speed")
+    {
+        parseDouble(value, current_.speed);
+    }
+    else if (key == "progress")
+    {
+        current_.ended    = (value == "end");
+        current_.sequence = ++sequence_;
+        last_             = current_;
+        current_          = ProgressSnapshot();
+        if (callback_)
+        {
+            callback_(last_);
+        }
+        return true;
+    }
+    return false;
+}
+
+auto FFmpegProgressParser::feed(std::string_view chunk) -> size_t
+{
+    size_t blocks = 0;
+    while (!chunk.empty())
+    {
+        const auto nl = chunk.find('\n');
+        if (nl == std::string_view::npos)
+        {
+            /// 过长的残行不属于 -progress 协议，直接丢弃
+            const size_t room = sizeof(partial_) - partialLen_;
+            if (chunk.size() <= room)
+            {
+                std::memcpy(partial_ + partialLen_, chunk.data(), chunk.size());
+                partialLen_ += chunk.size();
+            }
+            else
+            {
+                partialLen_ = 0;
+            }
+            break;
+        }
+
+        const auto head = chunk.substr(0, nl);
+        chunk.remove_prefix(nl + 1);
+
+        bool done = false;
+        if (partialLen_ > 0)
+        {
+            const size_t room = sizeof(partial_) - partialLen_;
+            if (head.size() <= room)
+            {
+                std::memcpy(partial_ + partialLen_, head.data(), head.size());
+                done = feedLine(std::string_view(partial_, partialLen_ + head.size()));
+            }
+            partialLen_ = 0;
+        }
+        else
+        {
+            done = feedLine(head);
+        }
+        blocks += done ? 1 : 0;
+    }
+    return blocks;
+}
+
+auto FFmpegProgressParser::last() const -> const ProgressSnapshot &
+{
+    return last_;
+}
+
+auto FFmpegProgressParser::reset() -> void
+{
+    current_    = ProgressSnapshot();
+    last_       = ProgressSnapshot();
+    sequence_   = 0;
+    partialLen_ = 0;
+}
+
+auto FFmpegProgressParser::parseClock(std::string_view text, int64_t &microseconds) -> bool
+{
+    text          = trim(text);
+    bool negative = false;
+    if (!text.empty() && text.front() == '-')
+    {
+        negative = true;
+        text.remove_prefix(1);
+    }
+
+    int64_t     parts[3] = { 0, 0, 0 };
+    const char *p        = text.data();
+    const char *end      = text.data() + text.size();
+    for (int i = 0; i < 3; ++i)
+    {
+        const auto [ptr, ec] = std::from_chars(p, end, parts[i]);
+        if (ec != std::errc() || ptr == p)
+        {
+            return false;
+        }
+        p = ptr;
+        if (i < 2)
+        {
+            if (p == end || *p != ':')
+            {
+                return false;
+            }
+            ++p;
+        }
+    }
+
+    /// 小数部分按位数换算成微秒（ffmpeg 输出 6 位，兼容更短的写法）
+    int64_t fraction = 0;
+    if (p != end && *p == '.')
+    {
+        ++p;
+        int digits = 0;
+        for (; p != end && *p >= '0' && *p <= '9'; ++p)
+        {
+            if (digits < 6)
+            {
+                fraction = fraction * 10 + (*p - '0');
+                ++digits;
+            }
+        }
+        for (; digits < 6; ++digits)
+        {
+            fraction *= 10;
+        }
+    }
+
+    microseconds = ((parts[0] * 60 + parts[1]) * 60 + parts[2]) * 1000000 + fraction;
+    if (negative)
+    {
+        microseconds = -microseconds;
+    }
+    return true;
+}
@@ -0,0 +1,514 @@
+﻿#include "FileCopier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+#endif
+
+namespace
+{
+    constexpr int    MAX_DEFAULT_JOBS = 8;       ///< 受磁盘带宽限制，默认并行数不必随核数无限增长
+    constexpr size_t BUFFER_SIZE      = 1 << 20; ///< 用户态回退路径的缓冲大小
+
+    struct CopyJob
+    {
+        fs::path source;
+        fs::path target;
+        uint64_t size = 0;
+    };
+
+    /// 先写 <目标>.part，完成后改名，中断的复制不会留下看似完整的文件
+    auto partPathOf(const fs::path &target) -> fs::path
+    {
+        return fs::path(target.string() + ".part");
+    }
+
+#ifdef _WIN32
+    struct ProgressContext
+    {
+        std::atomic<uint64_t> *copied = nullptr;
+        uint64_t               last   = 0;
+    };
+
+    DWORD CALLBACK copyProgressRoutine(LARGE_INTEGER, LARGE_INTEGER transferred, LARGE_INTEGER, LARGE_INTEGER, DWORD,
+                                       DWORD, HANDLE, HANDLE, LPVOID data)
+    {
+        auto          *context = static_cast<ProgressContext *>(data);
+        const uint64_t now     = static_cast<uint64_t>(transferred.QuadPart);
+        context->copied->fetch_add(now - context->last, std::memory_order_relaxed);
+        context->last = now;
+        return PROGRESS_CONTINUE;
+    }
+
+    auto copyOne(const CopyJob &job, const FileCopier::Options &options, std::atomic<uint64_t> &copied,
+                 FileCopier::Method &method, uint64_t &bytes, std::string &errorMsg) -> bool
+    {
+        const auto part = partPathOf(job.target);
+
+        /// 大文件绕过系统缓存，避免复制 TB 级数据时把缓存挤满
+        DWORD flags = COPY_FILE_FAIL_IF_EXISTS;
+        if (job.size >= (256ull << 20))
+        {
+            flags |= COPY_FILE_NO_BUFFERING;
+        }
+
+        ProgressContext context{ &copied, 0 };
+        ::DeleteFileW(part.wstring().c_str());
+        if (!::CopyFileExW(job.source.wstring().c_str(), part.wstring().c_str(), copyProgressRoutine, &context,
+                           nullptr, flags))
+        {
+            errorMsg = "复制失败: " + job.source.string() + "，错误码: " + std::to_string(::GetLastError());
+            ::DeleteFileW(part.wstring().c_str());
+            return false;
+        }
+
+        /// 不带 MOVEFILE_REPLACE_EXISTING 时目标已存在会失败，规划之后才出现的目标不会被覆盖
+        const DWORD moveFlags = options.overwrite ? MOVEFILE_REPLACE_EXISTING : 0;
+        if (!::MoveFileExW(part.wstring().c_str(), job.target.wstring().c_str(), moveFlags))
+        {
+            errorMsg = "无法重命名为目标文件: " + job.target.string() + "，错误码: " + std::to_string(::GetLastError());
+            ::DeleteFileW(part.wstring().c_str());
+            return false;
+        }
+
+        method = FileCopier::Method::Platform;
+        bytes  = context.last;
+        return true;
+    }
+#else
+    /// 用户态回退：pread/pwrite 按偏移读写，与内核路径共用已完成的字节数
+    auto readWriteChunk(int in, int out, uint64_t offset, size_t length, std::vector<char> &buffer) -> ssize_t
+    {
+        const ssize_t n = ::pread(in, buffer.data(), std::min(length, buffer.size()), static_cast<off_t>(offset));
+        if (n <= 0)
+        {
+            return n;
+        }
+
+        ssize_t written = 0;
+        while (written < n)
+        {
+            const ssize_t w = ::pwrite(out, buffer.data() + written, static_cast<size_t>(n - written),
+                                       static_cast<off_t>(offset + written));
+            if (w < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return -1;
+            }
+            written += w;
+        }
+        return n;
+    }
+
+    /// .part 改名为目标。不覆盖时不能用 rename：规划之后才出现的目标会被静默替换
+    auto publish(const fs::path &part, const fs::path &target, bool overwrite) -> bool
+    {
+        if (overwrite)
+        {
+            return ::rename(part.c_str(), target.c_str()) == 0;
+        }
+#ifdef __linux__
+        if (::renameat2(AT_FDCWD, part.c_str(), AT_FDCWD, target.c_str(), RENAME_NOREPLACE) == 0)
+        {
+            return true;
+        }
+        if (errno != EINVAL && errno != ENOSYS)
+        {
+            return false;
+        }
+#endif
+        /// 文件系统不支持 RENAME_NOREPLACE 时用硬链接：目标已存在则以 EEXIST 失败
+        if (::link(part.c_str(), target.c_str()) != 0)
+        {
+            return false;
+        }
+        ::unlink(part.c_str());
+        return true;
+    }
+
+    auto copyOne(const CopyJob &job, const FileCopier::Options &options, std::atomic<uint64_t> &copied,
+                 FileCopier::Method &method, uint64_t &bytes, std::string &errorMsg) -> bool
+    {
+        const auto part = partPathOf(job.target);
+
+        const int in = ::open(job.source.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0)
+        {
+            errorMsg = "无法打开源文件: " + job.source.string() + " (" + std::strerror(errno) + ")";
+            return false;
+        }
+
+        struct stat st;
+        if (::fstat(in, &st) != 0)
+        {
+            errorMsg = "无法获取文件信息: " + job.source.string() + " (" + std::strerror(errno) + ")";
+            ::close(in);
+            return false;
+        }
+
+        const int out = ::open(part.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, (st.st_mode & 0777) | S_IWUSR);
+        if (out < 0)
+        {
+            errorMsg = "无法创建目标文件: " + part.string() + " (" + std::strerror(errno) + ")";
+            ::close(in);
+            return false;
+        }
+
+        auto fail = [&](const std::string &what) -> bool
+        {
+            errorMsg = what + ": " + job.source.string() + " (" + std::strerror(errno) + ")";
+            ::close(out);
+            ::close(in);
+            ::unlink(part.c_str());
+            return false;
+        };
+
+        const uint64_t size = static_cast<uint64_t>(st.st_size);
+        uint64_t       done = 0;
+        method              = FileCopier::Method::ReadWrite;
+
+#ifdef __linux__
+        /// 1. 同一文件系统（btrfs/XFS/bcachefs...）上直接共享数据块
+        if (options.reflink && size > 0 && ::ioctl(out, FICLONE, in) == 0)
+        {
+            method = FileCopier::Method::Reflink;
+            done   = size;
+            copied.fetch_add(size, std::memory_order_relaxed);
+        }
+        else
+        {
+            /// 2. 预分配：减少碎片，磁盘空间不足时在开始前就失败
+            if (options.preallocate && size > 0 && ::fallocate(out, 0, 0, static_cast<off_t>(size)) != 0 &&
+                errno == ENOSPC)
+            {
+                return fail("磁盘空间不足");
+            }
+            ::posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+            method = FileCopier::Method::CopyFileRange;
+        }
+#endif
+
+        std::vector<char> buffer;
+        while (done < size)
+        {
+            const size_t want = static_cast<size_t>(std::min<uint64_t>(options.chunkSize, size - done));
+            ssize_t      n    = 0;
+
+#ifdef __linux__
+            if (method == FileCopier::Method::CopyFileRange)
+            {
+                loff_t inOffset  = static_cast<loff_t>(done);
+                loff_t outOffset = static_cast<loff_t>(done);
+                n                = ::copy_file_range(in, &inOffset, out, &outOffset, want, 0);
+
+                /// 旧内核不支持跨文件系统（EXDEV）或文件系统不支持时，在第一块就回退
+                if (done == 0 && (n == 0 || (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP ||
+                                                        errno == EINVAL))))
+                {
+                    method = FileCopier::Method::Sendfile;
+                    continue;
+                }
+            }
+            else if (method == FileCopier::Method::Sendfile)
+            {
+                off_t inOffset = static_cast<off_t>(done);
+                n              = ::sendfile(out, in, &inOffset, want);
+                if (done == 0 && (n == 0 || (n < 0 && (errno == EINVAL || errno == ENOSYS))))
+                {
+                    method = FileCopier::Method::ReadWrite;
+                    continue;
+                }
+            }
+            else
+#endif
+            {
+                if (buffer.empty())
+                {
+                    buffer.resize(BUFFER_SIZE);
+                }
+                n = readWriteChunk(in, out, done, want, buffer);
+            }
+
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return fail("复制失败");
+            }
+            if (n == 0)
+            {
+                break; ///< 源文件在复制过程中变短
+            }
+            done += static_cast<uint64_t>(n);
+            copied.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        }
+
+        /// 预分配的长度可能比实际复制的多（源文件变短）
+        if (done != size && ::ftruncate(out, static_cast<off_t>(done)) != 0)
+        {
+            return fail("无法截断目标文件");
+        }
+
+        /// 保留权限与时间戳；NFS 等会把写入错误推迟到 close 时报告
+        ::fchmod(out, st.st_mode & 07777);
+        const struct timespec times[2] = { st.st_atim, st.st_mtim };
+        ::futimens(out, times);
+        if (::close(out) != 0)
+        {
+            errorMsg = "写入目标文件失败: " + part.string() + " (" + std::strerror(errno) + ")";
+            ::close(in);
+            ::unlink(part.c_str());
+            return false;
+        }
+        ::close(in);
+
+        if (!publish(part, job.target, options.overwrite))
+        {
+            errorMsg = errno == EEXIST ? "目标已存在: " + job.target.string() + " (使用 --overwrite 覆盖)"
+                                       : "无法重命名为目标文件: " + job.target.string() + " (" + std::strerror(errno) + ")";
+            ::unlink(part.c_str());
+            return false;
+        }
+        bytes = done;
+        return true;
+    }
+#endif
+
+    /// 目录名：去掉末尾分隔符后的最后一段（"media/" -> "media"）
+    auto leafName(const fs::path &path) -> fs::path
+    {
+        auto normalized = path.lexically_normal();
+        return normalized.has_filename() ? normalized.filename() : normalized.parent_path().filename();
+    }
+
+    /// 按 cp / cp -r 的规则展开出逐个文件的复制任务，并预先创建目录结构
+    auto planJobs(const fs::path &source, fs::path target, const FileCopier::Options &options,
+                  std::vector<CopyJob> &jobs, uint64_t &directories, std::string &errorMsg) -> bool
+    {
+        std::error_code ec;
+        const auto      status = fs::status(source, ec);
+        if (ec || !fs::exists(status))
+        {
+            errorMsg = "源路径不存在: " + source.string();
+            return false;
+        }
+
+        if (fs::is_regular_file(status))
+        {
+            if (fs::is_directory(target, ec))
+            {
+                target /= source.filename();
+            }
+            if (fs::exists(target, ec) && fs::equivalent(source, target, ec))
+            {
+                errorMsg = "源文件与目标相同: " + target.string();
+                return false;
+            }
+            if (!options.overwrite && fs::exists(target, ec))
+            {
+                errorMsg = "目标已存在: " + target.string() + " (使用 --overwrite 覆盖)";
+                return false;
+            }
+            if (target.has_parent_path())
+            {
+                fs::create_directories(target.parent_path(), ec);
+            }
+            jobs.push_back({ source, target, static_cast<uint64_t>(fs::file_size(source, ec)) });
+            return true;
+        }
+
+        if (!fs::is_directory(status))
+        {
+            errorMsg = "不支持的源文件类型: " + source.string();
+            return false;
+        }
+
+        if (fs::is_directory(target, ec))
+        {
+            target /= leafName(source);
+        }
+
+        /// 防止把目录复制到自身内部（无限递归）
+        const auto absSource = fs::weakly_canonical(source, ec);
+        const auto absTarget = fs::weakly_canonical(target, ec);
+        const auto relative  = absTarget.lexically_relative(absSource);
+        if (!relative.empty() && *relative.begin() != "..")
+        {
+            errorMsg = "目标位于源目录内部: " + target.string();
+            return false;
+        }
+
+        if (!fs::create_directories(target, ec) && ec)
+        {
+            errorMsg = "无法创建目录: " + target.string() + " (" + ec.message() + ")";
+            return false;
+        }
+        ++directories;
+
+        auto it = fs::recursive_directory_iterator(source, fs::directory_options::skip_permission_denied, ec);
+        for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+        {
+            const auto      rel = it->path().lexically_relative(source);
+            std::error_code entryEc;
+            if (it->is_directory(entryEc))
+            {
+                fs::create_directories(target / rel, entryEc);
+                ++directories;
+            }
+            else if (it->is_regular_file(entryEc))
+            {
+                jobs.push_back({ it->path(), target / rel, static_cast<uint64_t>(it->file_size(entryEc)) });
+            }
+        }
+        if (ec)
+        {
+            errorMsg = "遍历目录失败: " + source.string() + " (" + ec.message() + ")";
+            return false;
+        }
+        return true;
+    }
+} // namespace
+
+auto FileCopier::copy(const std::string_view &source, const std::string_view &destination, const Options &options,
+                      Result &result, std::string &errorMsg, const ProgressCallback &progress) const -> bool
+{
+    const auto start = std::chrono::steady_clock::now();
+    result           = Result{};
+
+    std::vector<CopyJob> jobs;
+    if (!planJobs(fs::path(source), fs::path(destination), options, jobs, result.directories, errorMsg))
+    {
+        return false;
+    }
+
+    /// 大文件优先：并行时最后剩下的都是小文件，尾部不会只剩一个线程在跑
+    std::ranges::sort(jobs, std::ranges::greater{}, &CopyJob::size);
+
+    uint64_t total = 0;
+    for (const auto &job : jobs)
+    {
+        total += job.size;
+    }
+
+    int jobCount = options.jobs;
+    if (jobCount <= 0)
+    {
+        jobCount = std::min(MAX_DEFAULT_JOBS, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+    }
+    jobCount    = static_cast<int>(std::clamp<size_t>(jobs.size(), 1, static_cast<size_t>(jobCount)));
+    result.jobs = jobCount;
+
+    /// 各线程按原子下标领取文件；结果计数用原子量，错误信息加锁收集
+    std::atomic<size_t>   next{ 0 };
+    std::atomic<size_t>   finished{ 0 };
+    std::atomic<uint64_t> copied{ 0 };
+    std::atomic<uint64_t> copiedBytes{ 0 };
+    std::atomic<uint64_t> succeeded{ 0 };
+    std::atomic<uint64_t> byMethod[METHOD_COUNT]{};
+    std::mutex            errorMutex;
+
+    auto worker = [&]()
+    {
+        for (size_t i = next.fetch_add(1); i < jobs.size(); i = next.fetch_add(1))
+        {
+            Method          method = Method::ReadWrite;
+            std::string     error;
+            std::error_code ec;
+            if (!options.overwrite && fs::exists(jobs[i].target, ec))
+            {
+                error = "目标已存在: " + jobs[i].target.string() + " (使用 --overwrite 覆盖)";
+            }
+            else if (uint64_t bytes = 0; copyOne(jobs[i], options, copied, method, bytes, error))
+            {
+                succeeded.fetch_add(1, std::memory_order_relaxed);
+                copiedBytes.fetch_add(bytes, std::memory_order_relaxed);
+                byMethod[static_cast<int>(method)].fetch_add(1, std::memory_order_relaxed);
+            }
+            if (!error.empty())
+            {
+                std::lock_guard lock(errorMutex);
+                result.errors.push_back(std::move(error));
+            }
+            finished.fetch_add(1, std::memory_order_release);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(jobCount);
+    for (int i = 0; i < jobCount; ++i)
+    {
+        workers.emplace_back(worker);
+    }
+
+    while (finished.load(std::memory_order_acquire) < jobs.size())
+    {
+        if (progress)
+        {
+            progress(copied.load(std::memory_order_relaxed), total);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    for (auto &thread : workers)
+    {
+        thread.join();
+    }
+    if (progress)
+    {
+        progress(copied.load(), total);
+    }
+
+    result.files   = succeeded.load();
+    result.bytes   = copiedBytes.load();
+    result.failed  = result.errors.size();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (size_t i = 0; i < METHOD_COUNT; ++i)
+    {
+        result.byMethod[i] = byMethod[i].load();
+    }
+
+    if (result.failed > 0)
+    {
+        errorMsg = std::to_string(result.failed) + " 个文件复制失败，首个错误: " + result.errors.front();
+        return false;
+    }
+    return true;
+}
+
+auto FileCopier::methodName(Method method) -> const char *
+{
+    switch (method)
+    {
+        case Method::Reflink:
+            return "reflink";
+        case Method::CopyFileRange:
+            return "copy_file_range";
+        case Method::Sendfile:
+            return "sendfile";
+        case Method::ReadWrite:
+            return "read/write";
+        case Method::Platform:
+            return "CopyFileEx";
+    }
+    return "unknown";
+}
@@ -0,0 +1,355 @@
+﻿#include "FolderWatcher.h"
+#include "XConst.h"
+#include "XTool.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <ranges>
+#include <set>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /// 上传工具常用的临时文件：隐藏文件或 .part/.tmp 后缀，改名为正式文件时会再收到 IN_MOVED_TO
+    auto isTemporaryName(const std::string &name) -> bool
+    {
+        return name.empty() || name[0] == '.' || name.ends_with(".part") || name.ends_with(".tmp");
+    }
+
+    auto normalizePath(const std::string &path) -> std::string
+    {
+        std::error_code ec;
+        auto            absolute = fs::absolute(path, ec);
+        return (ec ? fs::path(path) : absolute).lexically_normal().string();
+    }
+} // namespace
+
+class FolderWatcher::PImpl
+{
+public:
+    /// 等待确认的文件
+    struct Pending
+    {
+        std::chrono::steady_clock::time_point deadline;
+        size_t                                directory = 0;
+        uintmax_t                             size      = 0;
+        bool                                  sized     = false; ///< 已记录过一次大小
+    };
+
+    PImpl(FolderWatcher *owner);
+    ~PImpl();
+
+public:
+    auto accepts(const Directory &directory, const std::string &name) const -> bool;
+
+    /// 读出所有排队的 inotify 事件，合并到 pending_
+    auto drainEvents() -> void;
+
+    /// 启动前已在目录中的文件同样加入 pending_，按事件文件的规则确认
+    auto scanExisting() -> void;
+
+    /// 处理到期的文件：大小稳定则回调，否则再等一个 stable 周期
+    auto checkPending(const ReadyCallback &onReady) -> void;
+
+public:
+    FolderWatcher                 *owner_ = nullptr;
+    Options                        options_;
+    int                            inotifyFd_ = -1;
+    int                            stopFd_    = -1;
+    std::map<int, size_t>          watches_; ///< watch 描述符 → 目录下标
+    std::map<std::string, Pending> pending_;
+    std::mutex                     ignoredMutex_;
+    std::set<std::string>          ignored_;
+};
+
+FolderWatcher::PImpl::PImpl(FolderWatcher *owner) : owner_(owner)
+{
+}
+
+FolderWatcher::PImpl::~PImpl()
+{
+#ifdef __linux__
+    if (inotifyFd_ >= 0)
+    {
+        ::close(inotifyFd_);
+    }
+    if (stopFd_ >= 0)
+    {
+        ::close(stopFd_);
+    }
+#endif
+}
+
+auto FolderWatcher::PImpl::accepts(const Directory &directory, const std::string &name) const -> bool
+{
+    if (isTemporaryName(name))
+    {
+        return false;
+    }
+    /// 文件名会代入任务参数并经 /bin/sh -c 执行，含 shell 特殊字符的文件不处理
+    if (XTool::hasShellMetachar(name))
+    {
+        std::cerr << "[监视] 文件名含 shell 特殊字符，已跳过: " << name << std::endl;
+        return false;
+    }
+    if (directory.extensions.empty())
+    {
+        return true;
+    }
+
+    std::string ext = fs::path(name).extension().string();
+    std::ranges::transform(ext, ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return std::ranges::find(directory.extensions, ext) != directory.extensions.end();
+}
+
+auto FolderWatcher::PImpl::drainEvents() -> void
+{
+#ifdef __linux__
+    alignas(inotify_event) char buffer[64 * 1024];
+    while (true)
+    {
+        const ssize_t length = ::read(inotifyFd_, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            break; /// EAGAIN：已读完
+        }
+
+        const auto now      = std::chrono::steady_clock::now();
+        bool       overflow = false;
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                overflow = true;
+                continue;
+            }
+            if (event->mask & IN_IGNORED)
+            {
+                /// 监视已被内核移除，描述符随之失效（之后可能被复用），从表中删掉
+                if (const auto it = watches_.find(event->wd); it != watches_.end())
+                {
+                    std::cerr << "[监视] 目录已被删除或卸载，停止监视: " << options_.directories[it->second].path
+                              << std::endl;
+                    watches_.erase(it);
+                }
+                continue;
+            }
+            if (event->len == 0 || (event->mask & IN_ISDIR) || !watches_.contains(event->wd))
+            {
+                continue;
+            }
+
+            const std::string name      = event->name;
+            const size_t      directory = watches_[event->wd];
+            if (!accepts(options_.directories[directory], name))
+            {
+                continue;
+            }
+
+            const std::string path = (fs::path(options_.directories[directory].path) / name).string();
+            {
+                std::lock_guard<std::mutex> lock(ignoredMutex_);
+                if (ignored_.contains(path))
+                {
+                    continue;
+                }
+            }
+
+            /// 合并：连续事件只推迟截止时间，已记录的大小作废
+            auto &pending     = pending_[path];
+            pending.deadline  = now + options_.settle;
+            pending.directory = directory;
+            pending.sized     = false;
+        }
+
+        /// 溢出时丢失的事件无从得知，重新扫描一遍目录；已处理的文件在 ignored_ 中会被跳过
+        if (overflow)
+        {
+            std::cerr << "[监视] 事件队列溢出，重新扫描目录" << std::endl;
+            scanExisting();
+        }
+    }
+#endif
+}
+
+auto FolderWatcher::PImpl::scanExisting() -> void
+{
+    const auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options_.directories.size(); ++i)
+    {
+        const auto     &directory = options_.directories[i];
+        std::error_code ec;
+        for (fs::directory_iterator it(directory.path, ec), end; !ec && it != end; it.increment(ec))
+        {
+            std::error_code typeEc;
+            if (!it->is_regular_file(typeEc) || !accepts(directory, it->path().filename().string()))
+            {
+                continue;
+            }
+
+            const std::string path = it->path().string();
+            {
+                std::lock_guard<std::mutex> lock(ignoredMutex_);
+                if (ignored_.contains(path))
+                {
+                    continue;
+                }
+            }
+
+            auto &pending     = pending_[path];
+            pending.deadline  = now + options_.settle;
+            pending.directory = i;
+            pending.sized     = false;
+        }
+    }
+}
+
+auto FolderWatcher::PImpl::checkPending(const ReadyCallback &onReady) -> void
+{
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = pending_.begin(); it != pending_.end();)
+    {
+        auto &[path, pending] = *it;
+        if (pending.deadline > now)
+        {
+            ++it;
+            continue;
+        }
+
+        std::error_code ec;
+        const auto      size = fs::file_size(path, ec);
+        if (ec)
+        {
+            it = pending_.erase(it); /// 已被移走或删除
+            continue;
+        }
+
+        /// 空文件再等一个 stable 周期仍为空就放弃；之后再写入会重新收到 IN_CLOSE_WRITE
+        if (size == 0 && pending.sized && pending.size == 0)
+        {
+            it = pending_.erase(it);
+            continue;
+        }
+
+        if (!pending.sized || size != pending.size || size == 0)
+        {
+            pending.size     = size;
+            pending.sized    = true;
+            pending.deadline = now + options_.stable;
+            ++it;
+            continue;
+        }
+
+        const std::string ready     = path;
+        const size_t      directory = pending.directory;
+
+        it = pending_.erase(it);
+        onReady(ready, directory);
+    }
+}
+
+FolderWatcher::FolderWatcher() : impl_(std::make_unique<PImpl>(this))
+{
+}
+
+FolderWatcher::~FolderWatcher() = default;
+
+auto FolderWatcher::start(const Options &options, std::string &errorMsg) -> bool
+{
+#ifdef __linux__
+    impl_->options_ = options;
+    for (auto &directory : impl_->options_.directories)
+    {
+        directory.path = normalizePath(directory.path);
+    }
+
+    impl_->inotifyFd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    impl_->stopFd_    = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (impl_->inotifyFd_ < 0 || impl_->stopFd_ < 0)
+    {
+        errorMsg = "无法创建 inotify 实例";
+        return false;
+    }
+
+    /// 只关心写完关闭与移入两种事件，写入过程中的 IN_MODIFY 不会唤醒
+    constexpr uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO;
+    for (size_t i = 0; i < impl_->options_.directories.size(); ++i)
+    {
+        const auto &directory = impl_->options_.directories[i].path;
+        const int   wd        = ::inotify_add_watch(impl_->inotifyFd_, directory.c_str(), mask);
+        if (wd < 0)
+        {
+            errorMsg = "无法监视目录: " + directory;
+            return false;
+        }
+        impl_->watches_[wd] = i;
+    }
+
+    /// 先建立监视再扫描，扫描期间写完的文件不会漏掉（重复的事件在 pending_ 中合并）
+    impl_->scanExisting();
+    return true;
+#else
+    errorMsg = "目录监视依赖 inotify，当前平台不支持";
+    return false;
+#endif
+}
+
+auto FolderWatcher::run(const ReadyCallback &onReady) -> void
+{
+#ifdef __linux__
+    pollfd fds[2] = { { impl_->inotifyFd_, POLLIN, 0 }, { impl_->stopFd_, POLLIN, 0 } };
+    while (true)
+    {
+        /// 没有待确认的文件时无限等待；否则只等到最近的截止时间
+        int timeout = -1;
+        if (!impl_->pending_.empty())
+        {
+            auto next = std::ranges::min(impl_->pending_ | std::views::values, {}, &PImpl::Pending::deadline).deadline;
+            auto wait = std::chrono::ceil<std::chrono::milliseconds>(next - std::chrono::steady_clock::now());
+            timeout   = static_cast<int>(std::max<int64_t>(0, wait.count()));
+        }
+
+        if (::poll(fds, 2, timeout) < 0 && errno != EINTR)
+        {
+            break;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            break;
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            impl_->drainEvents();
+        }
+        impl_->checkPending(onReady);
+    }
+#endif
+}
+
+auto FolderWatcher::stop() -> void
+{
+#ifdef __linux__
+    if (impl_->stopFd_ >= 0)
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] auto written = ::write(impl_->stopFd_, &one, sizeof(one));
+    }
+#endif
+}
+
+auto FolderWatcher::ignore(const std::string &path) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->ignoredMutex_);
+    impl_->ignored_.insert(normalizePath(path));
+}
@@ -0,0 +1,185 @@
+﻿#include "FragmentNotifier.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+namespace
+{
+    auto readBE32(const uint8_t *p) -> uint32_t
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    auto readBE64(const uint8_t *p) -> uint64_t
+    {
+        return (static_cast<uint64_t>(readBE32(p)) << 32) | readBE32(p + 4);
+    }
+
+    /// 跟踪按规范化绝对路径匹配
+    auto normalizePath(const std::string &path) -> std::string
+    {
+        std::error_code ec;
+        auto            absolute = fs::absolute(path, ec);
+        return (ec ? fs::path(path) : absolute).lexically_normal().generic_string();
+    }
+} // namespace
+
+class FragmentNotifier::PImpl
+{
+public:
+    struct Watch
+    {
+        uint64_t offset    = 0;  ///< 下一个片段的起点（= 已确定字节数）
+        size_t   nextIndex = 0;
+        size_t   fragments = 0;  ///< 已写完的媒体片段数
+        int64_t  lastSize  = -1; ///< 上次扫描时的 total_size
+    };
+
+public:
+    /// 扫描一个文件并累计新片段；调用方持有 mutex_
+    auto scan(const std::string &path, Watch &watch, bool atEnd) -> void;
+
+public:
+    std::mutex                   mutex_;
+    std::map<std::string, Watch> watches_;
+};
+
+auto FragmentNotifier::PImpl::scan(const std::string &path, Watch &watch, bool atEnd) -> void
+{
+    std::vector<Fragment> fragments;
+    if (FragmentNotifier::scan(path, watch.offset, watch.nextIndex, fragments, atEnd))
+    {
+        watch.fragments += static_cast<size_t>(std::ranges::count(fragments, false, &Fragment::init));
+    }
+}
+
+FragmentNotifier::FragmentNotifier() : impl_(std::make_unique<PImpl>())
+{
+}
+
+FragmentNotifier::~FragmentNotifier() = default;
+
+auto FragmentNotifier::watch(const std::string &path) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    /// 重试时 ffmpeg 会截断重写输出，状态从头开始
+    impl_->watches_[normalizePath(path)] = PImpl::Watch{};
+}
+
+auto FragmentNotifier::update(const std::string &path, int64_t totalSize) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    if (impl_->watches_.empty())
+    {
+        return;
+    }
+
+    const std::string key = normalizePath(path);
+    auto              it  = impl_->watches_.find(key);
+    /// total_size 没有增长说明没有新数据落盘，不必读文件
+    if (it == impl_->watches_.end() || totalSize <= it->second.lastSize)
+    {
+        return;
+    }
+    it->second.lastSize = totalSize;
+    impl_->scan(key, it->second, false);
+}
+
+auto FragmentNotifier::finish(const std::string &path, bool success) -> size_t
+{
+    const std::string key = normalizePath(path);
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    auto                        it = impl_->watches_.find(key);
+    if (it == impl_->watches_.end())
+    {
+        return 0;
+    }
+    if (success)
+    {
+        impl_->scan(key, it->second, true);
+    }
+
+    const size_t fragments = it->second.fragments;
+    impl_->watches_.erase(it);
+    return fragments;
+}
+
+auto FragmentNotifier::scan(const std::string &path, uint64_t &offset, size_t &nextIndex,
+                            std::vector<Fragment> &fragments, bool atEnd) -> bool
+{
+    std::error_code ec;
+    const uint64_t  fileSize = fs::file_size(path, ec);
+    if (ec)
+    {
+        return false;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    /// 只读 box 头：size(4) + type(4)，size==1 时后跟 64 位长度；
+    /// box 完整落在文件大小之内才算写完，moov 结束初始化段，mdat 结束一个媒体片段
+    uint64_t pos = offset;
+    while (pos + 8 <= fileSize)
+    {
+        uint8_t header[16];
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(pos));
+        if (!file.read(reinterpret_cast<char *>(header), 8))
+        {
+            break;
+        }
+
+        uint64_t          boxSize    = readBE32(header);
+        uint64_t          headerSize = 8;
+        const std::string type(reinterpret_cast<const char *>(header + 4), 4);
+        if (boxSize == 1)
+        {
+            if (pos + 16 > fileSize || !file.read(reinterpret_cast<char *>(header + 8), 8))
+            {
+                break;
+            }
+            boxSize    = readBE64(header + 8);
+            headerSize = 16;
+        }
+        else if (boxSize == 0)
+        {
+            /// 延伸到文件末尾的 box 只有在写完后才能确定
+            if (!atEnd)
+            {
+                break;
+            }
+            boxSize = fileSize - pos;
+        }
+
+        if (boxSize < headerSize)
+        {
+            return false; /// 不是 ISO BMFF 结构
+        }
+        if (pos + boxSize > fileSize)
+        {
+            break;
+        }
+        pos += boxSize;
+
+        if (type == "moov" || type == "mdat")
+        {
+            Fragment fragment;
+            fragment.path   = path;
+            fragment.index  = nextIndex++;
+            fragment.offset = offset;
+            fragment.size   = pos - offset;
+            fragment.init   = type == "moov";
+            fragments.push_back(std::move(fragment));
+            offset = pos;
+        }
+    }
+    return true;
+}
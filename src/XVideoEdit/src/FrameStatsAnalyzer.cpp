@@ -0,0 +1,423 @@
+﻿#include "FrameStatsAnalyzer.h"
+#include "XTool.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+    constexpr char     TABLE_MAGIC[8] = { 'X', 'F', 'R', 'M', 'T', 'B', 'L', '1' };
+    constexpr uint32_t MAX_GOP_BUCKET = 1024; ///< GOP 长度 >= 1024 归入最后一个桶
+    constexpr size_t   SUB_BUCKETS    = 16;   ///< 每个 2 的幂区间细分数（相对误差约 6%）
+    constexpr size_t   SIZE_BUCKETS   = SUB_BUCKETS + 60 * SUB_BUCKETS;
+    constexpr size_t   TABLE_BATCH    = 4096; ///< 帧表批量写入的记录数
+
+    /// 帧大小 -> 对数分桶下标
+    auto sizeBucket(uint64_t value) -> size_t
+    {
+        if (value < SUB_BUCKETS)
+        {
+            return static_cast<size_t>(value);
+        }
+        int    exponent = 63 - std::countl_zero(value); /// >= 4
+        size_t sub      = static_cast<size_t>((value >> (exponent - 4)) & (SUB_BUCKETS - 1));
+        return SUB_BUCKETS + static_cast<size_t>(exponent - 4) * SUB_BUCKETS + sub;
+    }
+
+    /// 分桶下标 -> 桶内代表值（取中点）
+    auto bucketValue(size_t bucket) -> uint64_t
+    {
+        if (bucket < SUB_BUCKETS)
+        {
+            return bucket;
+        }
+        size_t   exponent = (bucket - SUB_BUCKETS) / SUB_BUCKETS + 4;
+        size_t   sub      = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+        uint64_t width    = 1ULL << (exponent - 4);
+        uint64_t lower    = (1ULL << exponent) + sub * width;
+        return lower + width / 2;
+    }
+
+    auto parseDouble(std::string_view text, double &value) -> bool
+    {
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && ptr == text.data() + text.size();
+    }
+
+    auto parseUInt(std::string_view text, uint64_t &value) -> bool
+    {
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && ptr == text.data() + text.size();
+    }
+} // namespace
+
+class FrameStatsAnalyzer::PImpl
+{
+public:
+    PImpl(FrameStatsAnalyzer *owner);
+    ~PImpl() = default;
+
+public:
+    auto addFrame(const FrameRecord &frame) -> void;
+
+    auto closeSecond() -> void;
+
+    auto closeGop() -> void;
+
+    auto flushTable() -> void;
+
+public:
+    FrameStatsAnalyzer *owner_ = nullptr;
+    Summary             summary_;
+    bool                finished_ = false;
+
+    /// 每秒码率
+    int64_t  currentSecond_ = -1;
+    uint64_t secondBytes_   = 0;
+    uint64_t secondCount_   = 0;
+    double   secondBpsSum_  = 0.0;
+
+    /// GOP
+    uint32_t                                 framesInGop_ = 0;
+    uint64_t                                 gopFrameSum_ = 0;
+    double                                   lastKeyPts_  = -1.0;
+    std::array<uint64_t, MAX_GOP_BUCKET + 1> gopHistogram_{};
+
+    /// 帧大小分布
+    std::array<uint64_t, SIZE_BUCKETS> sizeHistogram_{};
+
+    /// 二进制帧表
+    std::ofstream            table_;
+    std::vector<FrameRecord> tableBuffer_;
+};
+
+FrameStatsAnalyzer::PImpl::PImpl(FrameStatsAnalyzer *owner) : owner_(owner)
+{
+}
+
+auto FrameStatsAnalyzer::PImpl::addFrame(const FrameRecord &frame) -> void
+{
+    auto &s = summary_;
+    if (s.frames == 0)
+    {
+        s.firstPts = frame.pts;
+    }
+    s.frames++;
+    s.totalBytes += frame.size;
+    s.lastPts = std::max(s.lastPts, frame.pts);
+    s.sizeMax = std::max(s.sizeMax, frame.size);
+
+    switch (frame.pictType)
+    {
+        case 'I':
+            s.iFrames++;
+            break;
+        case 'P':
+            s.pFrames++;
+            break;
+        case 'B':
+            s.bFrames++;
+            break;
+        default:
+            s.otherFrames++;
+            break;
+    }
+
+    /// 每秒码率：时间戳跨秒时结算上一秒
+    auto second = static_cast<int64_t>(std::floor(frame.pts));
+    if (second > currentSecond_)
+    {
+        closeSecond();
+        currentSecond_ = second;
+    }
+    secondBytes_ += frame.size;
+
+    /// GOP：遇到关键帧结算上一个 GOP
+    if (frame.keyFrame)
+    {
+        closeGop();
+        if (lastKeyPts_ >= 0.0)
+        {
+            s.maxKeyframeInterval = std::max(s.maxKeyframeInterval, frame.pts - lastKeyPts_);
+        }
+        lastKeyPts_ = frame.pts;
+    }
+    framesInGop_++;
+
+    sizeHistogram_[std::min(sizeBucket(frame.size), SIZE_BUCKETS - 1)]++;
+
+    if (table_.is_open())
+    {
+        tableBuffer_.push_back(frame);
+        if (tableBuffer_.size() >= TABLE_BATCH)
+        {
+            flushTable();
+        }
+    }
+}
+
+auto FrameStatsAnalyzer::PImpl::closeSecond() -> void
+{
+    if (currentSecond_ < 0)
+    {
+        return;
+    }
+
+    double bps = static_cast<double>(secondBytes_) * 8.0;
+    auto  &s   = summary_;
+    if (secondCount_ == 0 || bps < s.minSecondBps)
+    {
+        s.minSecondBps = bps;
+    }
+    if (bps > s.maxSecondBps)
+    {
+        s.maxSecondBps = bps;
+        s.peakSecond   = static_cast<double>(currentSecond_);
+    }
+    secondCount_++;
+    secondBpsSum_ += bps;
+    s.avgSecondBps = secondBpsSum_ / static_cast<double>(secondCount_);
+    secondBytes_   = 0;
+}
+
+auto FrameStatsAnalyzer::PImpl::closeGop() -> void
+{
+    if (framesInGop_ == 0)
+    {
+        return;
+    }
+
+    auto &s = summary_;
+    if (s.gopCount == 0 || framesInGop_ < s.minGop)
+    {
+        s.minGop = framesInGop_;
+    }
+    s.maxGop = std::max(s.maxGop, framesInGop_);
+    s.gopCount++;
+    gopFrameSum_ += framesInGop_;
+    s.avgGop = static_cast<double>(gopFrameSum_) / static_cast<double>(s.gopCount);
+
+    gopHistogram_[std::min(framesInGop_, MAX_GOP_BUCKET)]++;
+    framesInGop_ = 0;
+}
+
+auto FrameStatsAnalyzer::PImpl::flushTable() -> void
+{
+    if (table_.is_open() && !tableBuffer_.empty())
+    {
+        table_.write(reinterpret_cast<const char *>(tableBuffer_.data()),
+                     static_cast<std::streamsize>(tableBuffer_.size() * sizeof(FrameRecord)));
+    }
+    tableBuffer_.clear();
+}
+
+/// ==================== FrameStatsAnalyzer ====================
+
+FrameStatsAnalyzer::FrameStatsAnalyzer() : impl_(std::make_unique<PImpl>(this))
+{
+}
+
+FrameStatsAnalyzer::~FrameStatsAnalyzer()
+{
+    finish();
+}
+
+auto FrameStatsAnalyzer::openFrameTable(const std::string_view &path, std::string &errorMsg) -> bool
+{
+    impl_->table_.open(fs::path(path), std::ios::binary | std::ios::trunc);
+    if (!impl_->table_.is_open())
+    {
+        errorMsg = "无法创建帧表文件: " + std::string(path);
+        return false;
+    }
+
+    uint32_t recordSize = sizeof(FrameRecord);
+    impl_->table_.write(TABLE_MAGIC, sizeof(TABLE_MAGIC));
+    impl_->table_.write(reinterpret_cast<const char *>(&recordSize), sizeof(recordSize));
+    impl_->tableBuffer_.reserve(TABLE_BATCH);
+    return true;
+}
+
+auto FrameStatsAnalyzer::feedLine(std::string_view line) -> bool
+{
+    /// compact 格式：key_frame=1|pts_time=0.040000|pkt_size=1234|pict_type=P
+    FrameRecord frame;
+    bool        hasSize     = false;
+    bool        hasPts      = false;
+    double      fallbackPts = -1.0;
+
+    while (!line.empty())
+    {
+        auto             sep   = line.find('|');
+        std::string_view field = line.substr(0, sep);
+        line                   = sep == std::string_view::npos ? std::string_view{} : line.substr(sep + 1);
+
+        auto eq = field.find('=');
+        if (eq == std::string_view::npos)
+        {
+            continue;
+        }
+        std::string_view key   = field.substr(0, eq);
+        std::string_view value = field.substr(eq + 1);
+
+        if (key == "key_frame")
+        {
+            frame.keyFrame = value == "1" ? 1 : 0;
+        }
+        else if (key == "pict_type")
+        {
+            frame.pictType = value.empty() ? '?' : value.front();
+        }
+        else if (key == "pkt_size")
+        {
+            uint64_t size = 0;
+            hasSize       = parseUInt(value, size);
+            frame.size    = static_cast<uint32_t>(std::min<uint64_t>(size, UINT32_MAX));
+        }
+        else if (key == "best_effort_timestamp_time")
+        {
+            hasPts = parseDouble(value, frame.pts) || hasPts;
+        }
+        else if (key == "pts_time" || key == "pkt_dts_time")
+        {
+            double pts = 0.0;
+            if (fallbackPts < 0.0 && parseDouble(value, pts))
+            {
+                fallbackPts = pts;
+            }
+        }
+    }
+
+    if (!hasSize)
+    {
+        return false;
+    }
+    if (!hasPts)
+    {
+        /// 没有时间戳时沿用上一帧时间，仍计入数量与大小统计
+        frame.pts = fallbackPts >= 0.0 ? fallbackPts : impl_->summary_.lastPts;
+    }
+
+    impl_->addFrame(frame);
+    return true;
+}
+
+auto FrameStatsAnalyzer::finish() -> void
+{
+    if (impl_->finished_)
+    {
+        return;
+    }
+    impl_->finished_ = true;
+    impl_->closeSecond();
+    impl_->closeGop();
+    impl_->flushTable();
+    if (impl_->table_.is_open())
+    {
+        impl_->table_.close();
+    }
+}
+
+auto FrameStatsAnalyzer::summary() const -> Summary
+{
+    Summary s = impl_->summary_;
+
+    /// 由对数直方图计算近似分位数
+    auto percentile = [this, &s](double p) -> uint32_t
+    {
+        if (s.frames == 0)
+        {
+            return 0;
+        }
+        auto     target = static_cast<uint64_t>(std::ceil(p * static_cast<double>(s.frames)));
+        uint64_t seen   = 0;
+        for (size_t i = 0; i < SIZE_BUCKETS; ++i)
+        {
+            seen += impl_->sizeHistogram_[i];
+            if (seen >= target)
+            {
+                return static_cast<uint32_t>(std::min<uint64_t>(bucketValue(i), s.sizeMax));
+            }
+        }
+        return s.sizeMax;
+    };
+
+    s.sizeP50 = percentile(0.50);
+    s.sizeP90 = percentile(0.90);
+    s.sizeP99 = percentile(0.99);
+    return s;
+}
+
+auto FrameStatsAnalyzer::gopDistribution() const -> std::vector<std::pair<uint32_t, uint64_t>>
+{
+    std::vector<std::pair<uint32_t, uint64_t>> result;
+    for (uint32_t len = 0; len <= MAX_GOP_BUCKET; ++len)
+    {
+        if (impl_->gopHistogram_[len] > 0)
+        {
+            result.emplace_back(len, impl_->gopHistogram_[len]);
+        }
+    }
+    return result;
+}
+
+auto FrameStatsAnalyzer::formatSummary() const -> std::string
+{
+    Summary           s = summary();
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+
+    ss << "=== 帧级统计 ===\n";
+    ss << "总帧数: " << s.frames << " (I: " << s.iFrames << ", P: " << s.pFrames << ", B: " << s.bFrames;
+    if (s.otherFrames > 0)
+    {
+        ss << ", 其他: " << s.otherFrames;
+    }
+    ss << ")\n";
+    ss << "时间范围: " << s.firstPts << "s - " << s.lastPts << "s\n";
+    ss << "每秒码率: 最小 " << s.minSecondBps / 1000.0 << " kb/s, 平均 " << s.avgSecondBps / 1000.0
+       << " kb/s, 最大 " << s.maxSecondBps / 1000.0 << " kb/s (第 " << static_cast<int64_t>(s.peakSecond)
+       << " 秒)\n";
+    ss << "帧大小: P50 " << s.sizeP50 << " B, P90 " << s.sizeP90 << " B, P99 " << s.sizeP99 << " B, 最大 "
+       << s.sizeMax << " B\n";
+    ss << "GOP: " << s.gopCount << " 个, 长度 最小 " << s.minGop << " / 平均 " << s.avgGop << " / 最大 " << s.maxGop
+       << "\n";
+    ss << "最大关键帧间隔: " << s.maxKeyframeInterval << " 秒\n";
+
+    auto distribution = gopDistribution();
+    if (!distribution.empty())
+    {
+        /// 只列出最常见的几种 GOP 长度
+        std::ranges::sort(distribution, [](const auto &a, const auto &b) { return a.second > b.second; });
+        ss << "GOP分布:";
+        for (size_t i = 0; i < std::min<size_t>(distribution.size(), 8); ++i)
+        {
+            ss << " " << distribution[i].first << (distribution[i].first == MAX_GOP_BUCKET ? "+" : "") << "帧×"
+               << distribution[i].second;
+        }
+        ss << "\n";
+    }
+
+    return ss.str();
+}
+
+auto FrameStatsAnalyzer::buildProbeCommand(const std::string_view &input, const std::string_view &selectStreams)
+        -> std::string
+{
+    std::stringstream cmd;
+    cmd << "\"" << XTool::getFFprobePath() << "\" -v error";
+    if (!selectStreams.empty())
+    {
+        cmd << " -select_streams " << selectStreams;
+    }
+    cmd << " -show_frames -show_entries frame=key_frame,pict_type,pkt_size,best_effort_timestamp_time,pts_time"
+        << " -of compact=p=0 \"" << input << "\"";
+    return cmd.str();
+}
@@ -0,0 +1,201 @@
+﻿#include "IndexCommandBuilder.h"
+#include "MediaCatalog.h"
+#include "MediaProbeCache.h"
+#include "VideoFileValidator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+auto IndexCommandBuilder::parseOptions(const std::map<std::string, ParameterValue>& params) const
+        -> IndexCommandBuilder::IndexOptions
+{
+    IndexOptions options;
+    options.dir = params.at("--dir").asString();
+
+    if (params.contains("--output") && !params.at("--output").asString().empty())
+    {
+        options.output = params.at("--output").asString();
+    }
+
+    if (params.contains("--jobs"))
+    {
+        options.jobs = params.at("--jobs").asInt();
+    }
+    if (options.jobs <= 0)
+    {
+        options.jobs = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    /// 无值的 --all 视为开启
+    if (params.contains("--all"))
+    {
+        const auto& value = params.at("--all").asString();
+        options.all_files = value.empty() || params.at("--all").asBool();
+    }
+    return options;
+}
+
+auto IndexCommandBuilder::collectFiles(const IndexOptions& options) const -> std::vector<std::string>
+{
+    std::vector<std::string> files;
+    std::error_code          ec;
+    auto                     it = fs::recursive_directory_iterator(
+            options.dir, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        std::error_code statEc;
+        if (!it->is_regular_file(statEc))
+        {
+            continue;
+        }
+
+        std::string path = it->path().string();
+        std::string ignored;
+        if (options.all_files || VideoFileValidator::isVideoFileByExtension(path, ignored))
+        {
+            files.push_back(std::move(path));
+        }
+    }
+
+    /// 排序保证目录文件的行序稳定
+    std::ranges::sort(files);
+    return files;
+}
+
+auto IndexCommandBuilder::build(const std::map<std::string, ParameterValue>&) const -> std::string
+{
+    /// 索引任务全部在进程内执行，不生成外部命令
+    return {};
+}
+
+auto IndexCommandBuilder::validate(const std::map<std::string, ParameterValue>& params, std::string& errorMsg) const
+        -> bool
+{
+    if (!params.contains("--dir"))
+    {
+        errorMsg = "缺少必需参数: --dir";
+        return false;
+    }
+
+    std::error_code ec;
+    fs::path        dir = params.at("--dir").asString();
+    if (!fs::is_directory(dir, ec))
+    {
+        errorMsg = "目录不存在: " + dir.string();
+        return false;
+    }
+
+    if (params.contains("--jobs") && params.at("--jobs").asInt() < 0)
+    {
+        errorMsg = "--jobs 必须为非负整数";
+        return false;
+    }
+    return true;
+}
+
+auto IndexCommandBuilder::getTitle(const std::map<std::string, ParameterValue>& params) const -> std::string
+{
+    return "索引: " + params.at("--dir").asString();
+}
+
+auto IndexCommandBuilder::isInProcess(const std::map<std::string, ParameterValue>&) const -> bool
+{
+    return true;
+}
+
+auto IndexCommandBuilder::run(const std::map<std::string, ParameterValue>& params, std::string& resultMsg,
+                              std::string& errorMsg) const -> bool
+{
+    auto         start   = std::chrono::steady_clock::now();
+    IndexOptions options = parseOptions(params);
+
+    /// 1. 收集文件
+    std::vector<std::string> files = collectFiles(options);
+    if (files.empty())
+    {
+        errorMsg = "目录中没有可索引的媒体文件: " + options.dir;
+        return false;
+    }
+
+    size_t workerCount = std::min<size_t>(options.jobs, files.size());
+    std::cout << "发现 " << files.size() << " 个文件，使用 " << workerCount << " 个并行探测" << std::endl;
+
+    /// 2. 并行探测：各线程按原子下标领取文件，结果写入各自槽位，无需加锁
+    std::vector<MediaCatalog::Row> rows(files.size());
+    std::vector<uint8_t>           ok(files.size(), 0);
+    std::atomic<size_t>            next{ 0 };
+    std::atomic<size_t>            done{ 0 };
+    std::atomic<size_t>            failed{ 0 };
+    auto*                          cache = MediaProbeCache::getInstance();
+
+    auto worker = [&]()
+    {
+        for (size_t i = next.fetch_add(1); i < files.size(); i = next.fetch_add(1))
+        {
+            MediaProbeCache::FileKey key;
+            MediaProbeInfo           info;
+            std::string              probeError;
+            if (MediaProbeCache::makeKey(files[i], key, probeError) && cache->probe(files[i], info, probeError))
+            {
+                rows[i] = MediaCatalog::Row::fromProbe(files[i], key.size, key.mtimeNs / 1000000000, info);
+                ok[i]   = 1;
+            }
+            else
+            {
+                failed.fetch_add(1, std::memory_order_relaxed);
+            }
+            done.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        workers.emplace_back(worker);
+    }
+
+    while (done.load() < files.size())
+    {
+        std::cout << "\r已探测 " << done.load() << "/" << files.size() << std::flush;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    for (auto& thread : workers)
+    {
+        thread.join();
+    }
+    std::cout << "\r已探测 " << files.size() << "/" << files.size() << std::endl;
+
+    /// 3. 丢弃探测失败的文件后写目录
+    std::vector<MediaCatalog::Row> indexed;
+    indexed.reserve(files.size());
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        if (ok[i])
+        {
+            indexed.push_back(std::move(rows[i]));
+        }
+    }
+
+    if (!MediaCatalog::write(options.output, indexed, errorMsg))
+    {
+        return false;
+    }
+
+    double            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto              stats   = cache->getStatistics();
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "已写入目录: " << options.output << "\n";
+    ss << "索引文件: " << indexed.size() << "，失败: " << failed.load() << "，用时 " << seconds << " 秒\n";
+    ss << "缓存: 内存命中 " << stats.hits << "，磁盘命中 " << stats.diskHits << "，探测 " << stats.misses;
+    resultMsg = ss.str();
+    return true;
+}
+
+IMPLEMENT_CREATE(IndexCommandBuilder);
@@ -0,0 +1,304 @@
+﻿#include "InputPrefetcher.h"
+#include "XConst.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /// 顶层 box 数量上限：分片 MP4 有成千上万个 moof/mdat，其 moov 在文件头，已被文件头覆盖
+    constexpr int MAX_TOP_LEVEL_BOXES = 256;
+
+    auto readBE32(const uint8_t *p) -> uint32_t
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    auto readBE64(const uint8_t *p) -> uint64_t
+    {
+        return (static_cast<uint64_t>(readBE32(p)) << 32) | readBE32(p + 4);
+    }
+
+    /// 在顶层 box 中查找 moov；不是 ISO BMFF 文件时返回 false
+    auto findMoov(const std::string &path, uint64_t fileSize, InputPrefetcher::Range &moov) -> bool
+    {
+        std::ifstream file(path, std::ios::binary);
+        uint64_t      pos = 0;
+        for (int i = 0; file && i < MAX_TOP_LEVEL_BOXES && pos + 8 <= fileSize; ++i)
+        {
+            uint8_t header[16];
+            file.seekg(static_cast<std::streamoff>(pos));
+            if (!file.read(reinterpret_cast<char *>(header), 8))
+            {
+                return false;
+            }
+
+            uint64_t          boxSize    = readBE32(header);
+            uint64_t          headerSize = 8;
+            const std::string type(reinterpret_cast<const char *>(header + 4), 4);
+            if (i == 0 && type != "ftyp")
+            {
+                return false;
+            }
+            if (boxSize == 1)
+            {
+                if (!file.read(reinterpret_cast<char *>(header + 8), 8))
+                {
+                    return false;
+                }
+                boxSize    = readBE64(header + 8);
+                headerSize = 16;
+            }
+            else if (boxSize == 0)
+            {
+                boxSize = fileSize - pos;
+            }
+            if (boxSize < headerSize)
+            {
+                return false;
+            }
+
+            if (type == "moov")
+            {
+                moov.offset = pos;
+                moov.length = std::min(boxSize, fileSize - pos);
+                return true;
+            }
+            pos += boxSize;
+        }
+        return false;
+    }
+} // namespace
+
+class InputPrefetcher::PImpl
+{
+public:
+    PImpl(InputPrefetcher *owner, const Options &options);
+    ~PImpl();
+
+public:
+    auto workerLoop() -> void;
+
+public:
+    InputPrefetcher                *owner_ = nullptr;
+    Options                         options_;
+    mutable std::mutex              mutex_;
+    std::condition_variable         workCv_;
+    std::condition_variable         idleCv_;
+    std::deque<std::string>         requests_;
+    std::set<std::string>           requested_; ///< 排队或正在预读、尚未 release 的文件
+    std::map<std::string, uint64_t> charged_;   ///< 文件 → 占用的预算
+    Statistics                      stats_;
+    bool                            busy_     = false;
+    bool                            stopping_ = false;
+    std::thread                     worker_;
+};
+
+InputPrefetcher::PImpl::PImpl(InputPrefetcher *owner, const Options &options) : owner_(owner), options_(options)
+{
+}
+
+InputPrefetcher::PImpl::~PImpl()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    workCv_.notify_all();
+    if (worker_.joinable())
+    {
+        worker_.join();
+    }
+}
+
+auto InputPrefetcher::PImpl::workerLoop() -> void
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        workCv_.wait(lock, [this] { return stopping_ || !requests_.empty(); });
+        if (stopping_)
+        {
+            return;
+        }
+
+        const std::string path = std::move(requests_.front());
+        requests_.pop_front();
+        busy_ = true;
+        lock.unlock();
+
+        /// 读 box 头本身也可能在冷存储上阻塞，所以放在后台线程
+        std::vector<Range> ranges;
+        const bool         planned = plan(path, options_, ranges);
+
+        lock.lock();
+        uint64_t total = 0;
+        if (planned && requested_.contains(path))
+        {
+            /// 按预算截断；moov 排在前面，优先保证
+            uint64_t remaining = options_.budgetBytes - std::min(options_.budgetBytes, stats_.pending);
+            for (auto &range : ranges)
+            {
+                range.length = std::min(range.length, remaining);
+                remaining -= range.length;
+                total += range.length;
+            }
+            std::erase_if(ranges, [](const Range &range) { return range.length == 0; });
+
+            if (total == 0)
+            {
+                stats_.skipped++;
+            }
+            else
+            {
+                charged_[path] = total;
+                stats_.pending += total;
+            }
+        }
+        lock.unlock();
+
+        if (total > 0)
+        {
+            advise(path, ranges);
+        }
+
+        lock.lock();
+        if (total > 0)
+        {
+            stats_.files++;
+            stats_.bytes += total;
+        }
+        busy_ = false;
+        idleCv_.notify_all();
+    }
+}
+
+InputPrefetcher::InputPrefetcher() : InputPrefetcher(Options{})
+{
+}
+
+InputPrefetcher::InputPrefetcher(const Options &options) : impl_(std::make_unique<PImpl>(this, options))
+{
+    impl_->worker_ = std::thread(&PImpl::workerLoop, impl_.get());
+}
+
+InputPrefetcher::~InputPrefetcher() = default;
+
+auto InputPrefetcher::prefetch(const std::string &path) -> void
+{
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        if (!impl_->requested_.insert(path).second)
+        {
+            return;
+        }
+        impl_->requests_.push_back(path);
+    }
+    impl_->workCv_.notify_one();
+}
+
+auto InputPrefetcher::release(const std::string &path) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    if (impl_->requested_.erase(path) == 0)
+    {
+        return;
+    }
+    std::erase(impl_->requests_, path);
+
+    if (auto it = impl_->charged_.find(path); it != impl_->charged_.end())
+    {
+        impl_->stats_.pending -= it->second;
+        impl_->charged_.erase(it);
+    }
+    impl_->idleCv_.notify_all();
+}
+
+auto InputPrefetcher::waitIdle() -> void
+{
+    std::unique_lock<std::mutex> lock(impl_->mutex_);
+    impl_->idleCv_.wait(lock, [this] { return impl_->requests_.empty() && !impl_->busy_; });
+}
+
+auto InputPrefetcher::getStatistics() const -> Statistics
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->stats_;
+}
+
+auto InputPrefetcher::plan(const std::string &path, const Options &options, std::vector<Range> &ranges) -> bool
+{
+    std::error_code ec;
+    const uint64_t  fileSize = fs::file_size(path, ec);
+    if (ec || fileSize == 0)
+    {
+        return false;
+    }
+
+    const Range head{ 0, std::min(options.headBytes, fileSize) };
+
+    /// moov 未前置（在 mdat 之后）时 ffmpeg 打开文件后第一件事就是跳到文件末尾读取它
+    Range moov;
+    if (options.moov && findMoov(path, fileSize, moov) && moov.offset + moov.length > head.length)
+    {
+        const uint64_t begin = std::max(moov.offset, head.length);
+        ranges.push_back({ begin, moov.offset + moov.length - begin });
+    }
+    if (head.length > 0)
+    {
+        ranges.push_back(head);
+    }
+    return true;
+}
+
+auto InputPrefetcher::advise(const std::string &path, const std::vector<Range> &ranges) -> uint64_t
+{
+    uint64_t total = 0;
+#ifdef __linux__
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return 0;
+    }
+    for (const auto &range : ranges)
+    {
+        /// readahead 把读请求提交给块设备（不拷贝到用户态）；不支持时（如部分 FUSE）退回 fadvise
+        const auto offset = static_cast<off_t>(range.offset);
+        if (::readahead(fd, offset, range.length) != 0)
+        {
+            ::posix_fadvise(fd, offset, static_cast<off_t>(range.length), POSIX_FADV_WILLNEED);
+        }
+        total += range.length;
+    }
+    ::close(fd);
+#endif
+    return total;
+}
+
+auto InputPrefetcher::evict(const std::string &path) -> bool
+{
+#ifdef __linux__
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    const bool ok = ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    ::close(fd);
+    return ok;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,247 @@
+﻿#include "JobScheduler.h"
+#include "InputPrefetcher.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobScheduler::PImpl
+{
+public:
+    struct Pending
+    {
+        uint64_t                              id = 0;
+        std::string                           label;
+        Job                                   job;
+        std::vector<std::string>              inputs;
+        bool                                  prefetched = false;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+    PImpl(JobScheduler *owner, size_t concurrency);
+    ~PImpl() = default;
+
+public:
+    auto workerLoop() -> void;
+
+    /// 取出队首 lookahead_ 个作业中尚未预读的输入；调用方持有 mutex_
+    auto takePrefetchInputs() -> std::vector<std::string>;
+
+public:
+    JobScheduler                    *owner_ = nullptr;
+    mutable std::mutex               mutex_;
+    std::condition_variable          workCv_; ///< 有新作业或停止
+    std::condition_variable          idleCv_; ///< 作业结束
+    std::deque<Pending>              queue_;
+    std::vector<std::thread>         workers_;
+    FinishCallback                   onFinished_;
+    Statistics                       stats_;
+    std::shared_ptr<InputPrefetcher> prefetcher_;
+    size_t                           lookahead_   = 0;
+    size_t                           concurrency_ = 1;
+    uint64_t                         nextId_      = 1;
+    bool                             stopping_    = false;
+};
+
+JobScheduler::PImpl::PImpl(JobScheduler *owner, size_t concurrency) : owner_(owner)
+{
+    concurrency_ = concurrency > 0 ? concurrency : std::max(1u, std::thread::hardware_concurrency());
+}
+
+auto JobScheduler::PImpl::workerLoop() -> void
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        workCv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty())
+        {
+            return; /// 停止且队列已空
+        }
+
+        Pending pending = std::move(queue_.front());
+        queue_.pop_front();
+        stats_.queued--;
+        stats_.running++;
+        Metrics::getInstance()->jobStarted(
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - pending.queuedAt).count());
+
+        /// 本作业开始读取自己的输入，同时让下一个排队作业开始预读
+        const auto prefetcher = prefetcher_;
+        const auto ahead      = prefetcher ? takePrefetchInputs() : std::vector<std::string>{};
+        lock.unlock();
+
+        if (prefetcher)
+        {
+            for (const auto &input : pending.inputs)
+            {
+                prefetcher->release(input);
+            }
+            for (const auto &input : ahead)
+            {
+                prefetcher->prefetch(input);
+            }
+        }
+
+        JobResult result;
+        result.id        = pending.id;
+        result.label     = pending.label;
+        const auto start = std::chrono::steady_clock::now();
+        try
+        {
+            result.success = pending.job(result.errorMsg);
+        }
+        catch (const std::exception &e)
+        {
+            result.success  = false;
+            result.errorMsg = std::string("作业异常: ") + e.what();
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        FinishCallback callback = onFinished_;
+        lock.unlock();
+        if (callback)
+        {
+            callback(result);
+        }
+
+        lock.lock();
+        stats_.running--;
+        (result.success ? stats_.succeeded : stats_.failed)++;
+        Metrics::getInstance()->jobFinished(result.success);
+        idleCv_.notify_all();
+    }
+}
+
+auto JobScheduler::PImpl::takePrefetchInputs() -> std::vector<std::string>
+{
+    std::vector<std::string> inputs;
+    for (size_t i = 0; i < queue_.size() && i < lookahead_; ++i)
+    {
+        if (!queue_[i].prefetched)
+        {
+            queue_[i].prefetched = true;
+            inputs.insert(inputs.end(), queue_[i].inputs.begin(), queue_[i].inputs.end());
+        }
+    }
+    return inputs;
+}
+
+JobScheduler::JobScheduler(size_t concurrency) : impl_(std::make_unique<PImpl>(this, concurrency))
+{
+    impl_->workers_.reserve(impl_->concurrency_);
+    for (size_t i = 0; i < impl_->concurrency_; ++i)
+    {
+        impl_->workers_.emplace_back(&PImpl::workerLoop, impl_.get());
+    }
+}
+
+JobScheduler::~JobScheduler()
+{
+    shutdown(true);
+}
+
+auto JobScheduler::submit(const std::string &label, const Job &job, const std::vector<std::string> &inputs)
+        -> uint64_t
+{
+    std::shared_ptr<InputPrefetcher> prefetcher;
+    std::vector<std::string>         ahead;
+    uint64_t                         id = 0;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        if (impl_->stopping_)
+        {
+            return 0;
+        }
+        id = impl_->nextId_++;
+        impl_->queue_.push_back({ id, label, job, inputs, false, std::chrono::steady_clock::now() });
+        impl_->stats_.queued++;
+        Metrics::getInstance()->jobQueued();
+
+        /// 所有工作线程都在忙时作业才会等待，此时才值得预读
+        if (impl_->prefetcher_ && impl_->stats_.running >= impl_->concurrency_)
+        {
+            prefetcher = impl_->prefetcher_;
+            ahead      = impl_->takePrefetchInputs();
+        }
+    }
+    impl_->workCv_.notify_one();
+
+    for (const auto &input : ahead)
+    {
+        prefetcher->prefetch(input);
+    }
+    return id;
+}
+
+auto JobScheduler::setPrefetcher(const std::shared_ptr<InputPrefetcher> &prefetcher, size_t lookahead) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->prefetcher_ = prefetcher;
+    impl_->lookahead_  = lookahead;
+}
+
+auto JobScheduler::setOnFinished(const FinishCallback &callback) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->onFinished_ = callback;
+}
+
+auto JobScheduler::waitIdle() -> void
+{
+    std::unique_lock<std::mutex> lock(impl_->mutex_);
+    impl_->idleCv_.wait(lock, [this] { return impl_->queue_.empty() && impl_->stats_.running == 0; });
+}
+
+auto JobScheduler::shutdown(bool drain) -> void
+{
+    std::deque<PImpl::Pending> dropped;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        if (!drain)
+        {
+            impl_->stats_.cancelled += impl_->queue_.size();
+            impl_->stats_.queued = 0;
+            Metrics::getInstance()->jobsDropped(impl_->queue_.size());
+            dropped.swap(impl_->queue_);
+        }
+        impl_->stopping_ = true;
+    }
+    if (impl_->prefetcher_)
+    {
+        for (const auto &pending : dropped)
+        {
+            for (const auto &input : pending.inputs)
+            {
+                impl_->prefetcher_->release(input);
+            }
+        }
+    }
+    impl_->workCv_.notify_all();
+
+    for (auto &worker : impl_->workers_)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+    impl_->workers_.clear();
+}
+
+auto JobScheduler::concurrency() const -> size_t
+{
+    return impl_->concurrency_;
+}
+
+auto JobScheduler::getStatistics() const -> Statistics
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->stats_;
+}
@@ -0,0 +1,917 @@
+﻿#include "JobServer.h"
+#include "JobScheduler.h"
+#include "ProgressDashboard.h"
+#include "TaskManager.h"
+#include "XConst.h"
+#include "XTool.h"
+
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /// epoll 事件的 data.u64：监听套接字与唤醒通知占用前两个值，其余为连接ID
+    constexpr uint64_t LISTEN_KEY  = 0;
+    constexpr uint64_t WAKE_KEY    = 1;
+    constexpr uint64_t FIRST_KEY   = 2;
+    constexpr int      MAX_EVENTS  = 256;
+    constexpr size_t   READ_CHUNK  = 16 << 10;
+    constexpr size_t   COMPACT_MIN = 64 << 10; ///< 已发送部分超过此值时才整理发送缓冲
+
+    /// 信号处理函数只能访问无锁的全局状态
+    std::atomic<JobServer *> g_activeServer{ nullptr };
+
+    extern "C" void onServerStopSignal(int)
+    {
+        if (auto *server = g_activeServer.load())
+        {
+            server->stop();
+        }
+    }
+
+    /// 错误信息可能来自外部进程输出，非法 UTF-8 替换掉而不是抛异常
+    auto dumpLine(const nlohmann::json &j) -> std::string
+    {
+        return j.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) + "\n";
+    }
+
+    auto makeEvent(const char *event, const std::string &id) -> nlohmann::json
+    {
+        nlohmann::json j = { { "event", event } };
+        if (!id.empty())
+        {
+            j["id"] = id;
+        }
+        return j;
+    }
+
+    auto round1(double value) -> double
+    {
+        return std::round(value * 10.0) / 10.0;
+    }
+
+    /// 参数最终拼进 /bin/sh -c 执行的命令行，含 shell 特殊字符的一律拒绝
+    auto findUnsafeParam(const std::map<std::string, std::string> &params, std::string &name) -> bool
+    {
+        for (const auto &[key, value] : params)
+        {
+            if (XTool::hasShellMetachar(key) || XTool::hasShellMetachar(value))
+            {
+                name = key;
+                return true;
+            }
+        }
+        return false;
+    }
+} // namespace
+
+class JobServer::PImpl
+{
+public:
+    struct Client
+    {
+        int         fd = -1;
+        std::string input;
+        std::string output;
+        size_t      outputOffset  = 0;     ///< output 中已发送的字节
+        size_t      activeJobs    = 0;     ///< 尚未推送结果的作业数
+        bool        readClosed    = false; ///< 对端已关闭写方向，发完结果后关闭连接
+        bool        watchingWrite = false; ///< 发送缓冲非空时才关注可写事件
+    };
+
+    /// 已接受、尚未结束的作业
+    struct JobEntry
+    {
+        uint64_t    client = 0;
+        std::string id;
+        bool        running         = false;
+        uint64_t    progressVersion = 0; ///< 上次推送的进度版本
+    };
+
+    /// 工作线程投递给 epoll 线程的消息
+    struct Posted
+    {
+        uint64_t    client = 0;
+        std::string line;
+        bool        final = false; ///< 作业的最后一条消息
+    };
+
+    PImpl(JobServer *owner, TaskManager &taskManager);
+    ~PImpl() = default;
+
+public:
+    /// 以下方法只在 epoll 线程调用
+    auto open(std::string &errorMsg) -> bool;
+    auto closeAll() -> void;
+    auto loop() -> void;
+    auto acceptClients() -> void;
+    auto readClient(uint64_t key, uint32_t events) -> void;
+    auto handleLine(uint64_t key, const std::string &line) -> void;
+    auto submitJob(uint64_t key, const Request &request) -> void;
+
+    /// 追加到发送缓冲并尽量写出；droppable 的消息在慢客户端积压过多时丢弃
+    auto send(uint64_t key, const std::string &line, bool droppable = false) -> void;
+    auto flushClient(uint64_t key) -> void;
+    auto updateEvents(uint64_t key, const Client &client) -> void;
+    auto closeClient(uint64_t key) -> void;
+    auto deliverPosted() -> void;
+    auto pushProgress() -> void;
+
+    /// 在工作线程中执行作业
+    auto runJob(uint64_t jobId, const std::string &task, const std::map<std::string, std::string> &params,
+                std::string &errorMsg) -> bool;
+
+    /// 线程安全：投递消息并唤醒 epoll 线程
+    auto post(uint64_t client, std::string line, bool final) -> void;
+    auto wake() -> void;
+
+public:
+    JobServer                             *owner_ = nullptr;
+    TaskManager                           &taskManager_;
+    Config                                 config_;
+    std::unique_ptr<JobScheduler>          scheduler_;
+    std::unordered_map<uint64_t, Client>   clients_;
+    uint64_t                               nextClient_   = FIRST_KEY;
+    uint64_t                               nextJob_      = 1;
+    int                                    epollFd_      = -1;
+    int                                    listenFd_     = -1;
+    int                                    wakeFd_       = -1;
+    bool                                   bound_        = false;
+    bool                                   acceptPaused_ = false; ///< 文件描述符耗尽时暂停接受连接
+    std::atomic<bool>                      stopping_{ false };
+    std::mutex                             jobsMutex_;
+    std::unordered_map<uint64_t, JobEntry> jobs_;
+    std::mutex                             postedMutex_;
+    std::vector<Posted>                    posted_;
+    std::mutex                             outputMutex_;
+};
+
+JobServer::PImpl::PImpl(JobServer *owner, TaskManager &taskManager) : owner_(owner), taskManager_(taskManager)
+{
+}
+
+#ifdef __linux__
+auto JobServer::PImpl::open(std::string &errorMsg) -> bool
+{
+    const auto &path = config_.socketPath;
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        errorMsg = "套接字路径过长: " + path;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    /// 上次异常退出留下的套接字文件：连不上说明没有服务在监听，可以删除
+    std::error_code ec;
+    if (fs::is_socket(path, ec))
+    {
+        const int  probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const bool alive = probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+        if (probe >= 0)
+        {
+            ::close(probe);
+        }
+        if (alive)
+        {
+            errorMsg = "已有服务在监听: " + path;
+            return false;
+        }
+        fs::remove(path, ec);
+    }
+
+    listenFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0 || ::bind(listenFd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        errorMsg = "无法绑定套接字: " + path + " (" + std::strerror(errno) + ")";
+        return false;
+    }
+    bound_ = true;
+    /// 套接字可以提交任意任务，只允许本用户连接；在 listen 之前收紧权限，中间没有可连接的窗口
+    if (::chmod(path.c_str(), S_IRUSR | S_IWUSR) < 0)
+    {
+        errorMsg = "无法设置套接字权限: " + path + " (" + std::strerror(errno) + ")";
+        return false;
+    }
+    if (::listen(listenFd_, SOMAXCONN) < 0)
+    {
+        errorMsg = "无法监听套接字: " + path + " (" + std::strerror(errno) + ")";
+        return false;
+    }
+
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_  = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd_ < 0 || wakeFd_ < 0)
+    {
+        errorMsg = "无法创建 epoll 实例";
+        return false;
+    }
+
+    epoll_event event{};
+    event.events   = EPOLLIN;
+    event.data.u64 = LISTEN_KEY;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &event);
+    event.data.u64 = WAKE_KEY;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event);
+    return true;
+}
+
+auto JobServer::PImpl::closeAll() -> void
+{
+    for (auto &[key, client] : clients_)
+    {
+        ::close(client.fd);
+    }
+    clients_.clear();
+
+    for (int *fd : { &listenFd_, &epollFd_, &wakeFd_ })
+    {
+        if (*fd >= 0)
+        {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+    if (bound_)
+    {
+        std::error_code ec;
+        fs::remove(config_.socketPath, ec);
+        bound_ = false;
+    }
+}
+
+auto JobServer::PImpl::loop() -> void
+{
+    const auto  interval     = std::chrono::milliseconds(std::max(50, config_.progressIntervalMs));
+    auto        nextProgress = std::chrono::steady_clock::now() + interval;
+    epoll_event events[MAX_EVENTS];
+
+    while (!stopping_.load())
+    {
+        /// 没有运行中的作业时无限等待：空闲连接不会唤醒本线程
+        int timeout = -1;
+        if (scheduler_->getStatistics().running > 0)
+        {
+            auto wait = std::chrono::ceil<std::chrono::milliseconds>(nextProgress - std::chrono::steady_clock::now());
+            timeout   = static_cast<int>(std::max<int64_t>(0, wait.count()));
+        }
+
+        const int count = ::epoll_wait(epollFd_, events, MAX_EVENTS, timeout);
+        if (count < 0 && errno != EINTR)
+        {
+            break;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            const uint64_t key = events[i].data.u64;
+            if (key == LISTEN_KEY)
+            {
+                acceptClients();
+            }
+            else if (key == WAKE_KEY)
+            {
+                uint64_t              value   = 0;
+                [[maybe_unused]] auto drained = ::read(wakeFd_, &value, sizeof(value));
+            }
+            else
+            {
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                {
+                    readClient(key, events[i].events);
+                }
+                if ((events[i].events & EPOLLOUT) && clients_.contains(key))
+                {
+                    flushClient(key);
+                }
+            }
+        }
+
+        deliverPosted();
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= nextProgress)
+        {
+            pushProgress();
+            nextProgress = now + interval;
+        }
+    }
+}
+
+auto JobServer::PImpl::acceptClients() -> void
+{
+    while (true)
+    {
+        const int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EMFILE || errno == ENFILE)
+            {
+                /// 监听套接字是水平触发的，不暂停会一直被唤醒；有连接关闭后恢复
+                epoll_event event{};
+                event.data.u64 = LISTEN_KEY;
+                ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, listenFd_, &event);
+                acceptPaused_ = true;
+
+                std::lock_guard<std::mutex> lock(outputMutex_);
+                std::cerr << "[服务] 文件描述符已用尽，暂停接受新连接（当前 " << clients_.size() << " 个）"
+                          << std::endl;
+            }
+            return;
+        }
+
+        const uint64_t key = nextClient_++;
+        epoll_event    event{};
+        event.events   = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = key;
+        if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            ::close(fd);
+            continue;
+        }
+        clients_[key].fd = fd;
+    }
+}
+
+auto JobServer::PImpl::readClient(uint64_t key, uint32_t events) -> void
+{
+    auto it = clients_.find(key);
+    if (it == clients_.end())
+    {
+        return;
+    }
+
+    /// 已半关闭的连接只等结果发完；再收到挂断说明对端已完全关闭
+    if (it->second.readClosed)
+    {
+        if (events & (EPOLLHUP | EPOLLERR))
+        {
+            closeClient(key);
+        }
+        return;
+    }
+
+    char buffer[READ_CHUNK];
+    bool eof = false;
+    while (true)
+    {
+        const ssize_t n = ::recv(it->second.fd, buffer, sizeof(buffer), 0);
+        if (n > 0)
+        {
+            it->second.input.append(buffer, static_cast<size_t>(n));
+            if (it->second.input.size() > config_.maxLineBytes * 4)
+            {
+                break;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        if (n < 0)
+        {
+            closeClient(key);
+            return;
+        }
+        eof = true;
+        break;
+    }
+
+    /// 逐行处理；处理过程中连接可能因发送失败被关闭，每行之后重新查找
+    std::string input = std::move(it->second.input);
+    size_t      start = 0;
+    for (size_t pos = input.find('\n'); pos != std::string::npos; pos = input.find('\n', start))
+    {
+        std::string line = input.substr(start, pos - start);
+        start            = pos + 1;
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (!line.empty())
+        {
+            handleLine(key, line);
+        }
+        if (!clients_.contains(key))
+        {
+            return;
+        }
+    }
+    input.erase(0, start);
+
+    it = clients_.find(key);
+    if (input.size() > config_.maxLineBytes)
+    {
+        auto event       = makeEvent("error", {});
+        event["message"] = "请求过长，连接已关闭";
+        send(key, dumpLine(event));
+        closeClient(key);
+        return;
+    }
+
+    if (eof)
+    {
+        /// 对端关闭写方向：最后一行可以没有换行；连接保留到作业结果发完
+        if (!input.empty())
+        {
+            handleLine(key, input);
+            it = clients_.find(key);
+            if (it == clients_.end())
+            {
+                return;
+            }
+        }
+        it->second.readClosed = true;
+        updateEvents(key, it->second);
+        flushClient(key);
+        return;
+    }
+    it->second.input = std::move(input);
+}
+
+auto JobServer::PImpl::handleLine(uint64_t key, const std::string &line) -> void
+{
+    Request     request;
+    std::string error;
+    if (!parseRequest(line, request, error))
+    {
+        auto event       = makeEvent("error", {});
+        event["message"] = error;
+        send(key, dumpLine(event));
+        return;
+    }
+
+    if (request.op == "submit")
+    {
+        submitJob(key, request);
+    }
+    else if (request.op == "ping")
+    {
+        send(key, dumpLine(makeEvent("pong", request.id)));
+    }
+    else if (request.op == "status")
+    {
+        const auto stats     = scheduler_->getStatistics();
+        auto       event     = makeEvent("status", request.id);
+        event["clients"]     = clients_.size();
+        event["concurrency"] = scheduler_->concurrency();
+        event["queued"]      = stats.queued;
+        event["running"]     = stats.running;
+        event["succeeded"]   = stats.succeeded;
+        event["failed"]      = stats.failed;
+        send(key, dumpLine(event));
+    }
+    else
+    {
+        auto event       = makeEvent("error", request.id);
+        event["message"] = "未知的操作: " + request.op;
+        send(key, dumpLine(event));
+    }
+}
+
+auto JobServer::PImpl::submitJob(uint64_t key, const Request &request) -> void
+{
+    std::string error;
+    if (request.task.empty())
+    {
+        error = "缺少 task";
+    }
+    else if (!taskManager_.hasTaskInstance(request.task))
+    {
+        error = "未知任务: " + request.task;
+    }
+    else if (std::string name; findUnsafeParam(request.params, name))
+    {
+        error = "参数含有不允许的 shell 特殊字符: " + name;
+    }
+    if (!error.empty())
+    {
+        auto event       = makeEvent("error", request.id);
+        event["message"] = error;
+        send(key, dumpLine(event));
+        return;
+    }
+
+    const uint64_t jobId = nextJob_++;
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex_);
+        jobs_[jobId] = { key, request.id };
+    }
+    clients_[key].activeJobs++;
+
+    /// 先回复受理，再提交：started 总在 accepted 之后到达
+    auto event     = makeEvent("accepted", request.id);
+    event["job"]   = jobId;
+    event["task"]  = request.task;
+    event["ahead"] = scheduler_->getStatistics().queued;
+    send(key, dumpLine(event));
+
+    scheduler_->submit(request.task + "#" + std::to_string(jobId),
+                       [this, jobId, task = request.task, params = request.params](std::string &errorMsg)
+                       { return runJob(jobId, task, params, errorMsg); });
+}
+
+auto JobServer::PImpl::runJob(uint64_t jobId, const std::string &task,
+                              const std::map<std::string, std::string> &params, std::string &errorMsg) -> bool
+{
+    uint64_t    client = 0;
+    std::string id;
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex_);
+        auto                       &entry = jobs_.at(jobId);
+        entry.running                     = true;
+        client                            = entry.client;
+        id                                = entry.id;
+    }
+
+    auto started   = makeEvent("started", id);
+    started["job"] = jobId;
+    post(client, dumpLine(started), false);
+
+    /// 本线程中启动的 ffmpeg 进度条带上作业ID，进度推送按此找到对应的连接
+    const auto start = std::chrono::steady_clock::now();
+    ProgressDashboard::setThreadTag(jobId);
+    bool ok = false;
+    try
+    {
+        ok = taskManager_.executeTask(task, params, errorMsg);
+    }
+    catch (const std::exception &e)
+    {
+        errorMsg = e.what();
+    }
+    ProgressDashboard::setThreadTag(0);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex_);
+        jobs_.erase(jobId);
+    }
+
+    auto finished       = makeEvent("finished", id);
+    finished["job"]     = jobId;
+    finished["success"] = ok;
+    finished["seconds"] = round1(seconds);
+    if (!ok)
+    {
+        finished["error"] = errorMsg;
+    }
+    post(client, dumpLine(finished), true);
+
+    std::lock_guard<std::mutex> lock(outputMutex_);
+    std::cout << "[服务] " << (ok ? "✓ " : "✗ ") << task << " #" << jobId << std::fixed << std::setprecision(1)
+              << " (" << seconds << " 秒)";
+    if (!ok)
+    {
+        std::cout << " " << errorMsg;
+    }
+    std::cout << std::endl;
+    return ok;
+}
+
+auto JobServer::PImpl::send(uint64_t key, const std::string &line, bool droppable) -> void
+{
+    auto it = clients_.find(key);
+    if (it == clients_.end())
+    {
+        return;
+    }
+    auto &client = it->second;
+    if (droppable && client.output.size() - client.outputOffset > config_.maxPendingBytes)
+    {
+        return;
+    }
+    client.output += line;
+    flushClient(key);
+}
+
+auto JobServer::PImpl::flushClient(uint64_t key) -> void
+{
+    auto &client = clients_.at(key);
+    while (client.outputOffset < client.output.size())
+    {
+        const ssize_t n = ::send(client.fd, client.output.data() + client.outputOffset,
+                                 client.output.size() - client.outputOffset, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            client.outputOffset += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        closeClient(key);
+        return;
+    }
+
+    if (client.outputOffset == client.output.size())
+    {
+        client.output.clear();
+        client.outputOffset = 0;
+    }
+    else if (client.outputOffset >= COMPACT_MIN)
+    {
+        client.output.erase(0, client.outputOffset);
+        client.outputOffset = 0;
+    }
+
+    const bool pending = !client.output.empty();
+    if (client.readClosed && !pending && client.activeJobs == 0)
+    {
+        closeClient(key);
+        return;
+    }
+    if (pending != client.watchingWrite)
+    {
+        client.watchingWrite = pending;
+        updateEvents(key, client);
+    }
+}
+
+auto JobServer::PImpl::updateEvents(uint64_t key, const Client &client) -> void
+{
+    epoll_event event{};
+    event.events   = (client.readClosed ? 0u : static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP)) |
+            (client.watchingWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    event.data.u64 = key;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, client.fd, &event);
+}
+
+auto JobServer::PImpl::closeClient(uint64_t key) -> void
+{
+    auto it = clients_.find(key);
+    if (it == clients_.end())
+    {
+        return;
+    }
+    ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    ::close(it->second.fd);
+    clients_.erase(it);
+
+    /// 连接断开不取消其作业，结果直接丢弃
+    if (acceptPaused_)
+    {
+        epoll_event event{};
+        event.events   = EPOLLIN;
+        event.data.u64 = LISTEN_KEY;
+        ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, listenFd_, &event);
+        acceptPaused_ = false;
+    }
+}
+
+auto JobServer::PImpl::wake() -> void
+{
+    if (wakeFd_ >= 0)
+    {
+        const uint64_t        one     = 1;
+        [[maybe_unused]] auto written = ::write(wakeFd_, &one, sizeof(one));
+    }
+}
+
+auto JobServer::PImpl::deliverPosted() -> void
+{
+    std::vector<Posted> posted;
+    {
+        std::lock_guard<std::mutex> lock(postedMutex_);
+        posted.swap(posted_);
+    }
+
+    for (auto &message : posted)
+    {
+        auto it = clients_.find(message.client);
+        if (it == clients_.end())
+        {
+            continue;
+        }
+        if (message.final && it->second.activeJobs > 0)
+        {
+            it->second.activeJobs--;
+        }
+        send(message.client, message.line);
+    }
+}
+
+auto JobServer::PImpl::pushProgress() -> void
+{
+    const auto progress = ProgressDashboard::getInstance()->getJobProgress();
+
+    std::vector<std::pair<uint64_t, std::string>> messages;
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex_);
+        for (const auto &job : progress)
+        {
+            auto it = job.tag != 0 ? jobs_.find(job.tag) : jobs_.end();
+            if (it == jobs_.end() || !it->second.running || it->second.progressVersion == job.version)
+            {
+                continue;
+            }
+            it->second.progressVersion = job.version;
+
+            auto event       = makeEvent("progress", it->second.id);
+            event["job"]     = job.tag;
+            event["label"]   = job.label;
+            event["seconds"] = round1(job.seconds);
+            if (job.percent >= 0)
+            {
+                event["percent"] = round1(job.percent);
+                event["total"]   = round1(job.totalSeconds);
+            }
+            if (job.fps >= 0)
+            {
+                event["fps"] = round1(job.fps);
+            }
+            if (job.speed >= 0)
+            {
+                event["speed"] = std::round(job.speed * 100.0) / 100.0;
+            }
+            if (job.totalSize >= 0)
+            {
+                event["bytes"] = job.totalSize;
+            }
+            messages.emplace_back(it->second.client, dumpLine(event));
+        }
+    }
+
+    for (const auto &[client, line] : messages)
+    {
+        send(client, line, true);
+    }
+}
+
+auto JobServer::PImpl::post(uint64_t client, std::string line, bool final) -> void
+{
+    {
+        std::lock_guard<std::mutex> lock(postedMutex_);
+        posted_.push_back({ client, std::move(line), final });
+    }
+    wake();
+}
+#endif
+
+JobServer::JobServer(TaskManager &taskManager) : impl_(std::make_unique<PImpl>(this, taskManager))
+{
+}
+
+JobServer::~JobServer() = default;
+
+auto JobServer::run(const Config &config, std::string &errorMsg) -> bool
+{
+#ifdef __linux__
+    if (config.socketPath.empty())
+    {
+        errorMsg = "缺少套接字路径";
+        return false;
+    }
+    if (config.jobs == 0)
+    {
+        errorMsg = "jobs 必须为正整数";
+        return false;
+    }
+
+    impl_->config_ = config;
+    impl_->stopping_.store(false);
+    if (!impl_->open(errorMsg))
+    {
+        impl_->closeAll();
+        return false;
+    }
+
+    /// 进度经面板的任务邮箱转发给客户端，服务运行期间始终启用面板
+    auto       dashboard    = ProgressDashboard::getInstance();
+    const bool dashboardWas = dashboard->isEnabled();
+    dashboard->setEnabled(true);
+    impl_->scheduler_ = std::make_unique<JobScheduler>(config.jobs);
+
+    struct sigaction action{};
+    struct sigaction previousInt{};
+    struct sigaction previousTerm{};
+    action.sa_handler = onServerStopSignal;
+    sigemptyset(&action.sa_mask);
+    g_activeServer.store(this);
+    sigaction(SIGINT, &action, &previousInt);
+    sigaction(SIGTERM, &action, &previousTerm);
+
+    std::cout << "[服务] 正在监听 " << config.socketPath << "，并发 " << config.jobs << "，按 Ctrl+C 停止"
+              << std::endl;
+    impl_->loop();
+
+    sigaction(SIGINT, &previousInt, nullptr);
+    sigaction(SIGTERM, &previousTerm, nullptr);
+    g_activeServer.store(nullptr);
+
+    /// 运行中的作业做完并尽量把结果发出去，排队的作业丢弃
+    std::cout << "\n[服务] 正在停止，等待运行中的作业..." << std::endl;
+    impl_->scheduler_->shutdown(false);
+    impl_->deliverPosted();
+    dashboard->setEnabled(dashboardWas);
+
+    const auto stats = impl_->scheduler_->getStatistics();
+    std::cout << "[服务] 成功 " << stats.succeeded << "，失败 " << stats.failed << "，未执行 " << stats.cancelled
+              << std::endl;
+    impl_->scheduler_.reset();
+    impl_->closeAll();
+    return true;
+#else
+    errorMsg = "作业服务依赖 epoll 与 Unix 域套接字，当前平台不支持";
+    return false;
+#endif
+}
+
+auto JobServer::stop() -> void
+{
+    impl_->stopping_.store(true);
+#ifdef __linux__
+    impl_->wake();
+#endif
+}
+
+auto JobServer::parseRequest(const std::string &line, Request &request, std::string &errorMsg) -> bool
+{
+    const auto j = nlohmann::json::parse(line, nullptr, false);
+    if (j.is_discarded() || !j.is_object())
+    {
+        errorMsg = "请求不是合法的 JSON 对象";
+        return false;
+    }
+
+    auto text = [](const nlohmann::json &value)
+    { return value.is_string() ? value.get<std::string>() : value.dump(); };
+
+    request = {};
+    try
+    {
+        request.op   = j.value("op", "submit");
+        request.task = j.value("task", "");
+        if (j.contains("id"))
+        {
+            request.id = text(j["id"]);
+        }
+
+        if (j.contains("params"))
+        {
+            if (!j["params"].is_object())
+            {
+                errorMsg = "params 必须是对象";
+                return false;
+            }
+            for (const auto &[key, value] : j["params"].items())
+            {
+                request.params[key] = text(value);
+            }
+        }
+
+        /// 位置参数与 task 命令一致：arg1、arg2 ...
+        if (j.contains("args"))
+        {
+            if (!j["args"].is_array())
+            {
+                errorMsg = "args 必须是数组";
+                return false;
+            }
+            for (size_t i = 0; i < j["args"].size(); ++i)
+            {
+                request.params["arg" + std::to_string(i + 1)] = text(j["args"][i]);
+            }
+        }
+    }
+    catch (const nlohmann::json::exception &e)
+    {
+        errorMsg = std::string("请求字段类型错误: ") + e.what();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,564 @@
+﻿#include "JobTelemetry.h"
+#include "BinaryIO.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <tuple>
+#include <unordered_map>
+
+namespace
+{
+    constexpr char     TELEMETRY_MAGIC[8]  = { 'X', 'J', 'T', 'E', 'L', 'E', 'M', '1' };
+    constexpr auto     TELEMETRY_FILE_NAME = ".job_telemetry";
+    constexpr uint32_t MAX_RECORD_BYTES    = 16u * 1024 * 1024;
+    constexpr size_t   MIN_SAMPLES         = 16;
+
+    /// CSV 字段：整体加双引号，内部双引号写两次（RFC 4180）
+    auto csvField(const std::string &value) -> std::string
+    {
+        std::string quoted = "\"";
+        for (char c : value)
+        {
+            if (c == '"')
+            {
+                quoted += '"';
+            }
+            quoted += c;
+        }
+        quoted += '"';
+        return quoted;
+    }
+
+    /// 中位数（会打乱输入顺序），空输入返回0
+    auto median(std::vector<double> &values) -> double
+    {
+        if (values.empty())
+        {
+            return 0.0;
+        }
+        const auto mid = values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2);
+        std::nth_element(values.begin(), mid, values.end());
+        double result = *mid;
+        if (values.size() % 2 == 0)
+        {
+            result = (result + *std::max_element(values.begin(), mid)) / 2.0;
+        }
+        return result;
+    }
+
+    /// 两个采样合并：速率取平均，累计量取后者
+    auto mergeSamples(const TelemetrySample &a, const TelemetrySample &b) -> TelemetrySample
+    {
+        auto average = [](float x, float y) { return x < 0 ? y : (y < 0 ? x : (x + y) / 2.0f); };
+
+        TelemetrySample merged = b;
+        merged.fps             = average(a.fps, b.fps);
+        merged.speed           = average(a.speed, b.speed);
+        merged.bitrateKbps     = average(a.bitrateKbps, b.bitrateKbps);
+        return merged;
+    }
+
+    auto encode(const TelemetryRun &run) -> std::string
+    {
+        BinaryWriter writer;
+        writer.put(run.startTimeMs);
+        writer.put(run.wallSeconds);
+        writer.put(run.mediaSeconds);
+        writer.put(run.exitCode);
+        writer.put(run.sampleInterval);
+        writer.putString(run.task);
+        writer.putString(run.videoCodec);
+        writer.putString(run.preset);
+        writer.putString(run.resolution);
+        writer.putString(run.source);
+        writer.putString(run.output);
+        writer.put(static_cast<uint32_t>(run.samples.size()));
+        for (const auto &sample : run.samples)
+        {
+            writer.put(sample.elapsed);
+            writer.put(sample.fps);
+            writer.put(sample.speed);
+            writer.put(sample.bitrateKbps);
+            writer.put(sample.outTime);
+            writer.put(sample.totalSize);
+        }
+        return writer.data();
+    }
+
+    auto decode(std::string_view payload, TelemetryRun &run) -> bool
+    {
+        BinaryReader reader(payload);
+        uint32_t     count = 0;
+        if (!reader.get(run.startTimeMs) || !reader.get(run.wallSeconds) || !reader.get(run.mediaSeconds) ||
+            !reader.get(run.exitCode) || !reader.get(run.sampleInterval) || !reader.getString(run.task) ||
+            !reader.getString(run.videoCodec) || !reader.getString(run.preset) || !reader.getString(run.resolution) ||
+            !reader.getString(run.source) || !reader.getString(run.output) || !reader.get(count))
+        {
+            return false;
+        }
+
+        run.samples.resize(count);
+        for (auto &sample : run.samples)
+        {
+            if (!reader.get(sample.elapsed) || !reader.get(sample.fps) || !reader.get(sample.speed) ||
+                !reader.get(sample.bitrateKbps) || !reader.get(sample.outTime) || !reader.get(sample.totalSize))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+} // namespace
+
+auto TelemetryRun::medianSpeed() const -> double
+{
+    std::vector<double> values;
+    values.reserve(samples.size());
+    for (const auto &sample : samples)
+    {
+        if (sample.speed > 0)
+        {
+            values.push_back(sample.speed);
+        }
+    }
+    if (values.empty())
+    {
+        return wallSeconds > 0 ? mediaSeconds / wallSeconds : 0.0;
+    }
+    return median(values);
+}
+
+auto TelemetryRun::medianFps() const -> double
+{
+    std::vector<double> values;
+    values.reserve(samples.size());
+    for (const auto &sample : samples)
+    {
+        if (sample.fps > 0)
+        {
+            values.push_back(sample.fps);
+        }
+    }
+    return median(values);
+}
+
+class JobTelemetry::PImpl
+{
+public:
+    /// 正在记录的任务
+    struct ActiveJob
+    {
+        Profile                               profile;
+        int64_t                               startTimeMs = 0;
+        std::chrono::steady_clock::time_point start;
+        float                                 interval = 1.0f;
+        float                                 nextAt   = 0.0f;
+        std::vector<TelemetrySample>          samples;
+    };
+
+    PImpl(JobTelemetry *owner);
+    ~PImpl() = default;
+
+public:
+    auto filePath() const -> fs::path;
+
+    auto append(const TelemetryRun &run) -> void;
+
+public:
+    JobTelemetry                           *owner_ = nullptr;
+    mutable std::mutex                      mutex_;
+    fs::path                                storageDir_;
+    bool                                    enabled_    = true;
+    double                                  interval_   = 1.0;
+    size_t                                  maxSamples_ = 512;
+    uint64_t                                nextId_     = 1;
+    std::unordered_map<uint64_t, ActiveJob> jobs_;
+};
+
+JobTelemetry::PImpl::PImpl(JobTelemetry *owner) : owner_(owner)
+{
+}
+
+auto JobTelemetry::PImpl::filePath() const -> fs::path
+{
+    return storageDir_ / TELEMETRY_FILE_NAME;
+}
+
+auto JobTelemetry::PImpl::append(const TelemetryRun &run) -> void
+{
+    std::error_code ec;
+    if (!storageDir_.empty() && !fs::exists(storageDir_, ec))
+    {
+        fs::create_directories(storageDir_, ec);
+    }
+
+    auto path    = filePath();
+    bool newFile = !fs::exists(path, ec) || fs::file_size(path, ec) < sizeof(TELEMETRY_MAGIC);
+
+    /// 文件头不对（其他程序的文件或已损坏）时改名留存，另起新文件，不往别人的文件里追加
+    if (!newFile)
+    {
+        char          magic[sizeof(TELEMETRY_MAGIC)] = {};
+        std::ifstream existing(path, std::ios::binary);
+        if (!existing.read(magic, sizeof(magic)) || std::memcmp(magic, TELEMETRY_MAGIC, sizeof(magic)) != 0)
+        {
+            existing.close();
+            auto rotated = path;
+            rotated += ".bad";
+            fs::rename(path, rotated, ec);
+            if (ec)
+            {
+                return;
+            }
+            newFile = true;
+        }
+    }
+    auto openMode = std::ios::binary | (newFile ? std::ios::trunc : std::ios::app);
+
+    std::ofstream file(path, openMode);
+    if (!file.is_open())
+    {
+        return; /// 记录文件不可写时静默丢弃，不影响任务本身
+    }
+    if (newFile)
+    {
+        file.write(TELEMETRY_MAGIC, sizeof(TELEMETRY_MAGIC));
+    }
+
+    /// 长度前缀与记录体一次写出，崩溃时最多留下一条不完整的尾记录
+    const std::string payload = encode(run);
+    const auto        len     = static_cast<uint32_t>(payload.size());
+    std::string       buffer(reinterpret_cast<const char *>(&len), sizeof(len));
+    buffer += payload;
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+JobTelemetry::JobTelemetry() : impl_(std::make_unique<PImpl>(this))
+{
+}
+
+JobTelemetry::~JobTelemetry() = default;
+
+auto JobTelemetry::setStorageDirectory(const fs::path &dir) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->storageDir_ = dir;
+}
+
+auto JobTelemetry::storageDirectory() const -> fs::path
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->storageDir_;
+}
+
+auto JobTelemetry::setEnabled(bool enabled) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->enabled_ = enabled;
+}
+
+auto JobTelemetry::isEnabled() const -> bool
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->enabled_;
+}
+
+auto JobTelemetry::setSampleInterval(double seconds) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->interval_ = std::max(0.1, seconds);
+}
+
+auto JobTelemetry::sampleInterval() const -> double
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->interval_;
+}
+
+auto JobTelemetry::setMaxSamples(size_t count) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->maxSamples_ = std::max(MIN_SAMPLES, count);
+}
+
+auto JobTelemetry::beginJob(const Profile &profile) -> uint64_t
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    if (!impl_->enabled_)
+    {
+        return 0;
+    }
+
+    const auto     sinceEpoch = std::chrono::system_clock::now().time_since_epoch();
+    const uint64_t id         = impl_->nextId_++;
+    auto          &job        = impl_->jobs_[id];
+    job.profile        = profile;
+    job.start          = std::chrono::steady_clock::now();
+    job.startTimeMs    = std::chrono::duration_cast<std::chrono::milliseconds>(sinceEpoch).count();
+    job.interval       = static_cast<float>(impl_->interval_);
+    job.samples.reserve(impl_->maxSamples_);
+    return id;
+}
+
+auto JobTelemetry::record(uint64_t id, const ProgressSnapshot &snapshot) -> void
+{
+    if (id == 0)
+    {
+        return;
+    }
+
+    const auto                  now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    auto                        it = impl_->jobs_.find(id);
+    if (it == impl_->jobs_.end())
+    {
+        return;
+    }
+
+    auto       &job     = it->second;
+    const float elapsed = std::chrono::duration<float>(now - job.start).count();
+    if (elapsed < job.nextAt && !snapshot.ended)
+    {
+        return;
+    }
+
+    TelemetrySample sample;
+    sample.elapsed     = elapsed;
+    sample.fps         = static_cast<float>(snapshot.fps);
+    sample.speed       = static_cast<float>(snapshot.speed);
+    sample.bitrateKbps = static_cast<float>(snapshot.bitrateKbps);
+    sample.outTime     = snapshot.outTimeUs > 0 ? static_cast<float>(snapshot.outTimeSeconds()) : 0.0f;
+    sample.totalSize   = snapshot.totalSize > 0 ? static_cast<uint64_t>(snapshot.totalSize) : 0;
+    job.samples.push_back(sample);
+    job.nextAt = elapsed + job.interval;
+
+    /// 达到上限：相邻两点合并，间隔加倍
+    if (job.samples.size() >= impl_->maxSamples_)
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i + 1 < job.samples.size(); i += 2)
+        {
+            job.samples[kept++] = mergeSamples(job.samples[i], job.samples[i + 1]);
+        }
+        if (job.samples.size() % 2 != 0)
+        {
+            job.samples[kept++] = job.samples.back();
+        }
+        job.samples.resize(kept);
+        job.interval *= 2.0f;
+    }
+}
+
+auto JobTelemetry::finishJob(uint64_t id, int exitCode) -> void
+{
+    if (id == 0)
+    {
+        return;
+    }
+
+    const auto                  now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    auto                        node = impl_->jobs_.extract(id);
+    if (node.empty())
+    {
+        return;
+    }
+
+    auto        &job = node.mapped();
+    TelemetryRun run;
+    run.startTimeMs    = job.startTimeMs;
+    run.wallSeconds    = std::chrono::duration<double>(now - job.start).count();
+    run.mediaSeconds   = job.profile.mediaSeconds;
+    run.exitCode       = exitCode;
+    run.sampleInterval = job.interval;
+    run.task           = std::move(job.profile.task);
+    run.videoCodec     = std::move(job.profile.videoCodec);
+    run.preset         = std::move(job.profile.preset);
+    run.resolution     = std::move(job.profile.resolution);
+    run.source         = std::move(job.profile.source);
+    run.output         = std::move(job.profile.output);
+    run.samples        = std::move(job.samples);
+    impl_->append(run);
+}
+
+auto JobTelemetry::loadRuns(std::vector<TelemetryRun> &runs, std::string &errorMsg) const -> bool
+{
+    runs.clear();
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    std::ifstream               file(impl_->filePath(), std::ios::binary);
+    if (!file.is_open())
+    {
+        return true; /// 还没有任何记录
+    }
+
+    char magic[sizeof(TELEMETRY_MAGIC)] = {};
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, TELEMETRY_MAGIC, sizeof(magic)) != 0)
+    {
+        errorMsg = "遥测记录文件格式不兼容: " + impl_->filePath().string();
+        return false;
+    }
+
+    std::string payload;
+    while (true)
+    {
+        uint32_t len = 0;
+        if (!file.read(reinterpret_cast<char *>(&len), sizeof(len)) || len > MAX_RECORD_BYTES)
+        {
+            break;
+        }
+        payload.resize(len);
+        if (!file.read(payload.data(), len))
+        {
+            break; /// 末尾记录不完整（写入时崩溃）
+        }
+
+        TelemetryRun run;
+        if (decode(payload, run))
+        {
+            runs.push_back(std::move(run));
+        }
+    }
+    return true;
+}
+
+auto JobTelemetry::clear() -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    std::error_code             ec;
+    fs::remove(impl_->filePath(), ec);
+}
+
+auto JobTelemetry::summarize(const std::vector<TelemetryRun> &runs) -> std::vector<GroupStats>
+{
+    struct Accumulator
+    {
+        std::vector<double> speeds;
+        std::vector<double> fps;
+        std::vector<double> walls;
+        size_t              failed = 0;
+    };
+
+    using GroupKey = std::tuple<std::string, std::string, std::string, std::string>;
+    std::map<GroupKey, Accumulator> accumulators;
+    for (const auto &run : runs)
+    {
+        auto &acc = accumulators[{ run.task, run.videoCodec, run.preset, run.resolution }];
+        if (run.exitCode != 0)
+        {
+            acc.failed++;
+            continue;
+        }
+        acc.speeds.push_back(run.medianSpeed());
+        acc.walls.push_back(run.wallSeconds);
+        if (const double fps = run.medianFps(); fps > 0)
+        {
+            acc.fps.push_back(fps);
+        }
+    }
+
+    std::vector<GroupStats>       groups;
+    std::map<std::string, double> fastest;
+    for (auto &[key, acc] : accumulators)
+    {
+        GroupStats group;
+        std::tie(group.task, group.videoCodec, group.preset, group.resolution) = key;
+        group.runs        = acc.speeds.size();
+        group.failed      = acc.failed;
+        group.medianSpeed = median(acc.speeds);
+        group.medianFps   = median(acc.fps);
+        group.medianWall  = median(acc.walls);
+
+        fastest[group.task] = std::max(fastest[group.task], group.medianSpeed);
+        groups.push_back(std::move(group));
+    }
+
+    for (auto &group : groups)
+    {
+        const double best = fastest[group.task];
+        group.relative    = best > 0 ? group.medianSpeed / best : 0.0;
+    }
+
+    /// 同一任务内按速度从快到慢
+    std::ranges::stable_sort(groups,
+                             [](const GroupStats &a, const GroupStats &b)
+                             { return a.task != b.task ? a.task < b.task : a.medianSpeed > b.medianSpeed; });
+    return groups;
+}
+
+auto JobTelemetry::formatSummary(const std::vector<GroupStats> &groups) -> std::string
+{
+    std::stringstream ss;
+    if (groups.empty())
+    {
+        ss << "暂无任务遥测记录\n";
+        return ss.str();
+    }
+
+    ss << std::left << std::setw(10) << "task" << std::setw(14) << "codec" << std::setw(12) << "preset"
+       << std::setw(12) << "resolution" << std::right << std::setw(6) << "runs" << std::setw(6) << "fail"
+       << std::setw(10) << "speed" << std::setw(10) << "fps" << std::setw(10) << "wall(s)" << std::setw(8) << "rel"
+       << "\n";
+    for (const auto &group : groups)
+    {
+        ss << std::left << std::setw(10) << group.task << std::setw(14) << group.videoCodec << std::setw(12)
+           << group.preset << std::setw(12) << group.resolution << std::right << std::setw(6) << group.runs
+           << std::setw(6) << group.failed << std::fixed << std::setprecision(2) << std::setw(9) << group.medianSpeed
+           << "x" << std::setprecision(1) << std::setw(10) << group.medianFps << std::setw(10) << group.medianWall
+           << std::setprecision(0) << std::setw(7) << group.relative * 100.0 << "%" << "\n";
+    }
+    ss << "（speed/fps/wall 为中位数；rel 为相对同任务最快配置的速度）\n";
+    return ss.str();
+}
+
+auto JobTelemetry::exportCsv(const std::vector<TelemetryRun> &runs, const std::string &path, std::string &errorMsg)
+        -> bool
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open())
+    {
+        errorMsg = "无法创建CSV文件: " + path;
+        return false;
+    }
+
+    auto optional = [&file](float value)
+    {
+        if (value >= 0)
+        {
+            file << value;
+        }
+    };
+
+    file << std::fixed << std::setprecision(3);
+    file << "run,start_ms,task,codec,preset,resolution,source,exit_code,elapsed,fps,speed,bitrate_kbps,out_time,"
+            "total_size\n";
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        const auto &run = runs[i];
+        for (const auto &sample : run.samples)
+        {
+            file << i << ',' << run.startTimeMs << ',' << csvField(run.task) << ',' << csvField(run.videoCodec) << ','
+                 << csvField(run.preset) << ',' << csvField(run.resolution) << ',' << csvField(run.source) << ','
+                 << run.exitCode << ',' << sample.elapsed << ',';
+            optional(sample.fps);
+            file << ',';
+            optional(sample.speed);
+            file << ',';
+            optional(sample.bitrateKbps);
+            file << ',' << sample.outTime << ',' << sample.totalSize << '\n';
+        }
+    }
+
+    if (!file)
+    {
+        errorMsg = "写入CSV文件失败: " + path;
+        return false;
+    }
+    return true;
+}
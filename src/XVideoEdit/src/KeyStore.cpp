@@ -0,0 +1,787 @@
+﻿#include "KeyStore.h"
+#include "AesEngine.h"
+#include "BinaryIO.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr char     STORE_MAGIC[8]   = { 'X', 'K', 'E', 'Y', 'S', 'T', 'R', '1' };
+    constexpr uint8_t  FLAG_DERIVED     = 0x01;
+    constexpr uint32_t MAX_RECORD_BYTES = 64 * 1024;
+    constexpr size_t   KID_BYTES        = 16;
+    constexpr auto     HKDF_SALT        = "XVideoEdit/KeyStore/v1";
+    constexpr auto     HKDF_INFO_PREFIX = "xve-asset:";
+    constexpr auto     MASTER_KEY_ENV   = "XVE_MASTER_KEY";
+
+    auto crc32(const uint8_t *data, size_t size) -> uint32_t
+    {
+        static const auto table = []
+        {
+            std::array<uint32_t, 256> t{};
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k)
+                {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                t[i] = c;
+            }
+            return t;
+        }();
+
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; ++i)
+        {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    /// SHA-256（FIPS 180-4），仅用于 HMAC / HKDF
+    class Sha256
+    {
+    public:
+        static constexpr size_t DIGEST_SIZE = 32;
+        static constexpr size_t BLOCK_SIZE  = 64;
+
+        using Digest = std::array<uint8_t, DIGEST_SIZE>;
+
+        auto update(const uint8_t *data, size_t size) -> void
+        {
+            totalBytes_ += size;
+            while (size > 0)
+            {
+                size_t take = std::min(size, BLOCK_SIZE - bufferLen_);
+                std::memcpy(buffer_ + bufferLen_, data, take);
+                bufferLen_ += take;
+                data += take;
+                size -= take;
+                if (bufferLen_ == BLOCK_SIZE)
+                {
+                    compress(buffer_);
+                    bufferLen_ = 0;
+                }
+            }
+        }
+
+        auto update(const std::string_view &data) -> void
+        {
+            update(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+        }
+
+        auto finish() -> Digest
+        {
+            uint64_t bits = totalBytes_ * 8;
+            uint8_t  pad  = 0x80;
+            update(&pad, 1);
+            pad = 0;
+            while (bufferLen_ != BLOCK_SIZE - 8)
+            {
+                update(&pad, 1);
+            }
+            uint8_t length[8];
+            for (int i = 0; i < 8; ++i)
+            {
+                length[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+            }
+            update(length, sizeof(length));
+
+            Digest digest;
+            for (int i = 0; i < 8; ++i)
+            {
+                for (int j = 0; j < 4; ++j)
+                {
+                    digest[4 * i + j] = static_cast<uint8_t>(state_[i] >> (24 - 8 * j));
+                }
+            }
+            return digest;
+        }
+
+    private:
+        auto compress(const uint8_t *block) -> void
+        {
+            static constexpr uint32_t k[64] = {
+                0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+            };
+
+            uint32_t w[64];
+            for (int i = 0; i < 16; ++i)
+            {
+                w[i] = (uint32_t{ block[4 * i] } << 24) | (uint32_t{ block[4 * i + 1] } << 16) |
+                        (uint32_t{ block[4 * i + 2] } << 8) | uint32_t{ block[4 * i + 3] };
+            }
+            for (int i = 16; i < 64; ++i)
+            {
+                uint32_t s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                uint32_t s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i]        = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+            uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+            for (int i = 0; i < 64; ++i)
+            {
+                uint32_t s1    = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+                uint32_t ch    = (e & f) ^ (~e & g);
+                uint32_t temp1 = h + s1 + ch + k[i] + w[i];
+                uint32_t s0    = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+                uint32_t maj   = (a & b) ^ (a & c) ^ (b & c);
+                uint32_t temp2 = s0 + maj;
+
+                h = g;
+                g = f;
+                f = e;
+                e = d + temp1;
+                d = c;
+                c = b;
+                b = a;
+                a = temp1 + temp2;
+            }
+
+            state_[0] += a;
+            state_[1] += b;
+            state_[2] += c;
+            state_[3] += d;
+            state_[4] += e;
+            state_[5] += f;
+            state_[6] += g;
+            state_[7] += h;
+        }
+
+    private:
+        uint32_t state_[8]           = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+        uint8_t  buffer_[BLOCK_SIZE] = {};
+        size_t   bufferLen_          = 0;
+        uint64_t totalBytes_         = 0;
+    };
+
+    auto hmacSha256(const std::vector<uint8_t> &key, const std::string_view &message) -> Sha256::Digest
+    {
+        uint8_t block[Sha256::BLOCK_SIZE] = {};
+        if (key.size() > Sha256::BLOCK_SIZE)
+        {
+            Sha256 hasher;
+            hasher.update(key.data(), key.size());
+            auto digest = hasher.finish();
+            std::memcpy(block, digest.data(), digest.size());
+        }
+        else
+        {
+            std::memcpy(block, key.data(), key.size());
+        }
+
+        uint8_t innerPad[Sha256::BLOCK_SIZE], outerPad[Sha256::BLOCK_SIZE];
+        for (size_t i = 0; i < Sha256::BLOCK_SIZE; ++i)
+        {
+            innerPad[i] = block[i] ^ 0x36;
+            outerPad[i] = block[i] ^ 0x5c;
+        }
+
+        Sha256 inner;
+        inner.update(innerPad, sizeof(innerPad));
+        inner.update(message);
+        auto innerDigest = inner.finish();
+
+        Sha256 outer;
+        outer.update(outerPad, sizeof(outerPad));
+        outer.update(innerDigest.data(), innerDigest.size());
+        return outer.finish();
+    }
+
+    /// HKDF-SHA256（RFC 5869）
+    auto hkdf(const std::vector<uint8_t> &ikm, const std::string_view &salt, const std::string_view &info,
+              size_t length) -> std::vector<uint8_t>
+    {
+        auto                 prkDigest = hmacSha256(std::vector<uint8_t>(salt.begin(), salt.end()),
+                                                    std::string_view(reinterpret_cast<const char *>(ikm.data()), ikm.size()));
+        std::vector<uint8_t> prk(prkDigest.begin(), prkDigest.end());
+
+        std::vector<uint8_t> okm;
+        std::string          previous;
+        for (uint8_t counter = 1; okm.size() < length; ++counter)
+        {
+            std::string message = previous;
+            message.append(info);
+            message.push_back(static_cast<char>(counter));
+            auto block = hmacSha256(prk, message);
+            previous.assign(reinterpret_cast<const char *>(block.data()), block.size());
+            okm.insert(okm.end(), block.begin(), block.end());
+        }
+        okm.resize(length);
+        return okm;
+    }
+
+    auto toHex(std::string_view bytes) -> std::string
+    {
+        return AesEngine::toHex(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+    }
+
+    auto encode(const KeyStore::Entry &entry) -> std::string
+    {
+        std::vector<uint8_t> kid, key, iv;
+        AesEngine::fromHex(entry.kid, kid);
+        AesEngine::fromHex(entry.key, key);
+        AesEngine::fromHex(entry.iv, iv);
+        kid.resize(KID_BYTES);
+
+        BinaryWriter writer;
+        writer.put<uint8_t>(entry.derived ? FLAG_DERIVED : 0);
+        writer.put<int64_t>(entry.createdAt);
+        writer.putBytes(kid);
+        writer.putString(entry.assetId);
+        writer.putString(entry.method);
+        writer.putBytes(entry.derived ? std::vector<uint8_t>{} : key);
+        writer.putBytes(iv);
+        return writer.data();
+    }
+
+    auto decode(std::string_view payload, KeyStore::Entry &entry) -> bool
+    {
+        BinaryReader     reader(payload);
+        uint8_t          flags = 0;
+        std::string_view kid, key, iv;
+        if (!reader.get(flags) || !reader.get(entry.createdAt) || !reader.getBytes(kid) ||
+            !reader.getString(entry.assetId) || !reader.getString(entry.method) || !reader.getBytes(key) ||
+            !reader.getBytes(iv))
+        {
+            return false;
+        }
+        entry.kid     = toHex(kid);
+        entry.key     = toHex(key);
+        entry.iv      = toHex(iv);
+        entry.derived = (flags & FLAG_DERIVED) != 0;
+        return true;
+    }
+
+    /// 建索引时只解析 KID 与资源ID
+    auto decodeIndexFields(std::string_view payload, std::string &kid, std::string &assetId) -> bool
+    {
+        BinaryReader     reader(payload);
+        uint8_t          flags     = 0;
+        int64_t          createdAt = 0;
+        std::string_view kidBytes;
+        if (!reader.get(flags) || !reader.get(createdAt) || !reader.getBytes(kidBytes) || !reader.getString(assetId))
+        {
+            return false;
+        }
+        kid = toHex(kidBytes);
+        return true;
+    }
+
+    auto seekFile(std::FILE *file, uint64_t offset) -> bool
+    {
+#ifdef _WIN32
+        return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+        return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+    }
+
+    /// 定位到文件末尾并返回实际偏移（其他进程也可能追加过记录）
+    auto seekEnd(std::FILE *file, uint64_t &offset) -> bool
+    {
+#ifdef _WIN32
+        if (_fseeki64(file, 0, SEEK_END) != 0)
+        {
+            return false;
+        }
+        const auto pos = _ftelli64(file);
+#else
+        if (fseeko(file, 0, SEEK_END) != 0)
+        {
+            return false;
+        }
+        const auto pos = ftello(file);
+#endif
+        if (pos < 0)
+        {
+            return false;
+        }
+        offset = static_cast<uint64_t>(pos);
+        return true;
+    }
+
+    auto syncFile(std::FILE *file) -> bool
+    {
+        if (std::fflush(file) != 0)
+        {
+            return false;
+        }
+#ifdef _WIN32
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+
+    /// 密钥库保存明文密钥：以追加 + 读方式打开，不存在时以 0600 创建，已存在的文件同样收紧为 0600
+    auto openPrivate(const std::string &path) -> std::FILE *
+    {
+#ifdef _WIN32
+        return std::fopen(path.c_str(), "a+b");
+#else
+        const int fd = ::open(path.c_str(), O_CREAT | O_RDWR | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        std::FILE *file = ::fchmod(fd, S_IRUSR | S_IWUSR) == 0 ? ::fdopen(fd, "a+b") : nullptr;
+        if (!file)
+        {
+            ::close(fd);
+        }
+        return file;
+#endif
+    }
+} // namespace
+
+class KeyStore::PImpl
+{
+public:
+    PImpl(KeyStore *owner);
+    ~PImpl() = default;
+
+public:
+    /// 扫描记录建立索引，返回最后一条完整记录之后的偏移
+    auto loadIndex(std::string &errorMsg) -> uint64_t;
+
+    auto readEntry(uint64_t offset, Entry &entry) const -> bool;
+
+    auto syncLocked(std::string &errorMsg) -> bool;
+
+    /// 后台落盘：最早未落盘的记录等待超过 maxDelay 时 fsync，不依赖下一次 put
+    auto flushLoop() -> void;
+
+public:
+    KeyStore                                 *owner_ = nullptr;
+    mutable std::mutex                        mutex_;
+    std::string                               path_;
+    std::FILE                                *file_ = nullptr;
+    uint64_t                                  end_  = 0;
+    SyncPolicy                                policy_;
+    size_t                                    pending_ = 0; ///< 已写入但未 fsync 的记录数
+    std::chrono::steady_clock::time_point     firstPending_;
+    std::condition_variable                   pendingCv_;
+    std::thread                               flusher_;
+    bool                                      stopping_ = false;
+    std::unordered_map<std::string, uint64_t> byAsset_;
+    std::unordered_map<std::string, uint64_t> byKid_;
+};
+
+KeyStore::PImpl::PImpl(KeyStore *owner) : owner_(owner)
+{
+}
+
+auto KeyStore::PImpl::loadIndex(std::string &errorMsg) -> uint64_t
+{
+    byAsset_.clear();
+    byKid_.clear();
+
+    MappedFile mapped;
+    if (!mapped.openRead(path_, errorMsg))
+    {
+        return 0;
+    }
+    mapped.advise(MappedFile::Advice::Sequential);
+
+    const auto *data = mapped.data();
+    size_t      size = mapped.size();
+    if (size < sizeof(STORE_MAGIC) || std::memcmp(data, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0)
+    {
+        errorMsg = "不是有效的密钥库文件: " + path_;
+        return 0;
+    }
+
+    /// 记录体在查找时再读取
+    uint64_t offset = sizeof(STORE_MAGIC);
+    while (offset + 2 * sizeof(uint32_t) <= size)
+    {
+        uint32_t len = 0, crc = 0;
+        std::memcpy(&len, data + offset, sizeof(len));
+        std::memcpy(&crc, data + offset + sizeof(len), sizeof(crc));
+        const uint8_t *payload = data + offset + 2 * sizeof(uint32_t);
+        if (len > MAX_RECORD_BYTES || offset + 2 * sizeof(uint32_t) + len > size || crc32(payload, len) != crc)
+        {
+            break; /// 末尾记录不完整（写入时掉电）
+        }
+
+        std::string kid, assetId;
+        if (decodeIndexFields(std::string_view(reinterpret_cast<const char *>(payload), len), kid, assetId))
+        {
+            byAsset_[std::move(assetId)] = offset;
+            byKid_[std::move(kid)]       = offset;
+        }
+        offset += 2 * sizeof(uint32_t) + len;
+    }
+
+    if (offset < size)
+    {
+        std::cout << "警告: 密钥库末尾有 " << size - offset << " 字节不完整记录，已截断: " << path_ << std::endl;
+        mapped.close();
+        std::error_code ec;
+        fs::resize_file(path_, offset, ec);
+    }
+    return offset;
+}
+
+auto KeyStore::PImpl::readEntry(uint64_t offset, Entry &entry) const -> bool
+{
+    uint32_t header[2] = {};
+    if (!seekFile(file_, offset) || std::fread(header, sizeof(header), 1, file_) != 1 || header[0] > MAX_RECORD_BYTES)
+    {
+        return false;
+    }
+    std::string payload(header[0], '\0');
+    if (std::fread(payload.data(), 1, payload.size(), file_) != payload.size())
+    {
+        return false;
+    }
+    return decode(payload, entry);
+}
+
+auto KeyStore::PImpl::syncLocked(std::string &errorMsg) -> bool
+{
+    if (!file_ || pending_ == 0)
+    {
+        return true;
+    }
+    if (!syncFile(file_))
+    {
+        errorMsg = "密钥库落盘失败: " + path_;
+        return false;
+    }
+    pending_ = 0;
+    return true;
+}
+
+auto KeyStore::PImpl::flushLoop() -> void
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_)
+    {
+        if (pending_ == 0)
+        {
+            pendingCv_.wait(lock, [this] { return stopping_ || pending_ > 0; });
+            continue;
+        }
+
+        const auto deadline = firstPending_ + policy_.maxDelay;
+        if (pendingCv_.wait_until(lock, deadline, [this] { return stopping_ || pending_ == 0; }))
+        {
+            continue;
+        }
+
+        std::string errorMsg;
+        if (!syncLocked(errorMsg))
+        {
+            std::cerr << "警告: " << errorMsg << std::endl;
+            firstPending_ = std::chrono::steady_clock::now(); /// 下一个周期重试
+        }
+    }
+}
+
+KeyStore::KeyStore()
+{
+    impl_ = std::make_unique<KeyStore::PImpl>(this);
+}
+
+KeyStore::~KeyStore()
+{
+    close();
+}
+
+auto KeyStore::open(const std::string &path, std::string &errorMsg) -> bool
+{
+    close();
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->path_ = path;
+
+    /// 追加模式：写入总是落在文件末尾，读取可任意定位
+    std::FILE *file = openPrivate(path);
+    if (!file)
+    {
+        errorMsg = "无法打开密钥库: " + path;
+        return false;
+    }
+
+    uint64_t size = 0;
+    if (!seekEnd(file, size) ||
+        (size == 0 && (std::fwrite(STORE_MAGIC, sizeof(STORE_MAGIC), 1, file) != 1 || !syncFile(file))))
+    {
+        std::fclose(file);
+        errorMsg = "写入密钥库文件头失败: " + path;
+        return false;
+    }
+
+    impl_->end_ = impl_->loadIndex(errorMsg);
+    if (impl_->end_ == 0)
+    {
+        std::fclose(file);
+        return false;
+    }
+    impl_->file_     = file;
+    impl_->pending_  = 0;
+    impl_->stopping_ = false;
+    impl_->flusher_  = std::thread([this] { impl_->flushLoop(); });
+    return true;
+}
+
+auto KeyStore::close() -> void
+{
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        impl_->stopping_ = true;
+    }
+    impl_->pendingCv_.notify_all();
+    if (impl_->flusher_.joinable())
+    {
+        impl_->flusher_.join();
+    }
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    if (!impl_->file_)
+    {
+        return;
+    }
+
+    std::string errorMsg;
+    if (!impl_->syncLocked(errorMsg))
+    {
+        std::cerr << "警告: " << errorMsg << std::endl;
+    }
+    std::fclose(impl_->file_);
+    impl_->file_ = nullptr;
+    impl_->byAsset_.clear();
+    impl_->byKid_.clear();
+}
+
+auto KeyStore::isOpen() const -> bool
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->file_ != nullptr;
+}
+
+auto KeyStore::path() const -> std::string
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->path_;
+}
+
+auto KeyStore::setSyncPolicy(const SyncPolicy &policy) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->policy_ = policy;
+}
+
+auto KeyStore::put(const Entry &entry, std::string &errorMsg) -> bool
+{
+    if (entry.assetId.empty())
+    {
+        errorMsg = "密钥记录缺少资源ID";
+        return false;
+    }
+
+    Entry record = entry;
+    if (record.createdAt == 0)
+    {
+        record.createdAt = std::chrono::duration_cast<std::chrono::seconds>(
+                                   std::chrono::system_clock::now().time_since_epoch())
+                                   .count();
+    }
+
+    std::string payload = encode(record);
+    uint32_t    header[2] = { static_cast<uint32_t>(payload.size()),
+                              crc32(reinterpret_cast<const uint8_t *>(payload.data()), payload.size()) };
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    if (!impl_->file_)
+    {
+        errorMsg = "密钥库未打开";
+        return false;
+    }
+
+    /// 记录偏移取自文件的实际末尾；a+ 模式下 fwrite 同样落在这里
+    uint64_t offset = 0;
+    if (!seekEnd(impl_->file_, offset))
+    {
+        errorMsg = "定位密钥库末尾失败: " + impl_->path_;
+        return false;
+    }
+
+    /// 记录整体写入后立即 fflush，进程崩溃不会丢失；掉电保护依赖批量 fsync
+    if (std::fwrite(header, sizeof(header), 1, impl_->file_) != 1 ||
+        std::fwrite(payload.data(), 1, payload.size(), impl_->file_) != payload.size() ||
+        std::fflush(impl_->file_) != 0)
+    {
+        errorMsg = "写入密钥库失败: " + impl_->path_;
+        return false;
+    }
+
+    /// 索引中保存规范化后的 KID（与读取时 toHex 的结果一致）
+    Entry stored;
+    decode(payload, stored);
+    impl_->byAsset_[stored.assetId] = offset;
+    impl_->byKid_[stored.kid]       = offset;
+    impl_->end_                     = offset + sizeof(header) + payload.size();
+
+    auto now = std::chrono::steady_clock::now();
+    if (impl_->pending_++ == 0)
+    {
+        impl_->firstPending_ = now;
+        impl_->pendingCv_.notify_one();
+    }
+    if (impl_->pending_ >= impl_->policy_.batchRecords || now - impl_->firstPending_ >= impl_->policy_.maxDelay)
+    {
+        return impl_->syncLocked(errorMsg);
+    }
+    return true;
+}
+
+auto KeyStore::find(const std::string &assetId, Entry &entry) const -> bool
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    auto                        it = impl_->byAsset_.find(assetId);
+    if (!impl_->file_ || it == impl_->byAsset_.end())
+    {
+        return false;
+    }
+
+    /// 偏移失效（文件被外部改写）时宁可找不到，也不能返回其他资源的密钥
+    Entry record;
+    if (!impl_->readEntry(it->second, record) || record.assetId != assetId)
+    {
+        return false;
+    }
+    entry = std::move(record);
+    return true;
+}
+
+auto KeyStore::findByKid(const std::string &kid, Entry &entry) const -> bool
+{
+    std::string normalized = kid;
+    std::ranges::transform(normalized, normalized.begin(), ::tolower);
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    auto                        it = impl_->byKid_.find(normalized);
+    if (!impl_->file_ || it == impl_->byKid_.end())
+    {
+        return false;
+    }
+
+    Entry record;
+    if (!impl_->readEntry(it->second, record) || record.kid != normalized)
+    {
+        return false;
+    }
+    entry = std::move(record);
+    return true;
+}
+
+auto KeyStore::sync(std::string &errorMsg) -> bool
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->syncLocked(errorMsg);
+}
+
+auto KeyStore::size() const -> size_t
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->byAsset_.size();
+}
+
+auto KeyStore::shared(const std::string &path, std::string &errorMsg) -> std::shared_ptr<KeyStore>
+{
+    static std::mutex                                       registryMutex;
+    static std::map<std::string, std::shared_ptr<KeyStore>> registry;
+
+    std::string                 id = assetIdFor(path);
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (auto it = registry.find(id); it != registry.end())
+    {
+        return it->second;
+    }
+
+    auto store = std::make_shared<KeyStore>();
+    if (!store->open(path, errorMsg))
+    {
+        return nullptr;
+    }
+    registry.emplace(id, store);
+    return store;
+}
+
+auto KeyStore::assetIdFor(const std::string &file) -> std::string
+{
+    std::error_code ec;
+    fs::path        canonical = fs::weakly_canonical(fs::absolute(file, ec), ec);
+    if (ec)
+    {
+        return fs::path(file).lexically_normal().generic_string();
+    }
+    return canonical.generic_string();
+}
+
+auto KeyStore::derive(const std::vector<uint8_t> &masterKey, const std::string &assetId, size_t keyBytes,
+                      std::string &key, std::string &kid) -> void
+{
+    /// 一次扩展得到 密钥 | 保留16字节 | KID，保留段是早期派生 IV 的位置，跳过它使已有的密钥与 KID 不变
+    auto okm = hkdf(masterKey, HKDF_SALT, std::string(HKDF_INFO_PREFIX) + assetId, keyBytes + 16 + KID_BYTES);
+    key      = AesEngine::toHex(okm.data(), keyBytes);
+    kid      = AesEngine::toHex(okm.data() + keyBytes + 16, KID_BYTES);
+}
+
+auto KeyStore::loadMasterKey(const std::string &value, std::vector<uint8_t> &masterKey, std::string &errorMsg)
+        -> bool
+{
+    std::string hex = value;
+    if (hex.empty())
+    {
+        const char *env = std::getenv(MASTER_KEY_ENV);
+        if (!env || !*env)
+        {
+            errorMsg = std::string("未提供主密钥: 请使用 --master-key <hex> 或设置环境变量 ") + MASTER_KEY_ENV;
+            return false;
+        }
+        hex = env;
+    }
+    if (hex.starts_with("0x") || hex.starts_with("0X"))
+    {
+        hex = hex.substr(2);
+    }
+
+    if (!AesEngine::fromHex(hex, masterKey) || masterKey.size() < 16)
+    {
+        errorMsg = "主密钥必须是至少 32 个十六进制字符 (16字节)";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,345 @@
+﻿#include "MappedFile.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+class MappedFile::PImpl
+{
+public:
+    PImpl()  = default;
+    ~PImpl() = default;
+
+public:
+    auto map(bool writable, std::string &errorMsg) -> bool;
+
+public:
+    uint8_t *data_     = nullptr;
+    uint64_t size_     = 0;
+    bool     writable_ = false;
+#ifdef _WIN32
+    HANDLE file_    = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+#ifdef _WIN32
+/// ==================== Windows 实现 ====================
+
+auto MappedFile::PImpl::map(bool writable, std::string &errorMsg) -> bool
+{
+    if (size_ == 0)
+    {
+        return true;
+    }
+
+    DWORD protect = writable ? PAGE_READWRITE : PAGE_READONLY;
+    mapping_      = ::CreateFileMappingW(file_, nullptr, protect, static_cast<DWORD>(size_ >> 32),
+                                         static_cast<DWORD>(size_ & 0xFFFFFFFF), nullptr);
+    if (!mapping_)
+    {
+        errorMsg = "创建文件映射失败，错误码: " + std::to_string(::GetLastError());
+        return false;
+    }
+
+    DWORD access = writable ? FILE_MAP_WRITE : FILE_MAP_READ;
+    data_        = static_cast<uint8_t *>(::MapViewOfFile(mapping_, access, 0, 0, 0));
+    if (!data_)
+    {
+        errorMsg = "映射文件视图失败，错误码: " + std::to_string(::GetLastError());
+        return false;
+    }
+    return true;
+}
+
+auto MappedFile::openRead(const std::string_view &path, std::string &errorMsg) -> bool
+{
+    close();
+    impl_->file_ = ::CreateFileW(fs::path(path).wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (impl_->file_ == INVALID_HANDLE_VALUE)
+    {
+        errorMsg = "无法打开文件: " + std::string(path);
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    ::GetFileSizeEx(impl_->file_, &size);
+    impl_->size_     = static_cast<uint64_t>(size.QuadPart);
+    impl_->writable_ = false;
+    if (!impl_->map(false, errorMsg))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+auto MappedFile::create(const std::string_view &path, uint64_t size, std::string &errorMsg) -> bool
+{
+    close();
+    impl_->file_ = ::CreateFileW(fs::path(path).wstring().c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                                 CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (impl_->file_ == INVALID_HANDLE_VALUE)
+    {
+        errorMsg = "无法创建文件: " + std::string(path);
+        return false;
+    }
+
+    impl_->size_     = size;
+    impl_->writable_ = true;
+    if (!impl_->map(true, errorMsg)) /// 映射大小大于文件时会自动扩展文件
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+auto MappedFile::close() -> bool
+{
+    bool ok = true;
+    if (impl_->data_)
+    {
+        ok           = ::UnmapViewOfFile(impl_->data_) != FALSE;
+        impl_->data_ = nullptr;
+    }
+    if (impl_->mapping_)
+    {
+        ::CloseHandle(impl_->mapping_);
+        impl_->mapping_ = nullptr;
+    }
+    if (impl_->file_ != INVALID_HANDLE_VALUE)
+    {
+        ok           = ::CloseHandle(impl_->file_) != FALSE && ok;
+        impl_->file_ = INVALID_HANDLE_VALUE;
+    }
+    impl_->size_ = 0;
+    return ok;
+}
+
+auto MappedFile::advise(Advice advice, uint64_t offset, uint64_t length) const -> void
+{
+    if (!impl_->data_ || advice != Advice::WillNeed)
+    {
+        return;
+    }
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = impl_->data_ + offset;
+    range.NumberOfBytes  = static_cast<SIZE_T>(length ? length : impl_->size_ - offset);
+    ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+}
+
+auto MappedFile::flush() const -> bool
+{
+    if (!impl_->data_ || !impl_->writable_)
+    {
+        return true;
+    }
+    return ::FlushViewOfFile(impl_->data_, 0) && ::FlushFileBuffers(impl_->file_);
+}
+
+#else
+/// ==================== POSIX 实现 ====================
+
+auto MappedFile::PImpl::map(bool writable, std::string &errorMsg) -> bool
+{
+    if (size_ == 0)
+    {
+        return true;
+    }
+
+    int   prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void *addr = ::mmap(nullptr, static_cast<size_t>(size_), prot, MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED)
+    {
+        errorMsg = "mmap失败: " + std::string(std::strerror(errno));
+        return false;
+    }
+    data_ = static_cast<uint8_t *>(addr);
+    return true;
+}
+
+auto MappedFile::openRead(const std::string_view &path, std::string &errorMsg) -> bool
+{
+    close();
+    impl_->fd_ = ::open(std::string(path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (impl_->fd_ < 0)
+    {
+        errorMsg = "无法打开文件: " + std::string(path) + " (" + std::strerror(errno) + ")";
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(impl_->fd_, &st) != 0)
+    {
+        errorMsg = "无法获取文件信息: " + std::string(path);
+        close();
+        return false;
+    }
+
+    impl_->size_     = static_cast<uint64_t>(st.st_size);
+    impl_->writable_ = false;
+    if (!impl_->map(false, errorMsg))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+auto MappedFile::create(const std::string_view &path, uint64_t size, std::string &errorMsg) -> bool
+{
+    close();
+    impl_->fd_ = ::open(std::string(path).c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (impl_->fd_ < 0)
+    {
+        errorMsg = "无法创建文件: " + std::string(path) + " (" + std::strerror(errno) + ")";
+        return false;
+    }
+
+    if (size > 0)
+    {
+        int error = 0;
+#ifdef __linux__
+        /// 先真正分配磁盘块，避免写映射时因磁盘满触发 SIGBUS；
+        /// 只有文件系统不支持预分配时才退回 ftruncate（稀疏文件），空间不足等错误直接失败。
+        /// posix_fallocate 通过返回值给出错误码，不设置 errno
+        error = ::posix_fallocate(impl_->fd_, 0, static_cast<off_t>(size));
+        if (error == EOPNOTSUPP || error == EINVAL)
+#endif
+        {
+            error = ::ftruncate(impl_->fd_, static_cast<off_t>(size)) == 0 ? 0 : errno;
+        }
+        if (error != 0)
+        {
+            errorMsg = "无法预分配文件空间: " + std::string(path) + " (" + std::strerror(error) + ")";
+            close();
+            ::unlink(std::string(path).c_str());
+            return false;
+        }
+    }
+
+    impl_->size_     = size;
+    impl_->writable_ = true;
+    if (!impl_->map(true, errorMsg))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+auto MappedFile::close() -> bool
+{
+    bool ok = true;
+    if (impl_->data_)
+    {
+        ok           = ::munmap(impl_->data_, static_cast<size_t>(impl_->size_)) == 0;
+        impl_->data_ = nullptr;
+    }
+    if (impl_->fd_ >= 0)
+    {
+        ok         = ::close(impl_->fd_) == 0 && ok;
+        impl_->fd_ = -1;
+    }
+    impl_->size_ = 0;
+    return ok;
+}
+
+auto MappedFile::advise(Advice advice, uint64_t offset, uint64_t length) const -> void
+{
+    if (!impl_->data_)
+    {
+        return;
+    }
+
+    int flag = MADV_NORMAL;
+    switch (advice)
+    {
+        case Advice::Sequential:
+            flag = MADV_SEQUENTIAL;
+            break;
+        case Advice::Random:
+            flag = MADV_RANDOM;
+            break;
+        case Advice::WillNeed:
+            flag = MADV_WILLNEED;
+            break;
+        case Advice::Normal:
+        default:
+            break;
+    }
+
+    /// madvise 要求起始地址按页对齐
+    static const uint64_t pageSize = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    uint64_t              begin    = offset / pageSize * pageSize;
+    uint64_t              end      = length ? std::min(impl_->size_, offset + length) : impl_->size_;
+    if (end > begin)
+    {
+        ::madvise(impl_->data_ + begin, static_cast<size_t>(end - begin), flag);
+    }
+}
+
+auto MappedFile::flush() const -> bool
+{
+    if (!impl_->data_ || !impl_->writable_)
+    {
+        return true;
+    }
+    return ::msync(impl_->data_, static_cast<size_t>(impl_->size_), MS_SYNC) == 0;
+}
+
+#endif
+
+/// ==================== 跨平台通用实现 ====================
+
+MappedFile::MappedFile() : impl_(std::make_unique<PImpl>())
+{
+}
+
+MappedFile::~MappedFile()
+{
+    if (impl_)
+    {
+        close();
+    }
+}
+
+MappedFile::MappedFile(MappedFile &&) noexcept            = default;
+MappedFile &MappedFile::operator=(MappedFile &&) noexcept = default;
+
+auto MappedFile::isOpen() const -> bool
+{
+#ifdef _WIN32
+    return impl_->file_ != INVALID_HANDLE_VALUE;
+#else
+    return impl_->fd_ >= 0;
+#endif
+}
+
+auto MappedFile::data() const -> const uint8_t *
+{
+    return impl_->data_;
+}
+
+auto MappedFile::mutableData() -> uint8_t *
+{
+    return impl_->writable_ ? impl_->data_ : nullptr;
+}
+
+auto MappedFile::size() const -> uint64_t
+{
+    return impl_->size_;
+}
@@ -0,0 +1,971 @@
+﻿#include "MediaCatalog.h"
+#include "MediaProbeCache.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <ranges>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+    constexpr char     CATALOG_MAGIC[8] = { 'X', 'M', 'C', 'A', 'T', '0', '0', '1' };
+    constexpr uint32_t CATALOG_VERSION  = 1;
+    constexpr uint16_t DICT_NONE        = 0xFFFF; ///< 字典列中的空值
+
+    enum class ColumnType : uint32_t
+    {
+        U16    = 1,
+        U32    = 2,
+        U64    = 3,
+        I64    = 4,
+        F32    = 5,
+        F64    = 6,
+        Dict16 = 7, ///< uint16 字典编号，字典为 "dict" 列
+        Str    = 8, ///< (count + 1) 个 uint64 偏移 + 字符串数据
+    };
+
+#pragma pack(push, 1)
+    struct FileHeader
+    {
+        char     magic[8];
+        uint32_t version;
+        uint32_t columnCount;
+        uint64_t rowCount;
+        uint64_t directoryOffset;
+    };
+
+    struct ColumnEntry
+    {
+        char     name[16];
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t count; ///< 元素个数（行列等于 rowCount，字典列为字典大小）
+        uint64_t offset;
+        uint64_t length;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(FileHeader) == 32);
+    static_assert(sizeof(ColumnEntry) == 48);
+
+    auto align8(uint64_t value) -> uint64_t
+    {
+        return (value + 7) & ~uint64_t{ 7 };
+    }
+
+    auto elementSize(ColumnType type) -> uint64_t
+    {
+        switch (type)
+        {
+            case ColumnType::U16:
+            case ColumnType::Dict16:
+                return 2;
+            case ColumnType::U32:
+            case ColumnType::F32:
+                return 4;
+            case ColumnType::U64:
+            case ColumnType::I64:
+            case ColumnType::F64:
+                return 8;
+            default:
+                return 0;
+        }
+    }
+
+    /// 写入阶段的一列
+    struct ColumnData
+    {
+        std::string name;
+        ColumnType  type  = ColumnType::U64;
+        uint64_t    count = 0;
+        std::string bytes;
+    };
+
+    template <typename T, typename Proj>
+    auto makeFixedColumn(const char *name, ColumnType type, const std::vector<MediaCatalog::Row> &rows, Proj proj)
+            -> ColumnData
+    {
+        ColumnData column{ name, type, rows.size(), {} };
+        column.bytes.resize(rows.size() * sizeof(T));
+        auto *out = column.bytes.data();
+        for (const auto &row : rows)
+        {
+            T value = static_cast<T>(proj(row));
+            std::memcpy(out, &value, sizeof(T));
+            out += sizeof(T);
+        }
+        return column;
+    }
+
+    template <typename Proj>
+    auto makeStringColumn(const char *name, size_t count, Proj proj) -> ColumnData
+    {
+        ColumnData column{ name, ColumnType::Str, count, {} };
+
+        std::vector<uint64_t> offsets;
+        offsets.reserve(count + 1);
+        std::string blob;
+        for (size_t i = 0; i < count; ++i)
+        {
+            offsets.push_back(blob.size());
+            blob += proj(i);
+        }
+        offsets.push_back(blob.size());
+
+        column.bytes.resize(offsets.size() * sizeof(uint64_t));
+        std::memcpy(column.bytes.data(), offsets.data(), column.bytes.size());
+        column.bytes += blob;
+        return column;
+    }
+
+    enum class CompareOp
+    {
+        Eq,
+        Ne,
+        Lt,
+        Le,
+        Gt,
+        Ge,
+        Contains,
+    };
+
+    struct Condition
+    {
+        std::string field;
+        CompareOp   op = CompareOp::Eq;
+        std::string text;
+        double      number    = 0.0;
+        bool        isNumeric = false;
+    };
+
+    auto toLower(std::string value) -> std::string
+    {
+        std::ranges::transform(value, value.begin(), [](unsigned char c) { return std::tolower(c); });
+        return value;
+    }
+
+    /// 数值支持 k/m/g 后缀（十进制倍数），便于写码率条件
+    auto parseNumber(std::string_view text, double &value) -> bool
+    {
+        double multiplier = 1.0;
+        if (!text.empty())
+        {
+            switch (std::tolower(static_cast<unsigned char>(text.back())))
+            {
+                case 'k':
+                    multiplier = 1e3;
+                    break;
+                case 'm':
+                    multiplier = 1e6;
+                    break;
+                case 'g':
+                    multiplier = 1e9;
+                    break;
+                default:
+                    break;
+            }
+            if (multiplier != 1.0)
+            {
+                text.remove_suffix(1);
+            }
+        }
+
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (ec != std::errc{} || ptr != text.data() + text.size())
+        {
+            return false;
+        }
+        value *= multiplier;
+        return true;
+    }
+
+    auto parseCondition(std::string_view expr, Condition &cond, std::string &errorMsg) -> bool
+    {
+        size_t pos = expr.find_first_of("<>=!~");
+        if (pos == std::string_view::npos || pos == 0)
+        {
+            errorMsg = "无效的过滤条件: " + std::string(expr);
+            return false;
+        }
+
+        cond.field            = toLower(std::string(expr.substr(0, pos)));
+        std::string_view rest  = expr.substr(pos);
+        size_t           opLen = 1;
+        if (rest.starts_with(">="))
+        {
+            cond.op = CompareOp::Ge;
+            opLen   = 2;
+        }
+        else if (rest.starts_with("<="))
+        {
+            cond.op = CompareOp::Le;
+            opLen   = 2;
+        }
+        else if (rest.starts_with("!="))
+        {
+            cond.op = CompareOp::Ne;
+            opLen   = 2;
+        }
+        else if (rest.starts_with("=="))
+        {
+            cond.op = CompareOp::Eq;
+            opLen   = 2;
+        }
+        else if (rest[0] == '=')
+        {
+            cond.op = CompareOp::Eq;
+        }
+        else if (rest[0] == '>')
+        {
+            cond.op = CompareOp::Gt;
+        }
+        else if (rest[0] == '<')
+        {
+            cond.op = CompareOp::Lt;
+        }
+        else if (rest[0] == '~')
+        {
+            cond.op = CompareOp::Contains;
+        }
+        else
+        {
+            errorMsg = "无效的比较运算符: " + std::string(expr);
+            return false;
+        }
+
+        cond.text      = std::string(rest.substr(opLen));
+        cond.isNumeric = parseNumber(cond.text, cond.number);
+        return true;
+    }
+
+    template <typename T>
+    auto compareValue(T lhs, CompareOp op, T rhs) -> bool
+    {
+        switch (op)
+        {
+            case CompareOp::Eq:
+                return lhs == rhs;
+            case CompareOp::Ne:
+                return lhs != rhs;
+            case CompareOp::Lt:
+                return lhs < rhs;
+            case CompareOp::Le:
+                return lhs <= rhs;
+            case CompareOp::Gt:
+                return lhs > rhs;
+            case CompareOp::Ge:
+                return lhs >= rhs;
+            default:
+                return false;
+        }
+    }
+
+    /// 按运算符展开为独立循环，内层循环无分支便于向量化
+    template <typename T, typename Cmp>
+    auto scanWith(const T *column, uint64_t rows, uint8_t *mask, Cmp cmp) -> void
+    {
+        for (uint64_t i = 0; i < rows; ++i)
+        {
+            mask[i] &= static_cast<uint8_t>(cmp(column[i]));
+        }
+    }
+
+    template <typename T>
+    auto scanNumeric(const T *column, uint64_t rows, uint8_t *mask, CompareOp op, double value) -> void
+    {
+        switch (op)
+        {
+            case CompareOp::Eq:
+                scanWith(column, rows, mask, [value](T v) { return static_cast<double>(v) == value; });
+                break;
+            case CompareOp::Ne:
+                scanWith(column, rows, mask, [value](T v) { return static_cast<double>(v) != value; });
+                break;
+            case CompareOp::Lt:
+                scanWith(column, rows, mask, [value](T v) { return static_cast<double>(v) < value; });
+                break;
+            case CompareOp::Le:
+                scanWith(column, rows, mask, [value](T v) { return static_cast<double>(v) <= value; });
+                break;
+            case CompareOp::Gt:
+                scanWith(column, rows, mask, [value](T v) { return static_cast<double>(v) > value; });
+                break;
+            case CompareOp::Ge:
+                scanWith(column, rows, mask, [value](T v) { return static_cast<double>(v) >= value; });
+                break;
+            default:
+                break;
+        }
+    }
+
+    auto formatBytes(uint64_t bytes) -> std::string
+    {
+        static const char *units[] = { "B", "KB", "MB", "GB", "TB" };
+        double             value   = static_cast<double>(bytes);
+        int                unit    = 0;
+        while (value >= 1024.0 && unit < 4)
+        {
+            value /= 1024.0;
+            ++unit;
+        }
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(unit == 0 ? 0 : 2) << value << " " << units[unit];
+        return ss.str();
+    }
+
+    auto formatDuration(double seconds) -> std::string
+    {
+        auto              total = static_cast<uint64_t>(seconds);
+        std::stringstream ss;
+        ss << total / 3600 << ":" << std::setw(2) << std::setfill('0') << (total / 60) % 60 << ":" << std::setw(2)
+           << std::setfill('0') << total % 60;
+        return ss.str();
+    }
+} // namespace
+
+/// ==================== MediaCatalog::Row ====================
+
+auto MediaCatalog::Row::fromProbe(const std::string_view &path, uint64_t size, int64_t mtime,
+                                  const MediaProbeInfo &info) -> Row
+{
+    Row row;
+    row.path     = path;
+    row.size     = size;
+    row.mtime    = mtime;
+    row.duration = info.duration;
+    row.bitRate  = info.bitRate;
+    row.format   = info.formatName;
+
+    if (const auto *video = info.videoStream())
+    {
+        row.width    = static_cast<uint32_t>(std::max(video->width, 0));
+        row.height   = static_cast<uint32_t>(std::max(video->height, 0));
+        row.fps      = static_cast<float>(video->fps);
+        row.vcodec   = video->codecName;
+        row.vbitrate = static_cast<uint32_t>(std::clamp<int64_t>(video->bitRate, 0, UINT32_MAX));
+    }
+    if (const auto *audio = info.audioStream())
+    {
+        row.acodec     = audio->codecName;
+        row.abitrate   = static_cast<uint32_t>(std::clamp<int64_t>(audio->bitRate, 0, UINT32_MAX));
+        row.sampleRate = static_cast<uint32_t>(std::max(audio->sampleRate, 0));
+        row.channels   = static_cast<uint16_t>(std::clamp(audio->channels, 0, 0xFFFF));
+    }
+    return row;
+}
+
+/// ==================== MediaCatalog::PImpl ====================
+
+class MediaCatalog::PImpl
+{
+public:
+    struct ColumnView
+    {
+        ColumnType     type   = ColumnType::U64;
+        uint64_t       count  = 0;
+        const uint8_t *data   = nullptr;
+        uint64_t       length = 0;
+    };
+
+    PImpl(MediaCatalog *owner);
+    ~PImpl() = default;
+
+public:
+    auto column(const std::string_view &name) const -> const ColumnView *;
+
+    auto stringAt(const ColumnView &column, uint64_t index) const -> std::string_view;
+
+    auto dictString(uint16_t id) const -> std::string_view;
+
+    auto applyCondition(const Condition &cond, std::vector<uint8_t> &mask, std::string &errorMsg) const -> bool;
+
+    template <typename T>
+    auto values(const ColumnView &column) const -> const T *
+    {
+        return reinterpret_cast<const T *>(column.data);
+    }
+
+public:
+    MediaCatalog                                   *owner_ = nullptr;
+    MappedFile                                      file_;
+    uint64_t                                        rowCount_ = 0;
+    std::vector<std::pair<std::string, ColumnView>> columns_;
+    const ColumnView                               *dict_ = nullptr;
+};
+
+MediaCatalog::PImpl::PImpl(MediaCatalog *owner) : owner_(owner)
+{
+}
+
+auto MediaCatalog::PImpl::column(const std::string_view &name) const -> const ColumnView *
+{
+    for (const auto &[columnName, view] : columns_)
+    {
+        if (columnName == name)
+        {
+            return &view;
+        }
+    }
+    return nullptr;
+}
+
+auto MediaCatalog::PImpl::stringAt(const ColumnView &column, uint64_t index) const -> std::string_view
+{
+    const auto *offsets = values<uint64_t>(column);
+    const char *blob    = reinterpret_cast<const char *>(column.data + (column.count + 1) * sizeof(uint64_t));
+    return { blob + offsets[index], static_cast<size_t>(offsets[index + 1] - offsets[index]) };
+}
+
+auto MediaCatalog::PImpl::dictString(uint16_t id) const -> std::string_view
+{
+    if (id == DICT_NONE || !dict_ || id >= dict_->count)
+    {
+        return {};
+    }
+    return stringAt(*dict_, id);
+}
+
+auto MediaCatalog::PImpl::applyCondition(const Condition &cond, std::vector<uint8_t> &mask,
+                                         std::string &errorMsg) const -> bool
+{
+    /// resolution=1920x1080 展开为 width/height 两个条件
+    if (cond.field == "resolution")
+    {
+        auto xPos = cond.text.find_first_of("xX");
+        if (xPos == std::string::npos || cond.op != CompareOp::Eq)
+        {
+            errorMsg = "resolution 仅支持 resolution=宽x高";
+            return false;
+        }
+        Condition width{ "width", CompareOp::Eq, {}, 0.0, true };
+        Condition height{ "height", CompareOp::Eq, {}, 0.0, true };
+        if (!parseNumber(cond.text.substr(0, xPos), width.number) ||
+            !parseNumber(cond.text.substr(xPos + 1), height.number))
+        {
+            errorMsg = "无效的分辨率: " + cond.text;
+            return false;
+        }
+        return applyCondition(width, mask, errorMsg) && applyCondition(height, mask, errorMsg);
+    }
+
+    const auto *view = column(cond.field);
+    if (!view || cond.field == "dict")
+    {
+        errorMsg = "未知的列: " + cond.field;
+        return false;
+    }
+
+    uint8_t *bits = mask.data();
+    switch (view->type)
+    {
+        case ColumnType::Dict16:
+        case ColumnType::Str:
+        {
+            if (cond.op != CompareOp::Eq && cond.op != CompareOp::Ne && cond.op != CompareOp::Contains)
+            {
+                errorMsg = "字符串列 " + cond.field + " 仅支持 = != ~";
+                return false;
+            }
+            auto predicate = [&cond](std::string_view value) -> bool
+            {
+                if (cond.op == CompareOp::Contains)
+                {
+                    return value.find(cond.text) != std::string_view::npos;
+                }
+                return compareValue(value, cond.op, std::string_view(cond.text));
+            };
+
+            if (view->type == ColumnType::Str)
+            {
+                for (uint64_t i = 0; i < rowCount_; ++i)
+                {
+                    if (bits[i])
+                    {
+                        bits[i] = predicate(stringAt(*view, i));
+                    }
+                }
+                break;
+            }
+
+            /// 字典列：先对字典求值一次，再按编号查表
+            std::vector<uint8_t> allowed(0x10000, 0);
+            allowed[DICT_NONE] = predicate({});
+            for (uint64_t id = 0; dict_ && id < dict_->count; ++id)
+            {
+                allowed[id] = predicate(stringAt(*dict_, id));
+            }
+            scanWith(values<uint16_t>(*view), rowCount_, bits, [&allowed](uint16_t id) { return allowed[id]; });
+            break;
+        }
+        default:
+        {
+            if (!cond.isNumeric || cond.op == CompareOp::Contains)
+            {
+                errorMsg = "数值列 " + cond.field + " 需要数值条件: " + cond.text;
+                return false;
+            }
+            switch (view->type)
+            {
+                case ColumnType::U16:
+                    scanNumeric(values<uint16_t>(*view), rowCount_, bits, cond.op, cond.number);
+                    break;
+                case ColumnType::U32:
+                    scanNumeric(values<uint32_t>(*view), rowCount_, bits, cond.op, cond.number);
+                    break;
+                case ColumnType::U64:
+                    scanNumeric(values<uint64_t>(*view), rowCount_, bits, cond.op, cond.number);
+                    break;
+                case ColumnType::I64:
+                    scanNumeric(values<int64_t>(*view), rowCount_, bits, cond.op, cond.number);
+                    break;
+                case ColumnType::F32:
+                    scanNumeric(values<float>(*view), rowCount_, bits, cond.op, cond.number);
+                    break;
+                case ColumnType::F64:
+                    scanNumeric(values<double>(*view), rowCount_, bits, cond.op, cond.number);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+/// ==================== MediaCatalog ====================
+
+MediaCatalog::MediaCatalog() : impl_(std::make_unique<PImpl>(this))
+{
+}
+
+MediaCatalog::~MediaCatalog() = default;
+
+auto MediaCatalog::write(const fs::path &path, const std::vector<Row> &rows, std::string &errorMsg) -> bool
+{
+    /// 1. 构建编解码器/容器名字典
+    std::unordered_map<std::string, uint16_t> dictIndex;
+    std::vector<std::string>                  dictionary;
+    auto                                      encode = [&](const std::string &value) -> uint16_t
+    {
+        if (value.empty())
+        {
+            return DICT_NONE;
+        }
+        auto [it, inserted] = dictIndex.try_emplace(value, static_cast<uint16_t>(dictionary.size()));
+        if (inserted)
+        {
+            dictionary.push_back(value);
+        }
+        return it->second;
+    };
+
+    std::vector<uint16_t> formatIds, vcodecIds, acodecIds;
+    formatIds.reserve(rows.size());
+    vcodecIds.reserve(rows.size());
+    acodecIds.reserve(rows.size());
+    for (const auto &row : rows)
+    {
+        formatIds.push_back(encode(row.format));
+        vcodecIds.push_back(encode(row.vcodec));
+        acodecIds.push_back(encode(row.acodec));
+        if (dictionary.size() >= DICT_NONE)
+        {
+            errorMsg = "字典项过多（超过65534个不同的编解码器/格式名）";
+            return false;
+        }
+    }
+
+    /// 2. 逐列编码
+    auto dictColumn = [&rows](const char *name, const std::vector<uint16_t> &ids) -> ColumnData
+    {
+        ColumnData column{ name, ColumnType::Dict16, rows.size(), {} };
+        column.bytes.resize(ids.size() * sizeof(uint16_t));
+        std::memcpy(column.bytes.data(), ids.data(), column.bytes.size());
+        return column;
+    };
+
+    std::vector<ColumnData> columns;
+    columns.push_back(makeStringColumn("path", rows.size(), [&rows](size_t i) -> const std::string &
+                                       { return rows[i].path; }));
+    columns.push_back(makeFixedColumn<uint64_t>("size", ColumnType::U64, rows, [](const Row &r) { return r.size; }));
+    columns.push_back(makeFixedColumn<int64_t>("mtime", ColumnType::I64, rows, [](const Row &r) { return r.mtime; }));
+    columns.push_back(
+            makeFixedColumn<double>("duration", ColumnType::F64, rows, [](const Row &r) { return r.duration; }));
+    columns.push_back(
+            makeFixedColumn<int64_t>("bitrate", ColumnType::I64, rows, [](const Row &r) { return r.bitRate; }));
+    columns.push_back(dictColumn("format", formatIds));
+    columns.push_back(makeFixedColumn<uint32_t>("width", ColumnType::U32, rows, [](const Row &r) { return r.width; }));
+    columns.push_back(
+            makeFixedColumn<uint32_t>("height", ColumnType::U32, rows, [](const Row &r) { return r.height; }));
+    columns.push_back(makeFixedColumn<float>("fps", ColumnType::F32, rows, [](const Row &r) { return r.fps; }));
+    columns.push_back(dictColumn("vcodec", vcodecIds));
+    columns.push_back(dictColumn("acodec", acodecIds));
+    columns.push_back(
+            makeFixedColumn<uint32_t>("vbitrate", ColumnType::U32, rows, [](const Row &r) { return r.vbitrate; }));
+    columns.push_back(
+            makeFixedColumn<uint32_t>("abitrate", ColumnType::U32, rows, [](const Row &r) { return r.abitrate; }));
+    columns.push_back(
+            makeFixedColumn<uint32_t>("samplerate", ColumnType::U32, rows, [](const Row &r) { return r.sampleRate; }));
+    columns.push_back(
+            makeFixedColumn<uint16_t>("channels", ColumnType::U16, rows, [](const Row &r) { return r.channels; }));
+    columns.push_back(makeStringColumn("dict", dictionary.size(), [&dictionary](size_t i) -> const std::string &
+                                       { return dictionary[i]; }));
+
+    /// 3. 计算布局
+    uint64_t                 offset = align8(sizeof(FileHeader) + columns.size() * sizeof(ColumnEntry));
+    std::vector<ColumnEntry> directory(columns.size());
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        auto &entry = directory[i];
+        std::memset(&entry, 0, sizeof(entry));
+        std::memcpy(entry.name, columns[i].name.data(), std::min(columns[i].name.size(), sizeof(entry.name) - 1));
+        entry.type   = static_cast<uint32_t>(columns[i].type);
+        entry.count  = columns[i].count;
+        entry.offset = offset;
+        entry.length = columns[i].bytes.size();
+        offset       = align8(offset + entry.length);
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, CATALOG_MAGIC, sizeof(header.magic));
+    header.version         = CATALOG_VERSION;
+    header.columnCount     = static_cast<uint32_t>(columns.size());
+    header.rowCount        = rows.size();
+    header.directoryOffset = sizeof(FileHeader);
+
+    /// 4. 映射临时文件一次性写入，完成后原子替换
+    fs::path   tmpPath = path;
+    tmpPath += ".tmp";
+    MappedFile out;
+    if (!out.create(tmpPath.string(), offset, errorMsg))
+    {
+        return false;
+    }
+
+    uint8_t *base = out.mutableData();
+    std::memcpy(base, &header, sizeof(header));
+    std::memcpy(base + header.directoryOffset, directory.data(), directory.size() * sizeof(ColumnEntry));
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        std::memcpy(base + directory[i].offset, columns[i].bytes.data(), columns[i].bytes.size());
+    }
+
+    bool flushed = out.flush();
+    out.close();
+
+    std::error_code ec;
+    if (!flushed)
+    {
+        fs::remove(tmpPath, ec);
+        errorMsg = "写入目录文件失败: " + tmpPath.string();
+        return false;
+    }
+    fs::rename(tmpPath, path, ec);
+    if (ec)
+    {
+        fs::remove(tmpPath, ec);
+        errorMsg = "无法替换目录文件: " + path.string();
+        return false;
+    }
+    return true;
+}
+
+auto MediaCatalog::open(const fs::path &path, std::string &errorMsg) -> bool
+{
+    impl_->columns_.clear();
+    impl_->dict_     = nullptr;
+    impl_->rowCount_ = 0;
+
+    if (!impl_->file_.openRead(path.string(), errorMsg))
+    {
+        return false;
+    }
+
+    const uint8_t *base = impl_->file_.data();
+    uint64_t       size = impl_->file_.size();
+    if (size < sizeof(FileHeader))
+    {
+        errorMsg = "目录文件过小: " + path.string();
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, CATALOG_MAGIC, sizeof(header.magic)) != 0 || header.version != CATALOG_VERSION)
+    {
+        errorMsg = "不是有效的目录文件: " + path.string();
+        return false;
+    }
+    if (header.directoryOffset + uint64_t{ header.columnCount } * sizeof(ColumnEntry) > size)
+    {
+        errorMsg = "目录文件已损坏（列目录越界）";
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.columnCount; ++i)
+    {
+        ColumnEntry entry;
+        std::memcpy(&entry, base + header.directoryOffset + i * sizeof(ColumnEntry), sizeof(entry));
+        entry.name[sizeof(entry.name) - 1] = '\0';
+
+        std::string name(entry.name);
+        auto        type = static_cast<ColumnType>(entry.type);
+        if (entry.offset % 8 != 0 || entry.offset > size || entry.length > size - entry.offset)
+        {
+            errorMsg = "目录文件已损坏（列越界）: " + name;
+            return false;
+        }
+
+        PImpl::ColumnView view{ type, entry.count, base + entry.offset, entry.length };
+        if (type == ColumnType::Str)
+        {
+            uint64_t indexBytes = (entry.count + 1) * sizeof(uint64_t);
+            if (entry.length < indexBytes)
+            {
+                errorMsg = "目录文件已损坏（字符串列）: " + name;
+                return false;
+            }
+            const auto *offsets  = impl_->values<uint64_t>(view);
+            uint64_t    blobSize = entry.length - indexBytes;
+            for (uint64_t k = 0; k < entry.count; ++k)
+            {
+                if (offsets[k] > offsets[k + 1] || offsets[k + 1] > blobSize)
+                {
+                    errorMsg = "目录文件已损坏（字符串偏移）: " + name;
+                    return false;
+                }
+            }
+        }
+        else if (elementSize(type) == 0 || entry.length < entry.count * elementSize(type))
+        {
+            errorMsg = "目录文件已损坏（列长度）: " + name;
+            return false;
+        }
+
+        if (name != "dict" && entry.count != header.rowCount)
+        {
+            errorMsg = "目录文件已损坏（行数不一致）: " + name;
+            return false;
+        }
+        impl_->columns_.emplace_back(std::move(name), view);
+    }
+
+    impl_->rowCount_ = header.rowCount;
+    impl_->dict_     = impl_->column("dict");
+    if (!impl_->column("path") || !impl_->column("size") || !impl_->column("duration"))
+    {
+        errorMsg = "目录文件缺少必需列";
+        return false;
+    }
+
+    impl_->file_.advise(MappedFile::Advice::WillNeed);
+    return true;
+}
+
+auto MediaCatalog::rowCount() const -> uint64_t
+{
+    return impl_->rowCount_;
+}
+
+auto MediaCatalog::columnNames() const -> std::vector<std::string>
+{
+    std::vector<std::string> names;
+    for (const auto &name : impl_->columns_ | std::views::keys)
+    {
+        if (name != "dict")
+        {
+            names.push_back(name);
+        }
+    }
+    names.emplace_back("resolution");
+    return names;
+}
+
+auto MediaCatalog::query(const QueryOptions &options, QueryResult &result, std::string &errorMsg) const -> bool
+{
+    auto start = std::chrono::steady_clock::now();
+    result     = QueryResult{};
+
+    if (!impl_->file_.isOpen())
+    {
+        errorMsg = "目录文件未打开";
+        return false;
+    }
+
+    uint64_t rows  = impl_->rowCount_;
+    result.scanned = rows;
+
+    /// 1. 过滤：逐条件扫描对应列，结果按位与到掩码
+    std::vector<uint8_t> mask(rows, 1);
+    std::string_view     where = options.where;
+    while (!where.empty())
+    {
+        size_t           sep  = where.find_first_of(",&");
+        std::string_view expr = where.substr(0, sep);
+        where                 = sep == std::string_view::npos ? std::string_view{} : where.substr(sep + 1);
+        if (expr.empty())
+        {
+            continue;
+        }
+
+        Condition cond;
+        if (!parseCondition(expr, cond, errorMsg) || !impl_->applyCondition(cond, mask, errorMsg))
+        {
+            return false;
+        }
+    }
+
+    /// 2. 分组键
+    std::string groupBy = toLower(options.groupBy);
+    std::function<uint64_t(uint64_t)>    groupKey;
+    std::function<std::string(uint64_t)> groupLabel;
+    if (groupBy == "resolution")
+    {
+        const auto *width  = impl_->values<uint32_t>(*impl_->column("width"));
+        const auto *height = impl_->values<uint32_t>(*impl_->column("height"));
+        groupKey           = [width, height](uint64_t i) { return (uint64_t{ width[i] } << 32) | height[i]; };
+        groupLabel         = [](uint64_t key)
+        { return key == 0 ? std::string("(无视频)") : std::to_string(key >> 32) + "x" + std::to_string(key & 0xFFFFFFFF); };
+    }
+    else if (!groupBy.empty())
+    {
+        const auto *view = impl_->column(groupBy);
+        if (!view || groupBy == "dict" || view->type == ColumnType::Str)
+        {
+            errorMsg = "无法按该列分组: " + groupBy;
+            return false;
+        }
+
+        switch (view->type)
+        {
+            case ColumnType::Dict16:
+            {
+                const auto *ids = impl_->values<uint16_t>(*view);
+                groupKey        = [ids](uint64_t i) { return uint64_t{ ids[i] }; };
+                groupLabel      = [this](uint64_t key)
+                {
+                    auto name = impl_->dictString(static_cast<uint16_t>(key));
+                    return name.empty() ? std::string("(无)") : std::string(name);
+                };
+                break;
+            }
+            case ColumnType::F32:
+            case ColumnType::F64:
+            {
+                bool        isFloat = view->type == ColumnType::F32;
+                const auto *data    = view->data;
+                groupKey            = [data, isFloat](uint64_t i)
+                {
+                    double value = isFloat ? reinterpret_cast<const float *>(data)[i]
+                                           : reinterpret_cast<const double *>(data)[i];
+                    return static_cast<uint64_t>(std::llround(value * 100.0));
+                };
+                groupLabel = [](uint64_t key)
+                {
+                    std::stringstream ss;
+                    ss << static_cast<double>(key) / 100.0;
+                    return ss.str();
+                };
+                break;
+            }
+            default:
+            {
+                const auto *data = view->data;
+                auto        type = view->type;
+                groupKey         = [data, type](uint64_t i) -> uint64_t
+                {
+                    switch (type)
+                    {
+                        case ColumnType::U16:
+                            return reinterpret_cast<const uint16_t *>(data)[i];
+                        case ColumnType::U32:
+                            return reinterpret_cast<const uint32_t *>(data)[i];
+                        default:
+                            return reinterpret_cast<const uint64_t *>(data)[i];
+                    }
+                };
+                groupLabel = [type](uint64_t key)
+                { return type == ColumnType::I64 ? std::to_string(static_cast<int64_t>(key)) : std::to_string(key); };
+                break;
+            }
+        }
+    }
+
+    /// 3. 聚合
+    const auto *sizes     = impl_->values<uint64_t>(*impl_->column("size"));
+    const auto *durations = impl_->values<double>(*impl_->column("duration"));
+    const auto *paths     = impl_->column("path");
+
+    std::unordered_map<uint64_t, Group> groups;
+    for (uint64_t i = 0; i < rows; ++i)
+    {
+        if (!mask[i])
+        {
+            continue;
+        }
+        result.matched++;
+        result.bytes += sizes[i];
+        result.duration += durations[i];
+
+        if (groupKey)
+        {
+            auto &group = groups[groupKey(i)];
+            group.count++;
+            group.bytes += sizes[i];
+            group.duration += durations[i];
+        }
+        if (result.paths.size() < options.limit)
+        {
+            result.paths.emplace_back(impl_->stringAt(*paths, i));
+        }
+    }
+
+    for (auto &[key, group] : groups)
+    {
+        group.key = groupLabel(key);
+        result.groups.push_back(std::move(group));
+    }
+    std::ranges::sort(result.groups, [](const Group &a, const Group &b)
+                      { return a.count != b.count ? a.count > b.count : a.key < b.key; });
+
+    result.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+auto MediaCatalog::formatResult(const QueryResult &result, const QueryOptions &options) -> std::string
+{
+    std::stringstream ss;
+    ss << "扫描 " << result.scanned << " 行，匹配 " << result.matched << " 行，用时 " << std::fixed
+       << std::setprecision(2) << result.elapsedMs << " ms\n";
+    ss << "总大小: " << formatBytes(result.bytes) << "，总时长: " << formatDuration(result.duration) << "\n";
+
+    if (!result.groups.empty())
+    {
+        ss << "\n按 " << options.groupBy << " 分组:\n";
+        ss << std::left << std::setw(16) << "值" << std::right << std::setw(10) << "数量" << std::setw(14) << "大小"
+           << std::setw(14) << "时长" << "\n";
+        for (const auto &group : result.groups)
+        {
+            ss << std::left << std::setw(16) << group.key << std::right << std::setw(10) << group.count
+               << std::setw(14) << formatBytes(group.bytes) << std::setw(14) << formatDuration(group.duration)
+               << "\n";
+        }
+    }
+
+    if (!result.paths.empty())
+    {
+        ss << "\n匹配文件（前 " << result.paths.size() << " 条）:\n";
+        for (const auto &path : result.paths)
+        {
+            ss << "  " << path << "\n";
+        }
+    }
+    return ss.str();
+}
@@ -0,0 +1,875 @@
+﻿#include "MediaProbeCache.h"
+#include "BinaryIO.h"
+#include "XExec.h"
+#include "XTool.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <list>
+#include <unordered_map>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#else
+#include <sys/stat.h>
+#endif
+
+using json = nlohmann::json;
+
+namespace
+{
+    constexpr char     CACHE_MAGIC[8]   = { 'X', 'P', 'C', 'A', 'C', 'H', 'E', '4' };
+    constexpr auto     CACHE_FILE_NAME  = ".probe_cache";
+    constexpr uint8_t  FLAG_KEYFRAMES   = 0x01;
+    constexpr uint8_t  FLAG_TOMBSTONE   = 0x80;
+    constexpr uint32_t MAX_RECORD_BYTES = 64u * 1024 * 1024;
+
+    struct FileKeyHash
+    {
+        auto operator()(const MediaProbeCache::FileKey &key) const noexcept -> size_t
+        {
+            size_t h = std::hash<uint64_t>{}(key.device);
+            h ^= std::hash<uint64_t>{}(key.inode) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            h ^= std::hash<uint64_t>{}(key.size) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            h ^= std::hash<int64_t>{}(key.mtimeNs) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
+    /// 解析 "30000/1001" 形式的帧率
+    auto parseRational(const std::string &value) -> double
+    {
+        auto slash = value.find('/');
+        try
+        {
+            if (slash == std::string::npos)
+            {
+                return value.empty() ? 0.0 : std::stod(value);
+            }
+            double num = std::stod(value.substr(0, slash));
+            double den = std::stod(value.substr(slash + 1));
+            return den > 0 ? num / den : 0.0;
+        }
+        catch (...)
+        {
+            return 0.0;
+        }
+    }
+
+    /// 旋转角度：新版 ffprobe 在显示矩阵的 side data 中给出（逆时针为正），旧文件在 rotate 标签中（顺时针）
+    auto parseRotation(const json &stream) -> int
+    {
+        double degrees = 0.0;
+        if (stream.contains("side_data_list") && stream.at("side_data_list").is_array())
+        {
+            for (const auto &side : stream.at("side_data_list"))
+            {
+                if (side.contains("rotation") && side.at("rotation").is_number())
+                {
+                    degrees = -side.at("rotation").get<double>();
+                    break;
+                }
+            }
+        }
+        else if (stream.contains("tags") && stream.at("tags").contains("rotate"))
+        {
+            try
+            {
+                degrees = std::stod(stream.at("tags").at("rotate").get<std::string>());
+            }
+            catch (...)
+            {
+                degrees = 0.0;
+            }
+        }
+        const int quarter = static_cast<int>(std::lround(degrees / 90.0));
+        return ((quarter % 4) + 4) % 4 * 90;
+    }
+
+    /// ffprobe 的 JSON 中数值字段大多以字符串形式给出
+    auto jsonNumber(const json &node, const char *name) -> double
+    {
+        if (!node.contains(name))
+        {
+            return 0.0;
+        }
+        const auto &value = node.at(name);
+        if (value.is_number())
+        {
+            return value.get<double>();
+        }
+        if (value.is_string())
+        {
+            try
+            {
+                return std::stod(value.get<std::string>());
+            }
+            catch (...)
+            {
+            }
+        }
+        return 0.0;
+    }
+
+    auto jsonString(const json &node, const char *name) -> std::string
+    {
+        if (node.contains(name) && node.at(name).is_string())
+        {
+            return node.at(name).get<std::string>();
+        }
+        return "";
+    }
+} // namespace
+
+/// ==================== MediaProbeInfo ====================
+
+auto MediaStreamInfo::displayAspect() const -> double
+{
+    if (width <= 0 || height <= 0)
+    {
+        return 0.0;
+    }
+    const double aspect = width * sar / height;
+    return rotation % 180 == 90 ? 1.0 / aspect : aspect;
+}
+
+auto MediaProbeInfo::videoStream() const -> const MediaStreamInfo *
+{
+    for (const auto &stream : streams)
+    {
+        if (stream.codecType == "video")
+        {
+            return &stream;
+        }
+    }
+    return nullptr;
+}
+
+auto MediaProbeInfo::audioStream() const -> const MediaStreamInfo *
+{
+    for (const auto &stream : streams)
+    {
+        if (stream.codecType == "audio")
+        {
+            return &stream;
+        }
+    }
+    return nullptr;
+}
+
+auto MediaProbeInfo::hasVideo() const -> bool
+{
+    return videoStream() != nullptr;
+}
+
+/// ==================== PImpl ====================
+
+class MediaProbeCache::PImpl
+{
+public:
+    using LruList = std::list<std::pair<FileKey, MediaProbeInfo>>;
+
+    PImpl(MediaProbeCache *owner);
+    ~PImpl() = default;
+
+public:
+    /// 查找（内存 -> 磁盘），调用方需持有锁
+    auto lookup(const FileKey &key, MediaProbeInfo &info) -> bool;
+
+    /// 写入内存与磁盘，调用方需持有锁
+    auto store(const FileKey &key, const MediaProbeInfo &info) -> void;
+
+    auto touch(const FileKey &key, const MediaProbeInfo &info) -> void;
+
+    /// 加载磁盘索引（懒加载）
+    auto ensureLoaded() -> void;
+
+    auto loadIndex() -> void;
+
+    auto compact() -> void;
+
+    auto readRecord(uint64_t offset, FileKey &key, uint8_t &flags, MediaProbeInfo &info) const -> bool;
+
+    auto appendRecord(const FileKey &key, uint8_t flags, const MediaProbeInfo &info) -> void;
+
+    auto cacheFilePath() const -> fs::path;
+
+public:
+    static auto encode(const FileKey &key, uint8_t flags, const MediaProbeInfo &info) -> std::string;
+
+    static auto decode(std::string_view payload, FileKey &key, uint8_t &flags, MediaProbeInfo &info) -> bool;
+
+    static auto runProbe(const std::string &path, MediaProbeInfo &info, std::string &errorMsg) -> bool;
+
+    static auto runKeyframeProbe(const std::string &path, MediaProbeInfo &info, std::string &errorMsg) -> bool;
+
+public:
+    MediaProbeCache                                             *owner_ = nullptr;
+    mutable std::mutex                                          mutex_;
+    fs::path                                                    storageDir_;
+    size_t                                                      capacity_ = 256;
+    LruList                                                     lru_;
+    std::unordered_map<FileKey, LruList::iterator, FileKeyHash> lruIndex_;
+    std::unordered_map<FileKey, uint64_t, FileKeyHash>          diskIndex_;
+    size_t                                                      diskRecords_ = 0;
+    bool                                                        loaded_      = false;
+    Statistics                                                  stats_;
+};
+
+MediaProbeCache::PImpl::PImpl(MediaProbeCache *owner) : owner_(owner)
+{
+}
+
+auto MediaProbeCache::PImpl::cacheFilePath() const -> fs::path
+{
+    return storageDir_ / CACHE_FILE_NAME;
+}
+
+auto MediaProbeCache::PImpl::lookup(const FileKey &key, MediaProbeInfo &info) -> bool
+{
+    if (auto it = lruIndex_.find(key); it != lruIndex_.end())
+    {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        info = it->second->second;
+        stats_.hits++;
+        return true;
+    }
+
+    ensureLoaded();
+    if (auto it = diskIndex_.find(key); it != diskIndex_.end())
+    {
+        FileKey diskKey;
+        uint8_t flags = 0;
+        if (readRecord(it->second, diskKey, flags, info) && diskKey == key)
+        {
+            touch(key, info);
+            stats_.diskHits++;
+            return true;
+        }
+        diskIndex_.erase(it);
+    }
+    return false;
+}
+
+auto MediaProbeCache::PImpl::store(const FileKey &key, const MediaProbeInfo &info) -> void
+{
+    ensureLoaded();
+    touch(key, info);
+    appendRecord(key, info.hasKeyframeIndex ? FLAG_KEYFRAMES : 0, info);
+}
+
+auto MediaProbeCache::PImpl::touch(const FileKey &key, const MediaProbeInfo &info) -> void
+{
+    if (auto it = lruIndex_.find(key); it != lruIndex_.end())
+    {
+        it->second->second = info;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+
+    lru_.emplace_front(key, info);
+    lruIndex_[key] = lru_.begin();
+
+    while (lru_.size() > capacity_)
+    {
+        lruIndex_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+auto MediaProbeCache::PImpl::ensureLoaded() -> void
+{
+    if (!loaded_)
+    {
+        loaded_ = true;
+        loadIndex();
+    }
+}
+
+auto MediaProbeCache::PImpl::loadIndex() -> void
+{
+    diskIndex_.clear();
+    diskRecords_ = 0;
+
+    std::ifstream file(cacheFilePath(), std::ios::binary);
+    if (!file.is_open())
+    {
+        return;
+    }
+
+    char magic[sizeof(CACHE_MAGIC)] = {};
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0)
+    {
+        /// 旧版本的记录无法解析，删除后由下一次写入重建，否则新记录会追加到旧文件头之后
+        std::cout << "警告: 探测缓存文件格式不兼容，已重建: " << cacheFilePath().string() << std::endl;
+        file.close();
+        std::error_code ec;
+        fs::remove(cacheFilePath(), ec);
+        return;
+    }
+
+    /// 只读取每条记录的长度与键，记录体按需读取
+    std::string payload;
+    while (true)
+    {
+        uint64_t offset = static_cast<uint64_t>(file.tellg());
+        uint32_t len    = 0;
+        if (!file.read(reinterpret_cast<char *>(&len), sizeof(len)) || len > MAX_RECORD_BYTES)
+        {
+            break;
+        }
+        constexpr size_t HEAD = sizeof(FileKey) + sizeof(uint8_t);
+        if (len < HEAD)
+        {
+            break;
+        }
+        payload.resize(HEAD);
+        if (!file.read(payload.data(), HEAD))
+        {
+            break;
+        }
+        file.seekg(len - HEAD, std::ios::cur);
+        if (!file)
+        {
+            break; /// 末尾记录不完整（写入时崩溃）
+        }
+
+        FileKey key;
+        std::memcpy(&key, payload.data(), sizeof(FileKey));
+        uint8_t flags = static_cast<uint8_t>(payload[sizeof(FileKey)]);
+
+        diskRecords_++;
+        if (flags & FLAG_TOMBSTONE)
+        {
+            diskIndex_.erase(key);
+        }
+        else
+        {
+            diskIndex_[key] = offset;
+        }
+    }
+    file.close();
+
+    /// 过期记录过多时重写文件
+    if (diskRecords_ > diskIndex_.size() * 2 + 64)
+    {
+        compact();
+    }
+}
+
+auto MediaProbeCache::PImpl::compact() -> void
+{
+    auto     path    = cacheFilePath();
+    fs::path tmpPath = path;
+    tmpPath += ".tmp";
+
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        return;
+    }
+    out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+
+    std::unordered_map<FileKey, uint64_t, FileKeyHash> newIndex;
+    for (const auto &[key, offset] : diskIndex_)
+    {
+        FileKey        diskKey;
+        uint8_t        flags = 0;
+        MediaProbeInfo info;
+        if (!readRecord(offset, diskKey, flags, info))
+        {
+            continue;
+        }
+        std::string payload = encode(diskKey, flags, info);
+        auto        len     = static_cast<uint32_t>(payload.size());
+        newIndex[diskKey]   = static_cast<uint64_t>(out.tellp());
+        out.write(reinterpret_cast<const char *>(&len), sizeof(len));
+        out.write(payload.data(), payload.size());
+    }
+    out.close();
+    if (!out)
+    {
+        return;
+    }
+
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    if (!ec)
+    {
+        diskIndex_   = std::move(newIndex);
+        diskRecords_ = diskIndex_.size();
+    }
+}
+
+auto MediaProbeCache::PImpl::readRecord(uint64_t offset, FileKey &key, uint8_t &flags, MediaProbeInfo &info) const
+        -> bool
+{
+    std::ifstream file(cacheFilePath(), std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file.seekg(static_cast<std::streamoff>(offset));
+
+    uint32_t len = 0;
+    if (!file.read(reinterpret_cast<char *>(&len), sizeof(len)) || len > MAX_RECORD_BYTES)
+    {
+        return false;
+    }
+
+    std::string payload(len, '\0');
+    if (!file.read(payload.data(), len))
+    {
+        return false;
+    }
+    return decode(payload, key, flags, info);
+}
+
+auto MediaProbeCache::PImpl::appendRecord(const FileKey &key, uint8_t flags, const MediaProbeInfo &info) -> void
+{
+    std::error_code ec;
+    if (!storageDir_.empty() && !fs::exists(storageDir_, ec))
+    {
+        fs::create_directories(storageDir_, ec);
+    }
+
+    auto path     = cacheFilePath();
+    bool newFile  = !fs::exists(path, ec) || fs::file_size(path, ec) < sizeof(CACHE_MAGIC);
+    auto openMode = std::ios::binary | (newFile ? std::ios::trunc : std::ios::app);
+
+    std::ofstream file(path, openMode);
+    if (!file.is_open())
+    {
+        return; /// 缓存不可写时退化为纯内存缓存
+    }
+    if (newFile)
+    {
+        file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    }
+
+    std::string payload = encode(key, flags, info);
+    auto        len     = static_cast<uint32_t>(payload.size());
+    file.seekp(0, std::ios::end);
+    auto offset = static_cast<uint64_t>(file.tellp());
+    file.write(reinterpret_cast<const char *>(&len), sizeof(len));
+    file.write(payload.data(), payload.size());
+    if (!file)
+    {
+        return;
+    }
+
+    diskRecords_++;
+    if (flags & FLAG_TOMBSTONE)
+    {
+        diskIndex_.erase(key);
+    }
+    else
+    {
+        diskIndex_[key] = offset;
+    }
+}
+
+auto MediaProbeCache::PImpl::encode(const FileKey &key, uint8_t flags, const MediaProbeInfo &info) -> std::string
+{
+    BinaryWriter writer;
+    writer.put(key);
+    writer.put(flags);
+    if (flags & FLAG_TOMBSTONE)
+    {
+        return writer.data();
+    }
+
+    writer.put(info.duration);
+    writer.put(info.bitRate);
+    writer.putString(info.formatName);
+    writer.put(static_cast<uint32_t>(info.streams.size()));
+    for (const auto &stream : info.streams)
+    {
+        writer.put(static_cast<int32_t>(stream.index));
+        writer.putString(stream.codecType);
+        writer.putString(stream.codecName);
+        writer.putString(stream.profile);
+        writer.putString(stream.pixFmt);
+        writer.putString(stream.timeBase);
+        writer.putString(stream.extradataHash);
+        writer.put(static_cast<int32_t>(stream.level));
+        writer.put(static_cast<int32_t>(stream.hasBFrames));
+        writer.put(static_cast<int32_t>(stream.width));
+        writer.put(static_cast<int32_t>(stream.height));
+        writer.put(stream.sar);
+        writer.put(static_cast<int32_t>(stream.rotation));
+        writer.put(stream.fps);
+        writer.put(stream.bitRate);
+        writer.put(static_cast<int32_t>(stream.sampleRate));
+        writer.put(static_cast<int32_t>(stream.channels));
+    }
+
+    writer.put(static_cast<uint32_t>(info.keyframes.size()));
+    for (double ts : info.keyframes)
+    {
+        writer.put(ts);
+    }
+    return writer.data();
+}
+
+auto MediaProbeCache::PImpl::decode(std::string_view payload, FileKey &key, uint8_t &flags, MediaProbeInfo &info)
+        -> bool
+{
+    BinaryReader reader(payload);
+    if (!reader.get(key) || !reader.get(flags))
+    {
+        return false;
+    }
+    if (flags & FLAG_TOMBSTONE)
+    {
+        return true;
+    }
+
+    info = MediaProbeInfo{};
+    uint32_t streamCount = 0;
+    if (!reader.get(info.duration) || !reader.get(info.bitRate) || !reader.getString(info.formatName) ||
+        !reader.get(streamCount))
+    {
+        return false;
+    }
+
+    info.streams.reserve(streamCount);
+    for (uint32_t i = 0; i < streamCount; ++i)
+    {
+        MediaStreamInfo stream;
+        int32_t         index = 0, level = 0, hasBFrames = 0, width = 0, height = 0;
+        int32_t         rotation = 0, sampleRate = 0, channels = 0;
+        if (!reader.get(index) || !reader.getString(stream.codecType) || !reader.getString(stream.codecName) ||
+            !reader.getString(stream.profile) || !reader.getString(stream.pixFmt) ||
+            !reader.getString(stream.timeBase) || !reader.getString(stream.extradataHash) || !reader.get(level) ||
+            !reader.get(hasBFrames) || !reader.get(width) || !reader.get(height) || !reader.get(stream.sar) ||
+            !reader.get(rotation) || !reader.get(stream.fps) || !reader.get(stream.bitRate) ||
+            !reader.get(sampleRate) || !reader.get(channels))
+        {
+            return false;
+        }
+        stream.index      = index;
+        stream.level      = level;
+        stream.hasBFrames = hasBFrames;
+        stream.width      = width;
+        stream.height     = height;
+        stream.rotation   = rotation;
+        stream.sampleRate = sampleRate;
+        stream.channels   = channels;
+        info.streams.push_back(std::move(stream));
+    }
+
+    uint32_t keyframeCount = 0;
+    if (!reader.get(keyframeCount))
+    {
+        return false;
+    }
+    info.keyframes.resize(keyframeCount);
+    for (auto &ts : info.keyframes)
+    {
+        if (!reader.get(ts))
+        {
+            return false;
+        }
+    }
+    info.hasKeyframeIndex = (flags & FLAG_KEYFRAMES) != 0;
+    return true;
+}
+
+auto MediaProbeCache::PImpl::runProbe(const std::string &path, MediaProbeInfo &info, std::string &errorMsg) -> bool
+{
+    std::string command = XTool::getFFprobePath() +
+            " -v error -show_data_hash crc32 -show_entries format=duration,bit_rate,format_name"
+            ":stream=index,codec_type,codec_name,profile,level,has_b_frames,pix_fmt,width,height,sample_aspect_ratio,"
+            "avg_frame_rate,r_frame_rate,time_base,extradata_hash,bit_rate,sample_rate,channels"
+            ":stream_side_data=rotation:stream_tags=rotate -of json \"" +
+            path + "\"";
+
+    XExec::XResult result = XExec::execute(command, false);
+    if (result.exitCode != 0)
+    {
+        errorMsg = "FFprobe探测失败: " + result.stderrOutput;
+        return false;
+    }
+
+    try
+    {
+        auto root = json::parse(result.stdoutOutput);
+
+        info = MediaProbeInfo{};
+        if (root.contains("format"))
+        {
+            const auto &format = root.at("format");
+            info.duration      = jsonNumber(format, "duration");
+            info.bitRate       = static_cast<int64_t>(jsonNumber(format, "bit_rate"));
+            info.formatName    = jsonString(format, "format_name");
+        }
+
+        if (root.contains("streams") && root.at("streams").is_array())
+        {
+            for (const auto &node : root.at("streams"))
+            {
+                MediaStreamInfo stream;
+                stream.index      = static_cast<int>(jsonNumber(node, "index"));
+                stream.codecType  = jsonString(node, "codec_type");
+                stream.codecName  = jsonString(node, "codec_name");
+                stream.profile    = jsonString(node, "profile");
+                stream.pixFmt     = jsonString(node, "pix_fmt");
+                stream.timeBase   = jsonString(node, "time_base");
+                stream.level      = static_cast<int>(jsonNumber(node, "level"));
+                stream.hasBFrames = static_cast<int>(jsonNumber(node, "has_b_frames"));
+                stream.width      = static_cast<int>(jsonNumber(node, "width"));
+                stream.height     = static_cast<int>(jsonNumber(node, "height"));
+                stream.bitRate    = static_cast<int64_t>(jsonNumber(node, "bit_rate"));
+                stream.sampleRate = static_cast<int>(jsonNumber(node, "sample_rate"));
+                stream.channels   = static_cast<int>(jsonNumber(node, "channels"));
+
+                /// -show_data_hash 给出 "CRC32:xxxxxxxx"；两个片段只有参数集相同才能共用一份文件头
+                stream.extradataHash = jsonString(node, "extradata_hash");
+
+                /// "0:1" 表示未知，按方形像素处理
+                auto sar = jsonString(node, "sample_aspect_ratio");
+                std::ranges::replace(sar, ':', '/');
+                stream.sar = parseRational(sar);
+                if (stream.sar <= 0)
+                {
+                    stream.sar = 1.0;
+                }
+                stream.rotation = parseRotation(node);
+
+                stream.fps = parseRational(jsonString(node, "avg_frame_rate"));
+                if (stream.fps <= 0)
+                {
+                    stream.fps = parseRational(jsonString(node, "r_frame_rate"));
+                }
+                info.streams.push_back(std::move(stream));
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        errorMsg = "解析FFprobe输出失败: " + std::string(e.what());
+        return false;
+    }
+
+    return true;
+}
+
+auto MediaProbeCache::PImpl::runKeyframeProbe(const std::string &path, MediaProbeInfo &info, std::string &errorMsg)
+        -> bool
+{
+    /// 只扫描数据包标志位，不解码，比 -skip_frame nokey 快得多
+    std::string command = XTool::getFFprobePath() +
+            " -v error -select_streams v:0 -show_entries packet=pts_time,flags -of csv=p=0 \"" + path + "\"";
+
+    XExec::XResult result = XExec::execute(command, false);
+    if (result.exitCode != 0)
+    {
+        errorMsg = "FFprobe关键帧扫描失败: " + result.stderrOutput;
+        return false;
+    }
+
+    info.keyframes.clear();
+    std::istringstream stream(result.stdoutOutput);
+    std::string        line;
+    while (std::getline(stream, line))
+    {
+        auto comma = line.find(',');
+        if (comma == std::string::npos || line.find('K', comma) == std::string::npos)
+        {
+            continue;
+        }
+        try
+        {
+            info.keyframes.push_back(std::stod(line.substr(0, comma)));
+        }
+        catch (...)
+        {
+            /// pts 为 N/A
+        }
+    }
+    std::ranges::sort(info.keyframes);
+    info.hasKeyframeIndex = true;
+    return true;
+}
+
+/// ==================== MediaProbeCache ====================
+
+MediaProbeCache::MediaProbeCache() : impl_(std::make_unique<PImpl>(this))
+{
+}
+
+MediaProbeCache::~MediaProbeCache() = default;
+
+auto MediaProbeCache::setStorageDirectory(const fs::path &dir) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    if (impl_->storageDir_ == dir)
+    {
+        return;
+    }
+    impl_->storageDir_ = dir;
+    impl_->loaded_     = false;
+    impl_->diskIndex_.clear();
+}
+
+auto MediaProbeCache::storageDirectory() const -> fs::path
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->storageDir_;
+}
+
+auto MediaProbeCache::setCapacity(size_t capacity) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->capacity_ = std::max<size_t>(1, capacity);
+    while (impl_->lru_.size() > impl_->capacity_)
+    {
+        impl_->lruIndex_.erase(impl_->lru_.back().first);
+        impl_->lru_.pop_back();
+    }
+}
+
+auto MediaProbeCache::probe(const std::string_view &path, MediaProbeInfo &info, std::string &errorMsg) -> bool
+{
+    FileKey key;
+    if (!makeKey(path, key, errorMsg))
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        if (impl_->lookup(key, info))
+        {
+            return true;
+        }
+        impl_->stats_.misses++;
+    }
+
+    /// 探测在锁外进行，允许多个文件并行探测
+    if (!PImpl::runProbe(std::string(path), info, errorMsg))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->store(key, info);
+    return true;
+}
+
+auto MediaProbeCache::probeKeyframes(const std::string_view &path, MediaProbeInfo &info, std::string &errorMsg)
+        -> bool
+{
+    if (!probe(path, info, errorMsg))
+    {
+        return false;
+    }
+    if (info.hasKeyframeIndex)
+    {
+        return true;
+    }
+
+    FileKey key;
+    if (!makeKey(path, key, errorMsg) || !PImpl::runKeyframeProbe(std::string(path), info, errorMsg))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->store(key, info);
+    return true;
+}
+
+auto MediaProbeCache::duration(const std::string_view &path) -> double
+{
+    MediaProbeInfo info;
+    std::string    errorMsg;
+    return probe(path, info, errorMsg) ? info.duration : 0.0;
+}
+
+auto MediaProbeCache::invalidate(const std::string_view &path) -> void
+{
+    FileKey     key;
+    std::string errorMsg;
+    if (!makeKey(path, key, errorMsg))
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    if (auto it = impl_->lruIndex_.find(key); it != impl_->lruIndex_.end())
+    {
+        impl_->lru_.erase(it->second);
+        impl_->lruIndex_.erase(it);
+    }
+    impl_->ensureLoaded();
+    if (impl_->diskIndex_.contains(key))
+    {
+        impl_->appendRecord(key, FLAG_TOMBSTONE, MediaProbeInfo{});
+    }
+}
+
+auto MediaProbeCache::clear() -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->lru_.clear();
+    impl_->lruIndex_.clear();
+    impl_->diskIndex_.clear();
+    impl_->diskRecords_ = 0;
+    impl_->loaded_      = true;
+
+    std::error_code ec;
+    fs::remove(impl_->cacheFilePath(), ec);
+}
+
+auto MediaProbeCache::getStatistics() const -> Statistics
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    Statistics                  stats = impl_->stats_;
+    stats.memEntries                  = impl_->lru_.size();
+    stats.diskEntries                 = impl_->diskIndex_.size();
+    return stats;
+}
+
+auto MediaProbeCache::makeKey(const std::string_view &path, FileKey &key, std::string &errorMsg) -> bool
+{
+#ifdef _WIN32
+    struct _stat64 st;
+    fs::path       filePath(path);
+    if (_wstat64(filePath.wstring().c_str(), &st) != 0)
+    {
+        errorMsg = "无法获取文件信息: " + std::string(path);
+        return false;
+    }
+    /// Windows 下 st_ino 恒为0，用绝对路径哈希代替
+    std::error_code ec;
+    key.device  = static_cast<uint64_t>(st.st_dev);
+    key.inode   = std::hash<std::wstring>{}(fs::absolute(filePath, ec).wstring());
+    key.size    = static_cast<uint64_t>(st.st_size);
+    key.mtimeNs = static_cast<int64_t>(st.st_mtime) * 1000000000LL;
+#else
+    struct stat st;
+    if (::stat(std::string(path).c_str(), &st) != 0)
+    {
+        errorMsg = "无法获取文件信息: " + std::string(path);
+        return false;
+    }
+    key.device = static_cast<uint64_t>(st.st_dev);
+    key.inode  = static_cast<uint64_t>(st.st_ino);
+    key.size   = static_cast<uint64_t>(st.st_size);
+#ifdef __APPLE__
+    key.mtimeNs = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    key.mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+#endif
+    return true;
+}
@@ -0,0 +1,320 @@
+﻿#include "Metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    class Counter
+    {
+    public:
+        auto add(uint64_t value = 1) -> void
+        {
+            value_.fetch_add(value, std::memory_order_relaxed);
+        }
+
+        auto value() const -> uint64_t
+        {
+            return value_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<uint64_t> value_{ 0 };
+    };
+
+    class Gauge
+    {
+    public:
+        auto add(int64_t delta) -> void
+        {
+            value_.fetch_add(delta, std::memory_order_relaxed);
+        }
+
+        auto value() const -> int64_t
+        {
+            return value_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<int64_t> value_{ 0 };
+    };
+
+    /// 固定桶边界的直方图；observe 只做三次原子加
+    class Histogram
+    {
+    public:
+        explicit Histogram(std::vector<double> bounds) :
+            bounds_(std::move(bounds)), buckets_(std::make_unique<std::atomic<uint64_t>[]>(bounds_.size() + 1))
+        {
+        }
+
+        auto observe(double value) -> void
+        {
+            const auto index = std::ranges::lower_bound(bounds_, value) - bounds_.begin();
+            buckets_[index].fetch_add(1, std::memory_order_relaxed);
+            sum_.fetch_add(value, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /// 输出 _bucket（累积）、_sum 与 _count；labels 为已有的标签（不含花括号）
+        auto render(std::string &out, std::string_view name, std::string_view labels) const -> void;
+
+    private:
+        std::vector<double>                      bounds_;
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets_; ///< 最后一个为 +Inf
+        std::atomic<double>                      sum_{ 0.0 };
+        std::atomic<uint64_t>                    count_{ 0 };
+    };
+
+    auto formatNumber(double value) -> std::string
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.10g", value);
+        return buffer;
+    }
+
+    /// 标签值转义：反斜杠、双引号与换行
+    auto escapeLabel(std::string_view value) -> std::string
+    {
+        std::string escaped;
+        escaped.reserve(value.size());
+        for (const char c : value)
+        {
+            if (c == '\\' || c == '"')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (c == '\n')
+            {
+                escaped += "\\n";
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    auto writeHeader(std::string &out, std::string_view name, std::string_view type, std::string_view help) -> void
+    {
+        out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+        out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+    }
+
+    auto writeSample(std::string &out, std::string_view name, std::string_view labels, const std::string &value)
+            -> void
+    {
+        out.append(name);
+        if (!labels.empty())
+        {
+            out.append("{").append(labels).append("}");
+        }
+        out.append(" ").append(value).append("\n");
+    }
+
+    auto Histogram::render(std::string &out, std::string_view name, std::string_view labels) const -> void
+    {
+        const std::string bucket = std::string(name) + "_bucket";
+        const std::string prefix = labels.empty() ? std::string() : std::string(labels) + ",";
+
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i <= bounds_.size(); ++i)
+        {
+            cumulative += buckets_[i].load(std::memory_order_relaxed);
+            const auto le = i < bounds_.size() ? formatNumber(bounds_[i]) : std::string("+Inf");
+            writeSample(out, bucket, prefix + "le=\"" + le + "\"", std::to_string(cumulative));
+        }
+        writeSample(out, std::string(name) + "_sum", labels, formatNumber(sum_.load(std::memory_order_relaxed)));
+        writeSample(out, std::string(name) + "_count", labels, std::to_string(count_.load(std::memory_order_relaxed)));
+    }
+
+    const std::vector<double> kTaskSecondsBuckets  = { 0.1, 0.5, 1, 5, 15, 60, 300, 900, 3600 };
+    const std::vector<double> kWaitSecondsBuckets  = { 0.01, 0.1, 1, 5, 30, 120, 600, 1800 };
+    const std::vector<double> kSpawnSecondsBuckets = { 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25 };
+    const std::vector<double> kSpeedBuckets        = { 0.25, 0.5, 1, 2, 4, 8, 16, 32, 64 };
+} // namespace
+
+struct Metrics::TaskSeries
+{
+    Counter   executions;
+    Counter   failures;
+    Histogram seconds{ kTaskSecondsBuckets };
+};
+
+class Metrics::PImpl
+{
+public:
+    Gauge     jobsQueued_;
+    Gauge     jobsRunning_;
+    Counter   jobsSucceeded_;
+    Counter   jobsFailed_;
+    Counter   jobsDropped_;
+    Histogram jobWaitSeconds_{ kWaitSecondsBuckets };
+
+    Gauge tasksRunning_;
+
+    Counter   spawns_;
+    Counter   spawnFailures_;
+    Histogram spawnSeconds_{ kSpawnSecondsBuckets };
+
+    Counter   encodes_;
+    Counter   encodeFailures_;
+    Counter   outputBytes_;
+    Histogram encodeSpeed_{ kSpeedBuckets };
+
+    mutable std::mutex                                                taskMutex_;
+    std::map<std::string, std::unique_ptr<TaskSeries>, std::less<>> tasks_;
+};
+
+Metrics::Metrics() : impl_(std::make_unique<PImpl>())
+{
+}
+
+Metrics::~Metrics() = default;
+
+auto Metrics::jobQueued() -> void
+{
+    impl_->jobsQueued_.add(1);
+}
+
+auto Metrics::jobStarted(double waitSeconds) -> void
+{
+    impl_->jobsQueued_.add(-1);
+    impl_->jobsRunning_.add(1);
+    impl_->jobWaitSeconds_.observe(waitSeconds);
+}
+
+auto Metrics::jobFinished(bool success) -> void
+{
+    impl_->jobsRunning_.add(-1);
+    (success ? impl_->jobsSucceeded_ : impl_->jobsFailed_).add();
+}
+
+auto Metrics::jobsDropped(size_t count) -> void
+{
+    impl_->jobsQueued_.add(-static_cast<int64_t>(count));
+    impl_->jobsDropped_.add(count);
+}
+
+auto Metrics::taskStarted() -> void
+{
+    impl_->tasksRunning_.add(1);
+}
+
+auto Metrics::taskFinished(TaskSeries &series, double seconds, bool success) -> void
+{
+    impl_->tasksRunning_.add(-1);
+    series.executions.add();
+    if (!success)
+    {
+        series.failures.add();
+    }
+    series.seconds.observe(seconds);
+}
+
+auto Metrics::taskSeries(std::string_view task) -> TaskSeries &
+{
+    std::lock_guard<std::mutex> lock(impl_->taskMutex_);
+    auto                        it = impl_->tasks_.find(task);
+    if (it == impl_->tasks_.end())
+    {
+        it = impl_->tasks_.emplace(std::string(task), std::make_unique<TaskSeries>()).first;
+    }
+    return *it->second;
+}
+
+auto Metrics::processSpawned(double seconds, bool success) -> void
+{
+    impl_->spawns_.add();
+    if (!success)
+    {
+        impl_->spawnFailures_.add();
+        return;
+    }
+    impl_->spawnSeconds_.observe(seconds);
+}
+
+auto Metrics::encodeFinished(double speed, int64_t bytes, bool success) -> void
+{
+    impl_->encodes_.add();
+    if (!success)
+    {
+        impl_->encodeFailures_.add();
+    }
+    if (bytes > 0)
+    {
+        impl_->outputBytes_.add(static_cast<uint64_t>(bytes));
+    }
+    if (success && speed > 0)
+    {
+        impl_->encodeSpeed_.observe(speed);
+    }
+}
+
+auto Metrics::render() const -> std::string
+{
+    std::string out;
+    out.reserve(8 << 10);
+
+    std::vector<std::pair<std::string, const TaskSeries *>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(impl_->taskMutex_);
+        for (const auto &[name, series] : impl_->tasks_)
+        {
+            tasks.emplace_back("task=\"" + escapeLabel(name) + "\"", series.get());
+        }
+    }
+
+    writeHeader(out, "xve_task_executions_total", "counter", "任务执行次数");
+    for (const auto &[labels, series] : tasks)
+    {
+        writeSample(out, "xve_task_executions_total", labels, std::to_string(series->executions.value()));
+    }
+    writeHeader(out, "xve_task_failures_total", "counter", "任务失败次数");
+    for (const auto &[labels, series] : tasks)
+    {
+        writeSample(out, "xve_task_failures_total", labels, std::to_string(series->failures.value()));
+    }
+    writeHeader(out, "xve_task_duration_seconds", "histogram", "任务执行耗时（秒）");
+    for (const auto &[labels, series] : tasks)
+    {
+        series->seconds.render(out, "xve_task_duration_seconds", labels);
+    }
+    writeHeader(out, "xve_tasks_running", "gauge", "正在执行的任务数");
+    writeSample(out, "xve_tasks_running", "", std::to_string(impl_->tasksRunning_.value()));
+
+    writeHeader(out, "xve_jobs_queued", "gauge", "作业队列中等待的作业数");
+    writeSample(out, "xve_jobs_queued", "", std::to_string(impl_->jobsQueued_.value()));
+    writeHeader(out, "xve_jobs_running", "gauge", "作业队列中正在执行的作业数");
+    writeSample(out, "xve_jobs_running", "", std::to_string(impl_->jobsRunning_.value()));
+    writeHeader(out, "xve_jobs_total", "counter", "作业队列处理的作业数，按结果区分");
+    writeSample(out, "xve_jobs_total", "result=\"succeeded\"", std::to_string(impl_->jobsSucceeded_.value()));
+    writeSample(out, "xve_jobs_total", "result=\"failed\"", std::to_string(impl_->jobsFailed_.value()));
+    writeSample(out, "xve_jobs_total", "result=\"dropped\"", std::to_string(impl_->jobsDropped_.value()));
+    writeHeader(out, "xve_job_queue_wait_seconds", "histogram", "作业从提交到开始执行的等待时间（秒）");
+    impl_->jobWaitSeconds_.render(out, "xve_job_queue_wait_seconds", "");
+
+    writeHeader(out, "xve_process_spawns_total", "counter", "启动外部进程的次数");
+    writeSample(out, "xve_process_spawns_total", "", std::to_string(impl_->spawns_.value()));
+    writeHeader(out, "xve_process_spawn_failures_total", "counter", "启动外部进程失败的次数");
+    writeSample(out, "xve_process_spawn_failures_total", "", std::to_string(impl_->spawnFailures_.value()));
+    writeHeader(out, "xve_process_spawn_seconds", "histogram", "启动外部进程的耗时（秒）");
+    impl_->spawnSeconds_.render(out, "xve_process_spawn_seconds", "");
+
+    writeHeader(out, "xve_encodes_total", "counter", "ffmpeg 编码次数");
+    writeSample(out, "xve_encodes_total", "", std::to_string(impl_->encodes_.value()));
+    writeHeader(out, "xve_encode_failures_total", "counter", "ffmpeg 编码失败次数");
+    writeSample(out, "xve_encode_failures_total", "", std::to_string(impl_->encodeFailures_.value()));
+    writeHeader(out, "xve_encode_speed_ratio", "histogram", "ffmpeg 编码的平均速度倍数（相对实时）");
+    impl_->encodeSpeed_.render(out, "xve_encode_speed_ratio", "");
+    writeHeader(out, "xve_output_bytes_total", "counter", "ffmpeg 写出的字节数");
+    writeSample(out, "xve_output_bytes_total", "", std::to_string(impl_->outputBytes_.value()));
+
+    return out;
+}
@@ -0,0 +1,452 @@
+﻿#include "MetricsExporter.h"
+#include "Metrics.h"
+#include "XConst.h"
+
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr size_t MAX_REQUEST_BYTES = 8 << 10;
+    constexpr int    CLIENT_TIMEOUT_S  = 2; ///< 逐个处理连接，慢客户端最多占用这么久
+} // namespace
+
+class MetricsExporter::PImpl
+{
+public:
+    enum class Mode
+    {
+        None,
+        Unix,
+        Tcp,
+        File
+    };
+
+    explicit PImpl(MetricsExporter *owner);
+
+public:
+    /// 解析目标写法，填写 mode_、path_、port_
+    auto parseTarget(const std::string &target, std::string &errorMsg) -> bool;
+
+    auto fileLoop() -> void;
+
+#ifdef __linux__
+    auto openSocket(std::string &errorMsg) -> bool;
+    auto serveLoop() -> void;
+    auto handleClient(int fd) -> void;
+    auto closeSocket() -> void;
+#endif
+
+public:
+    MetricsExporter        *owner_ = nullptr;
+    mutable std::mutex      mutex_;
+    std::condition_variable cv_;
+    std::thread             thread_;
+    Mode                    mode_ = Mode::None;
+    std::string             path_;
+    uint16_t                port_       = 0;
+    int                     intervalMs_ = 15000;
+    bool                    stopping_   = false;
+    int                     listenFd_   = -1;
+    int                     wakeFds_[2] = { -1, -1 }; ///< stop 写入一个字节唤醒 poll
+};
+
+MetricsExporter::PImpl::PImpl(MetricsExporter *owner) : owner_(owner)
+{
+}
+
+auto MetricsExporter::PImpl::parseTarget(const std::string &target, std::string &errorMsg) -> bool
+{
+    if (target.starts_with("file:") || target.starts_with("unix:"))
+    {
+        mode_ = target.starts_with("file:") ? Mode::File : Mode::Unix;
+        path_ = target.substr(5);
+        if (path_.empty())
+        {
+            errorMsg = "缺少路径: " + target;
+            return false;
+        }
+        return true;
+    }
+
+    /// 只允许回环地址，指标不对外暴露
+    std::string_view port = target;
+    if (const auto colon = target.rfind(':'); colon != std::string::npos)
+    {
+        const auto host = std::string_view(target).substr(0, colon);
+        if (host != "127.0.0.1" && host != "localhost")
+        {
+            errorMsg = "只能监听回环地址: " + std::string(host);
+            return false;
+        }
+        port.remove_prefix(colon + 1);
+    }
+
+    unsigned   value  = 0;
+    const auto result = std::from_chars(port.data(), port.data() + port.size(), value);
+    if (result.ec != std::errc() || result.ptr != port.data() + port.size() || value == 0 || value > 65535)
+    {
+        errorMsg = "无效的指标目标: " + target + "（unix:<路径>、[127.0.0.1:]<端口> 或 file:<路径>）";
+        return false;
+    }
+    mode_ = Mode::Tcp;
+    port_ = static_cast<uint16_t>(value);
+    return true;
+}
+
+auto MetricsExporter::PImpl::fileLoop() -> void
+{
+    /// path_ 只在线程未运行时修改；被 stop 唤醒后再写一次再退出
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        lock.unlock();
+        std::string errorMsg;
+        MetricsExporter::writeTextfile(path_, errorMsg);
+        lock.lock();
+
+        if (stopping_)
+        {
+            break;
+        }
+        cv_.wait_for(lock, std::chrono::milliseconds(intervalMs_), [this] { return stopping_; });
+    }
+}
+
+#ifdef __linux__
+auto MetricsExporter::PImpl::openSocket(std::string &errorMsg) -> bool
+{
+    if (mode_ == Mode::Unix)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path_.size() >= sizeof(address.sun_path))
+        {
+            errorMsg = "套接字路径过长: " + path_;
+            return false;
+        }
+        std::memcpy(address.sun_path, path_.c_str(), path_.size() + 1);
+
+        /// 上次异常退出留下的套接字文件：连不上说明没有进程在监听，可以删除
+        std::error_code ec;
+        if (fs::is_socket(path_, ec))
+        {
+            const int  probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            const bool alive =
+                    probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+            if (probe >= 0)
+            {
+                ::close(probe);
+            }
+            if (alive)
+            {
+                errorMsg = "已有进程在监听: " + path_;
+                return false;
+            }
+            fs::remove(path_, ec);
+        }
+
+        listenFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd_ < 0 || ::bind(listenFd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+        {
+            errorMsg = "无法绑定套接字: " + path_ + " (" + std::strerror(errno) + ")";
+            return false;
+        }
+    }
+    else
+    {
+        sockaddr_in address{};
+        address.sin_family      = AF_INET;
+        address.sin_port        = htons(port_);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        const int reuse = 1;
+        listenFd_       = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd_ >= 0)
+        {
+            ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        }
+        if (listenFd_ < 0 || ::bind(listenFd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+        {
+            errorMsg = "无法绑定端口 127.0.0.1:" + std::to_string(port_) + " (" + std::strerror(errno) + ")";
+            return false;
+        }
+    }
+
+    if (::listen(listenFd_, 16) < 0)
+    {
+        errorMsg = std::string("无法监听: ") + std::strerror(errno);
+        return false;
+    }
+    if (::pipe2(wakeFds_, O_CLOEXEC | O_NONBLOCK) < 0)
+    {
+        errorMsg = std::string("无法创建唤醒管道: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+auto MetricsExporter::PImpl::serveLoop() -> void
+{
+    pollfd fds[2] = { { listenFd_, POLLIN, 0 }, { wakeFds_[0], POLLIN, 0 } };
+    while (true)
+    {
+        if (::poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents != 0)
+        {
+            break;
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            const int client = ::accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client >= 0)
+            {
+                handleClient(client);
+                ::close(client);
+            }
+        }
+    }
+}
+
+auto MetricsExporter::PImpl::handleClient(int fd) -> void
+{
+    const timeval timeout{ CLIENT_TIMEOUT_S, 0 };
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    /// 只需要请求行，读到头部结束为止
+    std::string request;
+    char        buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_BYTES)
+    {
+        const auto n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+        {
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    const auto lineEnd = request.find("\r\n");
+    if (lineEnd == std::string::npos)
+    {
+        return;
+    }
+    const std::string_view line   = std::string_view(request).substr(0, lineEnd);
+    const auto             space1 = line.find(' ');
+    const auto             space2 = line.find(' ', space1 == std::string_view::npos ? line.size() : space1 + 1);
+    const auto             method = line.substr(0, space1);
+    auto path = space1 == std::string_view::npos ? std::string_view() : line.substr(space1 + 1, space2 - space1 - 1);
+    path      = path.substr(0, path.find('?'));
+
+    std::string status = "200 OK";
+    std::string body;
+    if (method != "GET" && method != "HEAD")
+    {
+        status = "405 Method Not Allowed";
+        body   = "只支持 GET\n";
+    }
+    else if (path != "/metrics" && path != "/")
+    {
+        status = "404 Not Found";
+        body   = "指标路径为 /metrics\n";
+    }
+    else
+    {
+        body = Metrics::getInstance()->render();
+    }
+
+    std::string response = "HTTP/1.1 " + status +
+            "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: " +
+            std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    if (method != "HEAD")
+    {
+        response += body;
+    }
+
+    size_t sent = 0;
+    while (sent < response.size())
+    {
+        const auto n = ::send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            break;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+auto MetricsExporter::PImpl::closeSocket() -> void
+{
+    for (int *fd : { &listenFd_, &wakeFds_[0], &wakeFds_[1] })
+    {
+        if (*fd >= 0)
+        {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+    if (mode_ == Mode::Unix)
+    {
+        std::error_code ec;
+        fs::remove(path_, ec);
+    }
+}
+#endif
+
+MetricsExporter::MetricsExporter() : impl_(std::make_unique<PImpl>(this))
+{
+    /// 先构造指标单例，保证退出时它晚于本对象析构（析构时还要写最后一次）
+    Metrics::getInstance();
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+auto MetricsExporter::start(const std::string &target, int intervalMs, std::string &errorMsg) -> bool
+{
+    stop();
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->stopping_   = false;
+    impl_->intervalMs_ = intervalMs > 0 ? intervalMs : 15000;
+    if (!impl_->parseTarget(target, errorMsg))
+    {
+        impl_->mode_ = PImpl::Mode::None;
+        return false;
+    }
+
+    if (impl_->mode_ == PImpl::Mode::File)
+    {
+        const auto parent = fs::path(impl_->path_).parent_path();
+        std::error_code ec;
+        if (!parent.empty() && !fs::is_directory(parent, ec))
+        {
+            errorMsg     = "目录不存在: " + parent.string();
+            impl_->mode_ = PImpl::Mode::None;
+            return false;
+        }
+        impl_->thread_ = std::thread([this] { impl_->fileLoop(); });
+        return true;
+    }
+
+#ifdef __linux__
+    if (!impl_->openSocket(errorMsg))
+    {
+        impl_->closeSocket();
+        impl_->mode_ = PImpl::Mode::None;
+        return false;
+    }
+    impl_->thread_ = std::thread([this] { impl_->serveLoop(); });
+    return true;
+#else
+    errorMsg     = "当前平台只支持 file: 目标";
+    impl_->mode_ = PImpl::Mode::None;
+    return false;
+#endif
+}
+
+auto MetricsExporter::stop() -> void
+{
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        if (impl_->mode_ == PImpl::Mode::None)
+        {
+            return;
+        }
+        impl_->stopping_ = true;
+#ifdef __linux__
+        if (impl_->wakeFds_[1] >= 0)
+        {
+            const char byte = 1;
+            [[maybe_unused]] const auto n = ::write(impl_->wakeFds_[1], &byte, 1);
+        }
+#endif
+    }
+    impl_->cv_.notify_all();
+    if (impl_->thread_.joinable())
+    {
+        impl_->thread_.join();
+    }
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+#ifdef __linux__
+    impl_->closeSocket();
+#endif
+    impl_->mode_ = PImpl::Mode::None;
+}
+
+auto MetricsExporter::isRunning() const -> bool
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->mode_ != PImpl::Mode::None;
+}
+
+auto MetricsExporter::describe() const -> std::string
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    switch (impl_->mode_)
+    {
+        case PImpl::Mode::Unix:
+            return "unix:" + impl_->path_ + " (GET /metrics)";
+        case PImpl::Mode::Tcp:
+            return "http://127.0.0.1:" + std::to_string(impl_->port_) + "/metrics";
+        case PImpl::Mode::File:
+            return "file:" + impl_->path_ + "（每 " + std::to_string(impl_->intervalMs_) + " 毫秒重写）";
+        case PImpl::Mode::None:
+            break;
+    }
+    return "";
+}
+
+auto MetricsExporter::writeTextfile(const std::string &path, std::string &errorMsg) -> bool
+{
+    const std::string temp = path + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            errorMsg = "无法写入: " + temp;
+            return false;
+        }
+        file << Metrics::getInstance()->render();
+        if (!file.flush())
+        {
+            errorMsg = "写入失败: " + temp;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(temp, path, ec);
+    if (ec)
+    {
+        errorMsg = "无法替换 " + path + ": " + ec.message();
+        return false;
+    }
+    return true;
+}
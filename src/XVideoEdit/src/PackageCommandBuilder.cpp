@@ -0,0 +1,699 @@
+﻿#include "PackageCommandBuilder.h"
+#include "KeyStore.h"
+#include "MediaProbeCache.h"
+#include "XExec.h"
+#include "XTool.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    constexpr size_t CENC_KEY_BYTES = 16; ///< cenc-aes-ctr 固定 AES-128
+
+    /// 去掉 0x 前缀和 UUID 连字符，统一小写
+    auto normalizeHex(const std::string& value) -> std::string
+    {
+        std::string hex = value;
+        if (hex.starts_with("0x") || hex.starts_with("0X"))
+        {
+            hex = hex.substr(2);
+        }
+        std::erase(hex, '-');
+        std::ranges::transform(hex, hex.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return hex;
+    }
+
+    auto isHex(const std::string& value, size_t length) -> bool
+    {
+        return value.size() == length && std::ranges::all_of(value, [](unsigned char c) { return std::isxdigit(c); });
+    }
+
+    auto randomHex(size_t bytes) -> std::string
+    {
+        static const char               hexChars[] = "0123456789abcdef";
+        std::random_device              rd; /// 密钥材料直接取自系统随机源
+        std::uniform_int_distribution<> dis(0, 255);
+
+        std::string hex;
+        hex.reserve(bytes * 2);
+        for (size_t i = 0; i < bytes; ++i)
+        {
+            const auto byte = static_cast<uint8_t>(dis(rd));
+            hex.push_back(hexChars[byte >> 4]);
+            hex.push_back(hexChars[byte & 0x0F]);
+        }
+        return hex;
+    }
+
+    /// MPD 中 default_KID 使用 UUID 格式 8-4-4-4-12
+    auto kidToUuid(const std::string& kid) -> std::string
+    {
+        return kid.substr(0, 8) + "-" + kid.substr(8, 4) + "-" + kid.substr(12, 4) + "-" + kid.substr(16, 4) + "-" +
+                kid.substr(20);
+    }
+
+    auto readText(const fs::path& path, std::string& text) -> bool
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            return false;
+        }
+        text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    /// 先写临时文件再 rename，播放器不会读到写了一半的清单
+    auto replaceText(const fs::path& path, const std::string& text, std::string& errorMsg) -> bool
+    {
+        const fs::path temp = path.string() + ".tmp";
+        std::ofstream  out(temp, std::ios::binary | std::ios::trunc);
+        if (!out || !out.write(text.data(), static_cast<std::streamsize>(text.size())))
+        {
+            errorMsg = "无法写入清单文件: " + temp.string();
+            return false;
+        }
+        out.close();
+
+        std::error_code ec;
+        fs::rename(temp, path, ec);
+        if (ec)
+        {
+            errorMsg = "无法替换清单文件: " + ec.message();
+            return false;
+        }
+        return true;
+    }
+
+    auto base64(const std::string& bytes) -> std::string
+    {
+        static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        std::string out;
+        out.reserve((bytes.size() + 2) / 3 * 4);
+        for (size_t i = 0; i < bytes.size(); i += 3)
+        {
+            const size_t   n = std::min<size_t>(3, bytes.size() - i);
+            const uint32_t v = static_cast<uint32_t>(static_cast<uint8_t>(bytes[i])) << 16 |
+                    (n > 1 ? static_cast<uint32_t>(static_cast<uint8_t>(bytes[i + 1])) << 8 : 0) |
+                    (n > 2 ? static_cast<uint32_t>(static_cast<uint8_t>(bytes[i + 2])) : 0);
+            out.push_back(table[(v >> 18) & 0x3F]);
+            out.push_back(table[(v >> 12) & 0x3F]);
+            out.push_back(n > 1 ? table[(v >> 6) & 0x3F] : '=');
+            out.push_back(n > 2 ? table[v & 0x3F] : '=');
+        }
+        return out;
+    }
+
+    /// 通用系统（W3C Common PSSH, 1077efec-...）的 v1 pssh box，只携带一个 KID
+    auto commonPssh(const std::string& kid) -> std::string
+    {
+        static const char systemId[] = "1077efecc0b24d02ace33c1e52e2fb4b";
+
+        std::string box;
+        auto        put32 = [&box](uint32_t v)
+        {
+            for (int shift = 24; shift >= 0; shift -= 8)
+            {
+                box.push_back(static_cast<char>((v >> shift) & 0xFF));
+            }
+        };
+        auto putHex = [&box](const std::string& hex)
+        {
+            for (size_t i = 0; i + 1 < hex.size(); i += 2)
+            {
+                box.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+            }
+        };
+
+        put32(52);
+        box += "pssh";
+        put32(0x01000000); ///< version 1, flags 0
+        putHex(systemId);
+        put32(1);
+        putHex(kid);
+        put32(0);
+        return box;
+    }
+
+    /// 在每个 HLS 媒体播放列表的 #EXT-X-MAP 前写入 #EXT-X-KEY，主播放列表不含分片不需要
+    /// 覆盖单码率（index.m3u8）、多码率（stream_N/index.m3u8）和 both 模式的 media_N.m3u8
+    auto annotatePlaylists(const fs::path& outputDir, const std::string& kid, std::string& errorMsg) -> bool
+    {
+        const std::string keyTag = "#EXT-X-KEY:METHOD=SAMPLE-AES-CTR,URI=\"data:text/plain;base64," +
+                base64(commonPssh(kid)) + "\",KEYID=0x" + kid +
+                ",KEYFORMAT=\"urn:uuid:1077efec-c0b2-4d02-ace3-3c1e52e2fb4b\",KEYFORMATVERSIONS=\"1\"\n";
+
+        std::vector<fs::path> playlists;
+        std::error_code       ec;
+        for (const auto& entry : fs::directory_iterator(outputDir, ec))
+        {
+            if (entry.is_directory() && entry.path().filename().string().starts_with("stream_"))
+            {
+                playlists.push_back(entry.path() / "index.m3u8");
+            }
+            else if (entry.path().extension() == ".m3u8")
+            {
+                playlists.push_back(entry.path());
+            }
+        }
+
+        for (const auto& playlist : playlists)
+        {
+            std::string text;
+            if (!readText(playlist, text) || text.find("#EXTINF") == std::string::npos ||
+                text.find("#EXT-X-KEY") != std::string::npos)
+            {
+                continue;
+            }
+
+            auto pos = text.find("#EXT-X-MAP");
+            if (pos == std::string::npos)
+            {
+                pos = text.find("#EXTINF");
+            }
+            text.insert(pos, keyTag);
+            if (!replaceText(playlist, text, errorMsg))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// "5000k" / "5M" / "5000" → kbps
+    auto parseKbps(const std::string& value) -> int
+    {
+        try
+        {
+            size_t       pos    = 0;
+            const double number = std::stod(value, &pos);
+            const char   unit   = pos < value.size() ? static_cast<char>(std::tolower(value[pos])) : 'k';
+            return static_cast<int>(unit == 'm' ? number * 1000 : number);
+        }
+        catch (...)
+        {
+            return 0;
+        }
+    }
+
+    /// 常见高度的默认码率（kbps）
+    auto defaultBitrate(int height) -> int
+    {
+        if (height >= 2160)
+            return 16000;
+        if (height >= 1440)
+            return 9000;
+        if (height >= 1080)
+            return 5000;
+        if (height >= 720)
+            return 2800;
+        if (height >= 480)
+            return 1400;
+        return 800;
+    }
+} // namespace
+
+auto PackageCommandBuilder::parseRenditions(const std::string& value, std::vector<Rendition>& renditions,
+                                            std::string& errorMsg) -> bool
+{
+    std::stringstream ss(value);
+    std::string       item;
+    while (std::getline(ss, item, ','))
+    {
+        if (item.empty())
+        {
+            continue;
+        }
+
+        const auto  colon  = item.find(':');
+        std::string height = item.substr(0, colon);
+        if (!height.empty() && (height.back() == 'p' || height.back() == 'P'))
+        {
+            height.pop_back();
+        }
+
+        Rendition rendition;
+        try
+        {
+            rendition.height = std::stoi(height);
+        }
+        catch (...)
+        {
+            rendition.height = 0;
+        }
+        rendition.bitrate = colon == std::string::npos ? defaultBitrate(rendition.height)
+                                                       : parseKbps(item.substr(colon + 1));
+        if (rendition.height <= 0 || rendition.bitrate <= 0)
+        {
+            errorMsg = "无效的码率档位: " + item + "（格式如 1080:5000k,720:2800k,480）";
+            return false;
+        }
+        renditions.push_back(rendition);
+    }
+
+    /// 从高到低排列，与播放器选择顺序一致
+    std::ranges::sort(renditions, std::greater{}, &Rendition::height);
+    return true;
+}
+
+auto PackageCommandBuilder::parseOptions(const std::map<std::string, ParameterValue>& params) const
+        -> PackageCommandBuilder::PackageOptions
+{
+    PackageOptions options;
+    options.input  = params.at("--input").asString();
+    options.output = params.at("--output").asString();
+
+    if (params.contains("--format") && !params.at("--format").empty())
+        options.format = params.at("--format").asString();
+    if (params.contains("--segment"))
+        options.segment = params.at("--segment").asDouble();
+    if (params.contains("--renditions"))
+    {
+        std::string errorMsg;
+        parseRenditions(params.at("--renditions").asString(), options.renditions, errorMsg);
+    }
+
+    options.encrypt = params.contains("--encrypt") &&
+            (params.at("--encrypt").empty() || params.at("--encrypt").asBool());
+    if (params.contains("--key"))
+        options.key = normalizeHex(params.at("--key").asString());
+    if (params.contains("--kid"))
+        options.kid = normalizeHex(params.at("--kid").asString());
+    if (params.contains("--keystore"))
+        options.keystore = params.at("--keystore").asString();
+    if (params.contains("--master-key"))
+    {
+        options.derive_key = true;
+        options.master_key = params.at("--master-key").asString();
+    }
+    if (params.contains("--asset-id"))
+        options.asset_id = params.at("--asset-id").asString();
+
+    /// 给出密钥或主密钥即视为加密
+    options.encrypt = options.encrypt || !options.key.empty() || options.derive_key;
+    return options;
+}
+
+auto PackageCommandBuilder::resolveKey(const PackageOptions& options, bool generate, std::string& key,
+                                       std::string& kid, std::string& errorMsg) const -> bool
+{
+    const std::string assetId = options.asset_id.empty() ? KeyStore::assetIdFor(options.output) : options.asset_id;
+
+    std::shared_ptr<KeyStore> store;
+    if (!options.keystore.empty())
+    {
+        store = KeyStore::shared(options.keystore, errorMsg);
+        if (!store)
+        {
+            return false;
+        }
+    }
+
+    bool fromStore = false;
+    if (!options.key.empty())
+    {
+        key = options.key;
+        kid = options.kid;
+    }
+    else if (options.derive_key)
+    {
+        /// 主密钥派生：同一资源ID总是得到同一密钥与KID，无需保存密钥材料
+        std::vector<uint8_t> masterKey;
+        if (!KeyStore::loadMasterKey(options.master_key, masterKey, errorMsg))
+        {
+            return false;
+        }
+        KeyStore::derive(masterKey, assetId, CENC_KEY_BYTES, key, kid);
+    }
+    else if (store)
+    {
+        KeyStore::Entry entry;
+        const bool      found =
+                options.kid.empty() ? store->find(assetId, entry) : store->findByKid(options.kid, entry);
+        if (found && entry.derived)
+        {
+            errorMsg = "密钥库中的记录由主密钥派生，请提供 --master-key: " + entry.kid;
+            return false;
+        }
+        if (found && isHex(entry.key, CENC_KEY_BYTES * 2))
+        {
+            key       = entry.key;
+            kid       = entry.kid;
+            fromStore = true;
+        }
+        else if (generate)
+        {
+            key = randomHex(CENC_KEY_BYTES);
+            kid = options.kid.empty() ? randomHex(16) : options.kid;
+        }
+        else
+        {
+            errorMsg = "密钥库中没有资源的密钥: " + assetId;
+            return false;
+        }
+    }
+    else
+    {
+        errorMsg = "加密打包需要 --key/--kid、--master-key 或 --keystore";
+        return false;
+    }
+
+    /// 新密钥写入密钥库，供 decrypt/授权服务按资源ID或KID查找
+    if (store && generate && !fromStore)
+    {
+        KeyStore::Entry entry;
+        entry.assetId = assetId;
+        entry.kid     = kid;
+        entry.method  = "cenc-aes-ctr";
+        entry.derived = options.derive_key;
+        if (!options.derive_key)
+        {
+            entry.key = key;
+        }
+        if (!store->put(entry, errorMsg))
+        {
+            return false;
+        }
+        std::cout << "密钥已写入密钥库: " << options.keystore << " (资源ID: " << assetId << ")" << std::endl;
+    }
+    return true;
+}
+
+auto PackageCommandBuilder::build(const std::map<std::string, ParameterValue>& params) const -> std::string
+{
+    PackageOptions  options = parseOptions(params);
+    const fs::path  outputDir(options.output);
+    std::error_code ec;
+    fs::create_directories(outputDir, ec);
+
+    /// 是否有音频、源高度决定映射与码率档位
+    MediaProbeInfo info;
+    std::string    errorMsg;
+    const bool     probed   = MediaProbeCache::getInstance()->probe(options.input, info, errorMsg);
+    const bool     hasAudio = !probed || info.audioStream() != nullptr;
+    const auto*    video    = probed ? info.videoStream() : nullptr;
+
+    /// 不放大：高于源的档位跳过，至少保留最低的一档
+    auto renditions = options.renditions;
+    if (video && video->height > 0 && !renditions.empty())
+    {
+        const auto lowest = renditions.back();
+        std::erase_if(renditions,
+                      [&](const Rendition& rendition)
+                      {
+                          if (rendition.height <= video->height)
+                          {
+                              return false;
+                          }
+                          std::cout << "[打包] 跳过 " << rendition.height << "p（源只有 " << video->height << "p）"
+                                    << std::endl;
+                          return true;
+                      });
+        if (renditions.empty())
+        {
+            renditions.push_back(lowest);
+        }
+    }
+    const size_t variants = std::max<size_t>(1, renditions.size());
+
+    /// validate 时已生成并保存了密钥，这里只查找；取不到密钥时不能退化为明文切片
+    std::string key, kid;
+    if (options.encrypt && !resolveKey(options, false, key, kid, errorMsg))
+    {
+        std::cerr << "错误: " << errorMsg << std::endl;
+        return {};
+    }
+
+    std::stringstream cmd;
+    cmd << "\"" << XTool::getFFmpegPath() << "\" ";
+    cmd << "-hide_banner -progress " << XExec::progressTarget() << " -nostats -loglevel error ";
+    cmd << "-y "; /// 覆盖已有切片
+
+    cmd << "-i \"" << options.input << "\" ";
+
+    /// HLS 的每个变体需要自带音频，DASH 的音频只需一个自适应集
+    const bool hls         = options.format == "hls";
+    const int  audioCopies = hasAudio ? (hls ? static_cast<int>(variants) : 1) : 0;
+
+    if (renditions.empty())
+    {
+        /// 单一码率：流复制，只做切片（和加密）
+        cmd << "-map 0:v:0 ";
+        if (hasAudio)
+        {
+            cmd << "-map 0:a:0 ";
+        }
+        cmd << "-c copy ";
+    }
+    else
+    {
+        /// 多码率：解码一次，split 后各自缩放编码
+        cmd << "-filter_complex \"[0:v:0]";
+        if (variants > 1)
+        {
+            cmd << "split=" << variants;
+            for (size_t i = 0; i < variants; ++i)
+            {
+                cmd << "[s" << i << "]";
+            }
+            cmd << ";";
+            for (size_t i = 0; i < variants; ++i)
+            {
+                cmd << (i ? ";" : "") << "[s" << i << "]scale=-2:" << renditions[i].height << "[v" << i << "]";
+            }
+        }
+        else
+        {
+            cmd << "scale=-2:" << renditions[0].height << "[v0]";
+        }
+        cmd << "\" ";
+
+        for (size_t i = 0; i < variants; ++i)
+        {
+            const int bitrate = renditions[i].bitrate;
+            cmd << "-map \"[v" << i << "]\" -c:v:" << i << " libx264 -b:v:" << i << " " << bitrate << "k -maxrate:v:"
+                << i << " " << bitrate * 107 / 100 << "k -bufsize:v:" << i << " " << bitrate * 2 << "k ";
+        }
+        for (int i = 0; i < audioCopies; ++i)
+        {
+            cmd << "-map 0:a:0 ";
+        }
+        if (hasAudio)
+        {
+            cmd << "-c:a aac -b:a 128k -ac 2 ";
+        }
+
+        /// 各档位在相同时间点强制关键帧，切片边界对齐才能无缝切换码率
+        cmd << "-preset fast -pix_fmt yuv420p -sc_threshold 0 -force_key_frames \"expr:gte(t,n_forced*"
+            << options.segment << ")\" ";
+    }
+
+    /// CENC 参数交给切片使用的 mp4 封装器，切片时逐样本加密
+    std::string cenc;
+    if (options.encrypt)
+    {
+        cenc = "encryption_scheme=cenc-aes-ctr:encryption_key=" + key + ":encryption_kid=" + kid;
+    }
+
+    if (hls)
+    {
+        cmd << "-f hls -hls_time " << options.segment << " -hls_playlist_type vod -hls_segment_type fmp4 ";
+        cmd << "-hls_fmp4_init_filename init.mp4 -master_pl_name master.m3u8 ";
+
+        fs::path playlist = outputDir / "index.m3u8";
+        fs::path segments = outputDir / "seg_%05d.m4s";
+        if (variants > 1)
+        {
+            std::string streamMap;
+            for (size_t i = 0; i < variants; ++i)
+            {
+                streamMap += (i ? " v:" : "v:") + std::to_string(i);
+                if (hasAudio)
+                {
+                    streamMap += ",a:" + std::to_string(i);
+                }
+                fs::create_directories(outputDir / ("stream_" + std::to_string(i)), ec);
+            }
+            cmd << "-var_stream_map \"" << streamMap << "\" ";
+            playlist = outputDir / "stream_%v" / "index.m3u8";
+            segments = outputDir / "stream_%v" / "seg_%05d.m4s";
+        }
+        cmd << "-hls_segment_filename \"" << segments.string() << "\" ";
+        if (!cenc.empty())
+        {
+            cmd << "-hls_segment_options \"" << cenc << "\" ";
+        }
+        cmd << "\"" << playlist.string() << "\"";
+    }
+    else
+    {
+        cmd << "-f dash -seg_duration " << options.segment << " -use_template 1 -use_timeline 1 ";
+        cmd << "-adaptation_sets \"id=0,streams=v" << (hasAudio ? " id=1,streams=a" : "") << "\" ";
+        if (options.format == "both")
+        {
+            /// 同一组 fMP4 切片同时写出 HLS 播放列表，不需要第二次封装
+            cmd << "-hls_playlist 1 ";
+        }
+        if (!cenc.empty())
+        {
+            cmd << "-format_options \"" << cenc << "\" ";
+        }
+        cmd << "\"" << (outputDir / "manifest.mpd").string() << "\"";
+    }
+
+    return cmd.str();
+}
+
+auto PackageCommandBuilder::validate(const std::map<std::string, ParameterValue>& params, std::string& errorMsg) const
+        -> bool
+{
+    if (!params.contains("--input") || params.at("--input").empty())
+    {
+        errorMsg = "缺少输入文件参数(--input)";
+        return false;
+    }
+    if (!params.contains("--output") || params.at("--output").empty())
+    {
+        errorMsg = "缺少输出目录参数(--output)";
+        return false;
+    }
+
+    std::error_code ec;
+    if (fs::is_regular_file(params.at("--output").asString(), ec))
+    {
+        errorMsg = "输出路径是已存在的文件，请指定目录: " + params.at("--output").asString();
+        return false;
+    }
+
+    if (params.contains("--format") && !params.at("--format").empty())
+    {
+        const auto format = params.at("--format").asString();
+        if (format != "hls" && format != "dash" && format != "both")
+        {
+            errorMsg = "不支持的打包格式: " + format + "（可选 hls、dash、both）";
+            return false;
+        }
+    }
+
+    if (params.contains("--segment") && params.at("--segment").asDouble() <= 0)
+    {
+        errorMsg = "--segment 必须大于0";
+        return false;
+    }
+
+    if (params.contains("--renditions"))
+    {
+        std::vector<Rendition> renditions;
+        if (!parseRenditions(params.at("--renditions").asString(), renditions, errorMsg))
+        {
+            return false;
+        }
+    }
+
+    PackageOptions options = parseOptions(params);
+    if (!options.encrypt)
+    {
+        return true;
+    }
+
+    if (!options.key.empty() && !isHex(options.key, CENC_KEY_BYTES * 2))
+    {
+        errorMsg = "--key 必须是32位十六进制（cenc-aes-ctr 使用 AES-128）";
+        return false;
+    }
+    if (!options.kid.empty() && !isHex(options.kid, 32))
+    {
+        errorMsg = "--kid 必须是32位十六进制";
+        return false;
+    }
+    if (!options.key.empty() && options.kid.empty())
+    {
+        errorMsg = "指定 --key 时必须同时指定 --kid";
+        return false;
+    }
+    if (options.key.empty() && !options.derive_key && options.keystore.empty())
+    {
+        errorMsg = "加密打包需要 --key/--kid、--master-key 或 --keystore";
+        return false;
+    }
+
+    /// 密钥在这里确定（必要时生成并写入密钥库），失败则任务不启动
+    std::string key, kid;
+    return resolveKey(options, true, key, kid, errorMsg);
+}
+
+auto PackageCommandBuilder::getTitle(const std::map<std::string, ParameterValue>& params) const -> std::string
+{
+    const std::string format = params.contains("--format") && !params.at("--format").empty()
+            ? params.at("--format").asString()
+            : "hls";
+    return "打包(" + format + "): " + fs::path(params.at("--input").asString()).filename().string();
+}
+
+auto PackageCommandBuilder::annotateManifest(const std::map<std::string, ParameterValue>& params,
+                                             std::string& errorMsg) const -> bool
+{
+    PackageOptions options = parseOptions(params);
+    if (!options.encrypt)
+    {
+        return true;
+    }
+
+    /// validate 时已确定并保存了密钥，这里只查找不生成
+    std::string key, kid;
+    if (!resolveKey(options, false, key, kid, errorMsg))
+    {
+        return false;
+    }
+
+    const fs::path outputDir = options.output;
+    if (options.format != "dash" && !annotatePlaylists(outputDir, kid, errorMsg))
+    {
+        return false;
+    }
+    if (options.format == "hls")
+    {
+        return true;
+    }
+
+    const fs::path manifest = outputDir / "manifest.mpd";
+    std::string    xml;
+    if (!readText(manifest, xml))
+    {
+        errorMsg = "无法读取清单文件: " + manifest.string();
+        return false;
+    }
+    if (xml.find("<ContentProtection") != std::string::npos)
+    {
+        return true;
+    }
+
+    /// 通用 mp4protection 描述：播放器据此知道媒体为 CENC 加密，并按 default_KID 请求密钥
+    const std::string protection = "\n\t\t\t<ContentProtection schemeIdUri=\"urn:mpeg:dash:mp4protection:2011\" "
+                                   "value=\"cenc\" cenc:default_KID=\"" +
+            kidToUuid(kid) + "\"/>";
+
+    if (auto pos = xml.find("<MPD"); pos != std::string::npos && xml.find("xmlns:cenc") == std::string::npos)
+    {
+        xml.insert(pos + 4, " xmlns:cenc=\"urn:mpeg:cenc:2013\"");
+    }
+    for (auto pos = xml.find("<AdaptationSet"); pos != std::string::npos; pos = xml.find("<AdaptationSet", pos))
+    {
+        const auto end = xml.find('>', pos);
+        if (end == std::string::npos)
+        {
+            break;
+        }
+        xml.insert(end + 1, protection);
+        pos = end + 1 + protection.size();
+    }
+
+    return replaceText(manifest, xml, errorMsg);
+}
+
+IMPLEMENT_CREATE(PackageCommandBuilder);
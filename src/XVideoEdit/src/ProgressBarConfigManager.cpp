@@ -194,6 +194,8 @@ auto ProgressBarConfigManager::saveToFile(const std::string_view& filename) -> b
         configJson["blink"]             = config->blink;
         configJson["updateIntervalMs"]  = config->updateIntervalMs;
         configJson["hideCursor"]        = config->hideCursor;
+        configJson["stallTimeoutSec"]   = config->stallTimeoutSec;
+        configJson["stallRetries"]      = config->stallRetries;
         configJson["themeName"]         = config->themeName;
 
         namedConfigsJson[name] = configJson;
@@ -254,6 +256,8 @@ auto ProgressBarConfigManager::loadFromFile(const std::string_view& filename) ->
                 config->blink             = configJson.value("blink", false);
                 config->updateIntervalMs  = configJson.value("updateIntervalMs", 100);
                 config->hideCursor        = configJson.value("hideCursor", true);
+                config->stallTimeoutSec   = configJson.value("stallTimeoutSec", 120);
+                config->stallRetries      = configJson.value("stallRetries", 1);
                 config->themeName         = configJson.value("themeName", "");
 
                 impl_->namedConfigs_[name] = config;
@@ -0,0 +1,574 @@
+﻿#include "ProgressDashboard.h"
+#include "XFile.h"
+#include "XTool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    thread_local uint64_t t_threadTag     = 0;
+    thread_local bool     t_threadVisible = true;
+
+    /// UTF-8 字符的显示宽度（中日韩全角字符占两列）
+    auto codepointWidth(uint32_t cp) -> int
+    {
+        if ((cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0xA4CF) || (cp >= 0xAC00 && cp <= 0xD7A3) ||
+            (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0xFE30 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF60) ||
+            (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x20000 && cp <= 0x3FFFD))
+        {
+            return 2;
+        }
+        return 1;
+    }
+
+    /// 追加 text，按显示宽度截断或补空格到 width 列，返回实际占用列数
+    auto appendFitted(std::string &out, std::string_view text, int width, bool pad) -> int
+    {
+        int    used = 0;
+        size_t i    = 0;
+        while (i < text.size())
+        {
+            const auto c   = static_cast<unsigned char>(text[i]);
+            size_t     len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 1;
+            len            = std::min(len, text.size() - i);
+
+            uint32_t cp = len == 1 ? c : (c & (0xFF >> (len + 1)));
+            for (size_t k = 1; k < len; ++k)
+            {
+                cp = (cp << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3F);
+            }
+
+            const int w = codepointWidth(cp);
+            if (used + w > width)
+            {
+                break;
+            }
+            out.append(text.substr(i, len));
+            used += w;
+            i += len;
+        }
+        if (pad)
+        {
+            out.append(static_cast<size_t>(width - used), ' ');
+            used = width;
+        }
+        return used;
+    }
+
+    auto formatClock(double seconds) -> std::string
+    {
+        if (seconds < 0)
+        {
+            return "--:--:--";
+        }
+        const auto total = static_cast<long long>(seconds);
+        char       buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%02lld:%02lld:%02lld", total / 3600, total / 60 % 60, total % 60);
+        return buffer;
+    }
+} // namespace
+
+class ProgressDashboard::PImpl
+{
+public:
+    struct Job
+    {
+        uint64_t                               id  = 0;
+        uint64_t                               tag = 0;
+        std::string                            label;
+        std::shared_ptr<const ProgressMailbox> mailbox;
+        double                                 totalSeconds = 0.0;
+        double                                 startSeconds = 0.0;
+        std::chrono::steady_clock::time_point  started;
+        uint64_t                               seenVersion = 0;
+        ProgressSnapshot                       last;
+    };
+
+    PImpl(ProgressDashboard *owner);
+    ~PImpl() = default;
+
+public:
+    /// 帧监听回调：有变化时拼出一帧并写出，返回写出字节数
+    auto paint() -> size_t;
+
+    /// 输出到 stdout，是否原地重绘取决于 stdout 是否为终端
+    auto useStdout() -> void;
+
+    /// 以下方法调用方持有 mutex_
+    auto summarize(std::chrono::steady_clock::time_point now) const -> Summary;
+    auto formatRow(const Job &job, std::chrono::steady_clock::time_point now, int columns) -> std::string;
+    auto formatSummary(const Summary &summary, int columns) -> std::string;
+
+public:
+    ProgressDashboard                    *owner_ = nullptr;
+    mutable std::mutex                    mutex_;
+    std::vector<Job>                      jobs_;
+    /// 不绘制的任务（后台作业），只供 getJobProgress 读取
+    std::vector<Job>                      hiddenJobs_;
+    std::vector<std::string>              pending_; ///< 待输出到面板上方的完成记录
+    std::vector<std::string>              lines_;   ///< 本帧的面板行（复用）
+    std::vector<std::string>              drawn_;   ///< 终端上当前的面板行
+    std::string                           frame_;   ///< 输出缓冲（复用）
+    OutputSink                            sink_;
+    bool                                  interactive_ = false;
+    bool                                  dirty_       = false;
+    std::atomic<bool>                     enabled_{ false };
+    std::once_flag                        listenerOnce_;
+    uint64_t                              listenerId_ = 0;
+    uint64_t                              nextId_     = 1;
+    size_t                                completed_  = 0;
+    size_t                                failed_     = 0;
+    uint64_t                              bytesDone_  = 0; ///< 已结束任务的输出字节
+    std::chrono::steady_clock::time_point batchStart_;
+};
+
+ProgressDashboard::PImpl::PImpl(ProgressDashboard *owner) : owner_(owner)
+{
+    useStdout();
+}
+
+auto ProgressDashboard::PImpl::useStdout() -> void
+{
+    int columns  = 0;
+    int rows     = 0;
+    interactive_ = XTool::getTerminalSize(columns, rows);
+    sink_        = [](std::string_view frame)
+    {
+        std::fwrite(frame.data(), 1, frame.size(), stdout);
+        std::fflush(stdout);
+    };
+}
+
+auto ProgressDashboard::PImpl::summarize(std::chrono::steady_clock::time_point now) const -> Summary
+{
+    Summary summary;
+    summary.running   = jobs_.size();
+    summary.completed = completed_;
+    summary.failed    = failed_;
+    summary.bytesOut  = bytesDone_;
+
+    double remaining = 0.0;
+    bool   known     = false;
+    for (const auto &job : jobs_)
+    {
+        const auto &snap    = job.last;
+        const double elapse = std::chrono::duration<double>(now - job.started).count();
+        if (snap.fps > 0)
+        {
+            summary.framesPerSecond += snap.fps;
+        }
+        if (snap.speed > 0)
+        {
+            summary.speed += snap.speed;
+        }
+        if (snap.totalSize > 0)
+        {
+            summary.bytesOut += static_cast<uint64_t>(snap.totalSize);
+            if (elapse >= 1.0)
+            {
+                summary.bytesPerSecond += snap.totalSize / elapse;
+            }
+        }
+        if (job.totalSeconds > 0)
+        {
+            const double done = snap.outTimeUs >= 0 ? snap.outTimeSeconds() - job.startSeconds : 0.0;
+            remaining += std::max(0.0, job.totalSeconds - done);
+            known = true;
+        }
+    }
+
+    /// 整批 ETA：剩余媒体时长按总吞吐量消化
+    if (known && summary.speed > 0)
+    {
+        summary.etaSeconds = remaining / summary.speed;
+    }
+    return summary;
+}
+
+auto ProgressDashboard::PImpl::formatRow(const Job &job, std::chrono::steady_clock::time_point now, int columns)
+        -> std::string
+{
+    constexpr int kLabelWidth = 24;
+    constexpr int kBarWidth   = 20;
+
+    const auto  &snap    = job.last;
+    const double current = snap.outTimeUs >= 0 ? std::max(0.0, snap.outTimeSeconds() - job.startSeconds) : 0.0;
+    const double percent = job.totalSeconds > 0 ? std::min(100.0, current / job.totalSeconds * 100.0) : -1.0;
+    const double elapse  = std::chrono::duration<double>(now - job.started).count();
+
+    std::string row;
+    row.reserve(160);
+    appendFitted(row, job.label, kLabelWidth, true);
+
+    const int filled = percent >= 0 ? static_cast<int>(percent / 100.0 * kBarWidth) : 0;
+    row += " [";
+    row.append(static_cast<size_t>(filled), '#');
+    row.append(static_cast<size_t>(kBarWidth - filled), percent >= 0 ? '-' : '.');
+    row += "] ";
+
+    char percentText[16] = "--";
+    char speedText[16]   = "--";
+    if (percent >= 0)
+    {
+        std::snprintf(percentText, sizeof(percentText), "%.0f%%", percent);
+    }
+    if (snap.speed >= 0)
+    {
+        std::snprintf(speedText, sizeof(speedText), "%.3gx", snap.speed);
+    }
+
+    /// 运行不足 1 秒时平均速率没有意义
+    const auto rate = snap.totalSize > 0 && elapse >= 1.0 ? static_cast<uintmax_t>(snap.totalSize / elapse) : 0;
+    const auto eta  = job.totalSeconds > 0 && snap.speed > 0 ? (job.totalSeconds - current) / snap.speed : -1.0;
+
+    char buffer[160];
+    std::snprintf(buffer, sizeof(buffer), "%4s %s/%s %6s %5.0ffps %9s/s ETA %s", percentText,
+                  formatClock(current).c_str(), formatClock(job.totalSeconds > 0 ? job.totalSeconds : -1).c_str(),
+                  speedText, std::max(0.0, snap.fps), XFile::formatFileSize(rate).c_str(), formatClock(eta).c_str());
+    row += buffer;
+
+    /// 行宽不能超过终端宽度，否则自动换行会打乱光标回退
+    std::string fitted;
+    appendFitted(fitted, row, columns - 1, false);
+    return fitted;
+}
+
+auto ProgressDashboard::PImpl::formatSummary(const Summary &summary, int columns) -> std::string
+{
+    char buffer[256];
+    std::snprintf(buffer, sizeof(buffer),
+                  "总计 运行 %zu 完成 %zu 失败 %zu | %.0f fps | %.2fx | %s/s | 已输出 %s | ETA %s", summary.running,
+                  summary.completed, summary.failed, summary.framesPerSecond, summary.speed,
+                  XFile::formatFileSize(static_cast<uintmax_t>(summary.bytesPerSecond)).c_str(),
+                  XFile::formatFileSize(summary.bytesOut).c_str(), formatClock(summary.etaSeconds).c_str());
+
+    std::string fitted;
+    appendFitted(fitted, buffer, columns - 1, false);
+    return fitted;
+}
+
+auto ProgressDashboard::PImpl::paint() -> size_t
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    bool changed = dirty_;
+    for (auto &job : jobs_)
+    {
+        if (job.mailbox->version() != job.seenVersion)
+        {
+            job.seenVersion = job.mailbox->load(job.last);
+            changed         = true;
+        }
+    }
+    if (!changed)
+    {
+        return 0;
+    }
+    dirty_ = false;
+
+    const auto now     = std::chrono::steady_clock::now();
+    const auto summary = summarize(now);
+    const bool ended   = jobs_.empty();
+    if (ended && (completed_ + failed_) > 0)
+    {
+        char buffer[256];
+        std::snprintf(buffer, sizeof(buffer), "=== 批次完成: %zu 个任务, 失败 %zu, 输出 %s, 用时 %s ===",
+                      completed_ + failed_, failed_, XFile::formatFileSize(bytesDone_).c_str(),
+                      formatClock(std::chrono::duration<double>(now - batchStart_).count()).c_str());
+        pending_.emplace_back(buffer);
+        completed_ = 0;
+        failed_    = 0;
+        bytesDone_ = 0;
+    }
+
+    frame_.clear();
+
+    /// 非终端：只输出完成记录
+    if (!interactive_)
+    {
+        for (const auto &line : pending_)
+        {
+            frame_ += line;
+            frame_ += '\n';
+        }
+        pending_.clear();
+        if (!frame_.empty())
+        {
+            sink_(frame_);
+        }
+        return frame_.size();
+    }
+
+    int columns = 120;
+    int rows    = 40;
+    XTool::getTerminalSize(columns, rows);
+    columns = std::max(columns, 20);
+
+    /// 面板高度不能超过终端，否则光标无法回到面板顶部
+    lines_.clear();
+    if (!ended)
+    {
+        const size_t maxRows = static_cast<size_t>(std::max(2, rows - 2));
+        const size_t visible = jobs_.size() + 1 <= maxRows ? jobs_.size() : maxRows - 2;
+        for (size_t i = 0; i < visible; ++i)
+        {
+            lines_.push_back(formatRow(jobs_[i], now, columns));
+        }
+        if (visible < jobs_.size())
+        {
+            lines_.push_back("... 另有 " + std::to_string(jobs_.size() - visible) + " 个任务");
+        }
+        lines_.push_back(formatSummary(summary, columns));
+    }
+
+    /// 回到面板顶部
+    if (!drawn_.empty())
+    {
+        frame_ += "\r\x1b[" + std::to_string(drawn_.size()) + "A";
+    }
+    else if (!ended)
+    {
+        frame_ += "\x1b[?25l";
+    }
+
+    /// 有完成记录插入时整块重画，否则只重发变化的行
+    const bool full = !pending_.empty();
+    for (const auto &line : pending_)
+    {
+        frame_ += "\x1b[2K";
+        frame_ += line;
+        frame_ += '\n';
+    }
+    for (size_t i = 0; i < lines_.size(); ++i)
+    {
+        if (!full && i < drawn_.size() && drawn_[i] == lines_[i])
+        {
+            frame_ += '\n';
+            continue;
+        }
+        frame_ += "\x1b[2K";
+        frame_ += lines_[i];
+        frame_ += '\n';
+    }
+
+    /// 面板变矮时清掉多余的旧行
+    const size_t written = pending_.size() + lines_.size();
+    if (written < drawn_.size())
+    {
+        const size_t extra = drawn_.size() - written;
+        for (size_t i = 0; i < extra; ++i)
+        {
+            frame_ += "\x1b[2K\n";
+        }
+        frame_ += "\x1b[" + std::to_string(extra) + "A";
+    }
+    if (ended)
+    {
+        frame_ += "\x1b[?25h";
+    }
+
+    pending_.clear();
+    drawn_.swap(lines_);
+    sink_(frame_);
+    return frame_.size();
+}
+
+ProgressDashboard::ProgressDashboard() : impl_(std::make_unique<PImpl>(this))
+{
+    /// 先构造渲染器：静态对象逆序析构，保证面板析构时渲染器仍然存在
+    ProgressRenderer::getInstance();
+}
+
+ProgressDashboard::~ProgressDashboard()
+{
+    if (impl_->listenerId_ != 0)
+    {
+        ProgressRenderer::getInstance()->removeFrameListener(impl_->listenerId_);
+    }
+}
+
+auto ProgressDashboard::setEnabled(bool enabled) -> void
+{
+    impl_->enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+auto ProgressDashboard::isEnabled() const -> bool
+{
+    return impl_->enabled_.load(std::memory_order_relaxed);
+}
+
+auto ProgressDashboard::setOutput(const OutputSink &sink, bool interactive) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    if (sink)
+    {
+        impl_->sink_        = sink;
+        impl_->interactive_ = interactive;
+    }
+    else
+    {
+        impl_->useStdout();
+    }
+    impl_->drawn_.clear();
+}
+
+auto ProgressDashboard::addJob(const std::string_view &label, const std::shared_ptr<const ProgressMailbox> &mailbox,
+                               double totalSeconds, double startSeconds) -> uint64_t
+{
+    /// 渲染线程持有自身的锁后才会回调面板，注册必须在面板锁之外
+    auto *renderer = ProgressRenderer::getInstance();
+    std::call_once(impl_->listenerOnce_,
+                   [this, renderer]()
+                   { impl_->listenerId_ = renderer->addFrameListener([this]() { impl_->paint(); }); });
+
+    PImpl::Job job;
+    job.tag          = t_threadTag;
+    job.label        = std::string(label);
+    job.mailbox      = mailbox;
+    job.totalSeconds = totalSeconds;
+    job.startSeconds = startSeconds;
+    job.started      = std::chrono::steady_clock::now();
+    job.seenVersion  = mailbox->load(job.last);
+
+    if (!t_threadVisible)
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        job.id = impl_->nextId_++;
+        impl_->hiddenJobs_.push_back(std::move(job));
+        return impl_->hiddenJobs_.back().id;
+    }
+
+    uint64_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        if (impl_->jobs_.empty() && impl_->completed_ + impl_->failed_ == 0)
+        {
+            impl_->batchStart_ = std::chrono::steady_clock::now();
+        }
+
+        job.id = impl_->nextId_++;
+        impl_->jobs_.push_back(std::move(job));
+        impl_->dirty_ = true;
+        id            = impl_->jobs_.back().id;
+    }
+    renderer->notify();
+    return id;
+}
+
+auto ProgressDashboard::finishJob(uint64_t id, bool success, const std::string_view &message) -> void
+{
+    bool batchEnded = false;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        if (std::erase_if(impl_->hiddenJobs_, [id](const PImpl::Job &job) { return job.id == id; }) > 0)
+        {
+            return;
+        }
+
+        auto &jobs = impl_->jobs_;
+        auto  it   = std::ranges::find(jobs, id, &PImpl::Job::id);
+        if (it == jobs.end())
+        {
+            return;
+        }
+
+        it->mailbox->load(it->last);
+        const double elapse = std::chrono::duration<double>(std::chrono::steady_clock::now() - it->started).count();
+        const auto   bytes  = it->last.totalSize > 0 ? static_cast<uint64_t>(it->last.totalSize) : 0;
+
+        std::string line = success ? "✓ " : "✗ ";
+        line += it->label;
+        line += "  用时 " + formatClock(elapse) + "  输出 " + XFile::formatFileSize(bytes);
+        if (!message.empty())
+        {
+            line += "  ";
+            line += message;
+        }
+        impl_->pending_.push_back(std::move(line));
+
+        (success ? impl_->completed_ : impl_->failed_) += 1;
+        impl_->bytesDone_ += bytes;
+        jobs.erase(it);
+        impl_->dirty_ = true;
+        batchEnded    = jobs.empty();
+    }
+
+    /// 整批结束时同步输出最后一帧，不依赖渲染线程（进程可能随即退出）
+    if (batchEnded)
+    {
+        impl_->paint();
+    }
+    else
+    {
+        ProgressRenderer::getInstance()->notify();
+    }
+}
+
+auto ProgressDashboard::getSummary() const -> Summary
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->summarize(std::chrono::steady_clock::now());
+}
+
+auto ProgressDashboard::getJobProgress() const -> std::vector<JobProgress>
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+    std::vector<JobProgress> result;
+    result.reserve(impl_->jobs_.size() + impl_->hiddenJobs_.size());
+    for (const auto *jobs : { &impl_->jobs_, &impl_->hiddenJobs_ })
+    {
+        for (const auto &job : *jobs)
+        {
+            ProgressSnapshot snap;
+            const uint64_t   version = job.mailbox->load(snap);
+            const double     current =
+                    snap.outTimeUs >= 0 ? std::max(0.0, snap.outTimeSeconds() - job.startSeconds) : 0.0;
+            const double     percent =
+                    job.totalSeconds > 0 ? std::min(100.0, current / job.totalSeconds * 100.0) : -1.0;
+
+            JobProgress progress;
+            progress.tag          = job.tag;
+            progress.label        = job.label;
+            progress.version      = version;
+            progress.percent      = percent;
+            progress.seconds      = current;
+            progress.totalSeconds = job.totalSeconds;
+            progress.fps          = snap.fps;
+            progress.speed        = snap.speed;
+            progress.totalSize    = snap.totalSize;
+            result.push_back(std::move(progress));
+        }
+    }
+    return result;
+}
+
+auto ProgressDashboard::setThreadTag(uint64_t tag, bool visible) -> void
+{
+    t_threadTag     = tag;
+    t_threadVisible = visible;
+}
+
+auto ProgressDashboard::getThreadTag() -> uint64_t
+{
+    return t_threadTag;
+}
+
+auto ProgressDashboard::isThreadVisible() -> bool
+{
+    return t_threadVisible;
+}
+
+auto ProgressDashboard::renderFrame() -> size_t
+{
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        impl_->dirty_ = true;
+    }
+    return impl_->paint();
+}
@@ -0,0 +1,195 @@
+﻿#include "ProgressRenderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ProgressRenderer::PImpl
+{
+public:
+    struct Subscriber
+    {
+        uint64_t                               id = 0;
+        std::shared_ptr<const ProgressMailbox> mailbox;
+        DrawCallback                           draw;
+        uint64_t                               drawnVersion = 0; ///< 最近一次绘制的邮箱版本
+    };
+
+    using FrameListenerList = std::vector<std::pair<uint64_t, FrameListener>>;
+
+    PImpl(ProgressRenderer *owner);
+    ~PImpl();
+
+public:
+    auto ensureThread() -> void;
+
+    auto run() -> void;
+
+    /// 重绘有新版本的进度条（调用方持有 mutex_）
+    auto drawChanged(Subscriber &subscriber) -> bool;
+
+public:
+    ProgressRenderer       *owner_ = nullptr;
+    mutable std::mutex      mutex_; ///< 保护 subscribers_，重绘期间持有，保证 detach 后不再回调
+    std::vector<Subscriber> subscribers_;
+    FrameListenerList       frameListeners_;
+    uint64_t                nextId_ = 1;
+    std::thread             thread_;
+    std::atomic<uint64_t>   generation_{ 0 }; ///< 每次 notify 加一，渲染线程在其上等待
+    std::atomic<bool>       stop_{ false };
+    std::atomic<int>        frameIntervalMs_{ 100 };
+    std::atomic<uint64_t>   notifies_{ 0 };
+    std::atomic<uint64_t>   wakeups_{ 0 };
+    std::atomic<uint64_t>   frames_{ 0 };
+};
+
+ProgressRenderer::PImpl::PImpl(ProgressRenderer *owner) : owner_(owner)
+{
+}
+
+ProgressRenderer::PImpl::~PImpl()
+{
+    if (thread_.joinable())
+    {
+        stop_.store(true, std::memory_order_release);
+        generation_.fetch_add(1, std::memory_order_release);
+        generation_.notify_all();
+        thread_.join();
+    }
+}
+
+auto ProgressRenderer::PImpl::ensureThread() -> void
+{
+    if (!thread_.joinable())
+    {
+        thread_ = std::thread([this]() { run(); });
+    }
+}
+
+auto ProgressRenderer::PImpl::run() -> void
+{
+    uint64_t seen = generation_.load(std::memory_order_acquire);
+    while (!stop_.load(std::memory_order_acquire))
+    {
+        /// 没有新的发布时阻塞在 futex 上，不产生任何唤醒
+        generation_.wait(seen, std::memory_order_acquire);
+        if (stop_.load(std::memory_order_acquire))
+        {
+            break;
+        }
+        seen = generation_.load(std::memory_order_acquire);
+        wakeups_.fetch_add(1, std::memory_order_relaxed);
+
+        const auto frameStart = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto &subscriber : subscribers_)
+            {
+                drawChanged(subscriber);
+            }
+            for (auto &[id, listener] : frameListeners_)
+            {
+                listener();
+            }
+        }
+
+        /// 帧率上限：这段时间内到达的发布合并到下一帧
+        std::this_thread::sleep_until(frameStart +
+                                      std::chrono::milliseconds(frameIntervalMs_.load(std::memory_order_relaxed)));
+    }
+}
+
+auto ProgressRenderer::PImpl::drawChanged(Subscriber &subscriber) -> bool
+{
+    if (subscriber.mailbox->version() == subscriber.drawnVersion)
+    {
+        return false;
+    }
+
+    ProgressSnapshot snapshot;
+    subscriber.drawnVersion = subscriber.mailbox->load(snapshot);
+    if (subscriber.draw)
+    {
+        subscriber.draw(snapshot);
+    }
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+ProgressRenderer::ProgressRenderer() : impl_(std::make_unique<PImpl>(this))
+{
+}
+
+ProgressRenderer::~ProgressRenderer() = default;
+
+auto ProgressRenderer::setMaxFps(int fps) -> void
+{
+    impl_->frameIntervalMs_.store(fps > 0 ? std::max(1, 1000 / fps) : 100, std::memory_order_relaxed);
+}
+
+auto ProgressRenderer::attach(const std::shared_ptr<const ProgressMailbox> &mailbox, const DrawCallback &draw)
+        -> uint64_t
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->ensureThread();
+
+    PImpl::Subscriber subscriber;
+    subscriber.id           = impl_->nextId_++;
+    subscriber.mailbox      = mailbox;
+    subscriber.draw         = draw;
+    subscriber.drawnVersion = mailbox->version();
+    impl_->subscribers_.push_back(std::move(subscriber));
+    return impl_->subscribers_.back().id;
+}
+
+auto ProgressRenderer::detach(uint64_t id) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    auto &subscribers = impl_->subscribers_;
+    for (auto it = subscribers.begin(); it != subscribers.end(); ++it)
+    {
+        if (it->id == id)
+        {
+            /// 帧率限制可能让最后一个块还没画出来
+            impl_->drawChanged(*it);
+            subscribers.erase(it);
+            return;
+        }
+    }
+}
+
+auto ProgressRenderer::addFrameListener(const FrameListener &listener) -> uint64_t
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->ensureThread();
+    impl_->frameListeners_.emplace_back(impl_->nextId_++, listener);
+    return impl_->frameListeners_.back().first;
+}
+
+auto ProgressRenderer::removeFrameListener(uint64_t id) -> void
+{
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    std::erase_if(impl_->frameListeners_, [id](const auto &item) { return item.first == id; });
+}
+
+auto ProgressRenderer::notify() -> void
+{
+    impl_->notifies_.fetch_add(1, std::memory_order_relaxed);
+    impl_->generation_.fetch_add(1, std::memory_order_release);
+    impl_->generation_.notify_one();
+}
+
+auto ProgressRenderer::getStatistics() const -> Statistics
+{
+    Statistics stats;
+    stats.notifies = impl_->notifies_.load(std::memory_order_relaxed);
+    stats.wakeups  = impl_->wakeups_.load(std::memory_order_relaxed);
+    stats.frames   = impl_->frames_.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    stats.attached = impl_->subscribers_.size();
+    return stats;
+}
@@ -1,4 +1,5 @@
 ﻿#include "TaskManager.h"
+#include "Metrics.h"
 #include <algorithm>
 #include <iomanip>
 #include <sstream>
@@ -20,13 +21,21 @@ public:
 
     auto updateStatistics(bool success) -> void;
 
+    /// 执行该任务的延迟注册；调用方不持有 mtx_
+    auto ensureLoaded(const std::string_view& name) const -> void;
+
+    auto loadAll() const -> void;
+
 public:
-    TaskManager*           owenr_ = nullptr;
-    TaskInstanceInfo::List taskInstances_;   ///< 任务实例
-    TaskTypeConfig::List   taskTypeConfigs_; ///< 任务类型配置
-    mutable std::mutex     mtx_;
-    mutable Statistics     statistics_;       ///< 统计信息
-    TaskHistoryList        executionHistory_; ///< 执行历史
+    TaskManager*                                           owenr_ = nullptr;
+    TaskInstanceInfo::List                                 taskInstances_;    ///< 任务实例
+    TaskTypeConfig::List                                   taskTypeConfigs_;  ///< 任务类型配置
+    mutable std::mutex                                     mtx_;
+    mutable Statistics                                     statistics_;       ///< 统计信息
+    TaskHistoryList                                        executionHistory_; ///< 执行历史
+    std::map<std::string, size_t, std::less<>>             runningCount_;     ///< 各任务正在执行的数量
+    mutable std::map<std::string, TaskLoader, std::less<>> loaders_;          ///< 登记了但尚未注册的任务
+    mutable std::recursive_mutex                           loaderMtx_;        ///< 串行执行 loader
 };
 
 TaskManager::PImpl::PImpl(TaskManager* owenr) : owenr_(owenr)
@@ -66,6 +75,46 @@ auto TaskManager::PImpl::updateStatistics(bool success) -> void
     (success ? statistics_.successExecutions : statistics_.failedExecutions)++;
 }
 
+auto TaskManager::PImpl::ensureLoaded(const std::string_view& name) const -> void
+{
+    std::lock_guard<std::recursive_mutex> loadLock(loaderMtx_);
+
+    TaskLoader loader;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        const auto                  it = loaders_.find(name);
+        if (it == loaders_.end())
+        {
+            return;
+        }
+        loader = std::move(it->second);
+        loaders_.erase(it);
+    }
+
+    /// loader 通过 registerTask 等接口注册，这些接口会自己加锁
+    loader();
+}
+
+auto TaskManager::PImpl::loadAll() const -> void
+{
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (loaders_.empty())
+        {
+            return;
+        }
+        for (const auto& name : loaders_ | std::views::keys)
+        {
+            names.push_back(name);
+        }
+    }
+    for (const auto& name : names)
+    {
+        ensureLoaded(name);
+    }
+}
+
 TaskManager::TaskManager() : impl_(std::make_unique<TaskManager::PImpl>(this))
 {
     impl_->registerDefaultTaskTypes();
@@ -190,6 +239,12 @@ auto TaskManager::createAndRegisterTask(const std::string_view& taskName, const
         throw std::runtime_error("任务已存在: " + std::string{ taskName });
     }
 
+    /// 直接注册时取代同名的延迟注册
+    if (const auto it = impl_->loaders_.find(taskName); it != impl_->loaders_.end())
+    {
+        impl_->loaders_.erase(it);
+    }
+
     /// 查找任务类型配置
     auto typeIt = impl_->taskTypeConfigs_.find(typeName);
     if (typeIt == impl_->taskTypeConfigs_.end())
@@ -222,18 +277,17 @@ auto TaskManager::createAndRegisterTask(const std::string_view& taskName, const
     /// 创建任务
     auto task = config.taskCreator(taskName, func, taskDescription);
 
-    /// 设置进度条
+    /// 设置进度条（保留工厂，并发执行时每个副本各自创建）
     if (config.progressBarCreator)
     {
-        if (auto progressBar = config.progressBarCreator(taskName))
-        {
-            task->setProgressBar(progressBar);
-        }
+        task->setProgressBarFactory([creator = config.progressBarCreator, name = std::string{ taskName }]
+                                    { return creator(name); });
     }
 
     TaskInstanceInfo info{ .name             = std::string{ taskName },
                            .typeName         = std::string{ typeName },
                            .task             = task,
+                           .metrics          = &Metrics::getInstance()->taskSeries(taskName),
                            .createdTime      = std::chrono::system_clock::now(),
                            .lastExecutedTime = std::chrono::system_clock::now() };
     /// 注册任务实例
@@ -255,6 +309,27 @@ auto TaskManager::registerTask(const std::string_view& name, const XTask::TaskFu
     return *task;
 }
 
+auto TaskManager::registerTaskLoader(const std::string_view& name, const TaskLoader& loader) -> void
+{
+    if (name.empty() || !loader)
+    {
+        throw std::invalid_argument("任务名称与注册函数不能为空");
+    }
+
+    std::lock_guard<std::mutex> lock(impl_->mtx_);
+    if (impl_->taskInstances_.contains(name))
+    {
+        throw std::runtime_error("任务已存在: " + std::string{ name });
+    }
+    impl_->loaders_[std::string{ name }] = loader;
+}
+
+auto TaskManager::getPendingLoaderCount() const -> size_t
+{
+    std::lock_guard<std::mutex> lock(impl_->mtx_);
+    return impl_->loaders_.size();
+}
+
 auto TaskManager::registerTaskInstance(const std::string_view& name, const XTask::Ptr& task,
                                        const std::string_view& typeName) -> bool
 {
@@ -273,6 +348,7 @@ auto TaskManager::registerTaskInstance(const std::string_view& name, const XTask
     TaskInstanceInfo info{ .name             = std::string{ name },
                            .typeName         = typeName.empty() ? "default" : std::string{ typeName },
                            .task             = task,
+                           .metrics          = &Metrics::getInstance()->taskSeries(name),
                            .createdTime      = std::chrono::system_clock::now(),
                            .lastExecutedTime = std::chrono::system_clock::now() };
 
@@ -284,12 +360,14 @@ auto TaskManager::registerTaskInstance(const std::string_view& name, const XTask
 
 auto TaskManager::hasTaskInstance(const std::string_view& name) const -> bool
 {
+    impl_->ensureLoaded(name);
     std::lock_guard<std::mutex> lock(impl_->mtx_);
     return impl_->taskInstances_.contains(name);
 }
 
 auto TaskManager::getTaskInstance(const std::string_view& name) const -> XTask::Ptr
 {
+    impl_->ensureLoaded(name);
     std::lock_guard<std::mutex> lock(impl_->mtx_);
 
     auto it = impl_->taskInstances_.find(name);
@@ -304,74 +382,89 @@ auto TaskManager::getTaskInstance(const std::string_view& name) const -> XTask::
 auto TaskManager::executeTask(const std::string_view& name, const std::map<std::string, std::string>& params,
                               std::string& error) -> bool
 {
-    std::lock_guard<std::mutex> lock(impl_->mtx_);
+    impl_->ensureLoaded(name);
 
-    const auto it = impl_->taskInstances_.find(name);
-    if (it == impl_->taskInstances_.end())
+    XTask::Ptr           task;
+    Metrics::TaskSeries* series = nullptr;
+    const auto           now = std::chrono::system_clock::now();
     {
-        error = "任务不存在: " + std::string{ name };
-        return false;
-    }
+        std::lock_guard<std::mutex> lock(impl_->mtx_);
 
-    auto& taskInfo = it->second;
-    auto  task     = taskInfo.task;
+        const auto it = impl_->taskInstances_.find(name);
+        if (it == impl_->taskInstances_.end())
+        {
+            error = "任务不存在: " + std::string{ name };
+            return false;
+        }
 
-    if (!task)
-    {
-        error = "任务对象无效: " + std::string{ name };
-        return false;
-    }
+        auto& taskInfo = it->second;
+        if (!taskInfo.task)
+        {
+            error = "任务对象无效: " + std::string{ name };
+            return false;
+        }
+
+        /// 同一任务已在执行时使用副本：参数表与进度条按执行隔离
+        auto& running = impl_->runningCount_[std::string{ name }];
+        task          = running > 0 ? taskInfo.task->clone() : taskInfo.task;
+        ++running;
+        series = taskInfo.metrics;
 
-    try
-    {
-        auto now                  = std::chrono::system_clock::now();
         taskInfo.lastExecutedTime = now;
         taskInfo.executionCount++;
-
         impl_->statistics_.totalExecutions++;
+    }
 
-        bool success = task->doExecute(params, error);
+    /// 执行期间不持有锁，其他任务（监视目录、后台作业）可以同时执行
+    auto* metrics = Metrics::getInstance();
+    metrics->taskStarted();
+    const auto  started = std::chrono::steady_clock::now();
+    bool        success = false;
+    std::string exceptionMsg;
+    try
+    {
+        success = task->doExecute(params, error);
+    }
+    catch (const std::exception& e)
+    {
+        error        = std::string("执行异常: ") + e.what();
+        exceptionMsg = e.what();
+    }
+    metrics->taskFinished(*series, std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count(),
+                          success);
 
-        /// 更新统计信息
-        impl_->updateStatistics(success);
+    std::lock_guard<std::mutex> lock(impl_->mtx_);
+    impl_->runningCount_[std::string{ name }]--;
 
-        /// 更新任务实例统计
-        if (success)
-        {
-            taskInfo.successCount++;
-        }
-        else
-        {
-            taskInfo.failureCount++;
-        }
+    /// 更新统计信息
+    impl_->updateStatistics(success);
 
-        /// 记录执行历史
-        std::stringstream ss;
-        auto              time_t_now = std::chrono::system_clock::to_time_t(now);
-        ss << std::put_time(std::localtime(&time_t_now), "%Y-%m-%d %H:%M:%S") << " - "
-           << (success ? "成功" : "失败: " + error);
-        impl_->addExecutionHistory(name, ss.str());
+    /// 更新任务实例统计（执行期间实例可能已被移除）
+    if (const auto it = impl_->taskInstances_.find(name); it != impl_->taskInstances_.end())
+    {
+        (success ? it->second.successCount : it->second.failureCount)++;
+    }
 
-        return success;
+    /// 记录执行历史
+    std::stringstream ss;
+    auto              time_t_now = std::chrono::system_clock::to_time_t(now);
+    ss << std::put_time(std::localtime(&time_t_now), "%Y-%m-%d %H:%M:%S") << " - ";
+    if (!exceptionMsg.empty())
+    {
+        ss << "异常: " << exceptionMsg;
     }
-    catch (const std::exception& e)
+    else
     {
-        error = std::string("执行异常: ") + e.what();
-        taskInfo.failureCount++;
-        impl_->updateStatistics(false);
-
-        std::stringstream ss;
-        auto              now        = std::chrono::system_clock::now();
-        auto              time_t_now = std::chrono::system_clock::to_time_t(now);
-        ss << std::put_time(std::localtime(&time_t_now), "%Y-%m-%d %H:%M:%S") << " - 异常: " << e.what();
-        impl_->addExecutionHistory(name, ss.str());
-
-        return false;
+        ss << (success ? "成功" : "失败: " + error);
     }
+    impl_->addExecutionHistory(name, ss.str());
+
+    return success;
 }
 
 auto TaskManager::getTaskInstanceNames() const -> std::vector<std::string>
 {
+    impl_->loadAll();
     std::lock_guard<std::mutex> lock(impl_->mtx_);
 
     std::vector<std::string> names;
@@ -388,12 +481,14 @@ auto TaskManager::getTaskInstanceNames() const -> std::vector<std::string>
 
 auto TaskManager::getTaskInstanceCount() const -> size_t
 {
+    impl_->loadAll();
     std::lock_guard<std::mutex> lock(impl_->mtx_);
     return impl_->taskInstances_.size();
 }
 
 auto TaskManager::getTaskInstanceInfo(const std::string_view& name) const -> TaskInstanceInfo::Option
 {
+    impl_->ensureLoaded(name);
     std::lock_guard<std::mutex> lock(impl_->mtx_);
     if (const auto it = impl_->taskInstances_.find(name); it != impl_->taskInstances_.end())
     {
@@ -407,6 +502,11 @@ auto TaskManager::getTaskInstanceInfo(const std::string_view& name) const -> Tas
 auto TaskManager::removeTaskInstance(const std::string_view& name) -> bool
 {
     std::lock_guard<std::mutex> lock(impl_->mtx_);
+    if (const auto it = impl_->loaders_.find(name); it != impl_->loaders_.end())
+    {
+        impl_->loaders_.erase(it);
+        return true;
+    }
 
     if (impl_->taskInstances_.erase(std::string{ name }) > 0)
     {
@@ -421,6 +521,7 @@ auto TaskManager::removeTaskInstance(const std::string_view& name) -> bool
 auto TaskManager::clearAllTaskInstances() -> void
 {
     std::lock_guard<std::mutex> lock(impl_->mtx_);
+    impl_->loaders_.clear();
 
     impl_->taskInstances_.clear();
     impl_->executionHistory_.clear();
@@ -429,6 +530,7 @@ auto TaskManager::clearAllTaskInstances() -> void
 
 auto TaskManager::getStatistics() const -> TaskManager::Statistics
 {
+    impl_->loadAll();
     std::lock_guard<std::mutex> lock(impl_->mtx_);
     return impl_->statistics_;
 }
@@ -473,6 +575,7 @@ auto TaskManager::createSimpleTask(const std::string_view& taskName, const XTask
 
 auto TaskManager::getTaskInfo() const -> std::map<std::string, std::string>
 {
+    impl_->loadAll();
     std::lock_guard<std::mutex> lock(impl_->mtx_);
 
     std::map<std::string, std::string> info;
@@ -487,6 +590,7 @@ auto TaskManager::getTaskInfo() const -> std::map<std::string, std::string>
 
 auto TaskManager::getTaskInstances() const -> XTask::List
 {
+    impl_->loadAll();
     std::lock_guard<std::mutex> lock(impl_->mtx_);
 
     static XTask::List tasks;
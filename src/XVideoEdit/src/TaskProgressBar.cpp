@@ -1,14 +1,15 @@
 ﻿#include "TaskProgressBar.h"
 
 #include "ProgressBarConfigManager.h"
+#include "ProgressDashboard.h"
 #include "XExec.h"
 
 #include <indicators/progress_bar.hpp>
 #include <indicators/cursor_control.hpp>
 
+#include <atomic>
 #include <filesystem>
 #include <iostream>
-#include <thread>
 #include <chrono>
 #include <sstream>
 
@@ -74,41 +75,46 @@ auto TaskProgressBar::PImpl::setupProgressBar(const std::string_view& title) ->
     currentPercent_ = 0.0f;
     isActive_       = true;
 
-    /// 隐藏光标以获得更流畅的显示
-    show_console_cursor(false);
+    /// 隐藏光标以获得更流畅的显示（后台作业不动终端）
+    if (ProgressDashboard::isThreadVisible())
+    {
+        show_console_cursor(false);
+    }
 }
 
 void TaskProgressBar::PImpl::showGenericImpl(XExec& exec, const std::string_view& taskName)
 {
     owner_->setTitle(taskName);
 
-    std::cout << "\n开始" << taskName << std::endl;
+    /// 后台作业不输出，只等待进程退出
+    const bool visible = ProgressDashboard::isThreadVisible();
+    if (visible)
+    {
+        std::cout << "\n开始" << taskName << std::endl;
+    }
+    owner_->setMessage("运行中...");
     owner_->updateDisplay();
 
-    auto  startTime = std::chrono::steady_clock::now();
-    float progress  = 0.0f;
+    /// 没有进度来源，不模拟进度，阻塞等待进程退出（期间不产生任何唤醒）
+    auto startTime = std::chrono::steady_clock::now();
+    int  exitCode  = exec.wait();
+    auto elapsed   = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - startTime);
 
-    /// 简单的主循环
-    while (exec.isRunning())
+    std::stringstream message;
+    message << " 用时 " << elapsed.count() << " 秒";
+    if (exitCode != 0)
     {
-        auto now     = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - startTime);
-
-        /// 简单模拟进度
-        progress = std::min(progress + 0.2f, 99.0f);
-        owner_->setValue(progress);
-
-        std::stringstream postfix;
-        postfix << "运行中... 已运行 " << elapsed.count() << " 秒";
-        owner_->setMessage(postfix.str());
-
-        owner_->updateDisplay();
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        markAsFailedImpl("失败 ✗" + message.str());
+    }
+    else
+    {
+        markAsCompletedImpl("任务完成 ✓" + message.str());
+    }
+    if (visible)
+    {
+        show_console_cursor(true);
+        std::cout << std::endl;
     }
-
-    markAsCompletedImpl("任务完成 ✓");
-    show_console_cursor(true);
-    std::cout << std::endl;
 }
 
 void TaskProgressBar::PImpl::updateProgressImpl(float percent, const std::string& message)
@@ -144,8 +150,12 @@ void TaskProgressBar::PImpl::markAsCompletedImpl(const std::string_view& message
 
     bar_.set_option(option::PostfixText{ message });
     bar_.set_option(option::ForegroundColor{ Color::green });
-    bar_.set_progress(100.f);
     isActive_ = false;
+    if (!ProgressDashboard::isThreadVisible())
+    {
+        return;
+    }
+    bar_.set_progress(100.f);
 }
 
 auto TaskProgressBar::PImpl::markAsFailedImpl(const std::string_view& message) -> void
@@ -157,8 +167,12 @@ auto TaskProgressBar::PImpl::markAsFailedImpl(const std::string_view& message) -
 
     bar_.set_option(option::PostfixText{ message });
     bar_.set_option(option::ForegroundColor{ Color::red });
-    bar_.print_progress();
     isActive_ = false;
+    if (!ProgressDashboard::isThreadVisible())
+    {
+        return;
+    }
+    bar_.print_progress();
 }
 
 
@@ -219,6 +233,10 @@ auto TaskProgressBar::markAsFailed(const std::string_view& message) -> void
     show_console_cursor(true);
 }
 
+auto TaskProgressBar::isStalled() const -> bool
+{
+    return false;
+}
 
 auto TaskProgressBar::applyConfig() -> void
 {
@@ -232,6 +250,11 @@ auto TaskProgressBar::getConfig() -> ProgressBarConfig::Ptr const
 
 auto TaskProgressBar::setValue(float percent) -> void
 {
+    /// set_progress 会立即重绘
+    if (!ProgressDashboard::isThreadVisible())
+    {
+        return;
+    }
     impl_->bar_.set_progress(percent);
 }
 
@@ -242,5 +265,9 @@ auto TaskProgressBar::setMessage(const std::string_view& text) -> void
 
 auto TaskProgressBar::updateDisplay() -> void
 {
+    if (!ProgressDashboard::isThreadVisible())
+    {
+        return;
+    }
     impl_->bar_.print_progress();
 }
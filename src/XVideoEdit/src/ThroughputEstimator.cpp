@@ -0,0 +1,83 @@
+﻿#include "ThroughputEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double CONFIDENCE_Z    = 1.645; ///< 双侧 90%
+    constexpr size_t MIN_OBSERVATION = 3;
+} // namespace
+
+ThroughputEstimator::ThroughputEstimator(double timeConstant) : timeConstant_(std::max(0.1, timeConstant))
+{
+}
+
+auto ThroughputEstimator::reset(double totalMedia) -> void
+{
+    *this       = ThroughputEstimator(timeConstant_);
+    totalMedia_ = std::max(0.0, totalMedia);
+}
+
+auto ThroughputEstimator::observe(double wall, double media) -> void
+{
+    /// 第一次观测只作为基准，避开启动阶段（探测输入、初始化编码器）的延迟
+    if (!started_)
+    {
+        started_   = true;
+        lastWall_  = wall;
+        lastMedia_ = media;
+        return;
+    }
+
+    const double dt = wall - lastWall_;
+    if (dt <= 0)
+    {
+        return;
+    }
+    const double dm      = media - lastMedia_;
+    const double instant = std::max(0.0, dm) / dt;
+    if (count_ == 0)
+    {
+        mean_     = instant;
+        variance_ = 0.0;
+        weight_   = 1.0;
+    }
+    else
+    {
+        /// 不等间隔的指数加权：alpha 随间隔变化，方差与均值的平方权重和一起更新
+        const double alpha = 1.0 - std::exp(-dt / timeConstant_);
+        const double diff  = instant - mean_;
+        mean_ += alpha * diff;
+        variance_ = (1.0 - alpha) * (variance_ + alpha * diff * diff);
+        weight_   = (1.0 - alpha) * (1.0 - alpha) * weight_ + alpha * alpha;
+    }
+
+    ++count_;
+    lastWall_  = wall;
+    lastMedia_ = std::max(lastMedia_, media);
+}
+
+auto ThroughputEstimator::estimate() const -> Estimate
+{
+    Estimate result;
+    result.rate = mean_;
+    if (count_ < MIN_OBSERVATION || mean_ <= 0)
+    {
+        return result;
+    }
+
+    result.valid = true;
+    if (totalMedia_ <= 0)
+    {
+        return result;
+    }
+
+    const double remaining = std::max(0.0, totalMedia_ - lastMedia_);
+    const double error     = CONFIDENCE_Z * std::sqrt(variance_ * weight_);
+    const double rateLow   = mean_ - error;
+    result.etaSeconds      = remaining / mean_;
+    result.etaLow          = remaining / (mean_ + error);
+    result.etaHigh         = rateLow > mean_ * 0.05 ? remaining / rateLow : -1.0;
+    return result;
+}
@@ -0,0 +1,331 @@
+﻿#include "ThumbsCommandBuilder.h"
+#include "MediaProbeCache.h"
+#include "TaskProgressBar.h"
+#include "XExec.h"
+#include "XTool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    constexpr int    MAX_DEFAULT_JOBS     = 8;
+    constexpr size_t MAX_SEEKS_PER_PROCESS = 32; ///< 每个输入都会打开文件与解码器，单进程的输入数有上限
+
+    /// WebVTT 时间格式 HH:MM:SS.mmm
+    auto formatVttTime(double seconds) -> std::string
+    {
+        const auto        ms = static_cast<long long>(std::llround(std::max(0.0, seconds) * 1000.0));
+        std::stringstream ss;
+        ss << std::setfill('0') << std::setw(2) << ms / 3600000 << ":" << std::setw(2) << ms / 60000 % 60 << ":"
+           << std::setw(2) << ms / 1000 % 60 << "." << std::setw(3) << ms % 1000;
+        return ss.str();
+    }
+
+    auto frameName(size_t index) -> std::string
+    {
+        std::stringstream ss;
+        ss << "frame_" << std::setfill('0') << std::setw(6) << index << ".jpg";
+        return ss.str();
+    }
+
+    auto spriteName(size_t index) -> std::string
+    {
+        std::stringstream ss;
+        ss << "sprite_" << std::setfill('0') << std::setw(3) << index << ".jpg";
+        return ss.str();
+    }
+} // namespace
+
+auto ThumbsCommandBuilder::parseOptions(const std::map<std::string, ParameterValue>& params) const
+        -> ThumbsCommandBuilder::ThumbsOptions
+{
+    ThumbsOptions options;
+    options.input = params.at("--input").asString();
+
+    if (params.contains("--output") && !params.at("--output").empty())
+    {
+        options.output = params.at("--output").asString();
+    }
+    else
+    {
+        const fs::path input(options.input);
+        options.output = (input.parent_path() / (input.stem().string() + "_thumbs")).string();
+    }
+
+    if (params.contains("--interval"))
+        options.interval = params.at("--interval").asDouble();
+    if (params.contains("--count"))
+        options.count = params.at("--count").asInt();
+    if (params.contains("--width"))
+        options.width = params.at("--width").asInt();
+    if (params.contains("--columns"))
+        options.columns = params.at("--columns").asInt();
+    if (params.contains("--rows"))
+        options.rows = params.at("--rows").asInt();
+    if (params.contains("--jobs"))
+        options.jobs = params.at("--jobs").asInt();
+    if (params.contains("--accurate"))
+        options.accurate = params.at("--accurate").empty() || params.at("--accurate").asBool();
+
+    if (options.jobs <= 0)
+    {
+        options.jobs = std::min(MAX_DEFAULT_JOBS, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+    }
+    return options;
+}
+
+auto ThumbsCommandBuilder::build(const std::map<std::string, ParameterValue>&) const -> std::string
+{
+    /// 由多个 ffmpeg 进程协作完成，在 run 中逐个构建命令
+    return {};
+}
+
+auto ThumbsCommandBuilder::validate(const std::map<std::string, ParameterValue>& params, std::string& errorMsg) const
+        -> bool
+{
+    if (!params.contains("--input") || params.at("--input").empty())
+    {
+        errorMsg = "缺少输入文件参数(--input)";
+        return false;
+    }
+
+    std::error_code ec;
+    if (!fs::is_regular_file(params.at("--input").asString(), ec))
+    {
+        errorMsg = "输入文件不存在: " + params.at("--input").asString();
+        return false;
+    }
+
+    if (params.contains("--interval") && params.at("--interval").asDouble() <= 0)
+    {
+        errorMsg = "--interval 必须大于0";
+        return false;
+    }
+
+    for (const auto* name : { "--count", "--jobs" })
+    {
+        if (params.contains(name) && params.at(name).asInt() < 0)
+        {
+            errorMsg = std::string(name) + " 必须为非负整数";
+            return false;
+        }
+    }
+
+    for (const auto* name : { "--width", "--columns", "--rows" })
+    {
+        if (params.contains(name) && params.at(name).asInt() <= 0)
+        {
+            errorMsg = std::string(name) + " 必须为正整数";
+            return false;
+        }
+    }
+    return true;
+}
+
+auto ThumbsCommandBuilder::getTitle(const std::map<std::string, ParameterValue>& params) const -> std::string
+{
+    return "缩略图: " + fs::path(params.at("--input").asString()).filename().string();
+}
+
+auto ThumbsCommandBuilder::isInProcess(const std::map<std::string, ParameterValue>&) const -> bool
+{
+    return true;
+}
+
+auto ThumbsCommandBuilder::run(const std::map<std::string, ParameterValue>& params, std::string& resultMsg,
+                               std::string& errorMsg) const -> bool
+{
+    const auto    start   = std::chrono::steady_clock::now();
+    ThumbsOptions options = parseOptions(params);
+
+    /// 1. 时长与尺寸来自探测缓存
+    MediaProbeInfo info;
+    if (!MediaProbeCache::getInstance()->probe(options.input, info, errorMsg))
+    {
+        return false;
+    }
+    const auto* video = info.videoStream();
+    if (!video || video->width <= 0 || info.duration <= 0)
+    {
+        errorMsg = "无法获取视频时长或尺寸: " + options.input;
+        return false;
+    }
+
+    /// 所有缩略图尺寸一致才能拼图；高度按显示宽高比（SAR 与旋转校正后）计算并取偶数，
+    /// 输出帧再 setsar=1，拼图与 WebVTT 坐标都按方形像素
+    const int width  = options.width;
+    const int height = std::max(2, static_cast<int>(std::lround(width / (2.0 * video->displayAspect()))) * 2);
+
+    /// 2. 时间点：每段取中点，避开片头黑场，也不会落在文件末尾之后
+    const size_t count = options.count > 0
+            ? static_cast<size_t>(options.count)
+            : static_cast<size_t>(std::max(1.0, std::ceil(info.duration / options.interval)));
+    const double interval = info.duration / static_cast<double>(count);
+
+    /// 上次中断留下的帧会被拼进最后一张不满的雪碧图，先清掉
+    std::error_code ec;
+    const fs::path  outputDir = options.output;
+    const fs::path  frameDir  = outputDir / ".frames";
+    fs::remove_all(frameDir, ec);
+    fs::create_directories(frameDir, ec);
+    if (ec)
+    {
+        errorMsg = "无法创建输出目录: " + frameDir.string() + " (" + ec.message() + ")";
+        return false;
+    }
+
+    /// 3. 并行提取：时间点分成若干批，每批一个 ffmpeg 进程。进程内每个时间点是一个带输入侧 -ss 的输入，
+    /// 直接跳到关键帧只解码一帧，各自映射到一个输出文件；批数约为 jobs 的整数倍，进程数远少于时间点数
+    auto bar = TaskProgressBar::create();
+    bar->setTitle(getTitle(params));
+
+    const size_t workerCount = std::min<size_t>(options.jobs, count);
+    const size_t batchSize   = std::clamp<size_t>((count + workerCount - 1) / workerCount, 1, MAX_SEEKS_PER_PROCESS);
+    const size_t batches     = (count + batchSize - 1) / batchSize;
+
+    std::vector<uint8_t> ok(count, 0);
+    std::atomic<size_t>  next{ 0 };
+    std::atomic<size_t>  done{ 0 };
+
+    auto worker = [&]()
+    {
+        for (size_t batch = next.fetch_add(1); batch < batches; batch = next.fetch_add(1))
+        {
+            const size_t first = batch * batchSize;
+            const size_t last  = std::min(count, first + batchSize);
+
+            std::ostringstream cmd;
+            cmd << "\"" << XTool::getFFmpegPath() << "\" -hide_banner -nostats -loglevel error -y ";
+            cmd << std::fixed << std::setprecision(3);
+            for (size_t i = first; i < last; ++i)
+            {
+                if (!options.accurate)
+                {
+                    /// 只解码关键帧，-ss 落在关键帧上而不是向后解码到精确时间（输入选项，每个输入都要写）
+                    cmd << "-noaccurate_seek -skip_frame nokey ";
+                }
+                cmd << "-ss " << (static_cast<double>(i) + 0.5) * interval << " -i \"" << options.input << "\" ";
+            }
+            for (size_t i = first; i < last; ++i)
+            {
+                cmd << "-map " << i - first << ":v:0 -frames:v 1 -vf \"scale=" << width << ":" << height
+                    << ",setsar=1\" -q:v 4 \"" << (frameDir / frameName(i)).string() << "\" ";
+            }
+
+            /// 个别时间点失败时进程可能返回非0，逐个检查输出文件
+            XExec::execute(cmd.str(), true);
+            for (size_t i = first; i < last; ++i)
+            {
+                ok[i] = fs::exists(frameDir / frameName(i));
+            }
+            done.fetch_add(last - first, std::memory_order_release);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        workers.emplace_back(worker);
+    }
+
+    while (done.load(std::memory_order_acquire) < count)
+    {
+        const size_t finished = done.load();
+        bar->setProgress(static_cast<float>(90.0 * finished / count),
+                         "已提取 " + std::to_string(finished) + "/" + std::to_string(count));
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    for (auto& thread : workers)
+    {
+        thread.join();
+    }
+
+    /// 个别时间点失败（如末尾没有关键帧）时沿用前一帧，保证格子与时间段一一对应
+    size_t failed    = 0;
+    int    lastValid = -1;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (ok[i])
+        {
+            lastValid = static_cast<int>(i);
+            continue;
+        }
+        ++failed;
+        const int source = lastValid >= 0 ? lastValid : static_cast<int>(std::ranges::find(ok, 1) - ok.begin());
+        if (source >= static_cast<int>(count))
+        {
+            bar->markAsFailed();
+            fs::remove_all(frameDir, ec);
+            errorMsg = "所有时间点都提取失败: " + options.input;
+            return false;
+        }
+        fs::copy_file(frameDir / frameName(source), frameDir / frameName(i), fs::copy_options::overwrite_existing, ec);
+    }
+
+    /// 4. 拼图：每 columns×rows 帧一张，最后一张不满时 tile 滤镜用空白补齐
+    const size_t perSheet = static_cast<size_t>(options.columns) * options.rows;
+    const size_t sheets   = (count + perSheet - 1) / perSheet;
+    for (size_t sheet = 0; sheet < sheets; ++sheet)
+    {
+        bar->setProgress(static_cast<float>(90.0 + 10.0 * sheet / sheets),
+                         "拼图 " + std::to_string(sheet + 1) + "/" + std::to_string(sheets));
+
+        std::ostringstream cmd;
+        cmd << "\"" << XTool::getFFmpegPath() << "\" -hide_banner -nostats -loglevel error -y "
+            << "-start_number " << sheet * perSheet << " -i \"" << (frameDir / "frame_%06d.jpg").string() << "\" "
+            << "-frames:v 1 -vf \"tile=" << options.columns << "x" << options.rows << "\" -q:v 4 \""
+            << (outputDir / spriteName(sheet)).string() << "\"";
+
+        auto result = XExec::execute(cmd.str(), true);
+        if (result.exitCode != 0)
+        {
+            bar->markAsFailed();
+            errorMsg = "拼接雪碧图失败: " + result.stdoutOutput;
+            return false;
+        }
+    }
+    fs::remove_all(frameDir, ec);
+
+    /// 5. WebVTT 索引：每段时间指向雪碧图中的一个格子
+    const fs::path vttPath = outputDir / "thumbnails.vtt";
+    std::ofstream  vtt(vttPath, std::ios::binary);
+    if (!vtt)
+    {
+        bar->markAsFailed();
+        errorMsg = "无法写入索引文件: " + vttPath.string();
+        return false;
+    }
+    vtt << "WEBVTT\n";
+    for (size_t i = 0; i < count; ++i)
+    {
+        const size_t cell = i % perSheet;
+        const int    x    = static_cast<int>(cell % options.columns) * width;
+        const int    y    = static_cast<int>(cell / options.columns) * height;
+        vtt << "\n"
+            << formatVttTime(i * interval) << " --> " << formatVttTime(std::min(info.duration, (i + 1) * interval))
+            << "\n"
+            << spriteName(i / perSheet) << "#xywh=" << x << "," << y << "," << width << "," << height << "\n";
+    }
+    vtt.close();
+    bar->markAsCompleted();
+
+    const double      seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "已生成 " << count << " 张缩略图 (" << width << "x" << height << ")，" << sheets << " 张雪碧图\n";
+    ss << "索引: " << vttPath.string() << "\n";
+    ss << "间隔 " << interval << " 秒，失败 " << failed << "，并行 " << workerCount << "，ffmpeg 进程 " << batches
+       << "，用时 " << seconds << " 秒";
+    resultMsg = ss.str();
+    return true;
+}
+
+IMPLEMENT_CREATE(ThumbsCommandBuilder);
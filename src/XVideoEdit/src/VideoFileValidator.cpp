@@ -1,11 +1,11 @@
 ﻿#include "VideoFileValidator.h"
 
 #include "XFile.h"
-#include "XExec.h"
-#include "XTool.h"
+#include "MediaProbeCache.h"
 
 #include <fstream>
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 
 auto VideoFileValidator::isVideoFile(const std::string& filePath, std::string& errorMsg, ValidationLevel level) -> bool
@@ -206,22 +206,13 @@ auto VideoFileValidator::isVideoFileByFFmpeg(const std::string& filePath, std::s
 {
     try
     {
-        std::string command = XTool::getFFprobePath() +
-                " -v error -select_streams v:0 -show_entries stream=codec_type "
-                "-of default=noprint_wrappers=1:nokey=1 \"" +
-                filePath + "\"";
-
-        XExec::XResult result = XExec::execute(command);
-        if (result.exitCode != 0)
+        MediaProbeInfo info;
+        if (!MediaProbeCache::getInstance()->probe(filePath, info, errorMsg))
         {
-            errorMsg = "FFmpeg探测失败: " + result.stderrOutput;
             return false;
         }
 
-        std::string output = result.stdoutOutput;
-        std::erase(output, '\n');
-        std::erase(output, '\r');
-        if (output == "video")
+        if (info.hasVideo())
         {
             return true;
         }
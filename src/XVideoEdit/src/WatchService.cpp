@@ -0,0 +1,412 @@
+﻿#include "WatchService.h"
+#include "FolderWatcher.h"
+#include "InputPrefetcher.h"
+#include "JobScheduler.h"
+#include "ProgressDashboard.h"
+#include "TaskManager.h"
+#include "XConst.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+namespace
+{
+    /// 信号处理函数只能访问无锁的全局状态
+    std::atomic<FolderWatcher *> g_activeWatcher{ nullptr };
+
+    extern "C" void onStopSignal(int)
+    {
+        if (auto *watcher = g_activeWatcher.load())
+        {
+            watcher->stop();
+        }
+    }
+
+    auto normalizeExtension(std::string ext) -> std::string
+    {
+        std::ranges::transform(ext, ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (!ext.empty() && ext[0] != '.')
+        {
+            ext.insert(ext.begin(), '.');
+        }
+        return ext;
+    }
+
+    auto replaceAll(std::string &text, const std::string &from, const std::string &to) -> void
+    {
+        for (size_t pos = text.find(from); pos != std::string::npos; pos = text.find(from, pos + to.size()))
+        {
+            text.replace(pos, from.size(), to);
+        }
+    }
+
+    auto parseStep(const nlohmann::json &j, WatchService::Step &step, std::string &errorMsg) -> bool
+    {
+        step.task = j.value("task", "");
+        if (step.task.empty())
+        {
+            errorMsg = "流水线步骤缺少 task";
+            return false;
+        }
+        /// items() 只引用对象本身，临时的 json 需要先保存下来
+        const auto params = j.value("params", nlohmann::json::object());
+        for (const auto &[key, value] : params.items())
+        {
+            step.params[key] = value.is_string() ? value.get<std::string>() : value.dump();
+        }
+        return true;
+    }
+} // namespace
+
+class WatchService::PImpl
+{
+public:
+    PImpl(WatchService *owner, TaskManager &taskManager);
+    ~PImpl() = default;
+
+public:
+    /// 检查目录与任务是否存在
+    auto validate(const Config &config, std::string &errorMsg) const -> bool;
+
+    /// 按顺序执行一个文件的流水线
+    auto runPipeline(const Folder &folder, const std::string &file, std::string &errorMsg) -> bool;
+
+    /// 流水线各步展开后的 --output
+    static auto outputsOf(const Folder &folder, const std::string &file) -> std::vector<std::string>;
+
+    /// 启动扫描前忽略目录中已有文件的输出，上次写回监视目录的输出不会被当成新文件
+    auto ignoreExistingOutputs(const Config &config) -> void;
+
+public:
+    WatchService *owner_ = nullptr;
+    TaskManager  &taskManager_;
+    FolderWatcher watcher_;
+    std::mutex    outputMutex_;
+};
+
+WatchService::PImpl::PImpl(WatchService *owner, TaskManager &taskManager) : owner_(owner), taskManager_(taskManager)
+{
+}
+
+auto WatchService::PImpl::validate(const Config &config, std::string &errorMsg) const -> bool
+{
+    if (config.folders.empty())
+    {
+        errorMsg = "没有配置监视目录";
+        return false;
+    }
+    if (config.jobs == 0)
+    {
+        errorMsg = "jobs 必须为正整数";
+        return false;
+    }
+
+    for (const auto &folder : config.folders)
+    {
+        std::error_code ec;
+        if (!fs::is_directory(folder.path, ec))
+        {
+            errorMsg = "监视目录不存在: " + folder.path;
+            return false;
+        }
+        if (folder.pipeline.empty())
+        {
+            errorMsg = "目录没有配置任务: " + folder.path;
+            return false;
+        }
+        for (const auto &step : folder.pipeline)
+        {
+            if (!taskManager_.hasTaskInstance(step.task))
+            {
+                errorMsg = "未知任务: " + step.task;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+auto WatchService::PImpl::runPipeline(const Folder &folder, const std::string &file, std::string &errorMsg) -> bool
+{
+    std::string previous = file;
+    for (const auto &step : folder.pipeline)
+    {
+        std::map<std::string, std::string> params;
+        for (const auto &[key, value] : step.params)
+        {
+            params[key] = expand(value, file, previous);
+        }
+
+        std::string error;
+        if (!taskManager_.executeTask(step.task, params, error))
+        {
+            errorMsg = step.task + ": " + error;
+            return false;
+        }
+        if (params.contains("--output"))
+        {
+            previous = params.at("--output");
+        }
+    }
+    return true;
+}
+
+auto WatchService::PImpl::outputsOf(const Folder &folder, const std::string &file) -> std::vector<std::string>
+{
+    std::vector<std::string> outputs;
+    std::string              previous = file;
+    for (const auto &step : folder.pipeline)
+    {
+        if (step.params.contains("--output"))
+        {
+            previous = expand(step.params.at("--output"), file, previous);
+            outputs.push_back(previous);
+        }
+    }
+    return outputs;
+}
+
+auto WatchService::PImpl::ignoreExistingOutputs(const Config &config) -> void
+{
+    for (const auto &folder : config.folders)
+    {
+        std::error_code ec;
+        for (fs::directory_iterator it(folder.path, ec), end; !ec && it != end; it.increment(ec))
+        {
+            std::error_code typeEc;
+            if (!it->is_regular_file(typeEc))
+            {
+                continue;
+            }
+            const auto ext = normalizeExtension(it->path().extension().string());
+            if (!folder.extensions.empty() && std::ranges::find(folder.extensions, ext) == folder.extensions.end())
+            {
+                continue;
+            }
+            for (const auto &output : outputsOf(folder, it->path().string()))
+            {
+                watcher_.ignore(output);
+            }
+        }
+    }
+}
+
+WatchService::WatchService(TaskManager &taskManager) : impl_(std::make_unique<PImpl>(this, taskManager))
+{
+}
+
+WatchService::~WatchService() = default;
+
+auto WatchService::loadConfig(const std::string &path, Config &config, std::string &errorMsg) -> bool
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        errorMsg = "无法打开配置文件: " + path;
+        return false;
+    }
+
+    try
+    {
+        const auto j = nlohmann::json::parse(file);
+
+        config.jobs          = j.value("jobs", config.jobs);
+        config.stableSeconds = j.value("stableSeconds", config.stableSeconds);
+        config.settleMs      = j.value("settleMs", config.settleMs);
+
+        config.prefetchFiles    = j.value("prefetchFiles", config.prefetchFiles);
+        config.prefetchMB       = j.value("prefetchMB", config.prefetchMB);
+        config.prefetchBudgetMB = j.value("prefetchBudgetMB", config.prefetchBudgetMB);
+
+        for (const auto &item : j.value("folders", nlohmann::json::array()))
+        {
+            Folder folder;
+            folder.path = item.value("path", "");
+            for (const auto &ext : item.value("extensions", std::vector<std::string>{}))
+            {
+                folder.extensions.push_back(normalizeExtension(ext));
+            }
+
+            /// 只有一步时可以直接写 task + params
+            if (item.contains("pipeline"))
+            {
+                for (const auto &stepJson : item.at("pipeline"))
+                {
+                    Step step;
+                    if (!parseStep(stepJson, step, errorMsg))
+                    {
+                        return false;
+                    }
+                    folder.pipeline.push_back(std::move(step));
+                }
+            }
+            else if (item.contains("task"))
+            {
+                Step step;
+                if (!parseStep(item, step, errorMsg))
+                {
+                    return false;
+                }
+                folder.pipeline.push_back(std::move(step));
+            }
+            config.folders.push_back(std::move(folder));
+        }
+    }
+    catch (const std::exception &e)
+    {
+        errorMsg = "配置文件格式错误: " + std::string(e.what());
+        return false;
+    }
+    return true;
+}
+
+auto WatchService::run(const Config &config, std::string &errorMsg) -> bool
+{
+    if (!impl_->validate(config, errorMsg))
+    {
+        return false;
+    }
+
+    FolderWatcher::Options options;
+    options.settle = std::chrono::milliseconds(std::max(0, config.settleMs));
+    options.stable = std::chrono::milliseconds(static_cast<int64_t>(std::max(0.0, config.stableSeconds) * 1000.0));
+    for (const auto &folder : config.folders)
+    {
+        options.directories.push_back({ folder.path, folder.extensions });
+    }
+    impl_->ignoreExistingOutputs(config);
+    if (!impl_->watcher_.start(options, errorMsg))
+    {
+        return false;
+    }
+
+    /// 并行处理时各任务的进度条合并到面板中，避免互相覆盖
+    auto       dashboard    = ProgressDashboard::getInstance();
+    const bool dashboardWas = dashboard->isEnabled();
+    if (config.jobs > 1)
+    {
+        dashboard->setEnabled(true);
+    }
+
+    JobScheduler scheduler(config.jobs);
+    if (config.prefetchFiles > 0)
+    {
+        InputPrefetcher::Options prefetch;
+        prefetch.headBytes   = static_cast<uint64_t>(config.prefetchMB) << 20;
+        prefetch.budgetBytes = static_cast<uint64_t>(config.prefetchBudgetMB) << 20;
+        scheduler.setPrefetcher(std::make_shared<InputPrefetcher>(prefetch), config.prefetchFiles);
+    }
+    scheduler.setOnFinished(
+            [this](const JobScheduler::JobResult &result)
+            {
+                std::lock_guard<std::mutex> lock(impl_->outputMutex_);
+                std::cout << "[监视] " << (result.success ? "✓ " : "✗ ") << result.label << std::fixed
+                          << std::setprecision(1) << " (" << result.seconds << " 秒)";
+                if (!result.success)
+                {
+                    std::cout << " " << result.errorMsg;
+                }
+                std::cout << std::endl;
+            });
+
+#ifdef __linux__
+    struct sigaction action{};
+    struct sigaction previousInt{};
+    struct sigaction previousTerm{};
+    action.sa_handler = onStopSignal;
+    sigemptyset(&action.sa_mask);
+    g_activeWatcher.store(&impl_->watcher_);
+    sigaction(SIGINT, &action, &previousInt);
+    sigaction(SIGTERM, &action, &previousTerm);
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(impl_->outputMutex_);
+        std::cout << "[监视] 正在监视 " << config.folders.size() << " 个目录，并发 " << config.jobs
+                  << "，按 Ctrl+C 停止" << std::endl;
+        for (const auto &folder : config.folders)
+        {
+            std::cout << "  " << folder.path << " →";
+            for (const auto &step : folder.pipeline)
+            {
+                std::cout << " " << step.task;
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    impl_->watcher_.run(
+            [&](const std::string &path, size_t index)
+            {
+                const auto &folder = config.folders[index];
+
+                /// 输出写回监视目录时不能再触发处理
+                const auto outputs = PImpl::outputsOf(folder, path);
+                for (const auto &output : outputs)
+                {
+                    impl_->watcher_.ignore(output);
+                }
+
+                /// 启动扫描到的文件可能上次已处理过：最终输出存在且不比输入旧则跳过
+                std::error_code inputEc, outputEc;
+                if (!outputs.empty())
+                {
+                    const auto inputTime  = fs::last_write_time(path, inputEc);
+                    const auto outputTime = fs::last_write_time(outputs.back(), outputEc);
+                    if (!inputEc && !outputEc && outputTime >= inputTime)
+                    {
+                        std::lock_guard<std::mutex> lock(impl_->outputMutex_);
+                        std::cout << "[监视] 跳过已处理的文件: " << path << std::endl;
+                        return;
+                    }
+                }
+
+                scheduler.submit(
+                        fs::path(path).filename().string(),
+                        [this, &folder, path](std::string &error) { return impl_->runPipeline(folder, path, error); },
+                        { path });
+            });
+
+#ifdef __linux__
+    sigaction(SIGINT, &previousInt, nullptr);
+    sigaction(SIGTERM, &previousTerm, nullptr);
+#endif
+    g_activeWatcher.store(nullptr);
+
+    /// 停止时运行中的作业做完；排队的文件仍在监视目录中，下次启动时由目录扫描重新入队
+    std::cout << "\n[监视] 正在停止，等待运行中的作业..." << std::endl;
+    scheduler.shutdown(false);
+    dashboard->setEnabled(dashboardWas);
+
+    const auto stats = scheduler.getStatistics();
+    std::cout << "[监视] 成功 " << stats.succeeded << "，失败 " << stats.failed << "，未处理 " << stats.cancelled
+              << std::endl;
+    return true;
+}
+
+auto WatchService::stop() -> void
+{
+    impl_->watcher_.stop();
+}
+
+auto WatchService::expand(const std::string &value, const std::string &file, const std::string &previous)
+        -> std::string
+{
+    const fs::path path(file);
+    std::string    result = value;
+    replaceAll(result, "{input}", file);
+    replaceAll(result, "{name}", path.filename().string());
+    replaceAll(result, "{stem}", path.stem().string());
+    replaceAll(result, "{ext}", path.extension().string());
+    replaceAll(result, "{dir}", path.parent_path().string());
+    replaceAll(result, "{prev}", previous.empty() ? file : previous);
+    return result;
+}
@@ -0,0 +1,287 @@
+﻿#include "XBenchmark.h"
+#include "FFmpegProgressParser.h"
+#include "InputPrefetcher.h"
+#include "ProgressDashboard.h"
+#include "XExec.h"
+#include "XFile.h"
+#include "XTool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <regex>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    /// 生成与 ffmpeg -progress 输出一致的块（每块 12 行）
+    auto makeProgressStream(size_t lines) -> std::string
+    {
+        std::string data;
+        data.reserve(lines * 24);
+
+        char   block[512];
+        size_t written = 0;
+        for (long long i = 0; written < lines; ++i, written += 12)
+        {
+            const long long us   = i * 40000;
+            const long long secs = us / 1000000;
+            const int       n    = std::snprintf(block, sizeof(block),
+                                                 "frame=%lld\nfps=%.2f\nstream_0_0_q=28.0\nbitrate=%.1fkbits/s\n"
+                                                 "total_size=%lld\nout_time_us=%lld\nout_time_ms=%lld\n"
+                                                 "out_time=%02lld:%02lld:%02lld.%06lld\ndup_frames=0\n"
+                                                 "drop_frames=%lld\nspeed=%.3gx\nprogress=continue\n",
+                                                 i, 25.0 + i % 7, 1800.0 + i % 100, i * 9000, us, us, secs / 3600,
+                                                 secs / 60 % 60, secs % 60, us % 1000000, i / 50,
+                                                 1.0 + (i % 30) / 10.0);
+            data.append(block, static_cast<size_t>(n));
+        }
+        return data;
+    }
+} // namespace
+
+auto XBenchmark::progressParser(size_t lines) -> std::string
+{
+    using Clock = std::chrono::steady_clock;
+
+    const std::string data = makeProgressStream(lines);
+
+    size_t lineCount = 0;
+    for (char c : data)
+    {
+        lineCount += (c == '\n') ? 1 : 0;
+    }
+
+    /// 1. FFmpegProgressParser：整块输入，内部按行切分
+    FFmpegProgressParser parser;
+    int64_t              checksum = 0;
+    parser.setCallback([&checksum](const ProgressSnapshot &snapshot) { checksum += snapshot.outTimeUs; });
+
+    const auto parserBegin  = Clock::now();
+    const auto blocks       = parser.feed(data);
+    const auto parserSecond = std::chrono::duration<double>(Clock::now() - parserBegin).count();
+
+    /// 2. 旧实现：每行复制为 std::string，out_time 行构造正则并逐段 stoi
+    int64_t    legacyChecksum = 0;
+    const auto legacyBegin    = Clock::now();
+    size_t     begin          = 0;
+    while (begin < data.size())
+    {
+        size_t end = data.find('\n', begin);
+        if (end == std::string::npos)
+        {
+            end = data.size();
+        }
+        const std::string line(data, begin, end - begin);
+        begin = end + 1;
+
+        const size_t timePos = line.find("out_time=");
+        if (timePos != std::string::npos)
+        {
+            const std::string displayTime = line.substr(timePos + 9);
+            std::regex        timeRegex(R"((\d{2}):(\d{2}):(\d{2})\.(\d+))");
+            std::smatch       matches;
+            if (std::regex_search(displayTime, matches, timeRegex))
+            {
+                legacyChecksum += std::stoi(matches[1].str()) * 3600 + std::stoi(matches[2].str()) * 60 +
+                                  std::stoi(matches[3].str());
+            }
+        }
+        const size_t speedPos = line.find("speed=");
+        if (speedPos != std::string::npos)
+        {
+            legacyChecksum += static_cast<int64_t>(line.substr(speedPos + 6).size());
+        }
+    }
+    const auto legacySecond = std::chrono::duration<double>(Clock::now() - legacyBegin).count();
+
+    auto perSecond = [](double count, double seconds) { return seconds > 0 ? count / seconds : 0.0; };
+
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(0);
+    os << "=== ffmpeg -progress 解析基准 ===\n";
+    os << "输入: " << lineCount << " 行, " << blocks << " 个块, " << data.size() / 1024 << " KB\n";
+    os << "FFmpegProgressParser: " << perSecond(lineCount, parserSecond) << " 行/秒, "
+       << perSecond(static_cast<double>(data.size()) / (1024.0 * 1024.0), parserSecond) << " MB/秒\n";
+    os << "旧正则解析:           " << perSecond(lineCount, legacySecond) << " 行/秒\n";
+    os << std::setprecision(1);
+    os << "加速比: " << (parserSecond > 0 ? legacySecond / parserSecond : 0.0) << "x"
+       << "  (校验: " << (checksum != 0 && legacyChecksum != 0 ? "ok" : "empty") << ")\n";
+    return os.str();
+}
+
+auto XBenchmark::dashboard(size_t jobs, size_t frames) -> std::string
+{
+    using Clock = std::chrono::steady_clock;
+
+    auto  *dashboard = ProgressDashboard::getInstance();
+    size_t bytes     = 0;
+    dashboard->setOutput([&bytes](std::string_view frame) { bytes += frame.size(); }, true);
+
+    std::vector<std::shared_ptr<ProgressMailbox>> mailboxes;
+    std::vector<uint64_t>                         ids;
+    for (size_t i = 0; i < jobs; ++i)
+    {
+        mailboxes.push_back(std::make_shared<ProgressMailbox>());
+        ids.push_back(dashboard->addJob("job_" + std::to_string(i) + ".mp4", mailboxes.back(), 600.0));
+    }
+    dashboard->renderFrame();
+    bytes = 0;
+
+    /// 每个任务约每 5 帧发布一次（ffmpeg 默认 0.5 秒一个块，面板 10 帧/秒）
+    double busy = 0.0;
+    for (size_t frame = 0; frame < frames; ++frame)
+    {
+        for (size_t i = 0; i < jobs; ++i)
+        {
+            if ((frame + i) % 5 != 0)
+            {
+                continue;
+            }
+            ProgressSnapshot snapshot;
+            snapshot.frame     = static_cast<int64_t>(frame * 12 + i);
+            snapshot.fps       = 48.0 + static_cast<double>(i % 7);
+            snapshot.speed     = 1.5 + static_cast<double>(i % 4) / 10.0;
+            snapshot.totalSize = static_cast<int64_t>((frame + 1) * 250000);
+            snapshot.outTimeUs = static_cast<int64_t>(frame) * 500000;
+            mailboxes[i]->store(snapshot);
+        }
+
+        const auto begin = Clock::now();
+        dashboard->renderFrame();
+        busy += std::chrono::duration<double>(Clock::now() - begin).count();
+    }
+    const size_t frameBytes = bytes;
+
+    for (auto id : ids)
+    {
+        dashboard->finishJob(id, true);
+    }
+    dashboard->setOutput(nullptr, false);
+
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(1);
+    os << "=== 多任务面板基准 ===\n";
+    os << "任务: " << jobs << ", 帧数: " << frames << "\n";
+    os << "每帧耗时: " << (frames > 0 ? busy / frames * 1e6 : 0.0) << " us\n";
+    os << "每帧输出: " << (frames > 0 ? static_cast<double>(frameBytes) / frames : 0.0) << " 字节 ("
+       << (frames > 0 ? static_cast<double>(frameBytes) / frames * 10.0 / 1024.0 : 0.0) << " KB/s @10fps)\n";
+    return os.str();
+}
+
+auto XBenchmark::prefetch(const std::vector<std::string> &files, size_t headMB) -> std::string
+{
+    using Clock = std::chrono::steady_clock;
+
+    InputPrefetcher::Options options;
+    options.headBytes   = static_cast<uint64_t>(headMB) << 20;
+    options.budgetBytes = UINT64_MAX;
+
+    /// 首帧时间：打开文件、读取 moov、解码第一帧视频
+    auto firstFrame = [](const std::string &file, bool &ok) -> double
+    {
+        const std::string cmd = "\"" + XTool::getFFmpegPath() + "\" -hide_banner -nostats -loglevel error -i \"" +
+                file + "\" -map 0:v:0 -frames:v 1 -f null -";
+
+        const auto begin  = Clock::now();
+        const auto result = XExec::execute(cmd, true);
+        ok                = result.exitCode == 0;
+        return std::chrono::duration<double>(Clock::now() - begin).count() * 1000.0;
+    };
+
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(1);
+    os << "=== 输入预读基准（首帧时间，毫秒）===\n";
+    os << "文件头预读: " << headMB << " MB + moov\n";
+    /// 中文表头按显示宽度手工对齐（setw 按字节计数）
+    os << "文件" << std::string(28, ' ') << "    冷缓存    预读后    热缓存      预读量\n";
+
+    double coldTotal     = 0.0;
+    double prefetchTotal = 0.0;
+    size_t measured      = 0;
+    for (const auto &file : files)
+    {
+        std::vector<InputPrefetcher::Range> ranges;
+        if (!InputPrefetcher::plan(file, options, ranges))
+        {
+            os << file << ": 无法读取\n";
+            continue;
+        }
+        if (!InputPrefetcher::evict(file))
+        {
+            os << file << ": 无法丢弃页缓存，结果不代表冷缓存\n";
+        }
+
+        /// 1. 冷缓存
+        bool         ok   = false;
+        const double cold = firstFrame(file, ok);
+        if (!ok)
+        {
+            os << file << ": ffmpeg 解码失败\n";
+            continue;
+        }
+
+        /// 2. 丢弃后预读（相当于排队期间已完成预读），再启动 ffmpeg
+        InputPrefetcher::evict(file);
+        const uint64_t advised  = InputPrefetcher::advise(file, ranges);
+        const double   prefetch = firstFrame(file, ok);
+
+        /// 3. 整个文件都在页缓存中时的下限
+        const double warm = firstFrame(file, ok);
+
+        os << std::left << std::setw(32) << XFile::getFileName(file).substr(0, 31) << std::right << std::setw(10)
+           << cold << std::setw(10) << prefetch << std::setw(10) << warm << std::setw(12)
+           << XFile::formatFileSize(advised) << "\n";
+        coldTotal += cold;
+        prefetchTotal += prefetch;
+        measured++;
+    }
+
+    if (measured > 0)
+    {
+        os << "平均: 冷缓存 " << coldTotal / measured << " ms, 预读后 " << prefetchTotal / measured << " ms, 减少 "
+           << (coldTotal > 0 ? 100.0 * (coldTotal - prefetchTotal) / coldTotal : 0.0) << "%\n";
+    }
+    return os.str();
+}
+
+auto XBenchmark::startup(const std::string &executable, size_t runs) -> std::string
+{
+    using Clock = std::chrono::steady_clock;
+
+    /// echo 任务不依赖外部程序，耗时几乎全部是启动与分发
+    const std::string cmd = "\"" + executable + "\" echo -m startup";
+
+    std::vector<double> samples;
+    samples.reserve(runs);
+    for (size_t i = 0; i < runs; ++i)
+    {
+        const auto begin  = Clock::now();
+        const auto result = XExec::execute(cmd, true);
+        const auto ms     = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        if (result.exitCode != 0)
+        {
+            return "启动失败: " + executable + "\n" + result.stdoutOutput;
+        }
+        samples.push_back(ms);
+    }
+    if (samples.empty())
+    {
+        return "没有运行次数\n";
+    }
+
+    std::ranges::sort(samples);
+    auto percentile = [&samples](double p)
+    { return samples[std::min(samples.size() - 1, static_cast<size_t>(p * static_cast<double>(samples.size())))]; };
+
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(2);
+    os << "=== 单次执行启动基准 ===\n";
+    os << "命令: " << cmd << " × " << runs << "\n";
+    os << "最短 " << samples.front() << " ms, 中位 " << percentile(0.5) << " ms, P90 " << percentile(0.9)
+       << " ms, 最长 " << samples.back() << " ms\n";
+    return os.str();
+}
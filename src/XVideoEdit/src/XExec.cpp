@@ -1,4 +1,5 @@
 ﻿#include "XExec.h"
+#include "Metrics.h"
 #include <iostream>
 #include <atomic>
 #include <mutex>
@@ -6,6 +7,8 @@
 #include <chrono>
 #include <sstream>
 #include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -17,6 +20,10 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #endif
 
 class XExec::PImpl
@@ -30,6 +37,8 @@ public:
 
     auto isRunning() const -> bool;
 
+    auto waitFor(int timeoutMs) -> bool;
+
     auto wait() -> int;
 
     auto terminate() -> bool;
@@ -44,12 +53,41 @@ public:
     auto cleanup() -> void;
     auto readOutput(bool isStderr) -> void;
 
+    /// 缓存输出并按行回调（跨读取块拼接不完整的行）
+    auto dispatchOutput(std::string_view chunk, bool isStderr) -> void;
+
+    /// 进程结束时回调最后一个没有换行符的行
+    auto flushPendingLine(bool isStderr) -> void;
+
+    /// 进度通道按行回调（不累积到 stdout_）
+    auto dispatchProgress(std::string_view chunk) -> void;
+
+    /// 作业登记：进程启动后按 tag 登记，回收前注销，避免向已被复用的 pid 发信号
+    struct JobRegistry
+    {
+        std::mutex                                mutex;
+        std::unordered_multimap<uint64_t, PImpl*> processes;
+        std::unordered_set<uint64_t>              cancelled;
+    };
+
+    static auto registry() -> JobRegistry&;
+
+    auto registerJob(uint64_t tag) -> void;
+    auto unregisterJob() -> void;
+
+    /// 只发送终止信号，不等待（调用时持有登记表的锁）
+    auto signalTerminate() -> bool;
+
 #ifdef _WIN32
     void closeAllHandles();
     bool checkProcessExited();
 #else
     void closeAllFds();
     bool checkProcessExited();
+    void readProgress();
+
+    /// 阻塞读取管道直到 EOF；子进程退出后再排空一段时间
+    void pumpPipe(int fd, const std::function<void(std::string_view)>& onData);
 #endif
 
 #ifdef _WIN32
@@ -68,10 +106,13 @@ public:
 #else
     struct ProcessHandles
     {
-        pid_t pid      = -1;
-        int   stdoutFd = -1;
-        int   stderrFd = -1;
-        int   stdinFd  = -1;
+        pid_t pid        = -1;
+        int   stdoutFd   = -1;
+        int   stderrFd   = -1;
+        int   stdinFd    = -1;
+        int   progressFd = -1; ///< 子进程 fd 3 的读端
+        int   exitRd     = -1; ///< 退出通知：wait() 关闭写端后读取线程的 poll 返回
+        int   exitWr     = -1;
     };
 
     ProcessHandles handles_;
@@ -83,12 +124,26 @@ public:
     std::atomic<bool>  isRunning_{ false };
     std::atomic<bool>  terminated_{ false };
     std::atomic<int>   exitCode_{ -1 };
+    std::atomic<bool>  exited_{ false }; ///< 子进程已退出，读取线程进入排空阶段
     OutputCallback     outputCallback_;
+    ProgressCallback   progressCallback_;
+    std::string        pendingStdout_;        ///< 尚未遇到换行符的 stdout 片段
+    std::string        pendingStderr_;        ///< 尚未遇到换行符的 stderr 片段
+    std::string        pendingProgress_;      ///< 尚未遇到换行符的进度片段
+    bool               captureOutput_ = true; ///< 是否把输出累积到 stdout_/stderr_
     std::thread        stdoutThread_;
     std::thread        stderrThread_;
+    std::thread        progressThread_;
     ExecutionMode      executionMode_ = ExecutionMode::Direct;
+    uint64_t           jobTag_        = 0;     ///< 已登记的作业，0 表示未登记
+    bool               processGroup_  = false; ///< 子进程自成进程组，终止时向整组发信号
 };
 
+namespace
+{
+    thread_local uint64_t t_jobTag = 0;
+}
+
 XExec::XExec() : impl_(std::make_unique<PImpl>())
 {
 }
@@ -101,6 +156,25 @@ auto XExec::setOutputCallback(const OutputCallback& callback) -> void
     impl_->outputCallback_ = callback;
 }
 
+auto XExec::setProgressCallback(const ProgressCallback& callback) -> void
+{
+    impl_->progressCallback_ = callback;
+}
+
+auto XExec::progressTarget() -> const char*
+{
+#ifdef _WIN32
+    return "pipe:1";
+#else
+    return "pipe:3";
+#endif
+}
+
+auto XExec::setCaptureOutput(bool capture) -> void
+{
+    impl_->captureOutput_ = capture;
+}
+
 auto XExec::setExecutionMode(ExecutionMode mode) -> void
 {
     impl_->executionMode_ = mode;
@@ -124,7 +198,31 @@ auto XExec::start(const std::string_view& cmd, bool redirectStderr) -> bool
         actualCmd = std::string(cmd);
     }
 
-    return impl_->start(actualCmd, redirectStderr, impl_->outputCallback_);
+    const uint64_t tag = t_jobTag;
+    if (tag != 0)
+    {
+        auto&                       jobs = PImpl::registry();
+        std::lock_guard<std::mutex> lock(jobs.mutex);
+        if (jobs.cancelled.contains(tag))
+        {
+            return false;
+        }
+    }
+
+    /// 启动耗时：管道、fork/CreateProcess 与读取线程
+    const auto started = std::chrono::steady_clock::now();
+    const bool success = impl_->start(actualCmd, redirectStderr, impl_->outputCallback_);
+    Metrics::getInstance()->processSpawned(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count(), success);
+    if (!success)
+    {
+        return false;
+    }
+    if (tag != 0)
+    {
+        impl_->registerJob(tag);
+    }
+    return true;
 }
 
 auto XExec::getOutput() const -> std::string
@@ -151,11 +249,45 @@ auto XExec::isRunning() const -> bool
     return impl_->isRunning();
 }
 
+auto XExec::waitFor(int timeoutMs) -> bool
+{
+    return impl_->waitFor(timeoutMs);
+}
+
 auto XExec::terminate() -> bool
 {
     return impl_->terminate();
 }
 
+auto XExec::setThreadJobTag(uint64_t tag) -> void
+{
+    if (tag == 0 && t_jobTag != 0)
+    {
+        auto&                       jobs = PImpl::registry();
+        std::lock_guard<std::mutex> lock(jobs.mutex);
+        jobs.cancelled.erase(t_jobTag);
+    }
+    t_jobTag = tag;
+}
+
+auto XExec::terminateJob(uint64_t tag) -> size_t
+{
+    auto&                       jobs = PImpl::registry();
+    std::lock_guard<std::mutex> lock(jobs.mutex);
+    jobs.cancelled.insert(tag);
+
+    size_t     count = 0;
+    const auto range = jobs.processes.equal_range(tag);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second->signalTerminate())
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
 /// 静态方法实现
 auto XExec::execute(const std::string_view& command, bool redirectStderr, int timeoutMs) -> XExec::XResult
 {
@@ -200,9 +332,51 @@ auto XExec::execute(const std::string_view& command, bool redirectStderr, int ti
 
 XExec::PImpl::~PImpl()
 {
+    unregisterJob();
     cleanup();
 }
 
+auto XExec::PImpl::registry() -> JobRegistry&
+{
+    static JobRegistry instance;
+    return instance;
+}
+
+auto XExec::PImpl::registerJob(uint64_t tag) -> void
+{
+    auto&                       jobs = registry();
+    std::lock_guard<std::mutex> lock(jobs.mutex);
+    jobTag_ = tag;
+    jobs.processes.emplace(tag, this);
+
+    /// 启动前检查与登记之间作业被取消
+    if (jobs.cancelled.contains(tag))
+    {
+        signalTerminate();
+    }
+}
+
+auto XExec::PImpl::unregisterJob() -> void
+{
+    if (jobTag_ == 0)
+    {
+        return;
+    }
+
+    auto&                       jobs = registry();
+    std::lock_guard<std::mutex> lock(jobs.mutex);
+    const auto                  range = jobs.processes.equal_range(jobTag_);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == this)
+        {
+            jobs.processes.erase(it);
+            break;
+        }
+    }
+    jobTag_ = 0;
+}
+
 #ifdef _WIN32
 /// ==================== Windows 实现 ====================
 
@@ -253,6 +427,8 @@ auto XExec::PImpl::start(const std::string_view& cmd, bool redirectStderr, Outpu
     exitCode_       = -1;
     stdout_.clear();
     stderr_.clear();
+    pendingStdout_.clear();
+    pendingStderr_.clear();
     terminated_ = false;
 
     SECURITY_ATTRIBUTES saAttr;
@@ -371,36 +547,7 @@ auto XExec::PImpl::readOutput(bool isStderr) -> void
 
         if (readResult && bytesRead > 0)
         {
-            buffer[bytesRead] = '\0';
-            std::string output(buffer);
-
-            std::lock_guard<std::mutex> lock(mutex_);
-            if (isStderr)
-            {
-                stderr_ += output;
-            }
-            else
-            {
-                stdout_ += output;
-            }
-
-            if (outputCallback_)
-            {
-                /// 按行回调
-                std::istringstream stream(output);
-                std::string        line;
-                while (std::getline(stream, line))
-                {
-                    if (!line.empty() && line.back() == '\r')
-                    {
-                        line.pop_back();
-                    }
-                    if (!line.empty())
-                    {
-                        outputCallback_(line, isStderr);
-                    }
-                }
-            }
+            dispatchOutput(std::string_view(buffer, bytesRead), isStderr);
         }
         else
         {
@@ -417,6 +564,7 @@ auto XExec::PImpl::readOutput(bool isStderr) -> void
             ::Sleep(10);
         }
     }
+    flushPendingLine(isStderr);
 }
 
 auto XExec::PImpl::wait() -> int
@@ -430,6 +578,7 @@ auto XExec::PImpl::wait() -> int
     if (handles_.hProcess != INVALID_HANDLE_VALUE)
     {
         ::WaitForSingleObject(handles_.hProcess, INFINITE);
+        unregisterJob();
 
         DWORD dwExitCode;
         if (::GetExitCodeProcess(handles_.hProcess, &dwExitCode))
@@ -488,9 +637,40 @@ auto XExec::PImpl::terminate() -> bool
     return true;
 }
 
+auto XExec::PImpl::signalTerminate() -> bool
+{
+    if (!isRunning_ || handles_.hProcess == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    terminated_ = true;
+    return TerminateProcess(handles_.hProcess, 1) != FALSE;
+}
+
 #else
 // ==================== Linux/macOS 实现 ====================
 
+namespace
+{
+    /// 管道以 close-on-exec 创建：同时启动的其他子进程不会继承这些描述符，
+    /// 否则继承下来的写端会让读端一直等不到 EOF。子进程中 dup2 到 0-3 的副本会清除该标志
+    auto createPipe(int fds[2]) -> bool
+    {
+#ifdef __linux__
+        return pipe2(fds, O_CLOEXEC) == 0;
+#else
+        if (pipe(fds) == -1)
+        {
+            return false;
+        }
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        return true;
+#endif
+    }
+} // namespace
+
 void XExec::PImpl::closeAllFds()
 {
     auto closeFd = [](int& fd)
@@ -505,6 +685,9 @@ void XExec::PImpl::closeAllFds()
     closeFd(handles_.stdoutFd);
     closeFd(handles_.stderrFd);
     closeFd(handles_.stdinFd);
+    closeFd(handles_.progressFd);
+    closeFd(handles_.exitRd);
+    closeFd(handles_.exitWr);
 }
 
 bool XExec::PImpl::checkProcessExited()
@@ -531,21 +714,25 @@ bool XExec::PImpl::start(const std::string_view& cmd, bool redirectStderr, Outpu
     exitCode_       = -1;
     stdout_.clear();
     stderr_.clear();
+    pendingStdout_.clear();
+    pendingStderr_.clear();
+    pendingProgress_.clear();
     terminated_ = false;
-    // 删除：reading_ = false;
+    exited_     = false;
 
-    int stdoutPipe[2] = { -1, -1 };
-    int stderrPipe[2] = { -1, -1 };
-    int stdinPipe[2]  = { -1, -1 };
+    int stdoutPipe[2]   = { -1, -1 };
+    int stderrPipe[2]   = { -1, -1 };
+    int stdinPipe[2]    = { -1, -1 };
+    int progressPipe[2] = { -1, -1 };
 
     // 创建管道
-    if (pipe(stdoutPipe) == -1)
+    if (!createPipe(stdoutPipe))
     {
         std::cerr << "创建stdout管道失败" << std::endl;
         return false;
     }
 
-    if (pipe(stdinPipe) == -1)
+    if (!createPipe(stdinPipe))
     {
         std::cerr << "创建stdin管道失败" << std::endl;
         close(stdoutPipe[0]);
@@ -553,7 +740,7 @@ bool XExec::PImpl::start(const std::string_view& cmd, bool redirectStderr, Outpu
         return false;
     }
 
-    if (!redirectStderr && pipe(stderrPipe) == -1)
+    if (!redirectStderr && !createPipe(stderrPipe))
     {
         std::cerr << "创建stderr管道失败" << std::endl;
         close(stdoutPipe[0]);
@@ -563,6 +750,16 @@ bool XExec::PImpl::start(const std::string_view& cmd, bool redirectStderr, Outpu
         return false;
     }
 
+    // 进度通道：创建失败不影响执行，ffmpeg 写 pipe:3 时会自行报错
+    if (!createPipe(progressPipe))
+    {
+        progressPipe[0] = progressPipe[1] = -1;
+    }
+
+    /// 后台作业的子进程自成进程组：kill 时 sh 与管道中的各进程一起结束。
+    /// 前台命令留在终端的进程组中，Ctrl+C 仍能直接送达
+    processGroup_ = t_jobTag != 0;
+
     handles_.pid = fork();
 
     if (handles_.pid == -1)
@@ -577,11 +774,21 @@ bool XExec::PImpl::start(const std::string_view& cmd, bool redirectStderr, Outpu
             close(stderrPipe[0]);
             close(stderrPipe[1]);
         }
+        if (progressPipe[0] != -1)
+        {
+            close(progressPipe[0]);
+            close(progressPipe[1]);
+        }
         return false;
     }
 
     if (handles_.pid == 0) // 子进程
     {
+        if (processGroup_)
+        {
+            setpgid(0, 0);
+        }
+
         // 关闭父进程用的读端
         close(stdoutPipe[0]);
         close(stdinPipe[1]);
@@ -589,23 +796,22 @@ bool XExec::PImpl::start(const std::string_view& cmd, bool redirectStderr, Outpu
         // 重定向stdin
         if (dup2(stdinPipe[0], STDIN_FILENO) == -1)
         {
-            exit(127);
+            _exit(127);
         }
         close(stdinPipe[0]);
 
         // 重定向stdout
         if (dup2(stdoutPipe[1], STDOUT_FILENO) == -1)
         {
-            exit(127);
+            _exit(127);
         }
-        close(stdoutPipe[1]);
 
-        // 重定向stderr
+        // 重定向stderr（需在关闭 stdoutPipe[1] 之前复制）
         if (redirectStderr)
         {
             if (dup2(stdoutPipe[1], STDERR_FILENO) == -1)
             {
-                exit(127);
+                _exit(127);
             }
         }
         else
@@ -613,18 +819,43 @@ bool XExec::PImpl::start(const std::string_view& cmd, bool redirectStderr, Outpu
             close(stderrPipe[0]);
             if (dup2(stderrPipe[1], STDERR_FILENO) == -1)
             {
-                exit(127);
+                _exit(127);
             }
             close(stderrPipe[1]);
         }
+        close(stdoutPipe[1]);
+
+        // 进度通道放到 fd 3（其余描述符均已就位，不会被覆盖）
+        if (progressPipe[1] != -1)
+        {
+            close(progressPipe[0]);
+            if (progressPipe[1] != 3)
+            {
+                if (dup2(progressPipe[1], 3) == -1)
+                {
+                    _exit(127);
+                }
+                close(progressPipe[1]);
+            }
+            else
+            {
+                fcntl(3, F_SETFD, 0); /// 恰好就是 fd 3 时没有经过 dup2，需手动清除 close-on-exec
+            }
+        }
 
         // 执行命令
         const std::string command{ cmd };
         execl("/bin/sh", "sh", "-c", command.c_str(), nullptr);
-        exit(127); // exec失败
+        _exit(127); // exec失败；_exit 不运行静态析构，子进程中不存在父进程的线程
     }
     else // 父进程
     {
+        // 父子进程都设置进程组，避免子进程 exec 前就收到终止请求时信号发不到整组
+        if (processGroup_)
+        {
+            setpgid(handles_.pid, handles_.pid);
+        }
+
         // 关闭子进程用的写端
         close(stdoutPipe[1]);
         handles_.stdoutFd = stdoutPipe[0];
@@ -637,12 +868,29 @@ bool XExec::PImpl::start(const std::string_view& cmd, bool redirectStderr, Outpu
             handles_.stderrFd = stderrPipe[0];
         }
 
+        if (progressPipe[0] != -1)
+        {
+            close(progressPipe[1]);
+            handles_.progressFd = progressPipe[0];
+        }
+
         // 设置管道非阻塞
         fcntl(handles_.stdoutFd, F_SETFL, O_NONBLOCK);
         if (!redirectStderr)
         {
             fcntl(handles_.stderrFd, F_SETFL, O_NONBLOCK);
         }
+        if (handles_.progressFd != -1)
+        {
+            fcntl(handles_.progressFd, F_SETFL, O_NONBLOCK);
+        }
+
+        int exitPipe[2] = { -1, -1 };
+        if (createPipe(exitPipe))
+        {
+            handles_.exitRd = exitPipe[0];
+            handles_.exitWr = exitPipe[1];
+        }
 
         // 关键：先设置 isRunning_，然后立即启动线程
         isRunning_.store(true, std::memory_order_release);
@@ -654,71 +902,75 @@ bool XExec::PImpl::start(const std::string_view& cmd, bool redirectStderr, Outpu
         {
             stderrThread_ = std::thread([this]() { readOutput(true); });
         }
+
+        if (handles_.progressFd != -1)
+        {
+            progressThread_ = std::thread([this]() { readProgress(); });
+        }
     }
 
     return true;
 }
 
-void XExec::PImpl::readOutput(bool isStderr)
+void XExec::PImpl::pumpPipe(int fd, const std::function<void(std::string_view)>& onData)
 {
-    int  fd = isStderr ? handles_.stderrFd : handles_.stdoutFd;
-    char buffer[4096];
+    /// 子进程退出后管道可能仍被孙进程持有：排空期间连续这么久没有数据就放弃
+    constexpr int DRAIN_MS = 200;
 
-    // 使用 isRunning_ 作为条件
-    while (isRunning_.load(std::memory_order_acquire))
+    char   buffer[4096];
+    pollfd fds[2]   = { { fd, POLLIN, 0 }, { handles_.exitRd, POLLIN, 0 } };
+    bool   draining = false;
+    while (true)
     {
-        ssize_t bytesRead = read(fd, buffer, sizeof(buffer) - 1);
-
-        if (bytesRead > 0)
+        /// 没有数据时阻塞在 poll 上，直到管道可读、EOF 或 wait() 关闭 exitWr 通知子进程已退出
+        draining        = draining || exited_.load(std::memory_order_acquire);
+        const int nfds  = draining ? 1 : 2;
+        const int ready = ::poll(fds, nfds, draining || handles_.exitRd < 0 ? DRAIN_MS : -1);
+        if (ready < 0)
         {
-            buffer[bytesRead] = '\0';
-            std::string output(buffer);
-
-            std::lock_guard<std::mutex> lock(mutex_);
-            if (isStderr)
-            {
-                stderr_ += output;
-            }
-            else
+            if (errno == EINTR)
             {
-                stdout_ += output;
-            }
-
-            if (outputCallback_)
-            {
-                std::istringstream stream(output);
-                std::string        line;
-                while (std::getline(stream, line))
-                {
-                    if (!line.empty())
-                    {
-                        outputCallback_(line, isStderr);
-                    }
-                }
+                continue;
             }
-        }
-        else if (bytesRead == 0)
-        {
-            // EOF，管道已关闭
             break;
         }
-        else if (bytesRead == -1)
+        if (ready == 0)
         {
-            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            if (draining)
             {
-                // 非阻塞，没有数据
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                continue;
-            }
-            else
-            {
-                // 其他错误
                 break;
             }
+            continue;
+        }
+        if (fds[0].revents == 0)
+        {
+            continue; /// 只有退出通知，下一轮进入排空
+        }
+
+        const ssize_t bytesRead = ::read(fd, buffer, sizeof(buffer));
+        if (bytesRead > 0)
+        {
+            onData(std::string_view(buffer, static_cast<size_t>(bytesRead)));
+        }
+        else if (bytesRead == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            break; // EOF 或错误
         }
     }
 }
 
+void XExec::PImpl::readProgress()
+{
+    pumpPipe(handles_.progressFd, [this](std::string_view chunk) { dispatchProgress(chunk); });
+}
+
+void XExec::PImpl::readOutput(bool isStderr)
+{
+    pumpPipe(isStderr ? handles_.stderrFd : handles_.stdoutFd,
+             [this, isStderr](std::string_view chunk) { dispatchOutput(chunk, isStderr); });
+    flushPendingLine(isStderr);
+}
+
 int XExec::PImpl::wait()
 {
     if (!isRunning_ && exitCode_ != -1)
@@ -729,6 +981,16 @@ int XExec::PImpl::wait()
     // 步骤1：等待进程退出
     if (handles_.pid > 0)
     {
+        // 先不回收，注销作业登记后再 waitpid，保证 terminateJob 不会向被复用的 pid 发信号
+        if (jobTag_ != 0)
+        {
+            siginfo_t info{};
+            while (waitid(P_PID, static_cast<id_t>(handles_.pid), &info, WEXITED | WNOWAIT) == -1 && errno == EINTR)
+            {
+            }
+            unregisterJob();
+        }
+
         int status;
         waitpid(handles_.pid, &status, 0);
 
@@ -746,10 +1008,13 @@ int XExec::PImpl::wait()
         }
     }
 
-    // 步骤2：关闭文件描述符，让读取线程自然退出
-    closeAllFds();
-
-    // 步骤3：等待线程结束
+    // 步骤2：先让读取线程读到EOF，避免关闭管道时丢弃尚未读取的输出
+    exited_.store(true, std::memory_order_release);
+    if (handles_.exitWr != -1)
+    {
+        close(handles_.exitWr); /// 读取线程的 poll 随之返回，进入排空阶段
+        handles_.exitWr = -1;
+    }
     if (stdoutThread_.joinable())
     {
         stdoutThread_.join();
@@ -760,6 +1025,14 @@ int XExec::PImpl::wait()
         stderrThread_.join();
     }
 
+    if (progressThread_.joinable())
+    {
+        progressThread_.join();
+    }
+
+    // 步骤3：关闭文件描述符
+    closeAllFds();
+
     // 步骤4：最后更新状态
     isRunning_.store(false, std::memory_order_release);
 
@@ -778,7 +1051,8 @@ bool XExec::PImpl::terminate()
 
     terminated_ = true;
 
-    if (kill(handles_.pid, SIGTERM) == -1)
+    const pid_t target = processGroup_ ? -handles_.pid : handles_.pid;
+    if (kill(target, SIGTERM) == -1)
     {
         std::cerr << "发送SIGTERM失败" << std::endl;
         return false;
@@ -795,7 +1069,7 @@ bool XExec::PImpl::terminate()
     }
 
     // 强制终止
-    if (kill(handles_.pid, SIGKILL) == -1)
+    if (kill(target, SIGKILL) == -1)
     {
         std::cerr << "发送SIGKILL失败" << std::endl;
         return false;
@@ -804,13 +1078,181 @@ bool XExec::PImpl::terminate()
     return true;
 }
 
+bool XExec::PImpl::signalTerminate()
+{
+    if (!isRunning_ || handles_.pid <= 0)
+    {
+        return false;
+    }
+
+    terminated_ = true;
+    return kill(processGroup_ ? -handles_.pid : handles_.pid, SIGTERM) == 0;
+}
+
 #endif
 
 // ==================== 跨平台通用实现 ====================
 
+auto XExec::PImpl::waitFor(int timeoutMs) -> bool
+{
+    if (!isRunning_)
+    {
+        return true;
+    }
+    timeoutMs = std::max(0, timeoutMs);
+
+#ifdef _WIN32
+    return handles_.hProcess == INVALID_HANDLE_VALUE ||
+            WaitForSingleObject(handles_.hProcess, static_cast<DWORD>(timeoutMs)) == WAIT_OBJECT_0;
+#else
+#ifdef __linux__
+    /// pidfd 在子进程退出（成为僵尸）时变为可读，不回收进程
+    if (handles_.pid > 0)
+    {
+        const int pidFd = static_cast<int>(::syscall(SYS_pidfd_open, handles_.pid, 0));
+        if (pidFd >= 0)
+        {
+            pollfd pfd{ pidFd, POLLIN, 0 };
+            int    ready = 0;
+            while ((ready = ::poll(&pfd, 1, timeoutMs)) == -1 && errno == EINTR)
+            {
+            }
+            ::close(pidFd);
+            return ready > 0 || !isRunning();
+        }
+    }
+#endif
+    /// 没有 pidfd（非 Linux 或内核 < 5.3）时按短间隔探测
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (isRunning())
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return true;
+#endif
+}
+
 auto XExec::PImpl::isRunning() const -> bool
 {
-    return isRunning_;
+    if (!isRunning_)
+    {
+        return false;
+    }
+
+    /// isRunning_ 要到 wait() 回收子进程后才清除；这里只探测是否已退出，不回收，退出码仍由 wait() 取得
+#ifdef _WIN32
+    return handles_.hProcess == INVALID_HANDLE_VALUE || WaitForSingleObject(handles_.hProcess, 0) != WAIT_OBJECT_0;
+#else
+    if (handles_.pid <= 0)
+    {
+        return true;
+    }
+    siginfo_t info{};
+    if (waitid(P_PID, static_cast<id_t>(handles_.pid), &info, WEXITED | WNOHANG | WNOWAIT) == 0 &&
+        info.si_pid == handles_.pid)
+    {
+        return false;
+    }
+    return true;
+#endif
+}
+
+auto XExec::PImpl::dispatchOutput(std::string_view chunk, bool isStderr) -> void
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (captureOutput_)
+    {
+        (isStderr ? stderr_ : stdout_).append(chunk);
+    }
+
+    if (!outputCallback_)
+    {
+        return;
+    }
+
+    /// 按行回调，\r 与 \n 都视为行结束（ffmpeg 的状态行以 \r 刷新）
+    std::string &pending = isStderr ? pendingStderr_ : pendingStdout_;
+    size_t       begin   = 0;
+    for (size_t i = 0; i < chunk.size(); ++i)
+    {
+        if (chunk[i] != '\n' && chunk[i] != '\r')
+        {
+            continue;
+        }
+
+        std::string_view piece = chunk.substr(begin, i - begin);
+        if (!pending.empty())
+        {
+            pending.append(piece);
+            outputCallback_(pending, isStderr);
+            pending.clear();
+        }
+        else if (!piece.empty())
+        {
+            outputCallback_(piece, isStderr);
+        }
+        begin = i + 1;
+    }
+    pending.append(chunk.substr(begin));
+}
+
+auto XExec::PImpl::flushPendingLine(bool isStderr) -> void
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string                &pending = isStderr ? pendingStderr_ : pendingStdout_;
+    if (outputCallback_ && !pending.empty())
+    {
+        outputCallback_(pending, isStderr);
+    }
+    pending.clear();
+}
+
+auto XExec::PImpl::dispatchProgress(std::string_view chunk) -> void
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!progressCallback_ && !outputCallback_)
+    {
+        return;
+    }
+
+    auto emit = [this](std::string_view line)
+    {
+        if (progressCallback_)
+        {
+            progressCallback_(line);
+        }
+        else
+        {
+            outputCallback_(line, false);
+        }
+    };
+
+    size_t begin = 0;
+    for (size_t i = 0; i < chunk.size(); ++i)
+    {
+        if (chunk[i] != '\n')
+        {
+            continue;
+        }
+
+        std::string_view piece = chunk.substr(begin, i - begin);
+        if (!pendingProgress_.empty())
+        {
+            pendingProgress_.append(piece);
+            emit(pendingProgress_);
+            pendingProgress_.clear();
+        }
+        else if (!piece.empty())
+        {
+            emit(piece);
+        }
+        begin = i + 1;
+    }
+    pendingProgress_.append(chunk.substr(begin));
 }
 
 auto XExec::PImpl::getStdout() const -> std::string
@@ -863,6 +1305,9 @@ auto XExec::PImpl::cleanup() -> void
     closeFd(handles_.stdoutFd);
     closeFd(handles_.stderrFd);
     closeFd(handles_.stdinFd);
+    closeFd(handles_.progressFd);
+    closeFd(handles_.exitRd);
+    closeFd(handles_.exitWr);
     handles_.pid = -1;
 #endif
 
@@ -1,12 +1,23 @@
 ﻿#include "XTask.h"
 #include "XExec.h"
 
+#include "ProgressDashboard.h"
 #include "TaskProgressBar.h"
 
 #include <algorithm>
 #include <iostream>
+#include <regex>
 #include <utility>
 
+namespace
+{
+    /// 日志中不回显密钥：-encryption_key/-decryption_key 参数与 CENC 封装选项中的密钥替换为 ***
+    auto redactSecrets(const std::string &command) -> std::string
+    {
+        static const std::regex pattern(R"(((?:en|de)cryption_key[= ]+)[0-9A-Fa-f]+)");
+        return std::regex_replace(command, pattern, "$1***");
+    }
+} // namespace
 
 class XTask::PImpl
 {
@@ -23,6 +34,7 @@ public:
     std::map<std::string, ParameterValue> parameterList_;
     mutable ProgressCallback              progressCallback_;
     TaskProgressBar::Ptr                  progressBar_ = nullptr;
+    BarFactory                            barFactory_;
     ICommandBuilder::Ptr                  builder_     = nullptr;
 };
 
@@ -160,6 +172,7 @@ auto XTask::doExecute(const std::map<std::string, std::string> &inputParams, std
 
     /// 4. 构建任务命令（如果有构建器）
     std::string command, result;
+    bool        inProcess = false;
     if (impl_->builder_)
     {
         ///  (1). 特定任务验证
@@ -172,14 +185,33 @@ auto XTask::doExecute(const std::map<std::string, std::string> &inputParams, std
         std::string title = impl_->builder_->getTitle(impl_->parameterList_);
         setTitle(title);
 
-        /// (3). 构建命令
-        command = impl_->builder_->build(impl_->parameterList_);
-        std::cout << "执行命令: " << command << std::endl;
+        /// (3). 构建命令（进程内任务无需命令）
+        inProcess = impl_->builder_->isInProcess(impl_->parameterList_);
+        if (!inProcess)
+        {
+            command = impl_->builder_->build(impl_->parameterList_);
+            if (command.empty())
+            {
+                errorMsg = "无法构建任务命令";
+                return false;
+            }
+            if (ProgressDashboard::isThreadVisible())
+            {
+                std::cout << "执行命令: " << redactSecrets(command) << std::endl;
+            }
+        }
     }
 
 
     /// 4. 执行一些任务
-    if (!execute(command, impl_->parameterList_, errorMsg, result))
+    if (inProcess)
+    {
+        if (!impl_->builder_->run(impl_->parameterList_, result, errorMsg))
+        {
+            return false;
+        }
+    }
+    else if (!execute(command, impl_->parameterList_, errorMsg, result))
     {
         return false;
     }
@@ -277,6 +309,32 @@ auto XTask::progressBar() const -> TaskProgressBar::Ptr
     return impl_->progressBar_;
 }
 
+auto XTask::setProgressBarFactory(const BarFactory &factory) -> XTask &
+{
+    impl_->barFactory_  = factory;
+    impl_->progressBar_ = factory ? factory() : nullptr;
+    return *this;
+}
+
+auto XTask::clone() const -> XTask::Ptr
+{
+    auto task = XTask::create(impl_->name_, impl_->func_, impl_->description_);
+    copyDefinitionTo(*task);
+    return task;
+}
+
+auto XTask::copyDefinitionTo(XTask &other) const -> void
+{
+    other.impl_->func_             = impl_->func_;
+    other.impl_->parameters_       = impl_->parameters_;
+    other.impl_->progressCallback_ = impl_->progressCallback_;
+    other.impl_->builder_          = impl_->builder_; /// 构建器无状态，可以共享
+    other.impl_->barFactory_       = impl_->barFactory_;
+
+    /// 没有工厂的进度条只能共享（默认任务通常没有进度条）
+    other.impl_->progressBar_ = impl_->barFactory_ ? impl_->barFactory_() : impl_->progressBar_;
+}
+
 auto XTask::setProgressCallback(ProgressCallback callback) -> XTask &
 {
     impl_->progressCallback_ = std::move(callback);
@@ -2,7 +2,9 @@
 
 #ifdef _WIN32
 #include <corecrt_io.h>
+#include <windows.h>
 #else
+#include <sys/ioctl.h>
 #include <unistd.h>
 #endif
 #include <algorithm>
@@ -19,6 +21,29 @@ auto XTool::isInteractiveTerminal() -> bool
 #endif
 }
 
+auto XTool::getTerminalSize(int &columns, int &rows) -> bool
+{
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (!_isatty(_fileno(stdout)) || !::GetConsoleScreenBufferInfo(::GetStdHandle(STD_OUTPUT_HANDLE), &info))
+    {
+        return false;
+    }
+    columns = info.srWindow.Right - info.srWindow.Left + 1;
+    rows    = info.srWindow.Bottom - info.srWindow.Top + 1;
+    return true;
+#else
+    struct winsize size = {};
+    if (!isatty(fileno(stdout)) || ioctl(fileno(stdout), TIOCGWINSZ, &size) != 0 || size.ws_col == 0)
+    {
+        return false;
+    }
+    columns = size.ws_col;
+    rows    = size.ws_row;
+    return true;
+#endif
+}
+
 auto XTool::split(const std::string_view &input, char delimiter, bool trimWhitespace) -> std::vector<std::string>
 {
     std::vector<std::string> ret;
@@ -98,6 +123,12 @@ auto XTool::smartSplit(const std::string &input) -> std::vector<std::string>
     return tokens;
 }
 
+auto XTool::hasShellMetachar(std::string_view value) -> bool
+{
+    constexpr std::string_view unsafe = "$`\"\\'\n\r;|&<>";
+    return value.find_first_of(unsafe) != std::string_view::npos || value.find('\0') != std::string_view::npos;
+}
+
 auto XTool::getFFmpegPath() -> std::string
 {
 #ifdef FFMPEG_PATH
@@ -1,11 +1,32 @@
 ﻿#include "XUserInput.h"
 
+#include "BackgroundJobs.h"
+#include "BatchScript.h"
 #include "ReplxxConfigurator.h"
 #include "XTool.h"
+#include "MediaProbeCache.h"
 
 #include <iostream>
 #include <stdexcept>
 #include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+namespace
+{
+    /// 去掉结尾的 &（不含 &&），返回是否要求后台执行
+    auto stripBackgroundSuffix(std::string_view& input) -> bool
+    {
+        const auto end = input.find_last_not_of(" \t");
+        if (end == std::string_view::npos || input[end] != '&' || (end > 0 && input[end - 1] == '&'))
+        {
+            return false;
+        }
+        const auto last = input.find_last_not_of(" \t", end == 0 ? 0 : end - 1);
+        input           = end == 0 || last == std::string_view::npos ? std::string_view() : input.substr(0, last + 1);
+        return true;
+    }
+} // namespace
 
 /// 私有实现类
 class XUserInput::PImpl
@@ -33,6 +54,24 @@ public:
 
     auto handleTaskCommand(const ParsedCommand& cmd) -> void;
 
+    /// 按命令名分发：task、内置命令、或直接以任务名开头；未知命令返回 false
+    auto dispatchCommand(ParsedCommand parsed) -> bool;
+
+    /// script <脚本文件> [--jobs N]：批量执行脚本中的命令
+    auto handleScriptCommand(const ParsedCommand& cmd) -> void;
+
+    /// 以 & 结尾的任务命令：提交到后台作业，立即返回
+    auto handleBackgroundCommand(ParsedCommand parsed, const std::string& command) -> void;
+
+    /// jobs / fg [id] / kill <id> / wait
+    auto handleJobsCommand() -> void;
+    auto handleForegroundCommand(const ParsedCommand& cmd) -> void;
+    auto handleKillCommand(const ParsedCommand& cmd) -> void;
+    auto handleWaitCommand() -> void;
+
+    /// 输出已结束尚未报告的后台作业
+    auto reportFinishedJobs() -> void;
+
     /// 错误处理
     auto handleError(const std::exception& e) -> void;
 
@@ -42,6 +81,8 @@ public:
 
     auto stop() -> void;
 
+    auto execute(const std::vector<std::string>& args) -> int;
+
     auto setOnCommandStart(CommandCallback callback) -> void;
 
     auto setOnCommandComplete(CommandCallback callback) -> void;
@@ -96,6 +137,9 @@ private:
     /// 初始化与清理
     auto initialize() -> void;
 
+    /// 交互模式才需要的组件：行编辑器与历史记录（读取历史文件）
+    auto initializeInteractive() -> void;
+
     auto initializeREPL() -> void;
 
     auto initializeSimpleMode() -> void;
@@ -124,7 +168,10 @@ private:
     std::unique_ptr<CommandParser>     commandParser_     = nullptr;
     std::unique_ptr<HistoryManager>    historyManager_    = nullptr;
     std::unique_ptr<TaskManager>       taskManager_       = nullptr;
+    std::unique_ptr<BackgroundJobs>    background_        = nullptr; ///< 首次使用 & 时创建，先于任务管理器析构
     std::unique_ptr<CompletionManager> completionManager_ = nullptr;
+
+    std::atomic<bool> atPrompt_{ false }; ///< REPL 正在等待输入，后台状态可以直接刷新提示符
 };
 
 /// =============== 实现 ===============
@@ -160,22 +207,31 @@ XUserInput::PImpl::~PImpl()
 
 auto XUserInput::PImpl::initialize() -> void
 {
-    /// 循环代理
-    rx_ = std::make_unique<replxx::Replxx>();
-
     /// 初始化任务管理器
     taskManager_ = std::make_unique<TaskManager>();
 
-    /// 初始化历史管理器
-    historyManager_ = std::make_unique<HistoryManager>(rx_, config_);
+    /// 探测缓存与历史记录放在同一目录
+    MediaProbeCache::getInstance()->setStorageDirectory(config_.historyPath.parent_path());
 
     /// 初始化补全管理器
     completionManager_ = std::make_unique<CompletionManager>();
 
     /// 注册内置命令（这会同时注册到补全管理器）
     registerBuiltinCommands();
+}
 
-    /// 加载历史记录
+auto XUserInput::PImpl::initializeInteractive() -> void
+{
+    if (historyManager_)
+    {
+        return;
+    }
+
+    /// 循环代理
+    rx_ = std::make_unique<replxx::Replxx>();
+
+    /// 初始化历史管理器并加载历史记录
+    historyManager_ = std::make_unique<HistoryManager>(rx_, config_);
     historyManager_->loadHistory();
 }
 
@@ -186,6 +242,10 @@ auto XUserInput::PImpl::registerBuiltinCommands() -> void
                            [this](const ParsedCommand&)
                            {
                                stateMachine_->transitionTo(InputStateMachine::State::Running);
+                               if (background_ && background_->activeCount() > 0)
+                               {
+                                   std::cout << "终止 " << background_->activeCount() << " 个后台作业\n";
+                               }
                                showGoodbyeMessage();
                                stateMachine_->transitionTo(InputStateMachine::State::ShuttingDown);
                            });
@@ -226,6 +286,15 @@ auto XUserInput::PImpl::registerBuiltinCommands() -> void
                                          << "=====================\n";
                            });
 
+    /// script 命令
+    registerCommandHandler("script", [this](const ParsedCommand& cmd) { handleScriptCommand(cmd); });
+
+    /// 后台作业控制
+    registerCommandHandler("jobs", [this](const ParsedCommand&) { handleJobsCommand(); });
+    registerCommandHandler("fg", [this](const ParsedCommand& cmd) { handleForegroundCommand(cmd); });
+    registerCommandHandler("kill", [this](const ParsedCommand& cmd) { handleKillCommand(cmd); });
+    registerCommandHandler("wait", [this](const ParsedCommand&) { handleWaitCommand(); });
+
     registerCommandHandler("list",
                            [this](const ParsedCommand&)
                            {
@@ -312,6 +381,7 @@ auto XUserInput::PImpl::start() -> void
     }
     stateMachine_->transitionTo(InputStateMachine::State::Running);
 
+    initializeInteractive();
     showWelcomeMessage();
 
     if (shouldUseREPL())
@@ -346,11 +416,15 @@ auto XUserInput::PImpl::runREPLLoop() -> void
     {
         const char* line = nullptr;
 
+        reportFinishedJobs();
+
+        atPrompt_ = true;
         do
         {
             line = rx_->input(getPrompt());
         }
         while (line == nullptr && errno == EAGAIN);
+        atPrompt_ = false;
 
         if (line == nullptr)
         {
@@ -368,6 +442,7 @@ auto XUserInput::PImpl::runSimpleLoop() -> void
 
     while (stateMachine_->isRunning())
     {
+        reportFinishedJobs();
         std::cout << getPrompt();
         std::cout.flush();
 
@@ -395,18 +470,27 @@ auto XUserInput::PImpl::handleCommand(const std::string_view& input) -> void
 
         stateMachine_->transitionTo(InputStateMachine::State::ProcessingCommand);
 
-        /// 解析命令
-        auto parsed = commandParser_->parse(input);
+        /// 解析命令；以 & 结尾的在后台执行
+        std::string_view line       = input;
+        const bool       background = stripBackgroundSuffix(line);
+        auto             parsed     = commandParser_->parse(line);
         if (!commandParser_->validate(parsed))
         {
             throw std::runtime_error("Invalid command format");
         }
 
         /// 添加到历史记录
-        historyManager_->addToHistory(input);
+        if (historyManager_)
+        {
+            historyManager_->addToHistory(input);
+        }
 
         /// 分发命令处理
-        if (parsed.command == "task")
+        if (background)
+        {
+            handleBackgroundCommand(parsed, std::string(line));
+        }
+        else if (parsed.command == "task")
         {
             handleTaskCommand(parsed);
         }
@@ -434,6 +518,49 @@ auto XUserInput::PImpl::handleCommand(const std::string_view& input) -> void
     }
 }
 
+auto XUserInput::PImpl::execute(const std::vector<std::string>& args) -> int
+{
+    if (args.empty())
+    {
+        return 2;
+    }
+
+    auto parsed = commandParser_->parseArgs(args);
+    if (!commandParser_->validate(parsed))
+    {
+        std::cerr << "无效的命令: " << args[0] << "\n";
+        return 2;
+    }
+
+    if (stateMachine_->getCurrentState() == InputStateMachine::State::Initializing)
+    {
+        stateMachine_->transitionTo(InputStateMachine::State::Running);
+    }
+
+    int exitCode = 0;
+    try
+    {
+        stateMachine_->transitionTo(InputStateMachine::State::ProcessingCommand);
+
+        if (!dispatchCommand(parsed))
+        {
+            std::cerr << "未知的命令或任务: " << parsed.command << "\n";
+            exitCode = 2;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "执行出错: " << e.what() << "\n";
+        exitCode = 1;
+    }
+
+    if (stateMachine_->getCurrentState() == InputStateMachine::State::ProcessingCommand)
+    {
+        stateMachine_->transitionTo(InputStateMachine::State::Running);
+    }
+    return exitCode;
+}
+
 auto XUserInput::PImpl::handleTaskCommand(const CommandParser::ParsedCommand& cmd) -> void
 {
     if (cmd.args.empty())
@@ -468,6 +595,278 @@ auto XUserInput::PImpl::handleTaskCommand(const CommandParser::ParsedCommand& cm
     }
 }
 
+auto XUserInput::PImpl::dispatchCommand(ParsedCommand parsed) -> bool
+{
+    /// 先查内置命令（不触发任务注册），再按名称查找任务（只注册这一个）
+    if (parsed.command == "task")
+    {
+        handleTaskCommand(parsed);
+    }
+    else if (commandHandlers_.contains(parsed.command))
+    {
+        handleBuiltinCommand(parsed);
+    }
+    else if (taskManager_->hasTaskInstance(parsed.command))
+    {
+        parsed.args.insert(parsed.args.begin(), parsed.command);
+        handleTaskCommand(parsed);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+auto XUserInput::PImpl::handleScriptCommand(const ParsedCommand& cmd) -> void
+{
+    if (cmd.args.empty())
+    {
+        throw std::runtime_error("用法: script <脚本文件> [--jobs N]");
+    }
+
+    size_t jobs = 1;
+    if (cmd.options.contains("--jobs"))
+    {
+        const int value = std::atoi(cmd.options.at("--jobs").c_str());
+        if (value <= 0)
+        {
+            throw std::runtime_error("--jobs 必须为正整数");
+        }
+        jobs = static_cast<size_t>(value);
+    }
+
+    /// 任务可以并行；内置命令（包括嵌套的 script）作为屏障串行执行
+    auto isTask = [this](const ParsedCommand& command)
+    {
+        return command.command == "task" ||
+                (!commandHandlers_.contains(command.command) && taskManager_->hasTaskInstance(command.command));
+    };
+
+    BatchScript script;
+    std::string error;
+    if (!script.load(cmd.args[0], isTask, error))
+    {
+        throw std::runtime_error(error);
+    }
+    for (const auto& command : script.getCommands())
+    {
+        if (command.barrier && !commandHandlers_.contains(command.parsed.command))
+        {
+            throw std::runtime_error("第 " + std::to_string(command.line) + " 行未知的命令或任务: " +
+                                     command.parsed.command);
+        }
+    }
+
+    const auto& commands = script.getCommands();
+    const auto  roots    = std::ranges::count_if(commands, [](const auto& command) { return command.dependsOn.empty(); });
+    std::cout << "[批处理] " << commands.size() << " 条命令，" << roots << " 条可立即执行，并行 " << jobs
+              << std::endl;
+
+    const bool ok = script.run(jobs,
+                               [this](const ParsedCommand& command, std::string& errorMsg) -> bool
+                               {
+                                   try
+                                   {
+                                       return dispatchCommand(command);
+                                   }
+                                   catch (const std::exception& e)
+                                   {
+                                       errorMsg = e.what();
+                                       return false;
+                                   }
+                               });
+    std::cout << script.formatReport();
+
+    if (!ok)
+    {
+        throw std::runtime_error("批处理中有命令未成功");
+    }
+}
+
+auto XUserInput::PImpl::handleBackgroundCommand(ParsedCommand parsed, const std::string& command) -> void
+{
+    if (parsed.command != "task")
+    {
+        if (commandHandlers_.contains(parsed.command) || !taskManager_->hasTaskInstance(parsed.command))
+        {
+            throw std::runtime_error("只有任务可以在后台运行: " + parsed.command);
+        }
+        parsed.args.insert(parsed.args.begin(), parsed.command);
+        parsed.command = "task";
+    }
+    if (parsed.args.empty() || !taskManager_->hasTaskInstance(parsed.args[0]))
+    {
+        throw std::runtime_error("Unknown task: " + (parsed.args.empty() ? std::string() : parsed.args[0]));
+    }
+
+    if (!background_)
+    {
+        background_ = std::make_unique<BackgroundJobs>();
+
+        /// REPL 等待输入时直接刷新：结束通知打印在提示符上方，状态行随提示符更新
+        background_->setOnStatus(
+                [this]()
+                {
+                    if (!atPrompt_ || !rx_)
+                    {
+                        return;
+                    }
+                    for (const auto& job : background_->takeFinished())
+                    {
+                        rx_->print("%s\n", BackgroundJobs::describe(job).c_str());
+                    }
+                    rx_->set_prompt(getPrompt());
+                });
+    }
+
+    const auto id = background_->submit(command,
+                                        [this, parsed](std::string& errorMsg) -> bool
+                                        {
+                                            try
+                                            {
+                                                handleTaskCommand(parsed);
+                                                return true;
+                                            }
+                                            catch (const std::exception& e)
+                                            {
+                                                errorMsg = e.what();
+                                                return false;
+                                            }
+                                        });
+    std::cout << "[" << id << "] 已在后台启动: " << command << std::endl;
+}
+
+auto XUserInput::PImpl::handleJobsCommand() -> void
+{
+    const auto jobs = background_ ? background_->list() : std::vector<BackgroundJobs::Job>{};
+    if (jobs.empty())
+    {
+        std::cout << "没有后台作业\n";
+        return;
+    }
+
+    for (const auto& job : jobs)
+    {
+        std::cout << BackgroundJobs::describe(job) << "\n";
+    }
+
+    /// 已结束的作业报告一次后移除
+    background_->takeFinished();
+}
+
+auto XUserInput::PImpl::handleForegroundCommand(const ParsedCommand& cmd) -> void
+{
+    if (!background_)
+    {
+        throw std::runtime_error("没有后台作业");
+    }
+
+    size_t id = cmd.args.empty() ? 0 : static_cast<size_t>(std::atoll(cmd.args[0].c_str()));
+    if (!cmd.args.empty() && id == 0)
+    {
+        throw std::runtime_error("用法: fg [作业编号]");
+    }
+
+    /// 不指定编号时取最近提交的作业
+    const auto jobs = background_->list();
+    const auto it   = id == 0 ? (jobs.empty() ? jobs.end() : jobs.end() - 1)
+                              : std::ranges::find(jobs, id, &BackgroundJobs::Job::id);
+    if (it == jobs.end())
+    {
+        throw std::runtime_error(id == 0 ? "没有后台作业" : "没有作业 [" + std::to_string(id) + "]");
+    }
+    id = it->id;
+    std::cout << it->command << std::endl;
+
+    /// 终端上用一行原地刷新该作业的进度
+    const bool live = XTool::isInteractiveTerminal();
+    auto       tick = [this, live, id]()
+    {
+        if (!live)
+        {
+            return;
+        }
+        for (const auto& job : background_->list())
+        {
+            if (job.id == id)
+            {
+                std::cout << "\r\x1b[K" << BackgroundJobs::describe(job) << std::flush;
+            }
+        }
+    };
+
+    BackgroundJobs::Job job;
+    std::string         error;
+    if (!background_->wait(id, job, tick, 500, error))
+    {
+        throw std::runtime_error(error);
+    }
+    if (live)
+    {
+        std::cout << "\r\x1b[K";
+    }
+    std::cout << BackgroundJobs::describe(job) << std::endl;
+
+    if (job.state != BackgroundJobs::State::Succeeded)
+    {
+        throw std::runtime_error("后台作业 [" + std::to_string(job.id) + "] " + BackgroundJobs::stateName(job.state));
+    }
+}
+
+auto XUserInput::PImpl::handleKillCommand(const ParsedCommand& cmd) -> void
+{
+    const size_t id = cmd.args.empty() ? 0 : static_cast<size_t>(std::atoll(cmd.args[0].c_str()));
+    if (id == 0)
+    {
+        throw std::runtime_error("用法: kill <作业编号>");
+    }
+
+    std::string error;
+    if (!background_ || !background_->kill(id, error))
+    {
+        throw std::runtime_error(background_ ? error : "没有后台作业");
+    }
+    std::cout << "[" << id << "] 已请求终止\n";
+}
+
+auto XUserInput::PImpl::handleWaitCommand() -> void
+{
+    if (!background_)
+    {
+        return;
+    }
+
+    const bool live = XTool::isInteractiveTerminal();
+    background_->waitAll(
+            [this, live]()
+            {
+                if (live)
+                {
+                    std::cout << "\r\x1b[K" << background_->statusLine() << std::flush;
+                }
+            },
+            500);
+    if (live)
+    {
+        std::cout << "\r\x1b[K";
+    }
+    reportFinishedJobs();
+}
+
+auto XUserInput::PImpl::reportFinishedJobs() -> void
+{
+    if (!background_)
+    {
+        return;
+    }
+    for (const auto& job : background_->takeFinished())
+    {
+        std::cout << BackgroundJobs::describe(job) << "\n";
+    }
+    std::cout.flush();
+}
+
 auto XUserInput::PImpl::handleBuiltinCommand(const ParsedCommand& cmd) -> void
 {
     auto handler = commandHandlers_[cmd.command];
@@ -531,12 +930,13 @@ auto XUserInput::PImpl::getConfig() const -> const UIConfig&
 
 auto XUserInput::PImpl::clearHistory() -> void
 {
+    initializeInteractive();
     historyManager_->clearHistory();
 }
 
 auto XUserInput::PImpl::getHistory() const -> std::vector<std::string>
 {
-    return historyManager_->getHistory();
+    return historyManager_ ? historyManager_->getHistory() : std::vector<std::string>{};
 }
 
 auto XUserInput::PImpl::getTaskCount() const -> size_t
@@ -629,6 +1029,16 @@ auto XUserInput::PImpl::showHelp() const -> void
             std::cout << "  list     - 列出所有任务\n";
         else if (cmd == "stats")
             std::cout << "  stats    - 显示任务统计信息\n";
+        else if (cmd == "script")
+            std::cout << "  script   - 批量执行脚本: script <文件> [--jobs N]\n";
+        else if (cmd == "jobs")
+            std::cout << "  jobs     - 列出后台作业（任务命令以 & 结尾即在后台运行）\n";
+        else if (cmd == "fg")
+            std::cout << "  fg       - 等待后台作业结束: fg [编号]\n";
+        else if (cmd == "kill")
+            std::cout << "  kill     - 终止后台作业: kill <编号>\n";
+        else if (cmd == "wait")
+            std::cout << "  wait     - 等待全部后台作业结束\n";
     }
 
     std::cout << "\n示例:\n"
@@ -666,7 +1076,9 @@ auto XUserInput::PImpl::showHelp() const -> void
 
 auto XUserInput::PImpl::getPrompt() const -> std::string
 {
-    return std::string(config_.prompt);
+    /// 有后台作业时在提示符上方显示一行状态
+    const auto status = background_ ? background_->statusLine() : std::string();
+    return status.empty() ? std::string(config_.prompt) : status + "\n" + std::string(config_.prompt);
 }
 
 auto XUserInput::PImpl::shouldUseREPL() const -> bool
@@ -718,6 +1130,11 @@ auto XUserInput::stop() -> void
     impl_->stop();
 }
 
+auto XUserInput::execute(const std::vector<std::string>& args) -> int
+{
+    return impl_->execute(args);
+}
+
 auto XUserInput::registerTask(const std::string_view& name, const TaskFunc& func, const std::string_view& description)
         -> XTask&
 {
@@ -1,8 +1,13 @@
-#include "ConvertCommandBuilder.h"
+﻿#include "ConvertCommandBuilder.h"
 #include "CutCommandBuilder.h"
 #include "AnalyzeCommandBuilder.h"
 #include "DecryptCommandBuilder.h"
 #include "EncryptCommandBuilder.h"
+#include "IndexCommandBuilder.h"
+#include "CopyCommandBuilder.h"
+#include "ThumbsCommandBuilder.h"
+#include "ConcatCommandBuilder.h"
+#include "PackageCommandBuilder.h"
 
 #include "CVProgressBar.h"
 #include "CutProgressBar.h"
@@ -11,25 +16,25 @@
 
 #include "AVTask.h"
 #include "XUserInput.h"
+#include "MediaCatalog.h"
+#include "XBenchmark.h"
+#include "ProgressDashboard.h"
+#include "JobServer.h"
+#include "JobTelemetry.h"
+#include "Metrics.h"
+#include "MetricsExporter.h"
+#include "WatchService.h"
 
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
 
-int main(int argc, char* argv[])
+/// 示例1：支持类型的copy任务
+static auto registerCopyTask(XUserInput& user_input) -> void
 {
-    setlocale(LC_ALL, "zh_CN.UTF-8");
-
-    XUserInput user_input;
-
-    /// 设置事件回调
-    user_input.setOnCommandStart([](const std::string_view& cmd) { std::cout << "开始执行命令: " << cmd << "\n"; });
-    user_input.setOnCommandComplete([](const std::string_view& cmd) { std::cout << "命令执行完成\n"; });
-    user_input.setOnError([](const std::string_view& error) { std::cerr << "执行出错: " << error << "\n"; });
-
-    user_input.getTaskManager().registerType<AVTask, CVProgressBar>("av", "音视频处理任务");
-
-    /// 示例1：支持类型的copy任务
     user_input
-            .registerTask(
+            .registerTask<CopyCommandBuilder>(
                     "copy",
                     [](const std::map<std::string, XUserInput::ParameterValue>& params, const std::string& msg)
                     {
@@ -37,10 +42,10 @@ int main(int argc, char* argv[])
                         auto src = params.at("-s").asString();
                         auto dst = params.at("-d").asString();
                         std::cout << "  从 " << src << " 复制到 " << dst << std::endl;
-                        /// 实际复制逻辑
+                        std::cout << msg << std::endl;
                     },
-                    "复制文件")
-            .addFileParam("-s", "源文件路径", true,
+                    "复制文件或目录（同一文件系统用引用链接，否则由内核直接复制，多文件并行）")
+            .addFileParam("-s", "源文件或目录路径", true,
                           [](std::string_view partial) -> std::vector<std::string>
                           {
                               /// 如果看起来像路径，返回空，让路径补全处理
@@ -60,9 +65,71 @@ int main(int argc, char* argv[])
                                   return {};
                               }
                               return { "backup/", "output/", "dest/" };
+                          })
+            .addIntParam("--jobs", "并行复制的文件数(默认按CPU核数，最多8)", false,
+                         [](std::string_view partial) -> std::vector<std::string>
+                         {
+                             static const std::vector<std::string> values = { "1", "2", "4", "8", "16" };
+                             std::vector<std::string>              suggestions;
+                             for (const auto& value : values)
+                             {
+                                 if (value.starts_with(partial))
+                                 {
+                                     suggestions.push_back(value);
+                                 }
+                             }
+                             return suggestions;
+                         })
+            .addBoolParam("--overwrite", "覆盖已存在的目标文件", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              static const std::vector<std::string> boolValues = { "true", "false", "1",
+                                                                                   "0",    "yes",   "no" };
+                              std::vector<std::string>              suggestions;
+                              for (const auto& value : boolValues)
+                              {
+                                  if (value.starts_with(partial))
+                                  {
+                                      suggestions.push_back(value);
+                                  }
+                              }
+                              return suggestions;
+                          })
+            .addBoolParam("--reflink", "同一文件系统时使用引用链接(默认 true)", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              static const std::vector<std::string> boolValues = { "true", "false", "1",
+                                                                                   "0",    "yes",   "no" };
+                              std::vector<std::string>              suggestions;
+                              for (const auto& value : boolValues)
+                              {
+                                  if (value.starts_with(partial))
+                                  {
+                                      suggestions.push_back(value);
+                                  }
+                              }
+                              return suggestions;
+                          })
+            .addBoolParam("--preallocate", "预分配目标文件空间(默认 true)", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              static const std::vector<std::string> boolValues = { "true", "false", "1",
+                                                                                   "0",    "yes",   "no" };
+                              std::vector<std::string>              suggestions;
+                              for (const auto& value : boolValues)
+                              {
+                                  if (value.starts_with(partial))
+                                  {
+                                      suggestions.push_back(value);
+                                  }
+                              }
+                              return suggestions;
                           });
+}
 
-    /// 示例2：数学计算任务（演示数值类型）
+/// 示例2：数学计算任务（演示数值类型）
+static auto registerCalculateTask(XUserInput& user_input) -> void
+{
     user_input
             .registerTask(
                     "calculate",
@@ -128,8 +195,11 @@ int main(int argc, char* argv[])
                               }
                               return suggestions;
                           });
+}
 
-    /// 示例3：服务器启动任务（演示多种类型）
+/// 示例3：服务器启动任务（演示多种类型）
+static auto registerStartTask(XUserInput& user_input) -> void
+{
     user_input
             .registerTask(
                     "start",
@@ -213,8 +283,11 @@ int main(int argc, char* argv[])
                                 }
                                 return suggestions;
                             });
+}
 
-    /// 示例4：回显任务（保持简单）
+/// 示例4：回显任务（保持简单）
+static auto registerEchoTask(XUserInput& user_input) -> void
+{
     user_input
             .registerTask(
                     "echo",
@@ -246,8 +319,11 @@ int main(int argc, char* argv[])
                                 }
                                 return suggestions;
                             });
+}
 
-    /// 示例5：视频转码任务
+/// 示例5：视频转码任务
+static auto registerConvertTask(XUserInput& user_input) -> void
+{
     user_input
             .registerTask<ConvertCommandBuilder>(
                     "cv", "av",
@@ -301,8 +377,101 @@ int main(int argc, char* argv[])
                                   }
                               }
                               return suggestions;
-                          });
+                          })
+            .addStringParam("--preset", "编码预设 (auto 为试编码后自动选择)", false,
+                            [](std::string_view partial) -> std::vector<std::string>
+                            {
+                                static const std::vector<std::string> values = { "auto",     "ultrafast", "superfast",
+                                                                                 "veryfast", "faster",    "fast",
+                                                                                 "medium",   "slow",      "slower",
+                                                                                 "veryslow" };
+                                std::vector<std::string>              suggestions;
+                                for (const auto& value : values)
+                                {
+                                    if (value.starts_with(partial))
+                                    {
+                                        suggestions.push_back(value);
+                                    }
+                                }
+                                return suggestions;
+                            })
+            .addStringParam("--crf", "质量因子 (auto 为在 20/23/26 中自动选择)", false,
+                            [](std::string_view partial) -> std::vector<std::string>
+                            {
+                                static const std::vector<std::string> values = { "auto", "18", "20", "23", "26", "28" };
+                                std::vector<std::string>              suggestions;
+                                for (const auto& value : values)
+                                {
+                                    if (value.starts_with(partial))
+                                    {
+                                        suggestions.push_back(value);
+                                    }
+                                }
+                                return suggestions;
+                            })
+            .addDoubleParam("--target-speed", "自动预设的目标速度倍数 (默认 1.0)", false,
+                            [](std::string_view partial) -> std::vector<std::string>
+                            {
+                                static const std::vector<std::string> values = { "0.5", "1.0", "2.0", "4.0" };
+                                std::vector<std::string>              suggestions;
+                                for (const auto& value : values)
+                                {
+                                    if (value.starts_with(partial))
+                                    {
+                                        suggestions.push_back(value);
+                                    }
+                                }
+                                return suggestions;
+                            })
+            .addStringParam("--deadline", "自动预设的完成期限 (秒/90m/1.5h/HH:MM:SS)", false,
+                            [](std::string_view partial) -> std::vector<std::string>
+                            {
+                                static const std::vector<std::string> values = { "600", "30m", "1h", "01:30:00" };
+                                std::vector<std::string>              suggestions;
+                                for (const auto& value : values)
+                                {
+                                    if (value.starts_with(partial))
+                                    {
+                                        suggestions.push_back(value);
+                                    }
+                                }
+                                return suggestions;
+                            })
+            .addBoolParam("--remux", "源流已满足目标时改为流复制 (默认 true)", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              static const std::vector<std::string> boolValues = { "true", "false", "1",
+                                                                                   "0",    "yes",   "no" };
+                              std::vector<std::string>              suggestions;
+                              for (const auto& value : boolValues)
+                              {
+                                  if (value.starts_with(partial))
+                                  {
+                                      suggestions.push_back(value);
+                                  }
+                              }
+                              return suggestions;
+                          })
+            .addBoolParam("--fragmented", "分片MP4输出，编码中即可读取已完成片段 (替代 --faststart)", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              static const std::vector<std::string> boolValues = { "true", "false", "1",
+                                                                                   "0",    "yes",   "no" };
+                              std::vector<std::string>              suggestions;
+                              for (const auto& value : boolValues)
+                              {
+                                  if (value.starts_with(partial))
+                                  {
+                                      suggestions.push_back(value);
+                                  }
+                              }
+                              return suggestions;
+                          })
+            .addDoubleParam("--frag-duration", "分片时长(秒，默认每个关键帧一个分片)", false);
+}
 
+static auto registerCutTask(XUserInput& user_input) -> void
+{
     user_input
             .registerTask<CutCommandBuilder, CutProgressBar>(
                     "cut", "av",
@@ -481,9 +650,43 @@ int main(int argc, char* argv[])
                                   }
                               }
                               return suggestions;
-                          });
+                          })
+            .addStringParam("--preset", "重新编码预设 (auto 为在剪切区间试编码后自动选择)", false,
+                            [](std::string_view partial) -> std::vector<std::string>
+                            {
+                                static const std::vector<std::string> values = { "auto",     "ultrafast", "superfast",
+                                                                                 "veryfast", "faster",    "fast",
+                                                                                 "medium",   "slow",      "slower",
+                                                                                 "veryslow" };
+                                std::vector<std::string>              suggestions;
+                                for (const auto& value : values)
+                                {
+                                    if (value.starts_with(partial))
+                                    {
+                                        suggestions.push_back(value);
+                                    }
+                                }
+                                return suggestions;
+                            })
+            .addStringParam("--crf", "重新编码质量因子 (auto 为自动选择)", false,
+                            [](std::string_view partial) -> std::vector<std::string>
+                            {
+                                static const std::vector<std::string> values = { "auto", "18", "20", "23", "26", "28" };
+                                std::vector<std::string>              suggestions;
+                                for (const auto& value : values)
+                                {
+                                    if (value.starts_with(partial))
+                                    {
+                                        suggestions.push_back(value);
+                                    }
+                                }
+                                return suggestions;
+                            });
+}
 
-    /// 示例6：分析视频信息任务
+/// 示例6：分析视频信息任务
+static auto registerAnalyzeTask(XUserInput& user_input) -> void
+{
     user_input
             .registerTask<AnalyzeCommandBuilder>(
                     "analyze", "av",
@@ -665,9 +868,68 @@ int main(int argc, char* argv[])
                                   }
                               }
                               return suggestions;
-                          });
+                          })
+            .addBoolParam("--cached", "使用探测缓存输出摘要（不重复调用ffprobe）", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              static const std::vector<std::string> boolValues = { "true", "false", "1",  "0",
+                                                                                   "yes",  "no",    "on", "off" };
+                              std::vector<std::string>              suggestions;
+                              for (const auto& value : boolValues)
+                              {
+                                  if (value.starts_with(partial))
+                                  {
+                                      suggestions.push_back(value);
+                                  }
+                              }
+                              return suggestions;
+                          })
+            .addBoolParam("--keyframes", "摘要中包含关键帧索引（结果缓存）", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              static const std::vector<std::string> boolValues = { "true", "false", "1",  "0",
+                                                                                   "yes",  "no",    "on", "off" };
+                              std::vector<std::string>              suggestions;
+                              for (const auto& value : boolValues)
+                              {
+                                  if (value.starts_with(partial))
+                                  {
+                                      suggestions.push_back(value);
+                                  }
+                              }
+                              return suggestions;
+                          })
+            .addBoolParam("--frame-stats", "流式帧级统计（码率/GOP/帧类型/帧大小分位数）", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              static const std::vector<std::string> boolValues = { "true", "false", "1",  "0",
+                                                                                   "yes",  "no",    "on", "off" };
+                              std::vector<std::string>              suggestions;
+                              for (const auto& value : boolValues)
+                              {
+                                  if (value.starts_with(partial))
+                                  {
+                                      suggestions.push_back(value);
+                                  }
+                              }
+                              return suggestions;
+                          })
+            .addStringParam("--frame-table", "输出二进制帧表文件(可选)", false,
+                            [](std::string_view partial) -> std::vector<std::string>
+                            {
+                                /// 如果是路径，返回空让路径补全处理
+                                if (partial.find('/') != std::string::npos || partial.find('\\') != std::string::npos ||
+                                    partial.find('.') != std::string::npos)
+                                {
+                                    return {};
+                                }
+                                return { "frames.bin" };
+                            });
+}
 
-    /// 示例7：视频加密任务
+/// 示例7：视频加密任务
+static auto registerEncryptTask(XUserInput& user_input) -> void
+{
     user_input
             .registerTask<EncryptCommandBuilder, EncryptProgressBar>(
                     "encrypt", "av",
@@ -888,11 +1150,40 @@ int main(int argc, char* argv[])
                                     }
                                 }
                                 return suggestions;
-                            });
-
+                            })
+            .addIntParam("--threads", "原生AES加密线程数(默认CPU核数)", false,
+                         [](std::string_view partial) -> std::vector<std::string>
+                         {
+                             static const std::vector<std::string> values = { "1", "2", "4", "8", "16" };
+                             std::vector<std::string>              suggestions;
+                             for (const auto& value : values)
+                             {
+                                 if (value.starts_with(partial))
+                                 {
+                                     suggestions.push_back(value);
+                                 }
+                             }
+                             return suggestions;
+                         })
+            .addFileParam("--keystore", "密钥库文件(可选，单文件保存所有资源密钥)", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              /// 如果是路径，返回空让路径补全处理
+                              if (partial.find('/') != std::string::npos || partial.find('\\') != std::string::npos ||
+                                  partial.find('.') != std::string::npos)
+                              {
+                                  return {};
+                              }
+                              return { "keys.xks", "keystore.xks" };
+                          })
+            .addStringParam("--master-key", "主密钥(十六进制，不带值时读环境变量XVE_MASTER_KEY)", false)
+            .addStringParam("--asset-id", "资源ID(默认为输出文件的绝对路径)", false);
+}
 
-    /// 示例8：视频解密任务
-    /// 示例8：视频解密任务 - 更新为支持播放功能
+/// 示例8：视频解密任务
+/// 示例8：视频解密任务 - 更新为支持播放功能
+static auto registerDecryptTask(XUserInput& user_input) -> void
+{
     user_input
             .registerTask<DecryptCommandBuilder, DecryptProgressBar>(
                     "decrypt", "av",
@@ -934,10 +1225,15 @@ int main(int argc, char* argv[])
                         if (play_enabled)
                         {
                             bool play_only = params.contains("--play-only") && params.at("--play-only").asBool();
+                            bool stream    = params.contains("--stream") && params.at("--stream").asBool();
                             if (play_only)
                             {
                                 std::cout << "  播放模式: 使用ffplay直接播放（不保存文件）" << std::endl;
                             }
+                            else if (stream)
+                            {
+                                std::cout << "  播放模式: 边解密边播放（管道传输，不写临时文件）" << std::endl;
+                            }
                             else
                             {
                                 std::cout << "  播放模式: 解密后使用ffplay播放" << std::endl;
@@ -1241,8 +1537,398 @@ int main(int argc, char* argv[])
                                   }
                               }
                               return suggestions;
-                          });
-
+                          })
+            .addIntParam("--threads", "原生AES解密线程数(默认CPU核数)", false,
+                         [](std::string_view partial) -> std::vector<std::string>
+                         {
+                             static const std::vector<std::string> values = { "1", "2", "4", "8", "16" };
+                             std::vector<std::string>              suggestions;
+                             for (const auto& value : values)
+                             {
+                                 if (value.starts_with(partial))
+                                 {
+                                     suggestions.push_back(value);
+                                 }
+                             }
+                             return suggestions;
+                         })
+            .addFileParam("--keystore", "密钥库文件(按资源ID或--kid查找密钥)", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              /// 如果是路径，返回空让路径补全处理
+                              if (partial.find('/') != std::string::npos || partial.find('\\') != std::string::npos ||
+                                  partial.find('.') != std::string::npos)
+                              {
+                                  return {};
+                              }
+                              return { "keys.xks", "keystore.xks" };
+                          })
+            .addStringParam("--master-key", "主密钥(十六进制，不带值时读环境变量XVE_MASTER_KEY)", false)
+            .addStringParam("--asset-id", "资源ID(默认为输入文件的绝对路径)", false)
+            .addBoolParam("--stream", "边解密边播放(ffmpeg管道直送ffplay，不写临时文件)", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              static const std::vector<std::string> boolValues = { "true", "false", "1",  "0",
+                                                                                   "yes",  "no",    "on", "off" };
+                              std::vector<std::string>              suggestions;
+                              for (const auto& value : boolValues)
+                              {
+                                  if (value.starts_with(partial))
+                                  {
+                                      suggestions.push_back(value);
+                                  }
+                              }
+                              return suggestions;
+                          })
+            .addStringParam("--stream-format", "流式播放封装格式(ts/fmp4，默认ts)", false,
+                            [](std::string_view partial) -> std::vector<std::string>
+                            {
+                                static const std::vector<std::string> values = { "ts", "fmp4" };
+                                std::vector<std::string>              suggestions;
+                                for (const auto& value : values)
+                                {
+                                    if (value.starts_with(partial))
+                                    {
+                                        suggestions.push_back(value);
+                                    }
+                                }
+                                return suggestions;
+                            });
+}
+
+/// 示例9：媒体库索引任务
+static auto registerIndexTask(XUserInput& user_input) -> void
+{
+    user_input
+            .registerTask<IndexCommandBuilder>(
+                    "index",
+                    [](const std::map<std::string, XUserInput::ParameterValue>& params, const std::string& msg)
+                    {
+                        std::cout << "[媒体库索引操作]" << std::endl;
+                        std::cout << "  扫描目录: " << params.at("--dir").asString() << std::endl;
+                        std::cout << msg << std::endl;
+                    },
+                    "并行探测目录下的媒体文件并生成列式目录（配合 query 命令查询）")
+            .addDirectoryParam("--dir", "要索引的目录", true)
+            .addFileParam("--output", "目录文件路径(默认 media.xcat)", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              /// 如果是路径，返回空让路径补全处理
+                              if (partial.find('/') != std::string::npos || partial.find('\\') != std::string::npos ||
+                                  partial.find('.') != std::string::npos)
+                              {
+                                  return {};
+                              }
+                              return { "media.xcat", "library.xcat" };
+                          })
+            .addIntParam("--jobs", "并行探测数(默认CPU核数)", false,
+                         [](std::string_view partial) -> std::vector<std::string>
+                         {
+                             static const std::vector<std::string> values = { "2", "4", "8", "16", "32" };
+                             std::vector<std::string>              suggestions;
+                             for (const auto& value : values)
+                             {
+                                 if (value.starts_with(partial))
+                                 {
+                                     suggestions.push_back(value);
+                                 }
+                             }
+                             return suggestions;
+                         })
+            .addBoolParam("--all", "索引所有文件(不按扩展名过滤)", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              static const std::vector<std::string> boolValues = { "true", "false", "1",  "0",
+                                                                                   "yes",  "no",    "on", "off" };
+                              std::vector<std::string>              suggestions;
+                              for (const auto& value : boolValues)
+                              {
+                                  if (value.starts_with(partial))
+                                  {
+                                      suggestions.push_back(value);
+                                  }
+                              }
+                              return suggestions;
+                          });
+}
+
+/// 示例10：缩略图/雪碧图任务
+static auto registerThumbsTask(XUserInput& user_input) -> void
+{
+    user_input
+            .registerTask<ThumbsCommandBuilder>(
+                    "thumbs",
+                    [](const std::map<std::string, XUserInput::ParameterValue>& params, const std::string& msg)
+                    {
+                        std::cout << "[缩略图操作]" << std::endl;
+                        std::cout << "  输入: " << params.at("--input").asString() << std::endl;
+                        std::cout << msg << std::endl;
+                    },
+                    "按时间点并行提取关键帧缩略图，拼成雪碧图并生成 WebVTT 索引")
+            .addFileParam("--input", "源文件路径", true)
+            .addDirectoryParam("--output", "输出目录(默认 <输入名>_thumbs)", false)
+            .addDoubleParam("--interval", "缩略图间隔(秒，默认 10)", false,
+                            [](std::string_view partial) -> std::vector<std::string>
+                            {
+                                static const std::vector<std::string> values = { "1", "2", "5", "10", "30" };
+                                std::vector<std::string>              suggestions;
+                                for (const auto& value : values)
+                                {
+                                    if (value.starts_with(partial))
+                                    {
+                                        suggestions.push_back(value);
+                                    }
+                                }
+                                return suggestions;
+                            })
+            .addIntParam("--count", "缩略图数量(指定时覆盖 --interval)", false,
+                         [](std::string_view partial) -> std::vector<std::string>
+                         {
+                             static const std::vector<std::string> values = { "50", "100", "200" };
+                             std::vector<std::string>              suggestions;
+                             for (const auto& value : values)
+                             {
+                                 if (value.starts_with(partial))
+                                 {
+                                     suggestions.push_back(value);
+                                 }
+                             }
+                             return suggestions;
+                         })
+            .addIntParam("--width", "缩略图宽度(默认 160)", false,
+                         [](std::string_view partial) -> std::vector<std::string>
+                         {
+                             static const std::vector<std::string> values = { "120", "160", "240", "320" };
+                             std::vector<std::string>              suggestions;
+                             for (const auto& value : values)
+                             {
+                                 if (value.starts_with(partial))
+                                 {
+                                     suggestions.push_back(value);
+                                 }
+                             }
+                             return suggestions;
+                         })
+            .addIntParam("--columns", "雪碧图列数(默认 10)", false,
+                         [](std::string_view partial) -> std::vector<std::string>
+                         {
+                             static const std::vector<std::string> values = { "5", "10" };
+                             std::vector<std::string>              suggestions;
+                             for (const auto& value : values)
+                             {
+                                 if (value.starts_with(partial))
+                                 {
+                                     suggestions.push_back(value);
+                                 }
+                             }
+                             return suggestions;
+                         })
+            .addIntParam("--rows", "雪碧图行数(默认 10)", false,
+                         [](std::string_view partial) -> std::vector<std::string>
+                         {
+                             static const std::vector<std::string> values = { "5", "10" };
+                             std::vector<std::string>              suggestions;
+                             for (const auto& value : values)
+                             {
+                                 if (value.starts_with(partial))
+                                 {
+                                     suggestions.push_back(value);
+                                 }
+                             }
+                             return suggestions;
+                         })
+            .addIntParam("--jobs", "并行 ffmpeg 进程数(默认按CPU核数，最多8)", false,
+                         [](std::string_view partial) -> std::vector<std::string>
+                         {
+                             static const std::vector<std::string> values = { "2", "4", "8" };
+                             std::vector<std::string>              suggestions;
+                             for (const auto& value : values)
+                             {
+                                 if (value.starts_with(partial))
+                                 {
+                                     suggestions.push_back(value);
+                                 }
+                             }
+                             return suggestions;
+                         })
+            .addBoolParam("--accurate", "精确定位到时间点(需逐帧解码，较慢)", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              static const std::vector<std::string> boolValues = { "true", "false", "1",
+                                                                                   "0",    "yes",   "no" };
+                              std::vector<std::string>              suggestions;
+                              for (const auto& value : boolValues)
+                              {
+                                  if (value.starts_with(partial))
+                                  {
+                                      suggestions.push_back(value);
+                                  }
+                              }
+                              return suggestions;
+                          });
+}
+
+/// 示例11：无损拼接任务
+static auto registerConcatTask(XUserInput& user_input) -> void
+{
+    user_input
+            .registerTask<ConcatCommandBuilder>(
+                    "concat",
+                    [](const std::map<std::string, XUserInput::ParameterValue>& params, const std::string& msg)
+                    {
+                        std::cout << "[拼接操作]" << std::endl;
+                        std::cout << msg << std::endl;
+                    },
+                    "流复制拼接多个片段（只重新编码参数不一致的片段）")
+            .addStringParam("--inputs", "输入片段，逗号分隔（按顺序拼接）", false)
+            .addFileParam("--list", "片段列表文件（每行一个路径，# 开头为注释）", false)
+            .addDirectoryParam("--dir", "拼接目录下所有视频文件（按文件名排序）", false)
+            .addFileParam("--output", "输出文件路径", true,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              /// 如果是路径，返回空让路径补全处理
+                              if (partial.find('/') != std::string::npos || partial.find('\\') != std::string::npos ||
+                                  partial.find('.') != std::string::npos)
+                              {
+                                  return {};
+                              }
+                              return { "joined.mp4", "joined.mkv" };
+                          })
+            .addIntParam("--jobs", "并行重新编码数(默认按CPU核数，最多4)", false,
+                         [](std::string_view partial) -> std::vector<std::string>
+                         {
+                             static const std::vector<std::string> values = { "1", "2", "4", "8" };
+                             std::vector<std::string>              suggestions;
+                             for (const auto& value : values)
+                             {
+                                 if (value.starts_with(partial))
+                                 {
+                                     suggestions.push_back(value);
+                                 }
+                             }
+                             return suggestions;
+                         })
+            .addBoolParam("--faststart", "MP4快速启动(moov 前置)", false,
+                          [](std::string_view partial) -> std::vector<std::string>
+                          {
+                              static const std::vector<std::string> boolValues = { "true", "false", "1",
+                                                                                   "0",    "yes",   "no" };
+                              std::vector<std::string>              suggestions;
+                              for (const auto& value : boolValues)
+                              {
+                                  if (value.starts_with(partial))
+                                  {
+                                      suggestions.push_back(value);
+                                  }
+                              }
+                              return suggestions;
+                          });
+}
+
+/// 示例12：HLS/DASH 打包任务
+static auto registerPackageTask(XUserInput& user_input) -> void
+{
+    user_input
+            .registerTask<PackageCommandBuilder>(
+                    "package", "av",
+                    [](const std::map<std::string, XUserInput::ParameterValue>& params, const std::string& msg)
+                    {
+                        std::cout << "[打包操作]" << std::endl;
+                        std::string errorMsg;
+                        if (!PackageCommandBuilder::create()->annotateManifest(params, errorMsg))
+                        {
+                            std::cerr << "  写入加密信令失败: " << errorMsg << std::endl;
+                        }
+
+                        const auto dir    = fs::path(params.at("--output").asString());
+                        const auto format = params.contains("--format") ? params.at("--format").asString() : "hls";
+                        if (format != "dash")
+                        {
+                            std::cout << "  HLS: " << (dir / "master.m3u8").string() << std::endl;
+                        }
+                        if (format != "hls")
+                        {
+                            std::cout << "  DASH: " << (dir / "manifest.mpd").string() << std::endl;
+                        }
+                    },
+                    "一次封装输出 fMP4 HLS/DASH 切片（可多码率，可同时 CENC 加密）")
+            .addFileParam("--input", "源视频文件路径", true)
+            .addDirectoryParam("--output", "输出目录", true)
+            .addStringParam("--format", "打包格式(hls/dash/both，默认hls)", false,
+                            [](std::string_view partial) -> std::vector<std::string>
+                            {
+                                static const std::vector<std::string> formats = { "hls", "dash", "both" };
+                                std::vector<std::string>              suggestions;
+                                for (const auto& format : formats)
+                                {
+                                    if (format.starts_with(partial))
+                                    {
+                                        suggestions.push_back(format);
+                                    }
+                                }
+                                return suggestions;
+                            })
+            .addDoubleParam("--segment", "切片时长(秒，默认6)", false)
+            .addStringParam("--renditions", "码率档位(如 1080:5000k,720:2800k,480；默认流复制单一码率)", false,
+                            [](std::string_view partial) -> std::vector<std::string>
+                            {
+                                static const std::vector<std::string> ladders = { "1080:5000k,720:2800k,480:1400k",
+                                                                                  "720:2800k,480:1400k,360:800k" };
+                                std::vector<std::string>              suggestions;
+                                for (const auto& ladder : ladders)
+                                {
+                                    if (ladder.starts_with(partial))
+                                    {
+                                        suggestions.push_back(ladder);
+                                    }
+                                }
+                                return suggestions;
+                            })
+            .addBoolParam("--encrypt", "CENC 加密(cenc-aes-ctr)", false)
+            .addStringParam("--key", "加密密钥(32位十六进制，需同时指定--kid)", false)
+            .addStringParam("--kid", "Key ID(32位十六进制)", false)
+            .addFileParam("--keystore", "密钥库文件(没有记录时生成随机密钥并写入)", false)
+            .addStringParam("--master-key", "主密钥(十六进制，不带值时读环境变量XVE_MASTER_KEY)", false)
+            .addStringParam("--asset-id", "资源ID(默认为输出目录的绝对路径)", false);
+}
+
+/// 任务名 → 注册函数：任务按名称延迟注册，单次执行只构建用到的那一个
+static const std::pair<std::string_view, void (*)(XUserInput&)> TASK_REGISTRARS[] = {
+    { "copy", registerCopyTask },
+    { "calculate", registerCalculateTask },
+    { "start", registerStartTask },
+    { "echo", registerEchoTask },
+    { "cv", registerConvertTask },
+    { "cut", registerCutTask },
+    { "analyze", registerAnalyzeTask },
+    { "encrypt", registerEncryptTask },
+    { "decrypt", registerDecryptTask },
+    { "index", registerIndexTask },
+    { "thumbs", registerThumbsTask },
+    { "concat", registerConcatTask },
+    { "package", registerPackageTask },
+};
+
+int main(int argc, char* argv[])
+{
+    const auto startupBegin = std::chrono::steady_clock::now();
+
+    setlocale(LC_ALL, "zh_CN.UTF-8");
+
+    XUserInput user_input;
+
+    /// 设置事件回调
+    user_input.setOnCommandStart([](const std::string_view& cmd) { std::cout << "开始执行命令: " << cmd << "\n"; });
+    user_input.setOnCommandComplete([](const std::string_view& cmd) { std::cout << "命令执行完成\n"; });
+    user_input.setOnError([](const std::string_view& error) { std::cerr << "执行出错: " << error << "\n"; });
+
+    /// REPL 在列表、补全需要时才注册全部任务
+    auto& taskManager = user_input.getTaskManager();
+    taskManager.registerType<AVTask, CVProgressBar>("av", "音视频处理任务");
+    for (const auto& [name, registrar] : TASK_REGISTRARS)
+    {
+        taskManager.registerTaskLoader(name, [&user_input, registrar] { registrar(user_input); });
+    }
 
     /// 注册自定义命令
     user_input.registerCommandHandler("hello",
@@ -1252,15 +1938,334 @@ int main(int argc, char* argv[])
                                           std::cout << "Hello, " << name << "!\n";
                                       });
 
-    user_input.registerCommandHandler("stats",
-                                      [&user_input](const CommandParser::ParsedCommand&)
+    /// stats [--task 名称] [--csv 文件] [--interval 秒] [--clear]
+    /// 除会话信息外，按 任务/编码器/预设/分辨率 对比历史运行的中位速度；
+    /// --interval 只改本会话的采样间隔，启动时的默认值取 XVE_TELEMETRY_INTERVAL
+    user_input.registerCommandHandler(
+            "stats",
+            [&user_input](const CommandParser::ParsedCommand& cmd)
+            {
+                std::cout << "=== 统计信息 ===\n";
+                std::cout << "任务数量: " << user_input.getTaskCount() << "\n";
+                std::cout << "命令数量: " << user_input.getCommandCount() << "\n";
+                std::cout << "系统状态: " << user_input.getStateString() << "\n";
+
+                auto* telemetry = JobTelemetry::getInstance();
+                if (cmd.hasOption("--clear"))
+                {
+                    telemetry->clear();
+                    std::cout << "已清空任务遥测记录\n";
+                    return;
+                }
+                if (auto interval = cmd.getOption("--interval"); interval && !interval->empty())
+                {
+                    telemetry->setSampleInterval(std::stod(*interval));
+                }
+
+                std::vector<TelemetryRun> runs;
+                std::string               errorMsg;
+                if (!telemetry->loadRuns(runs, errorMsg))
+                {
+                    std::cerr << "读取遥测记录失败: " << errorMsg << "\n";
+                    return;
+                }
+                if (auto task = cmd.getOption("--task"); task && !task->empty())
+                {
+                    std::erase_if(runs, [&task](const TelemetryRun& run) { return run.task != *task; });
+                }
+
+                std::cout << "\n=== 任务吞吐（" << runs.size() << " 次运行，采样间隔 " << telemetry->sampleInterval()
+                          << " 秒）===\n";
+                std::cout << JobTelemetry::formatSummary(JobTelemetry::summarize(runs));
+
+                if (auto csv = cmd.getOption("--csv"); csv && !csv->empty())
+                {
+                    if (!JobTelemetry::exportCsv(runs, *csv, errorMsg))
+                    {
+                        std::cerr << "导出失败: " << errorMsg << "\n";
+                        return;
+                    }
+                    std::cout << "时间序列已导出: " << *csv << "\n";
+                }
+            });
+
+    /// 查询 index 生成的目录文件：query <目录文件> [--where 条件] [--group-by 列] [--list N]
+    /// 条件以逗号分隔且不含空格，如 --where height>=1080,vcodec=h264,abitrate>192k
+    user_input.registerCommandHandler(
+            "query",
+            [catalog = std::make_shared<MediaCatalog>(), opened = std::string(), openedTime = fs::file_time_type()](
+                    const CommandParser::ParsedCommand& cmd) mutable
+            {
+                std::string     path = cmd.args.empty() ? "media.xcat" : cmd.args[0];
+                std::string     errorMsg;
+                std::error_code ec;
+                auto            mtime = fs::last_write_time(path, ec);
+
+                /// 目录文件未变化时复用已有映射
+                if (path != opened || mtime != openedTime)
+                {
+                    if (!catalog->open(path, errorMsg))
+                    {
+                        std::cerr << "打开目录失败: " << errorMsg << "\n";
+                        opened.clear();
+                        return;
+                    }
+                    opened     = path;
+                    openedTime = mtime;
+                }
+
+                MediaCatalog::QueryOptions options;
+                options.where   = cmd.getOption("--where").value_or("");
+                options.groupBy = cmd.getOption("--group-by").value_or("");
+                if (auto list = cmd.getOption("--list"))
+                {
+                    options.limit = list->empty() ? 20 : std::stoul(*list);
+                }
+
+                MediaCatalog::QueryResult result;
+                if (!catalog->query(options, result, errorMsg))
+                {
+                    std::cerr << "查询失败: " << errorMsg << "\n";
+                    return;
+                }
+                std::cout << MediaCatalog::formatResult(result, options);
+            });
+
+    /// 多任务进度面板：dashboard [on|off]
+    user_input.registerCommandHandler("dashboard",
+                                      [](const CommandParser::ParsedCommand& cmd)
+                                      {
+                                          auto* dashboard = ProgressDashboard::getInstance();
+                                          if (!cmd.args.empty())
+                                          {
+                                              dashboard->setEnabled(cmd.args[0] == "on");
+                                          }
+                                          std::cout << "多任务面板: " << (dashboard->isEnabled() ? "开启" : "关闭")
+                                                    << "\n";
+                                      });
+
+    /// 监视目录：watch <配置.json> | watch <目录> --task 任务 [--output-dir 目录] [--ext .mp4,.mov]
+    /// 公共选项 [--jobs N] [--stable 秒] [--prefetch 预读文件数]；新文件写完后自动执行任务，按 Ctrl+C 停止
+    user_input.registerCommandHandler(
+            "watch",
+            [&user_input](const CommandParser::ParsedCommand& cmd)
+            {
+                if (cmd.args.empty())
+                {
+                    std::cerr << "用法: watch <配置.json> | watch <目录> --task 任务 [--output-dir 目录] "
+                                 "[--ext 扩展名] [--jobs N] [--stable 秒]\n";
+                    return;
+                }
+
+                WatchService::Config config;
+                std::string          errorMsg;
+                std::error_code      ec;
+                if (fs::is_directory(cmd.args[0], ec))
+                {
+                    auto task = cmd.getOption("--task");
+                    if (!task || task->empty())
+                    {
+                        std::cerr << "监视单个目录时需要指定 --task\n";
+                        return;
+                    }
+
+                    WatchService::Folder folder;
+                    folder.path = cmd.args[0];
+
+                    /// 默认输出到监视目录下的 done 子目录（子目录不在监视范围内）
+                    const fs::path outputDir = cmd.getOption("--output-dir").value_or(folder.path + "/done");
+                    fs::create_directories(outputDir, ec);
+
+                    std::stringstream extensions(cmd.getOption("--ext").value_or(""));
+                    for (std::string ext; std::getline(extensions, ext, ',');)
+                    {
+                        if (!ext.empty())
+                        {
+                            folder.extensions.push_back(ext[0] == '.' ? ext : "." + ext);
+                        }
+                    }
+                    folder.pipeline.push_back(
+                            { *task, { { "--input", "{input}" }, { "--output", (outputDir / "{name}").string() } } });
+                    config.folders.push_back(std::move(folder));
+                }
+                else if (!WatchService::loadConfig(cmd.args[0], config, errorMsg))
+                {
+                    std::cerr << "读取监视配置失败: " << errorMsg << "\n";
+                    return;
+                }
+
+                if (auto jobs = cmd.getOption("--jobs"); jobs && !jobs->empty())
+                {
+                    config.jobs = std::stoul(*jobs);
+                }
+                if (auto stable = cmd.getOption("--stable"); stable && !stable->empty())
+                {
+                    config.stableSeconds = std::stod(*stable);
+                }
+                if (auto prefetch = cmd.getOption("--prefetch"); prefetch && !prefetch->empty())
+                {
+                    config.prefetchFiles = std::stoul(*prefetch);
+                }
+
+                WatchService service(user_input.getTaskManager());
+                if (!service.run(config, errorMsg))
+                {
+                    std::cerr << "启动监视失败: " << errorMsg << "\n";
+                }
+            });
+
+    /// 作业服务：serve <套接字路径> [--jobs N] [--interval 毫秒]
+    /// 在 Unix 域套接字上接收按行分隔的 JSON 作业请求，进度与结果推回客户端，按 Ctrl+C 停止
+    user_input.registerCommandHandler("serve",
+                                      [&user_input](const CommandParser::ParsedCommand& cmd)
+                                      {
+                                          if (cmd.args.empty())
+                                          {
+                                              std::cerr << "用法: serve <套接字路径> [--jobs N] [--interval 毫秒]\n";
+                                              return;
+                                          }
+
+                                          JobServer::Config config;
+                                          config.socketPath = cmd.args[0];
+                                          if (auto jobs = cmd.getOption("--jobs"); jobs && !jobs->empty())
+                                          {
+                                              config.jobs = std::stoul(*jobs);
+                                          }
+                                          if (auto interval = cmd.getOption("--interval");
+                                              interval && !interval->empty())
+                                          {
+                                              config.progressIntervalMs = std::stoi(*interval);
+                                          }
+
+                                          JobServer   server(user_input.getTaskManager());
+                                          std::string errorMsg;
+                                          if (!server.run(config, errorMsg))
+                                          {
+                                              std::cerr << "启动作业服务失败: " << errorMsg << "\n";
+                                          }
+                                      });
+
+    /// 指标导出：metrics | metrics <目标> [--interval 毫秒] | metrics off
+    /// 目标为 unix:<路径>、[127.0.0.1:]<端口>（HTTP GET /metrics）或 file:<路径>（textfile collector）
+    user_input.registerCommandHandler("metrics",
+                                      [](const CommandParser::ParsedCommand& cmd)
                                       {
-                                          std::cout << "=== 统计信息 ===\n";
-                                          std::cout << "任务数量: " << user_input.getTaskCount() << "\n";
-                                          std::cout << "命令数量: " << user_input.getCommandCount() << "\n";
-                                          std::cout << "系统状态: " << user_input.getStateString() << "\n";
+                                          auto* exporter = MetricsExporter::getInstance();
+                                          if (cmd.args.empty())
+                                          {
+                                              std::cout << Metrics::getInstance()->render();
+                                              std::cout << "导出: "
+                                                        << (exporter->isRunning() ? exporter->describe() : "未启用")
+                                                        << "\n";
+                                              return;
+                                          }
+                                          if (cmd.args[0] == "off")
+                                          {
+                                              exporter->stop();
+                                              std::cout << "指标导出已停止\n";
+                                              return;
+                                          }
+
+                                          int interval = 15000;
+                                          if (auto value = cmd.getOption("--interval"); value && !value->empty())
+                                          {
+                                              interval = std::stoi(*value);
+                                          }
+                                          std::string errorMsg;
+                                          if (!exporter->start(cmd.args[0], interval, errorMsg))
+                                          {
+                                              std::cerr << "启动指标导出失败: " << errorMsg << "\n";
+                                              return;
+                                          }
+                                          std::cout << "指标导出: " << exporter->describe() << "\n";
+                                      });
+
+    /// 微基准：bench progress [--lines N] | bench dashboard [--jobs N] | bench prefetch <文件...> [--head MB]
+    ///        bench startup [--runs N]
+    user_input.registerCommandHandler("bench",
+                                      [argv0 = std::string(argv[0])](const CommandParser::ParsedCommand& cmd)
+                                      {
+                                          const std::string target = cmd.args.empty() ? "progress" : cmd.args[0];
+                                          if (target == "progress")
+                                          {
+                                              auto   lines = cmd.getOption("--lines");
+                                              size_t count = lines && !lines->empty() ? std::stoul(*lines) : 1200000;
+                                              std::cout << XBenchmark::progressParser(count);
+                                          }
+                                          else if (target == "dashboard")
+                                          {
+                                              auto   jobs  = cmd.getOption("--jobs");
+                                              size_t count = jobs && !jobs->empty() ? std::stoul(*jobs) : 64;
+                                              std::cout << XBenchmark::dashboard(count, 600);
+                                          }
+                                          else if (target == "prefetch")
+                                          {
+                                              if (cmd.args.size() < 2)
+                                              {
+                                                  std::cerr << "用法: bench prefetch <文件...> [--head MB]\n";
+                                                  return;
+                                              }
+                                              auto   head   = cmd.getOption("--head");
+                                              size_t headMB = head && !head->empty() ? std::stoul(*head) : 32;
+
+                                              std::vector<std::string> files(cmd.args.begin() + 1, cmd.args.end());
+                                              std::cout << XBenchmark::prefetch(files, headMB);
+                                          }
+                                          else if (target == "startup")
+                                          {
+                                              /// 重新启动自身；Linux 上取真实路径，其他平台用 argv[0]
+                                              std::error_code ec;
+                                              const auto      self  = fs::read_symlink("/proc/self/exe", ec);
+                                              auto            runs  = cmd.getOption("--runs");
+                                              size_t          count = runs && !runs->empty() ? std::stoul(*runs) : 50;
+                                              std::cout << XBenchmark::startup(ec ? argv0 : self.string(), count);
+                                          }
+                                          else
+                                          {
+                                              std::cerr << "未知的基准: " << target
+                                                        << "（可用: progress, dashboard, prefetch, startup）\n";
+                                          }
                                       });
 
+    /// 设置 XVE_METRICS（目标同 metrics 命令）时启动即导出，单次执行、serve、watch 同样适用；
+    /// file: 目标按 XVE_METRICS_INTERVAL 毫秒重写，退出时再写一次
+    if (const char* target = std::getenv("XVE_METRICS"); target && *target)
+    {
+        const char* interval = std::getenv("XVE_METRICS_INTERVAL");
+        std::string errorMsg;
+        if (!MetricsExporter::getInstance()->start(target, interval ? std::atoi(interval) : 15000, errorMsg))
+        {
+            std::cerr << "启动指标导出失败: " << errorMsg << "\n";
+        }
+    }
+
+    /// XVE_TELEMETRY_INTERVAL（秒）设置任务遥测的初始采样间隔，REPL、单次执行、serve、watch 一致
+    if (const char* interval = std::getenv("XVE_TELEMETRY_INTERVAL"); interval && *interval)
+    {
+        JobTelemetry::getInstance()->setSampleInterval(std::atof(interval));
+    }
+
+    /// 带参数启动时单次执行，如 XVideoEdit cv --input a.mp4 --output b.mp4：
+    /// 不初始化 REPL 与历史记录，只注册用到的任务；设置 XVE_STARTUP_TRACE 时输出进入 main 到开始分发的耗时
+    if (argc > 1)
+    {
+        if (std::getenv("XVE_STARTUP_TRACE"))
+        {
+            const auto elapsed = std::chrono::steady_clock::now() - startupBegin;
+            std::cerr << "[启动] " << std::fixed << std::setprecision(3)
+                      << std::chrono::duration<double, std::milli>(elapsed).count() << " ms，延迟注册 "
+                      << taskManager.getPendingLoaderCount() << " 个任务\n";
+        }
+
+        /// XVideoEdit --script jobs.txt --jobs 8 等价于 script jobs.txt --jobs 8
+        std::vector<std::string> args(argv + 1, argv + argc);
+        if (args[0] == "--script")
+        {
+            args[0] = "script";
+        }
+        return user_input.execute(args);
+    }
+
     user_input.start();
 
     return 0;